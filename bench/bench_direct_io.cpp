@@ -0,0 +1,191 @@
+// Page-cache footprint of the file sink, buffered against direct_io, next
+// to a co-running workload.
+//
+// A reader thread keeps scanning a working-set file (the "database")
+// while the logger writes as fast as it can. After each run the bench
+// reports the logging rate, the reader's rate, and how much of the log
+// file and of the working set is resident in the page cache (mincore()).
+// Buffered output leaves the whole log in the cache, where it competes
+// with the working set under memory pressure; direct_io keeps it out.
+//
+// Usage: coretrace_logger_bench_direct_io [log MiB] [working-set MiB] [dir]
+#include <coretrace/logger.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t MIB = 1 << 20;
+
+#if defined(__APPLE__)
+using MincoreEntry = char;
+#else
+using MincoreEntry = unsigned char;
+#endif
+
+// Bytes of path resident in the page cache.
+size_t resident_bytes(const std::string &path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return 0;
+  struct stat st;
+  size_t resident = 0;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    const size_t size = static_cast<size_t>(st.st_size);
+    void *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr != MAP_FAILED) {
+      const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+      std::vector<MincoreEntry> vec((size + page - 1) / page);
+      if (mincore(addr, size, vec.data()) == 0) {
+        for (MincoreEntry v : vec)
+          resident += (v & 1) ? page : 0;
+      }
+      munmap(addr, size);
+    }
+  }
+  close(fd);
+  return resident;
+}
+
+bool make_working_set(const std::string &path, size_t size) {
+  const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return false;
+  std::vector<char> block(MIB, 'w');
+  bool ok = true;
+  for (size_t done = 0; ok && done < size; done += block.size())
+    ok = write(fd, block.data(), block.size()) ==
+         static_cast<ssize_t>(block.size());
+  close(fd);
+  return ok;
+}
+
+// Scan the working set until stop is set (at least once). Returns bytes
+// read.
+size_t scan(const std::string &path, const std::atomic<bool> &stop) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return 0;
+  std::vector<char> block(MIB);
+  size_t total = 0;
+  off_t offset = 0;
+  for (;;) {
+    const ssize_t got = pread(fd, block.data(), block.size(), offset);
+    if (got <= 0) {
+      if (stop.load(std::memory_order_relaxed))
+        break;
+      offset = 0;
+      continue;
+    }
+    total += static_cast<size_t>(got);
+    offset += got;
+  }
+  close(fd);
+  return total;
+}
+
+struct Result {
+  double log_mib_s = 0;
+  double reader_mib_s = 0;
+  size_t log_resident = 0;
+  size_t set_resident = 0;
+  unsigned long long syscalls = 0;
+};
+
+Result run(bool direct, const std::string &log_path,
+           const std::string &set_path, size_t log_bytes) {
+  std::filesystem::remove(log_path);
+  std::atomic<bool> stop{true};
+  (void)scan(set_path, stop); // one pass brings the working set in
+  stop.store(false);
+  size_t read_bytes = 0;
+
+  coretrace::Logger logger;
+  logger.enable();
+  coretrace::FileSinkOptions opts;
+  opts.direct_io = direct;
+  opts.truncate = true;
+  if (!logger.set_file_sink(log_path, opts))
+    return {};
+
+  std::thread reader([&]() { read_bytes = scan(set_path, stop); });
+
+  const std::string payload(100, 'x');
+  const size_t line_size = payload.size() + 40; // about: prefix, seq
+  const size_t lines = log_bytes / line_size;
+
+  const Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < lines; ++i)
+    logger.log(coretrace::Level::Info, "seq={} {}\n", i, payload);
+  logger.flush();
+  const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+  stop.store(true);
+  reader.join();
+
+  const coretrace::SinkStats stats = logger.sink_stats();
+  logger.reset_sink();
+
+  Result result;
+  result.syscalls = stats.syscalls;
+  result.log_mib_s =
+      static_cast<double>(stats.bytes_written) / MIB / elapsed.count();
+  result.reader_mib_s =
+      static_cast<double>(read_bytes) / MIB / elapsed.count();
+  result.log_resident = resident_bytes(log_path);
+  result.set_resident = resident_bytes(set_path);
+  return result;
+}
+
+void print(const char *name, const Result &r, size_t set_bytes) {
+  std::printf("%-10s %10.0f %12.0f %14.1f %12.1f%% %10llu\n", name,
+              r.log_mib_s, r.reader_mib_s,
+              static_cast<double>(r.log_resident) / MIB,
+              100.0 * static_cast<double>(r.set_resident) /
+                  static_cast<double>(set_bytes),
+              r.syscalls);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const size_t log_mib = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 512;
+  const size_t set_mib = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 256;
+  const std::filesystem::path dir =
+      argc > 3 ? std::filesystem::path(argv[3])
+               : std::filesystem::temp_directory_path();
+
+  const std::string log_path = (dir / "coretrace_bench_direct.log").string();
+  const std::string set_path = (dir / "coretrace_bench_working_set").string();
+  if (!make_working_set(set_path, set_mib * MIB)) {
+    std::fprintf(stderr, "cannot create %s\n", set_path.c_str());
+    return 1;
+  }
+
+  std::printf("%zu MiB of log lines, %zu MiB working set scanned alongside\n",
+              log_mib, set_mib);
+  std::printf("%-10s %10s %12s %14s %13s %10s\n", "sink", "log MiB/s",
+              "reader MiB/s", "log cached MiB", "set cached", "syscalls");
+  print("buffered", run(false, log_path, set_path, log_mib * MIB),
+        set_mib * MIB);
+  print("direct_io", run(true, log_path, set_path, log_mib * MIB),
+        set_mib * MIB);
+
+  std::filesystem::remove(log_path);
+  std::filesystem::remove(set_path);
+  return 0;
+}
@@ -0,0 +1,77 @@
+// Throughput of the built-in file sinks against the unbuffered stderr path.
+//
+// Every variant writes the same records to a regular file: stderr is
+// redirected to it for the baseline, so the difference is one write(2) per
+// line versus large buffered appends (file sink) or a memcpy() into a
+// shared mapping (mmap sink).
+//
+// Usage: coretrace_logger_bench_file_sink [lines] [dir]
+#include <coretrace/logger.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double run(coretrace::Logger &logger, long lines) {
+  const Clock::time_point start = Clock::now();
+  for (long i = 0; i < lines; ++i)
+    logger.log(coretrace::Level::Info, "record seq={} value={}\n", i, i * 7);
+  logger.flush();
+  const std::chrono::duration<double, std::nano> elapsed =
+      Clock::now() - start;
+  return elapsed.count() / static_cast<double>(lines);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  using namespace coretrace;
+
+  const long lines = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 1000000;
+  const std::filesystem::path dir =
+      argc > 2 ? std::filesystem::path(argv[2])
+               : std::filesystem::temp_directory_path();
+  const std::filesystem::path stderr_path = dir / "coretrace_bench_stderr.log";
+  const std::filesystem::path file_path = dir / "coretrace_bench_file.log";
+  const std::filesystem::path mmap_path = dir / "coretrace_bench_mmap.log";
+
+  Logger logger;
+  logger.enable();
+
+  // Baseline: stderr redirected to a file.
+  std::fflush(stderr);
+  if (!std::freopen(stderr_path.string().c_str(), "w", stderr))
+    return 1;
+  const double stderr_ns = run(logger, lines);
+
+  // Built-in file sink with default options.
+  FileSinkOptions opts;
+  opts.truncate = true;
+  if (!logger.set_file_sink(file_path.string(), opts))
+    return 1;
+  const double file_ns = run(logger, lines);
+
+  // Built-in mmap sink with default options.
+  MmapSinkOptions mmap_opts;
+  mmap_opts.truncate = true;
+  if (!logger.set_mmap_sink(mmap_path.string(), mmap_opts))
+    return 1;
+  const double mmap_ns = run(logger, lines);
+  logger.reset_sink();
+
+  std::filesystem::remove(stderr_path);
+  std::filesystem::remove(file_path);
+  std::filesystem::remove(mmap_path);
+
+  std::printf("lines: %ld\n", lines);
+  std::printf("stderr (redirected): %8.1f ns/line\n", stderr_ns);
+  std::printf("file sink:           %8.1f ns/line\n", file_ns);
+  std::printf("mmap sink:           %8.1f ns/line\n", mmap_ns);
+  return 0;
+}
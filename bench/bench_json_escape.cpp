@@ -0,0 +1,100 @@
+// Throughput of JSON string escaping (Layout::Json): the vectorized
+// scanner against byte-at-a-time escaping.
+//
+// Both variants escape the same corpus of log-like messages into a reused
+// buffer: mostly plain text, with a quote, a backslash or a tab every few
+// dozen bytes, plus a share of long messages (paths, dumps) where the
+// scanner has long plain runs to skip.
+//
+// Usage: coretrace_logger_bench_json_escape [rounds]
+#include "logger_json.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<std::string> make_corpus() {
+  std::mt19937 rng(7);
+  const char plain[] = "abcdefghijklmnopqrstuvwxyz0123456789 =:/.,-_";
+  const char escaped[] = {'"', '\\', '\t', '\n'};
+  std::vector<std::string> corpus;
+  for (int i = 0; i < 10000; ++i) {
+    const size_t size = i % 10 == 0 ? 512 + rng() % 2048 : 32 + rng() % 96;
+    std::string message(size, ' ');
+    for (char &c : message)
+      c = rng() % 64 == 0 ? escaped[rng() % sizeof(escaped)]
+                          : plain[rng() % (sizeof(plain) - 1)];
+    corpus.push_back(std::move(message));
+  }
+  return corpus;
+}
+
+// Byte-at-a-time: test and copy every byte.
+void escape_bytewise(std::string &out, std::string_view value) {
+  char escape[6];
+  for (char c : value) {
+    const auto byte = static_cast<unsigned char>(c);
+    if (byte < 0x20 || c == '"' || c == '\\')
+      out.append(escape, coretrace::detail::json::escape_byte(byte, escape));
+    else
+      out.push_back(c);
+  }
+}
+
+template <typename Escape>
+double run(const std::vector<std::string> &corpus, long rounds,
+           size_t &bytes, size_t &check, Escape escape) {
+  std::string out;
+  out.reserve(4096);
+  bytes = 0;
+  check = 0;
+  const Clock::time_point start = Clock::now();
+  for (long round = 0; round < rounds; ++round) {
+    for (const std::string &message : corpus) {
+      out.clear();
+      escape(out, message);
+      bytes += message.size();
+      check += out.size();
+    }
+  }
+  const std::chrono::duration<double> elapsed = Clock::now() - start;
+  return static_cast<double>(bytes) / elapsed.count() / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  namespace json = coretrace::detail::json;
+
+  const long rounds = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 50;
+  const std::vector<std::string> corpus = make_corpus();
+
+  size_t bytes = 0;
+  size_t scalar_check = 0;
+  size_t simd_check = 0;
+  const double bytewise_mbs = run(
+      corpus, rounds, bytes, scalar_check,
+      [](std::string &out, std::string_view value) {
+        escape_bytewise(out, value);
+      });
+  const double scan_mbs = run(
+      corpus, rounds, bytes, simd_check,
+      [](std::string &out, std::string_view value) {
+        json::append_escaped(out, value);
+      });
+  if (scalar_check != simd_check)
+    return 1;
+
+  std::printf("input: %zu MB\n", bytes >> 20);
+  std::printf("byte-at-a-time: %8.1f MB/s\n", bytewise_mbs);
+  std::printf("scanner:        %8.1f MB/s (%s)\n", scan_mbs,
+              json::plain_run_engine());
+  return 0;
+}
@@ -0,0 +1,103 @@
+// Throughput of message sanitization (set_sanitize()) against a plain
+// copy of the same bytes.
+//
+// The corpus is log-like text: short messages with a share of long ones,
+// ASCII with a sprinkle of UTF-8 (accents, CJK). Clean messages are only
+// scanned; the dirty variant adds an ANSI escape or an invalid byte every
+// few hundred bytes, which forces a rewrite.
+//
+// Usage: coretrace_logger_bench_sanitize [rounds]
+#include "logger_sanitize.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<std::string> make_corpus(bool dirty) {
+  std::mt19937 rng(7);
+  const char plain[] = "abcdefghijklmnopqrstuvwxyz0123456789 =:/.,-_";
+  const char *const wide[] = {"\xc3\xa9", "\xe4\xb8\xad"};
+  const char *const hostile[] = {"\x1b[31m", "\xff", "\r"};
+  std::vector<std::string> corpus;
+  for (int i = 0; i < 10000; ++i) {
+    const size_t size = i % 10 == 0 ? 512 + rng() % 2048 : 32 + rng() % 96;
+    std::string message;
+    while (message.size() < size) {
+      if (rng() % 128 == 0)
+        message += wide[rng() % 2];
+      else if (dirty && rng() % 256 == 0)
+        message += hostile[rng() % 3];
+      else
+        message += plain[rng() % (sizeof(plain) - 1)];
+    }
+    corpus.push_back(std::move(message));
+  }
+  return corpus;
+}
+
+// What write_line() does: scan, and rewrite only when needed.
+void sanitize_message(std::string &out, std::string_view value) {
+  namespace sanitize = coretrace::detail::sanitize;
+  const size_t clean = sanitize::clean_prefix(value.data(), value.size());
+  if (clean == value.size()) {
+    out.append(value); // stands for the copy into the line buffer
+    return;
+  }
+  out.append(value.data(), clean);
+  sanitize::append_sanitized(out, value.substr(clean));
+}
+
+template <typename Pass>
+double run(const std::vector<std::string> &corpus, long rounds,
+           size_t &bytes, size_t &check, Pass pass) {
+  std::string out;
+  out.reserve(8192);
+  bytes = 0;
+  check = 0;
+  const Clock::time_point start = Clock::now();
+  for (long round = 0; round < rounds; ++round) {
+    for (const std::string &message : corpus) {
+      out.clear();
+      pass(out, message);
+      bytes += message.size();
+      check += out.size();
+    }
+  }
+  const std::chrono::duration<double> elapsed = Clock::now() - start;
+  return static_cast<double>(bytes) / elapsed.count() / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const long rounds = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 50;
+
+  for (const bool dirty : {false, true}) {
+    const std::vector<std::string> corpus = make_corpus(dirty);
+    size_t bytes = 0;
+    size_t copy_check = 0;
+    size_t check = 0;
+    const double copy_mbs = run(corpus, rounds, bytes, copy_check,
+                                [](std::string &out, std::string_view value) {
+                                  out.append(value);
+                                });
+    const double sanitize_mbs =
+        run(corpus, rounds, bytes, check, sanitize_message);
+    if (!dirty && check != copy_check)
+      return 1;
+
+    std::printf("%s input: %zu MB\n", dirty ? "dirty" : "clean",
+                bytes >> 20);
+    std::printf("  copy:     %8.1f MB/s\n", copy_mbs);
+    std::printf("  sanitize: %8.1f MB/s (%s)\n", sanitize_mbs,
+                coretrace::detail::sanitize::ascii_run_engine());
+  }
+  return 0;
+}
@@ -0,0 +1,114 @@
+// Producer latency and system calls of the file sink: one write(2) per
+// record, the buffered write(2) engine, and the io_uring engine.
+//
+// Every run writes the same records through set_file_sink(). The first
+// one flushes after each record (flush_bytes = 1), the baseline of a
+// plain unbuffered logger; the others use default buffering, the last
+// one with io_uring. Each log() call is timed individually: the tail
+// (p99, max) shows the calls that paid for a buffer write. System calls
+// come from Logger::sink_stats(). Without io_uring support (build option
+// or kernel) the last two rows both use write(2).
+//
+// Usage: coretrace_logger_bench_uring_sink [lines] [dir]
+#include <coretrace/logger.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+  double p50_ns = 0;
+  double p99_ns = 0;
+  double p999_ns = 0;
+  double max_ns = 0;
+  unsigned long long syscalls = 0;
+};
+
+Result run(coretrace::Logger &logger, long lines) {
+  std::vector<double> samples(static_cast<size_t>(lines));
+  for (long i = 0; i < lines; ++i) {
+    const Clock::time_point start = Clock::now();
+    logger.log(coretrace::Level::Info, "record seq={} value={}\n", i, i * 7);
+    const std::chrono::duration<double, std::nano> elapsed =
+        Clock::now() - start;
+    samples[static_cast<size_t>(i)] = elapsed.count();
+  }
+  logger.flush();
+
+  std::sort(samples.begin(), samples.end());
+  const auto at = [&](double q) {
+    return samples[static_cast<size_t>(q * static_cast<double>(lines - 1))];
+  };
+
+  Result result;
+  result.p50_ns = at(0.50);
+  result.p99_ns = at(0.99);
+  result.p999_ns = at(0.999);
+  result.max_ns = samples.back();
+  result.syscalls = logger.sink_stats().syscalls;
+  return result;
+}
+
+void print(const char *name, const Result &r) {
+  std::printf("%-10s %10llu %10.0f %10.0f %10.0f %12.0f\n", name, r.syscalls,
+              r.p50_ns, r.p99_ns, r.p999_ns, r.max_ns);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  using namespace coretrace;
+
+  const long lines = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 1000000;
+  if (lines <= 0)
+    return 1;
+  const std::filesystem::path dir =
+      argc > 2 ? std::filesystem::path(argv[2])
+               : std::filesystem::temp_directory_path();
+  const std::filesystem::path path = dir / "coretrace_bench_uring.log";
+
+  Logger logger;
+  logger.enable();
+
+  FileSinkOptions opts;
+  opts.truncate = true;
+
+  FileSinkOptions through = opts;
+  through.flush_bytes = 1;
+  if (!logger.set_file_sink(path.string(), through))
+    return 1;
+  const Result unbuffered = run(logger, lines);
+
+  if (!logger.set_file_sink(path.string(), opts))
+    return 1;
+  const Result sync = run(logger, lines);
+
+  opts.io_uring = true;
+  if (!logger.set_file_sink(path.string(), opts))
+    return 1;
+  const Result uring = run(logger, lines);
+  logger.reset_sink();
+
+  std::filesystem::remove(path);
+
+  std::printf("lines: %ld\n", lines);
+  std::printf("%-10s %10s %10s %10s %10s %12s\n", "engine", "syscalls",
+              "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+  print("per line", unbuffered);
+  print("write(2)", sync);
+  print("io_uring", uring);
+  std::printf("syscalls saved: %lld (vs per line: %lld)\n",
+              static_cast<long long>(sync.syscalls) -
+                  static_cast<long long>(uring.syscalls),
+              static_cast<long long>(unbuffered.syscalls) -
+                  static_cast<long long>(uring.syscalls));
+  return 0;
+}
@@ -0,0 +1,86 @@
+// Call-site code-size probe for the coretrace_logger_codesize target.
+//
+// Compiled twice: with CORETRACE_CODESIZE_LEGACY=1 every site expands the
+// former inline log() body (filters, std::vformat, try/catch); otherwise
+// every site uses the current log(), which inlines only the filter check.
+// The legacy body is forced inline, as it was in the header, so that the
+// compiler cannot fold the sites into one shared copy; the eight groups
+// of sites use eight argument signatures.
+#include <coretrace/logger.hpp>
+
+#include <utility>
+
+namespace {
+
+#if CORETRACE_CODESIZE_LEGACY
+
+#if defined(__GNUC__)
+#define CORETRACE_CODESIZE_INLINE __attribute__((always_inline)) inline
+#else
+#define CORETRACE_CODESIZE_INLINE __forceinline
+#endif
+
+template <typename... Args>
+CORETRACE_CODESIZE_INLINE void site_log(coretrace::LogEntry entry,
+                                        coretrace::Module mod,
+                                        std::string_view fmt,
+                                        Args &&...args) {
+  coretrace::init_once();
+
+  if (!coretrace::log_is_enabled())
+    return;
+  if (static_cast<int>(entry.level) <
+      static_cast<int>(coretrace::min_level()))
+    return;
+  if (!mod.name.empty() && !coretrace::module_is_enabled(mod.name))
+    return;
+
+  try {
+    std::string msg = std::vformat(fmt, std::make_format_args(args...));
+    if (msg.empty())
+      return;
+
+    coretrace::write_log_line(entry.level, mod.name, msg, entry.loc);
+  } catch (...) {
+    static const char fallback[] = "coretrace: log format error\n";
+    coretrace::write_raw(fallback, sizeof(fallback) - 1);
+  }
+}
+
+#else
+
+template <typename... Args>
+inline void site_log(coretrace::LogEntry entry, coretrace::Module mod,
+                     std::string_view fmt, Args &&...args) {
+  coretrace::log(entry, mod, fmt, std::forward<Args>(args)...);
+}
+
+#endif
+
+} // namespace
+
+// CORETRACE_CODESIZE_SITES in CMakeLists.txt must match the count below.
+#define CT_SITE(n, A, B)                                                       \
+  void codesize_site_##n(A a, B b, const char *c, double d) {                  \
+    site_log(coretrace::Level::Info, coretrace::Module("site"),                \
+             "site " #n " a={} b={} c={} d={}\n", a, b, c, d);                 \
+  }
+
+#define CT_SITES8(n, A, B)                                                     \
+  CT_SITE(n##0, A, B)                                                          \
+  CT_SITE(n##1, A, B)                                                          \
+  CT_SITE(n##2, A, B)                                                          \
+  CT_SITE(n##3, A, B)                                                          \
+  CT_SITE(n##4, A, B)                                                          \
+  CT_SITE(n##5, A, B)                                                          \
+  CT_SITE(n##6, A, B)                                                          \
+  CT_SITE(n##7, A, B)
+
+CT_SITES8(1, int, unsigned long)
+CT_SITES8(2, long, int)
+CT_SITES8(3, unsigned, short)
+CT_SITES8(4, long long, unsigned char)
+CT_SITES8(5, short, long)
+CT_SITES8(6, unsigned long, unsigned)
+CT_SITES8(7, char, long long)
+CT_SITES8(8, unsigned short, bool)
@@ -0,0 +1,52 @@
+# Prints the per-call-site code size of the legacy and outlined log() call
+# sites. Invoked by the coretrace_logger_codesize target:
+#
+#   cmake -DSIZE_TOOL=<size> -DSITES=<n> -DLEGACY_OBJECTS=<objs>
+#         -DOUTLINED_OBJECTS=<objs> -P CodeSizeReport.cmake
+#
+# Reads System V section sizes (`size -A`). Bytes in .text.unlikely /
+# .text.cold are reported as cold; every other .text* section is hot.
+
+function(measure_sections objects out_hot out_cold)
+  set(hot 0)
+  set(cold 0)
+
+  foreach(object IN LISTS objects)
+    execute_process(
+      COMMAND ${SIZE_TOOL} -A ${object}
+      OUTPUT_VARIABLE output
+      RESULT_VARIABLE result
+    )
+    if(NOT result EQUAL 0)
+      message(FATAL_ERROR "${SIZE_TOOL} failed on ${object}")
+    endif()
+
+    string(REPLACE "\n" ";" lines "${output}")
+    foreach(line IN LISTS lines)
+      if(line MATCHES "^(\\.text[^ \t]*)[ \t]+([0-9]+)")
+        set(section "${CMAKE_MATCH_1}")
+        set(bytes "${CMAKE_MATCH_2}")
+        if(section MATCHES "^\\.text\\.(unlikely|cold)")
+          math(EXPR cold "${cold} + ${bytes}")
+        else()
+          math(EXPR hot "${hot} + ${bytes}")
+        endif()
+      endif()
+    endforeach()
+  endforeach()
+
+  set(${out_hot} ${hot} PARENT_SCOPE)
+  set(${out_cold} ${cold} PARENT_SCOPE)
+endfunction()
+
+measure_sections("${LEGACY_OBJECTS}" legacy_hot legacy_cold)
+measure_sections("${OUTLINED_OBJECTS}" outlined_hot outlined_cold)
+
+math(EXPR legacy_hot_site "${legacy_hot} / ${SITES}")
+math(EXPR legacy_cold_site "${legacy_cold} / ${SITES}")
+math(EXPR outlined_hot_site "${outlined_hot} / ${SITES}")
+math(EXPR outlined_cold_site "${outlined_cold} / ${SITES}")
+
+message("coretrace-logger call-site code size (${SITES} sites)")
+message("  legacy   (inline format): hot ${legacy_hot} B (${legacy_hot_site} B/site), cold ${legacy_cold} B (${legacy_cold_site} B/site)")
+message("  outlined (cold vlog):     hot ${outlined_hot} B (${outlined_hot_site} B/site), cold ${outlined_cold} B (${outlined_cold_site} B/site)")
@@ -0,0 +1,302 @@
+#ifndef CORETRACE_BASIC_LOGGER_HPP
+#define CORETRACE_BASIC_LOGGER_HPP
+
+#include "coretrace/logger.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+namespace coretrace {
+
+// #######################################
+//  StaticPolicy — compile-time configuration
+// #######################################
+
+/// Compile-time configuration for BasicLogger. Every option is a constant, so
+/// the line writer generated from a policy has no runtime branch on
+/// configuration and no storage for features that are turned off.
+///
+/// Use the template arguments directly, or derive and override members:
+///   struct AllocPolicy : coretrace::StaticPolicy<true> {
+///     static constexpr std::string_view prefix = "==alloc==";
+///     static constexpr Level min_level = Level::Debug;
+///   };
+///   coretrace::BasicLogger<AllocPolicy> alloc_log(alloc_sink);
+///
+template <bool Timestamps = false, bool SourceLocation = false,
+          bool Colors = false, bool ThreadSafe = true,
+          Layout LineLayout = Layout::Text>
+struct StaticPolicy {
+  static constexpr bool timestamps = Timestamps;
+  static constexpr bool source_location = SourceLocation;
+  static constexpr bool colors = Colors;
+  static constexpr bool thread_safe = ThreadSafe;
+  static constexpr Layout layout = LineLayout;
+
+  /// Records below this level are dropped before any formatting.
+  static constexpr Level min_level = Level::Info;
+
+  /// Prefix tag (Layout::Text only).
+  static constexpr std::string_view prefix = "==ct==";
+
+  static_assert(LineLayout == Layout::Text || LineLayout == Layout::Short,
+                "Layout::Json, Layout::Cbor and Layout::Pattern are only "
+                "available on the runtime Logger");
+};
+
+namespace detail {
+
+// Lock type for policies that opt out of thread safety.
+struct NullMutex {
+  void lock() noexcept {}
+  void unlock() noexcept {}
+};
+
+// ANSI sequences emitted by static line writers. Same values as color(),
+// without the runtime terminal check: the policy decides.
+inline constexpr std::string_view ANSI_RESET = "\x1b[0m";
+inline constexpr std::string_view ANSI_DIM = "\x1b[2m";
+inline constexpr std::string_view ANSI_ITALIC = "\x1b[3m";
+inline constexpr std::string_view ANSI_GRAY = "\x1b[90m";
+
+[[nodiscard]] constexpr std::string_view ansi_level(Level level) {
+  switch (level) {
+  case Level::Debug:
+    return "\x1b[36m";
+  case Level::Info:
+    return "\x1b[32m";
+  case Level::Warn:
+    return "\x1b[33m";
+  case Level::Error:
+    return "\x1b[31m";
+  }
+  return "\x1b[36m";
+}
+
+// Fixed stack buffer that assembles one line and hands it to the sink in a
+// single call. A line larger than the buffer moves to the heap and still
+// reaches the sink whole.
+template <size_t Capacity> class StackLine {
+public:
+  explicit StackLine(SinkFn sink) noexcept : sink_(sink) {}
+
+  StackLine(const StackLine &) = delete;
+  StackLine &operator=(const StackLine &) = delete;
+
+  void append(std::string_view value) {
+    if (!spill_.empty()) {
+      spill_.append(value);
+      return;
+    }
+    if (value.size() > Capacity - len_) {
+      spill_.reserve(len_ + value.size());
+      spill_.assign(buf_, len_);
+      spill_.append(value);
+      return;
+    }
+    std::memcpy(buf_ + len_, value.data(), value.size());
+    len_ += value.size();
+  }
+
+  void append_dec(size_t value) {
+    char digits[20];
+    size_t idx = sizeof(digits);
+    do {
+      digits[--idx] = static_cast<char>('0' + (value % 10));
+      value /= 10;
+    } while (value != 0);
+    append(std::string_view(digits + idx, sizeof(digits) - idx));
+  }
+
+  void flush() {
+    const char *data = spill_.empty() ? buf_ : spill_.data();
+    const size_t size = spill_.empty() ? len_ : spill_.size();
+    if (size == 0)
+      return;
+    if (sink_)
+      sink_(data, size);
+    else
+      write_stderr(data, size);
+    len_ = 0;
+    spill_.clear();
+  }
+
+private:
+  SinkFn sink_;
+  size_t len_ = 0;
+  char buf_[Capacity];
+  std::string spill_; // the whole line once it outgrew buf_
+};
+
+} // namespace detail
+
+// #######################################
+//  BasicLogger — compile-time specialized logger
+// #######################################
+
+/// A logger whose layout and features are fixed by Policy (see
+/// StaticPolicy). Only the enable flag and the sink are runtime state; the
+/// lock disappears entirely when Policy::thread_safe is false.
+///
+/// Example:
+///   coretrace::BasicLogger<coretrace::StaticPolicy<true, true>> log(sink);
+///   log.enable();
+///   log.log(Level::Info, "ready in {} ms\n", ms);
+///
+/// Module tags are printed but not filtered; there is no module table.
+template <typename Policy> class alignas(64) BasicLogger {
+public:
+  explicit BasicLogger(SinkFn sink = nullptr) noexcept : sink_(sink) {}
+
+  BasicLogger(const BasicLogger &) = delete;
+  BasicLogger &operator=(const BasicLogger &) = delete;
+
+  void enable() noexcept { enabled_.store(true, std::memory_order_release); }
+
+  void disable() noexcept { enabled_.store(false, std::memory_order_release); }
+
+  [[nodiscard]] bool is_enabled() const noexcept {
+    return enabled_.load(std::memory_order_acquire);
+  }
+
+  /// Log a formatted message at the given level (see coretrace::log()).
+  template <typename... Args>
+  void log(LogEntry entry, std::string_view fmt, Args &&...args) {
+    if (accepts(entry.level)) [[unlikely]]
+      emit<false>(entry, {}, fmt, std::make_format_args(args...));
+  }
+
+  /// Log a formatted message with a module tag (see coretrace::log()).
+  template <typename... Args>
+  void log(LogEntry entry, Module mod, std::string_view fmt, Args &&...args) {
+    if (accepts(entry.level)) [[unlikely]] {
+      if (mod.name.empty())
+        emit<false>(entry, {}, fmt, std::make_format_args(args...));
+      else
+        emit<true>(entry, mod.name, fmt, std::make_format_args(args...));
+    }
+  }
+
+  /// Write a preformatted message as one line (no level filtering).
+  void write_log_line(Level level, std::string_view module_name,
+                      std::string_view message,
+                      const std::source_location &loc) {
+    if (module_name.empty())
+      write_line<false>(level, {}, message, loc);
+    else
+      write_line<true>(level, module_name, message, loc);
+  }
+
+private:
+  using Mutex = std::conditional_t<Policy::thread_safe, std::mutex,
+                                   detail::NullMutex>;
+
+  static constexpr size_t LINE_CAPACITY = 512;
+
+  [[nodiscard]] bool accepts(Level level) const noexcept {
+    return static_cast<int>(level) >= static_cast<int>(Policy::min_level) &&
+           is_enabled();
+  }
+
+  // Out of line and shared by every call site with the same policy.
+  template <bool WithModule>
+  CORETRACE_LOGGER_COLD void emit(const LogEntry &entry,
+                                  std::string_view module_name,
+                                  std::string_view fmt,
+                                  std::format_args args) {
+    try {
+      std::string msg = std::vformat(fmt, args);
+      if (msg.empty())
+        return;
+
+      write_line<WithModule>(entry.level, module_name, msg, entry.loc);
+    } catch (...) {
+      static const char fallback[] = "coretrace: log format error\n";
+      detail::StackLine<sizeof(fallback)> line(sink_);
+      line.append(std::string_view(fallback, sizeof(fallback) - 1));
+      line.flush();
+    }
+  }
+
+  static void paint(detail::StackLine<LINE_CAPACITY> &line,
+                    std::string_view seq) {
+    if constexpr (Policy::colors)
+      line.append(seq);
+  }
+
+  template <bool WithModule>
+  void write_line(Level level, std::string_view module_name,
+                  std::string_view message, const std::source_location &loc) {
+    detail::StackLine<LINE_CAPACITY> line(sink_);
+    std::lock_guard<Mutex> guard(mutex_);
+
+    // Optional timestamp: [2025-01-15T10:45:23.456]
+    if constexpr (Policy::timestamps) {
+      char ts_buf[TIMESTAMP_CAPACITY];
+      line.append(std::string_view(ts_buf, format_timestamp(ts_buf)));
+    }
+
+    if constexpr (Policy::layout == Layout::Text) {
+      // |PID|
+      paint(line, detail::ANSI_DIM);
+      line.append("|");
+      line.append_dec(static_cast<size_t>(pid()));
+      line.append("|");
+      paint(line, detail::ANSI_RESET);
+      line.append(" ");
+
+      // Prefix tag.
+      paint(line, detail::ANSI_GRAY);
+      paint(line, detail::ANSI_ITALIC);
+      line.append(Policy::prefix);
+      line.append(" ");
+      paint(line, detail::ANSI_RESET);
+    }
+
+    // [LEVEL]
+    paint(line, detail::ansi_level(level));
+    line.append("[");
+    line.append(level_label(level));
+    line.append("]");
+    paint(line, detail::ANSI_RESET);
+
+    // Optional source location: file.cpp:42
+    if constexpr (Policy::source_location) {
+      line.append(" ");
+      paint(line, detail::ANSI_DIM);
+      line.append(detail::source_basename(loc.file_name()));
+      line.append(":");
+      line.append_dec(static_cast<size_t>(loc.line()));
+      paint(line, detail::ANSI_RESET);
+    } else {
+      (void)loc;
+    }
+
+    // Module tag: (alloc)
+    if constexpr (WithModule) {
+      line.append(" ");
+      paint(line, detail::ANSI_DIM);
+      line.append("(");
+      line.append(module_name);
+      line.append(")");
+      paint(line, detail::ANSI_RESET);
+    } else {
+      (void)module_name;
+    }
+
+    line.append(" ");
+    line.append(message);
+    line.flush();
+  }
+
+  std::atomic<bool> enabled_{false};
+  SinkFn sink_;
+  [[no_unique_address]] Mutex mutex_;
+};
+
+} // namespace coretrace
+
+#endif // CORETRACE_BASIC_LOGGER_HPP
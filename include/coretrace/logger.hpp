@@ -1,12 +1,30 @@
 #ifndef CORETRACE_LOGGER_HPP
 #define CORETRACE_LOGGER_HPP
 
+#include <atomic>
+#include <chrono>
+#include <concepts>
 #include <cstddef>
 #include <cstdint>
 #include <format>
+#include <initializer_list>
+#include <iterator>
 #include <source_location>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Marks the out-of-line formatting path: kept out of the hot text section
+// and never inlined into call sites.
+#if defined(__GNUC__) || defined(__clang__)
+#define CORETRACE_LOGGER_COLD __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+#define CORETRACE_LOGGER_COLD __declspec(noinline)
+#else
+#define CORETRACE_LOGGER_COLD
+#endif
 
 namespace coretrace {
 
@@ -101,10 +119,678 @@ struct Module {
   explicit Module(const char *n) : name(n) {}
 };
 
+// #######################################
+//  Field — typed key/value pairs
+// #######################################
+
+/// Key of a structured field. Only constructible from a compile-time
+/// string (a literal), so records refer to it and never copy it.
+struct FieldKey {
+  std::string_view name;
+
+  template <size_t N>
+  // NOLINTNEXTLINE(google-explicit-constructor)
+  consteval FieldKey(const char (&key)[N]) : name(key, N - 1) {}
+};
+
+enum class FieldKind : uint8_t { Bool, Int, Uint, Float, String, Pointer };
+
+/// One typed value attached to a record (see kv()). Refers to the key and
+/// to string values; valid for the duration of the log() call.
+struct Field {
+  std::string_view key;
+  FieldKind kind = FieldKind::Int;
+  union {
+    long long int_value = 0;
+    unsigned long long uint_value;
+    double float_value;
+    bool bool_value;
+    const void *pointer_value;
+  };
+  std::string_view string_value; // FieldKind::String
+};
+
+/// Build a field from a key literal and a value: bool, integer, enum,
+/// floating point, string (string_view, std::string, C string) or pointer.
+///
+/// Example:
+///   coretrace::log(Level::Info, Module("alloc"), "malloc",
+///                  kv("ptr", ptr), kv("size", size));
+///
+template <typename T>
+[[nodiscard]] inline Field kv(FieldKey key, const T &value) noexcept {
+  Field field;
+  field.key = key.name;
+  if constexpr (std::is_same_v<T, bool>) {
+    field.kind = FieldKind::Bool;
+    field.bool_value = value;
+  } else if constexpr (std::is_enum_v<T>) {
+    return kv(key, static_cast<std::underlying_type_t<T>>(value));
+  } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+    field.kind = FieldKind::Int;
+    field.int_value = value;
+  } else if constexpr (std::is_integral_v<T>) {
+    field.kind = FieldKind::Uint;
+    field.uint_value = value;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    field.kind = FieldKind::Float;
+    field.float_value = static_cast<double>(value);
+  } else if constexpr (std::is_null_pointer_v<T>) {
+    field.kind = FieldKind::Pointer;
+    field.pointer_value = nullptr;
+  } else if constexpr (std::is_convertible_v<const T &, const char *>) {
+    const char *text = value;
+    field.kind = FieldKind::String;
+    field.string_value = text ? std::string_view(text) : "(null)";
+  } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+    field.kind = FieldKind::String;
+    field.string_value = value;
+  } else if constexpr (std::is_pointer_v<T>) {
+    field.kind = FieldKind::Pointer;
+    field.pointer_value = value;
+  } else {
+    static_assert(sizeof(T) == 0, "kv(): unsupported field type");
+  }
+  return field;
+}
+
+namespace detail {
+
+template <typename T>
+inline constexpr bool is_field = std::is_same_v<std::remove_cvref_t<T>, Field>;
+
+// Argument packs of the structured log() overloads: only fields.
+template <typename... Ts>
+concept FieldPack = sizeof...(Ts) > 0 && (is_field<Ts> && ...);
+
+// Argument packs of the formatted log() overloads: no field.
+template <typename... Ts>
+concept FormatPack = !(is_field<Ts> || ...);
+
+// File name part of a source path, as every layout prints it.
+[[nodiscard]] inline const char *source_basename(const char *path) {
+  if (!path)
+    return "<unknown>";
+
+  const char *last = path;
+  for (const char *p = path; *p; ++p) {
+    if (*p == '/' || *p == '\\')
+      last = p + 1;
+  }
+  return last;
+}
+
+} // namespace detail
+
+// #######################################
+//  SinkFn — custom output callback
+// #######################################
+
+/// Callback type for custom sinks.
+using SinkFn = void (*)(const char *data, size_t size);
+
+// #######################################
+//  File sink options
+// #######################################
+
+/// When buffered file output is forced to stable storage.
+enum class FileDurability {
+  None,         // leave writeback to the kernel
+  SyncInterval, // fdatasync() every flush_interval (0: every flush)
+  SyncOnError,  // fdatasync() after every Error line
+};
+
+/// Wall-clock rotation period. Boundaries are UTC, like log timestamps.
+enum class RotateInterval {
+  Never,
+  Hourly,
+  Daily,
+};
+
+/// Options for set_file_sink().
+struct FileSinkOptions {
+  /// Staging buffer size, rounded up to the page size. Lines are appended
+  /// to it and reach the file in large write(2) calls.
+  size_t buffer_size = 1 << 20;
+
+  /// Flush once this many bytes are buffered (0: when the buffer is full).
+  size_t flush_bytes = 0;
+
+  /// Background flush period (0: no timed flush).
+  std::chrono::milliseconds flush_interval{1000};
+
+  /// Flush right after every Error line.
+  bool flush_on_error = true;
+
+  FileDurability durability = FileDurability::None;
+
+  /// Keep this much disk space reserved ahead of the write offset with
+  /// fallocate() (Linux; 0 disables). Reduces fragmentation and metadata
+  /// updates on long appends.
+  size_t preallocate_bytes = 0;
+
+  /// Truncate an existing file instead of appending (O_APPEND).
+  bool truncate = false;
+
+  /// Submit writes through io_uring (Linux; needs a build with
+  /// CORETRACE_LOGGER_ENABLE_IO_URING). Lines are staged in a pool of four
+  /// registered buffers of buffer_size that are written asynchronously, so
+  /// no thread blocks in write(2). Falls back to the write(2) path when
+  /// io_uring is unavailable, or with rotation, direct_io or compression.
+  bool io_uring = false;
+
+  /// Keep the output out of the page cache: write with O_DIRECT from the
+  /// aligned buffer (FILE_FLAG_NO_BUFFERING on Windows). Where the file
+  /// system rejects it, write normally and drop written ranges from the
+  /// cache with posix_fadvise(POSIX_FADV_DONTNEED) after writeback.
+  bool direct_io = false;
+
+  /// Compress the output in blocks of buffer_size with the built-in LZ
+  /// codec. A background thread compresses each completed block into a
+  /// self-contained frame; producers only copy. Read the file back with
+  /// the ct-logunpack tool. Rotation sizes count compressed bytes.
+  bool compress = false;
+
+  // ── Rotation ─────────────────────────
+  //
+  // The active file keeps its name. On rollover it is renamed to
+  // "<path>.YYYYMMDD-HHMMSS.NNN" (UTC time of the rollover, NNN breaks
+  // ties), so rotated files sort lexically in creation order. The next
+  // file is opened ahead of time by a background thread ("<path>.next"):
+  // a rollover only swaps descriptors and never waits for open() or
+  // rename().
+
+  /// Rotate before the file would grow past this size (0: no limit).
+  /// Checked as each record arrives, buffered or not. A file exceeds it
+  /// only by a record larger than the limit, or while the next file is
+  /// not open yet.
+  size_t rotate_bytes = 0;
+
+  /// Rotate at the first record after each hour/day boundary.
+  RotateInterval rotate_every = RotateInterval::Never;
+
+  /// Rotated files to keep; the oldest are deleted (0: keep all).
+  size_t max_files = 0;
+};
+
+/// Counters of a built-in sink (see Logger::sink_stats()).
+struct SinkStats {
+  uint64_t bytes_written = 0; // bytes handed to the destination
+  uint64_t syscalls = 0;      // system calls issued to write, map or sync
+  uint64_t dropped_bytes = 0; // bytes lost to I/O errors or a closed sink
+  uint64_t dropped_lines = 0; // lines among dropped_bytes (overflow)
+};
+
+/// Options for set_mmap_sink().
+struct MmapSinkOptions {
+  /// Size of one mapped window of the file, rounded up to the mapping
+  /// granularity. The file grows one segment at a time.
+  size_t segment_size = 16 << 20;
+
+  /// Period of the background msync(MS_ASYNC) that starts writeback of
+  /// written pages and drops them from the process (0: only when a segment
+  /// is left).
+  std::chrono::milliseconds flush_interval{1000};
+
+  /// Truncate an existing file instead of appending to it.
+  bool truncate = false;
+};
+
+/// Options for set_sharded_sink().
+struct ShardedSinkOptions {
+  /// Staging buffer of each thread's shard.
+  size_t buffer_size = 64 << 10;
+
+  /// Background flush of every shard (0: no timed flush).
+  std::chrono::milliseconds flush_interval{1000};
+
+  /// Flush a thread's shard right after each of its Error lines.
+  bool flush_on_error = true;
+
+  /// Truncate existing shard files instead of appending to them.
+  bool truncate = false;
+};
+
+/// Options for set_stderr_nonblocking().
+struct StderrOptions {
+  /// Capacity of the ring that holds output stderr could not take yet.
+  /// Output that does not fit is dropped and counted.
+  size_t overflow_bytes = 1 << 20;
+};
+
+/// Options for set_pipe_sink().
+struct PipeSinkOptions {
+  /// Size of one output block, rounded up to the page size.
+  size_t buffer_size = 64 << 10;
+
+  /// Blocks the sink may hold: being filled, queued for the pipe, or still
+  /// unread by the child. Output that finds none free is dropped.
+  size_t buffer_count = 8;
+
+  /// Background hand-off of a partly filled block (0: no timed flush).
+  std::chrono::milliseconds flush_interval{1000};
+
+  /// Hand the block off right after every Error line.
+  bool flush_on_error = true;
+
+  /// Start the command again when it exits, restart_delay after it died.
+  bool restart = true;
+  std::chrono::milliseconds restart_delay{1000};
+
+  /// Longest flush() and close() wait for the child to take buffered
+  /// output; close() then also waits this long for the child to exit
+  /// before killing it.
+  std::chrono::milliseconds drain_timeout{1000};
+};
+
+/// Record format of set_syslog_sink().
+enum class SyslogFormat {
+  Rfc5424,  // "<PRI>1 TIMESTAMP - APP-NAME PROCID - [SD] MSG"
+  Journald, // journald native protocol: KEY=value fields
+};
+
+/// Options for set_syslog_sink().
+struct SyslogSinkOptions {
+  SyslogFormat format = SyslogFormat::Rfc5424;
+
+  /// Datagram socket to send to (empty: "/dev/log", or
+  /// "/run/systemd/journal/socket" for Journald).
+  std::string path;
+
+  /// APP-NAME / SYSLOG_IDENTIFIER (empty: left out).
+  std::string ident;
+
+  /// Syslog facility code (1: user, 16-23: local0-local7).
+  int facility = 1;
+
+  /// Records sent per sendmmsg() batch; a full batch is handed off.
+  size_t batch_size = 64;
+
+  /// Background hand-off of a partial batch (0: no timed flush).
+  std::chrono::milliseconds flush_interval{100};
+
+  /// Hand the batch off right after every Error record.
+  bool flush_on_error = true;
+
+  /// Largest record sent as one datagram. Longer Journald records are
+  /// passed in a sealed memfd; longer RFC 5424 records are truncated.
+  size_t max_datagram = 32 << 10;
+};
+
+/// Transport of set_net_sink().
+enum class NetProtocol {
+  Tcp, // one stream, frames coalesced into large writes
+  Udp, // one datagram per frame, sent in sendmmsg() batches
+};
+
+/// Options for set_net_sink().
+struct NetSinkOptions {
+  NetProtocol protocol = NetProtocol::Tcp;
+
+  /// Bounded buffer of framed records not sent yet. It holds output while
+  /// the collector is unreachable; records that do not fit are dropped.
+  size_t buffer_size = 4 << 20;
+
+  /// Wake the I/O thread once this much is buffered; also the largest
+  /// single write.
+  size_t batch_bytes = 64 << 10;
+
+  /// Send what is buffered at least this often (0: only at batch_bytes,
+  /// on flush() and after Error records).
+  std::chrono::milliseconds flush_interval{100};
+
+  /// Send right after every Error record.
+  bool flush_on_error = true;
+
+  /// Delay before reconnecting after a failed attempt, doubled on each
+  /// further failure up to max_reconnect_delay.
+  std::chrono::milliseconds reconnect_delay{100};
+  std::chrono::milliseconds max_reconnect_delay{5000};
+
+  /// Longest flush() and close() wait for buffered records to go out.
+  std::chrono::milliseconds drain_timeout{1000};
+};
+
+// #######################################
+//  Layout — shape of one log line
+// #######################################
+
+enum class Layout {
+  Text,    // [ts] |PID| prefix [LEVEL] file:line (module) msg
+  Short,   // [ts] [LEVEL] file:line (module) msg
+  Json,    // {"ts":..,"pid":..,..,"msg":".."} per line (Logger only)
+  Cbor,    // binary CBOR map per record (Logger only)
+  Pattern, // compiled set_pattern() format (Logger only)
+};
+
+/// Handling of multi-line messages in the Text and Short layouts.
+enum class LineFraming {
+  Off,       // message bytes as given
+  Terminate, // add a missing trailing newline
+  Indent,    // Terminate + continuation lines indented under the message
+  Prefix,    // Terminate + continuation lines repeat the record prefix
+};
+
+/// logfmt preset for set_pattern():
+///   level=INFO ts=2025-01-15T10:45:23.456 pid=12345 tid=12346
+///   prefix="==ct==" module=alloc file=main.cpp line=42 msg=malloc size=64
+inline constexpr std::string_view LOGFMT_PATTERN =
+    "level=%L%{ ts=}T pid=%P tid=%t prefix=%\"p%{ module=}\"m%{ file=}\"f"
+    "%{ line=}l msg=%\"v%k";
+
+// #######################################
+//  RedactRule — one set_redaction() pattern
+// #######################################
+
+struct RedactRule {
+  std::string_view pattern;
+  std::string_view replacement = "[REDACTED]";
+};
+
+// #######################################
+//  Logger — independent logging instance
+// #######################################
+
+/// Policy tag for the runtime-configurable logger: every option is a setter.
+/// Compile-time policies live in <coretrace/basic_logger.hpp>.
+struct RuntimePolicy {};
+
+template <typename Policy> class BasicLogger;
+
+class LineBuilder;
+class LogBatch;
+
+namespace detail::pattern {
+struct Program;
+} // namespace detail::pattern
+
+namespace detail::redact {
+class Matcher;
+} // namespace detail::redact
+
+/// A self-contained logger with its own configuration (enable flag, prefix,
+/// level, module filter, timestamps, source location), its own sink and its
+/// own output lock. Each instance is a separate contention domain: two
+/// Logger objects never serialize against each other.
+///
+/// The free functions below forward to default_logger(). A subsystem that
+/// needs a separate destination or lock owns its own instance:
+///
+///   coretrace::Logger net;
+///   net.set_sink(net_sink);
+///   net.enable();
+///   net.log(Level::Info, Module("peer"), "connected fd={}\n", fd);
+///
+/// New instances start disabled with the built-in defaults. The CT_LOG_LEVEL
+/// and CT_DEBUG environment variables only seed the default logger.
+template <> class alignas(64) BasicLogger<RuntimePolicy> {
+public:
+  struct State;
+
+  BasicLogger();
+  ~BasicLogger();
+
+  BasicLogger(const BasicLogger &) = delete;
+  BasicLogger &operator=(const BasicLogger &) = delete;
+
+  // ── Core ─────────────────────────────
+
+  void enable();
+  void disable();
+  [[nodiscard]] bool is_enabled() const;
+  void set_prefix(std::string_view prefix);
+
+  // ── Level filtering ──────────────────
+
+  void set_min_level(Level level);
+  [[nodiscard]] Level min_level() const;
+
+  // ── Module filtering ─────────────────
+
+  void enable_module(std::string_view name);
+  void disable_module(std::string_view name);
+  void enable_all_modules();
+  [[nodiscard]] bool module_is_enabled(std::string_view name) const;
+
+  // ── Output ───────────────────────────
+
+  void set_thread_safe(bool enabled);
+  void set_sink(SinkFn fn);
+  void reset_sink();
+
+  /// Route output to a built-in buffered file sink (see
+  /// coretrace::set_file_sink()). Returns false if the file cannot be
+  /// opened; the current sink is kept in that case.
+  [[nodiscard]] bool set_file_sink(std::string_view path,
+                                   const FileSinkOptions &options = {});
+
+  /// Route output to a built-in memory-mapped file sink (see
+  /// coretrace::set_mmap_sink()). Returns false if the file cannot be
+  /// opened or mapped; the current sink is kept in that case.
+  [[nodiscard]] bool set_mmap_sink(std::string_view path,
+                                   const MmapSinkOptions &options = {});
+
+  /// Route output to per-thread shard files (see
+  /// coretrace::set_sharded_sink()). Returns false if the directory of
+  /// base does not exist or the layout is Layout::Cbor; the current sink
+  /// is kept in that case.
+  [[nodiscard]] bool set_sharded_sink(std::string_view base,
+                                      const ShardedSinkOptions &options = {});
+
+  /// Stream output to the stdin of a child process (see
+  /// coretrace::set_pipe_sink()). Returns false if the command cannot be
+  /// started; the current sink is kept in that case.
+  [[nodiscard]] bool set_pipe_sink(std::string_view command,
+                                   const PipeSinkOptions &options = {});
+
+  /// Send records to the local system log (see
+  /// coretrace::set_syslog_sink()). Returns false if the socket cannot be
+  /// reached; the current sink is kept in that case.
+  [[nodiscard]] bool set_syslog_sink(const SyslogSinkOptions &options = {});
+
+  /// Forward records to a collector over TCP or UDP (see
+  /// coretrace::set_net_sink()). Returns false for an empty host or port
+  /// 0; the current sink is kept in that case.
+  [[nodiscard]] bool set_net_sink(std::string_view host, uint16_t port,
+                                  const NetSinkOptions &options = {});
+
+  /// Push bytes buffered by a built-in sink to their destination.
+  void flush();
+
+  /// Counters of the active built-in sink (all zero without one).
+  [[nodiscard]] SinkStats sink_stats() const;
+
+  void set_timestamps(bool enabled);
+  void set_source_location(bool enabled);
+
+  /// Shape of log lines (see coretrace::set_layout()).
+  void set_layout(Layout layout);
+  [[nodiscard]] Layout layout() const;
+
+  /// color() and level_color() for this logger: empty while it writes
+  /// Layout::Json or Layout::Cbor, whatever the default logger writes.
+  [[nodiscard]] std::string_view color(Color c) const;
+  [[nodiscard]] std::string_view level_color(Level level) const;
+
+  /// Compile and publish a line pattern (see coretrace::set_pattern()).
+  [[nodiscard]] bool set_pattern(std::string_view pattern);
+
+  /// Multi-line message handling (see coretrace::set_line_framing()).
+  void set_line_framing(LineFraming framing);
+  [[nodiscard]] LineFraming line_framing() const;
+
+  /// Escape untrusted message bytes (see coretrace::set_sanitize()).
+  void set_sanitize(bool enabled);
+  [[nodiscard]] bool sanitize_enabled() const;
+
+  // ── Redaction ────────────────────────
+
+  /// Replace secrets in message bodies (see coretrace::set_redaction()).
+  [[nodiscard]] bool set_redaction(std::initializer_list<RedactRule> rules);
+  [[nodiscard]] bool set_redaction(const RedactRule *rules, size_t count);
+  void clear_redaction();
+
+  // ── Oversized records ────────────────
+
+  /// Message size cap (see coretrace::set_max_record_size()).
+  void set_max_record_size(size_t max_bytes);
+  [[nodiscard]] size_t max_record_size() const;
+
+  /// Sidecar file for clipped payloads (see coretrace::set_blob_file()).
+  [[nodiscard]] bool set_blob_file(std::string_view path);
+
+  // ── Low-level write ──────────────────
+
+  void write_raw(const char *data, size_t size);
+  void write_str(std::string_view value);
+  void write_prefix(Level level);
+  void write_dec(size_t value);
+  void write_hex(uintptr_t value);
+  /// Write data under the output lock in a single sink call. The level
+  /// drives sink flush policies (e.g. flush on Error).
+  void write_atomic(const char *data, size_t size,
+                    Level level = Level::Info);
+  void write_log_line(Level level, std::string_view module_name,
+                      std::string_view message,
+                      const std::source_location &loc);
+
+  /// Lazy one-time initialization. Applies the environment defaults for
+  /// the default logger; no-op for other instances.
+  void init_once();
+
+  // ── Logging ──────────────────────────
+
+  /// Inline pre-filter: false when the record is certainly dropped (logging
+  /// disabled or level below the minimum). One relaxed load, no call.
+  [[nodiscard]] bool may_log(Level level) const noexcept {
+    return static_cast<int>(level) >= filter_.load(std::memory_order_relaxed);
+  }
+
+  /// Log a formatted message at the given level (see coretrace::log()).
+  /// Only the filter check is inlined; formatting happens out of line.
+  template <typename... Args>
+    requires detail::FormatPack<Args...>
+  void log(LogEntry entry, std::string_view fmt, Args &&...args) {
+    if (may_log(entry.level)) [[unlikely]]
+      vlog(entry, {}, fmt, std::make_format_args(args...));
+  }
+
+  /// Log a formatted message with a module tag (see coretrace::log()).
+  template <typename... Args>
+    requires detail::FormatPack<Args...>
+  void log(LogEntry entry, Module mod, std::string_view fmt, Args &&...args) {
+    if (may_log(entry.level)) [[unlikely]]
+      vlog(entry, mod.name, fmt, std::make_format_args(args...));
+  }
+
+  /// Log a message with structured fields (see coretrace::log()).
+  template <typename... Fields>
+    requires detail::FieldPack<Fields...>
+  void log(LogEntry entry, std::string_view message, const Fields &...fields) {
+    if (may_log(entry.level)) [[unlikely]] {
+      const Field list[] = {fields...};
+      vlog_fields(entry, {}, message, list, sizeof...(Fields));
+    }
+  }
+
+  /// Log a message with a module tag and structured fields.
+  template <typename... Fields>
+    requires detail::FieldPack<Fields...>
+  void log(LogEntry entry, Module mod, std::string_view message,
+           const Fields &...fields) {
+    if (may_log(entry.level)) [[unlikely]] {
+      const Field list[] = {fields...};
+      vlog_fields(entry, mod.name, message, list, sizeof...(Fields));
+    }
+  }
+
+  /// Out-of-line formatter behind log(): applies every filter, formats the
+  /// type-erased arguments and writes the line. Shared by all call sites.
+  CORETRACE_LOGGER_COLD void vlog(const LogEntry &entry,
+                                  std::string_view module_name,
+                                  std::string_view fmt, std::format_args args);
+
+  /// Out-of-line path of the structured log(): applies every filter and
+  /// writes the message with its fields.
+  CORETRACE_LOGGER_COLD void vlog_fields(const LogEntry &entry,
+                                         std::string_view module_name,
+                                         std::string_view message,
+                                         const Field *fields, size_t count);
+
+  /// Log a hex dump of size bytes at data (see coretrace::log_hexdump()).
+  void log_hexdump(LogEntry entry, std::string_view module_name,
+                   const void *data, size_t size) {
+    if (may_log(entry.level)) [[unlikely]]
+      vlog_hexdump(entry, module_name, data, size);
+  }
+
+  /// Out-of-line path of log_hexdump(): applies every filter, renders the
+  /// rows and writes them as one record.
+  CORETRACE_LOGGER_COLD void vlog_hexdump(const LogEntry &entry,
+                                          std::string_view module_name,
+                                          const void *data, size_t size);
+
+  /// Bytes shown by a hex dump (see coretrace::set_max_hexdump_size()).
+  void set_max_hexdump_size(size_t max_bytes);
+  [[nodiscard]] size_t max_hexdump_size() const;
+
+private:
+  friend BasicLogger &default_logger() noexcept;
+  friend class LineBuilder;
+  friend class LogBatch;
+
+  // Filter values: a Level, or FILTER_OFF when logging is disabled.
+  static constexpr int FILTER_OFF = static_cast<int>(Level::Error) + 1;
+
+  // Wraps statically allocated state (default logger); never frees it. The
+  // filter starts fully open so the first call reaches vlog() and applies
+  // the environment defaults.
+  constexpr explicit BasicLogger(State *state) noexcept
+      : filter_(0), state_(state), owns_state_(false) {}
+
+  // Recompute filter_ from the enable flag and minimum level.
+  void refresh_filter();
+
+  // Hand bytes to the active destination: built-in sink, SinkFn or stderr.
+  void deliver(const char *data, size_t size, Level level);
+
+  // write_atomic() of a LogBatch, with the end offset of each record.
+  void write_records(const char *data, const size_t *ends, size_t count,
+                     Level level);
+
+  // The same for a record sink: the bodies of a LogBatch, one
+  // write_record() each with the batch's module and location.
+  void write_bodies(const char *data, const size_t *ends, size_t count,
+                    Level level, std::string_view module,
+                    const std::source_location *loc);
+
+  // write_log_line() with optional structured fields.
+  void write_line(Level level, std::string_view module_name,
+                  std::string_view message, const Field *fields,
+                  size_t field_count, const std::source_location &loc);
+
+  static BasicLogger default_instance_;
+
+  std::atomic<int> filter_;
+  State *state_;
+  bool owns_state_;
+};
+
+/// The runtime-configurable logger (default instantiation of BasicLogger).
+using Logger = BasicLogger<RuntimePolicy>;
+
+/// Return the process-wide logger used by the free functions below.
+/// Statically initialized: usable before main() and from allocation hooks.
+[[nodiscard]] inline Logger &default_logger() noexcept {
+  return Logger::default_instance_;
+}
+
 // #######################################
 //  Core API
 // #######################################
 
+// The free functions below configure and write through default_logger().
+
 /// Enable logging output (disabled by default).
 void enable_logging();
 
@@ -164,16 +850,147 @@ void set_thread_safe(bool enabled);
 //  Sink (output destination)
 // #######################################
 
-/// Callback type for custom sinks.
-using SinkFn = void (*)(const char *data, size_t size);
-
 /// Redirect all log output to a custom sink function.
 /// Pass nullptr to revert to stderr (same as reset_sink()).
+///
+/// Switching sinks closes the built-in sink being replaced at once. Its
+/// object is freed once no thread can still be writing to it, by that
+/// switch or a later one, and at the latest with the logger.
 void set_sink(SinkFn fn);
 
 /// Revert to the default stderr sink.
 void reset_sink();
 
+/// Redirect all log output to a file through the built-in file sink: lines
+/// are appended to a large page-aligned buffer and written with O_APPEND in
+/// big chunks, flushed by size, by time, or on Error lines, with optional
+/// fdatasync() durability (see FileSinkOptions). Returns false if the file
+/// cannot be opened. set_sink()/reset_sink() flush and close it.
+///
+/// Example:
+///   coretrace::FileSinkOptions opts;
+///   opts.durability = coretrace::FileDurability::SyncOnError;
+///   coretrace::set_file_sink("/var/log/app.log", opts);
+///
+[[nodiscard]] bool set_file_sink(std::string_view path,
+                                 const FileSinkOptions &options = {});
+
+/// Redirect all log output to a memory-mapped file: the file is grown and
+/// mapped one segment at a time and lines are copied straight into the
+/// mapping, with no system call per line. The next segment is mapped ahead
+/// of time by a background thread, which also starts writeback of written
+/// pages and releases them. Data in the page cache survives a crash of the
+/// process (not of the machine). When the sink is closed the file is
+/// truncated to the bytes actually written; after a crash the zero-filled
+/// tail is skipped when the file is reopened. The sink keeps its length in
+/// "<path>.pos" so that records ending in NUL bytes (Layout::Cbor)
+/// survive a reopen; without that file, trailing NULs are dropped.
+///
+/// Example:
+///   coretrace::set_mmap_sink("/var/log/app.log");
+///
+[[nodiscard]] bool set_mmap_sink(std::string_view path,
+                                 const MmapSinkOptions &options = {});
+
+/// Redirect all log output to one file per thread, "<base>.<tid>.log".
+/// Each thread appends to its own buffered shard, so threads never wait
+/// for each other and the logger's output lock is skipped. Every record
+/// starts with a header, "@<monotonic ns, 20 digits> <per-thread seq> ",
+/// which the ct-logmerge tool uses to merge the shards back into one
+/// chronological stream. Shards are opened on a thread's first record and
+/// stay open until the sink is closed. Shards are text: the sink is
+/// refused while the layout is Layout::Cbor.
+///
+/// Example:
+///   coretrace::set_sharded_sink("/var/log/app");
+///   // ct-logmerge /var/log/app.*.log > app.log
+///
+[[nodiscard]] bool set_sharded_sink(std::string_view base,
+                                    const ShardedSinkOptions &options = {});
+
+/// Redirect all log output to the stdin of "/bin/sh -c command", e.g. a
+/// filter or a compressor. Records are gathered in page-aligned blocks
+/// that a background thread hands to the pipe with vmsplice() on Linux
+/// (the child reads straight from them, no copy) or write(2) elsewhere.
+/// Producers never wait for the child: when every block is taken, output
+/// is dropped and counted (sink_stats()), and a "[WARN] pipe overflow"
+/// line reports the loss in the stream. When the child exits it is
+/// started again (PipeSinkOptions::restart); output it had not read yet
+/// is lost. SIGPIPE is held on the writer thread only. POSIX only;
+/// returns false elsewhere.
+///
+/// Example:
+///   coretrace::set_pipe_sink("gzip -c >> /var/log/app.log.gz");
+///
+[[nodiscard]] bool set_pipe_sink(std::string_view command,
+                                 const PipeSinkOptions &options = {});
+
+/// Redirect all log output to the local system log over its Unix datagram
+/// socket, one datagram per record: RFC 5424 to /dev/log, or journald's
+/// native protocol. Levels map to syslog severities (Debug 7, Info 6,
+/// Warn 4, Error 3); the module becomes a structured field (SD-PARAM
+/// module / CORETRACE_MODULE), and with source locations on, journald
+/// records carry CODE_FILE, CODE_LINE and CODE_FUNC. The daemon adds its
+/// own timestamp and host, so the rendered line prefix is not sent.
+/// Records are batched and sent by a background thread with sendmmsg()
+/// (Linux); journald records too large for a datagram travel in a sealed
+/// memfd. POSIX only; returns false elsewhere.
+///
+/// Example:
+///   coretrace::SyslogSinkOptions opts;
+///   opts.format = coretrace::SyslogFormat::Journald;
+///   opts.ident = "app";
+///   coretrace::set_syslog_sink(opts);
+///
+[[nodiscard]] bool set_syslog_sink(const SyslogSinkOptions &options = {});
+
+/// Redirect all log output to a collector at host:port. Every record
+/// becomes a frame: a 4-byte big-endian length, then the record as the
+/// layout renders it (multi-line and CBOR records included; a batch gives
+/// one frame per record). Raw writes become a frame at each line end.
+/// Producers only append frames to a bounded buffer; an I/O thread
+/// connects, coalesces frames into writes of up to batch_bytes (TCP) or
+/// sends one datagram per frame in sendmmsg() batches (UDP). While the
+/// collector is unreachable, frames wait in the buffer and the thread
+/// reconnects with exponential backoff; a TCP frame cut by a lost
+/// connection is sent again whole. Over UDP a send refused by the peer
+/// reopens the socket, and a frame too large for a datagram is dropped.
+/// A record that does not fit in the buffer is dropped whole, never cut.
+/// When the buffer is full, records are
+/// dropped and counted (sink_stats()), and a "[WARN] net overflow" frame
+/// reports the loss. An unreachable collector is not an error: only an
+/// empty host or port 0 return false. POSIX only; returns false
+/// elsewhere.
+///
+/// Example:
+///   coretrace::set_net_sink("127.0.0.1", 5170);
+///
+[[nodiscard]] bool set_net_sink(std::string_view host, uint16_t port,
+                                const NetSinkOptions &options = {});
+
+/// Make stderr output (the default destination, write_stderr()) unable to
+/// block: stderr is switched to O_NONBLOCK, bytes it does not take are
+/// parked in a bounded overflow ring and a background thread writes them
+/// once the descriptor is writable again. When the ring is full, output is
+/// dropped and counted (stderr_stats()); a "[WARN] stderr overflow" line
+/// reports the loss once stderr drains. A stalled reader (e.g. a pipe to a
+/// hung log collector) then costs lines, never a hang.
+///
+/// O_NONBLOCK belongs to the open file, which may be shared with other
+/// processes; it is cleared again when disabled and at exit. Returns false
+/// where unsupported (Windows).
+bool set_stderr_nonblocking(bool enabled, const StderrOptions &options = {});
+
+/// Counters of the stderr path while non-blocking mode is on.
+[[nodiscard]] SinkStats stderr_stats();
+
+/// Push bytes buffered by a built-in sink to their destination. The
+/// default logger's built-in sink is closed at exit.
+void flush();
+
+/// Counters of the default logger's built-in sink.
+[[nodiscard]] SinkStats sink_stats();
+
 // #######################################
 //  Timestamps
 // #######################################
@@ -190,12 +1007,205 @@ void set_timestamps(bool enabled);
 /// Default: false.
 void set_source_location(bool enabled);
 
+// #######################################
+//  Layout
+// #######################################
+
+/// Select the shape of log lines. Default: Layout::Text.
+///
+/// Layout::Json writes one JSON object per record (JSON Lines):
+///   {"ts":"2025-01-15T10:45:23.456Z","pid":1234,"tid":1235,
+///    "level":"INFO","prefix":"==ct==","module":"alloc","file":"a.cpp",
+///    "line":42,"msg":"malloc","fields":{"size":64}}
+/// "ts" is present with timestamps on, "file"/"line" with source
+/// locations on, "module" and "fields" when the record has them. The
+/// trailing newline of the message is dropped. Strings are escaped with a
+/// vectorized scanner (SSE2/AVX2 on x86-64). While the default logger is
+/// in JSON mode, color() and level_color() return empty sequences, so
+/// colors formatted into messages never reach the output; another
+/// logger's Logger::color() follows that logger's layout. Low-level
+/// writes (write_raw(), LineBuilder) are passed through unchanged.
+///
+/// Layout::Cbor writes each record as a binary CBOR map with small integer
+/// keys (level, time in nanoseconds, pid, tid, prefix, module, file, line,
+/// message, fields) and no text rendering of numbers. Prefix, module and
+/// file names are sent once per output stream as {id, name} definitions
+/// and then referred to by id. A new sink, a rotated file, a restarted
+/// pipe child and a new network connection each start a new stream
+/// (records queued before a restart may still use the old ids).
+/// ct-logcbor turns such a stream back into the text layout. Colors are
+/// off as with Layout::Json; low-level writes still pass through
+/// unchanged and do not belong in a CBOR stream. Layout::Cbor is not
+/// selected while a sharded sink is installed: shards are read back as
+/// lines.
+void set_layout(Layout layout);
+
+/// Return the current layout.
+[[nodiscard]] Layout layout();
+
+/// Compile a line pattern and switch to Layout::Pattern. Returns false,
+/// leaving the layout unchanged, if the pattern does not parse.
+///
+///   coretrace::set_pattern("%T %-5L %m@%f:%l %v");
+///
+/// Conversions: %T timestamp, %L level, %P pid, %t thread id, %p prefix
+/// tag, %m module, %f file, %l line, %v message, %k structured fields
+/// (" key=value" each), %% a '%'. Between '%' and the conversion:
+///   {text}  written before the value, and the op skipped when empty
+///   -       left-align (pad after the value)
+///   "       quote and escape the value when needed (logfmt)
+///   N       minimum width in bytes, padded with spaces
+///   .N      maximum bytes of the value
+/// %T is empty with timestamps off, %f and %l with source locations off.
+/// Lines always end with a newline; the message's own is dropped. Colors
+/// are not written. LOGFMT_PATTERN is a logfmt preset.
+///
+/// The pattern is parsed once into a flat list of ops (literal copies and
+/// field writers) that each line runs without parsing. The list is
+/// published atomically, so set_pattern() may run while other threads
+/// log. A replaced list is freed by a later set_pattern(), set_redaction()
+/// or sink switch once no thread can still run it, at the latest with the
+/// logger. set_layout(Layout::Pattern) before any set_pattern() writes the
+/// Text layout.
+[[nodiscard]] bool set_pattern(std::string_view pattern);
+
+/// Frame multi-line messages (Text and Short layouts). Default:
+/// LineFraming::Off, where only the first line of a message carries the
+/// record prefix and a message without a trailing newline runs into the
+/// next record.
+///
+///   [ts] |PID| ==ct== [ERROR] stack:        LineFraming::Prefix
+///   [ts] |PID| ==ct== [ERROR]   #0 main
+///
+///   [ts] |PID| ==ct== [ERROR] stack:        LineFraming::Indent
+///                               #0 main
+///
+/// Indent pads to the printed width of the prefix (color sequences take
+/// none). Every mode but Off also ends each record with a newline.
+/// Newlines are found with memchr(), which the C library vectorizes, and
+/// the framed record is assembled in the same stack buffer as the line,
+/// so it still reaches the sink in one call when it fits. JSON, CBOR and
+/// pattern records are framed by their layout and ignore this setting.
+void set_line_framing(LineFraming framing);
+
+/// Return the current multi-line framing.
+[[nodiscard]] LineFraming line_framing();
+
+// #######################################
+//  Sanitization
+// #######################################
+
+/// Make message bodies safe for terminals and line-oriented parsers (off
+/// by default). Printable ASCII, tab, newline and well-formed UTF-8 pass
+/// unchanged; other control bytes (ANSI escapes included) are written as
+/// "\xHH", C1 control characters as "\u00HH", and ill-formed UTF-8 as
+/// U+FFFD:
+///
+///   log(Level::Info, "user={}\n", "\x1b[2Jroot\xff");
+///   // |PID| ==ct== [INFO] user=\x1b[2Jroot<U+FFFD>
+///
+/// The escapes are for display; a backslash in the input is not escaped.
+/// Only the message body is rewritten: the prefix, colors and field values
+/// (quoted and escaped on their own) are not. Applies to log(), batches
+/// and the records handed to record-oriented sinks; raw writes and
+/// LineBuilder pass through.
+///
+/// The message is checked 32 bytes per step with AVX2, UTF-8 validation
+/// included, when the CPU has it (SSE2 ASCII runs otherwise), and a clean
+/// message is never copied: leaving this on costs one pass over it.
+/// Each Logger has a single sink: enable it on the loggers whose
+/// destination needs it.
+void set_sanitize(bool enabled);
+
+/// Return whether message bodies are sanitized.
+[[nodiscard]] bool sanitize_enabled();
+
+// #######################################
+//  Redaction
+// #######################################
+
+/// Replace every match of the rules in message bodies before any sink or
+/// the blob file sees them (off by default), so tokens, addresses and card
+/// numbers never reach disk:
+///
+///   set_redaction({{"Bearer \\S+", "Bearer [REDACTED]"},
+///                  {"[\\w.+-]+@\\w+\\.[\\w.]+"},
+///                  {"\\d{13,19}", "[CARD]"}});
+///   log(Level::Info, "auth=Bearer eyJhbGci user=ann@example.com\n");
+///   // |PID| ==ct== [INFO] auth=Bearer [REDACTED] user=[REDACTED]
+///
+/// A pattern is a sequence of bytes and classes, each optionally repeated
+/// with ?, *, +, {n}, {n,} or {n,m} (at most 1024): \d digit, \w word
+/// byte, \s white space, \S not white space, \h hex digit, . any byte but
+/// newline, [a-z_] or [^...] a set; \ makes any other byte literal. ( ) |
+/// and a bare ] or } are reserved. Repeats are greedy and overlapping
+/// matches are replaced once. A pattern without a literal byte is tried
+/// at every offset of a run of its first class, left to right, so
+/// \d{3}[ -]\d{4} finds 555-1234 in 0555-1234. Checking one place is
+/// bounded: a pattern chaining open-ended repeats (".*x.*y.*z") may miss
+/// a match rather than stall the logger.
+///
+/// The literal part of every rule is found in one pass by a multi-pattern
+/// automaton; bytes that cannot start a match are skipped 32 at a time
+/// with AVX2 when the CPU has it, and a message without a match is never
+/// copied. Only message bodies are rewritten: the prefix and structured
+/// field values are not. Applies to log(), batches and the records handed
+/// to record-oriented sinks, after set_sanitize() and before the record
+/// size cap; raw writes and LineBuilder pass through.
+///
+/// Returns false if a pattern is invalid (the previous rules stay in use).
+/// An empty list is the same as clear_redaction().
+[[nodiscard]] bool set_redaction(std::initializer_list<RedactRule> rules);
+[[nodiscard]] bool set_redaction(const RedactRule *rules, size_t count);
+
+/// Stop redacting.
+void clear_redaction();
+
+// #######################################
+//  Oversized records
+// #######################################
+
+/// Smallest cap accepted by set_max_record_size() (room for the marker).
+inline constexpr size_t MIN_RECORD_SIZE = 128;
+
+/// Cap the message of each record at max_bytes (0, the default: no cap;
+/// smaller values are raised to MIN_RECORD_SIZE). A longer message is cut
+/// at a UTF-8 boundary and ends with a marker counting what was dropped,
+/// all within max_bytes:
+///
+///   |PID| ==ct== [INFO] payload: 0123456789abcdef…[+4194176 bytes]
+///
+/// log() with a format string keeps only the first max_bytes while
+/// formatting, so an accidental multi-megabyte argument never builds a
+/// multi-megabyte string, and no record holds the output lock for longer
+/// than max_bytes take to write. Applies to every layout; the prefix and
+/// structured fields are not counted. LogBatch records, and every record
+/// while set_redaction() rules are set, are cut after formatting.
+void set_max_record_size(size_t max_bytes);
+
+/// Return the message size cap (0: none).
+[[nodiscard]] size_t max_record_size();
+
+/// Keep the full payload of cut messages in a sidecar file (appended to,
+/// created if needed); an empty path closes it. Each payload is written
+/// as "#blob ID SIZE\n", the SIZE bytes and "\n", before its record, and
+/// the marker names it:
+///
+///   |PID| ==ct== [INFO] payload: 0123…[+4194176 bytes, blob 1234-1]
+///
+/// IDs are "PID-N", N counting from 1 per logger. Blobs are written under
+/// their own lock, never the output lock. Returns false if the file cannot
+/// be opened (the previous one stays in use).
+[[nodiscard]] bool set_blob_file(std::string_view path);
+
 // #######################################
 //  Color helpers
 // #######################################
 
 /// Return the ANSI escape sequence for the given color.
-/// Returns empty string_view when color output is disabled.
+/// Returns empty string_view when color output is disabled or the default
+/// logger uses Layout::Json or Layout::Cbor (see Logger::color() for
+/// another logger).
 [[nodiscard]] std::string_view color(Color c);
 
 /// Return the label string for a log level ("DEBUG", "INFO", "WARN", "ERROR").
@@ -215,7 +1225,8 @@ void write_raw(const char *data, size_t size);
 void write_str(std::string_view value);
 
 /// Write the formatted log prefix to the current sink.
-/// NOT mutex-protected — use write_log_line() for atomic output.
+/// NOT mutex-protected — use LineBuilder or write_log_line() for atomic
+/// output.
 void write_prefix(Level level);
 
 /// Write a decimal number (stack-allocated, no heap).
@@ -224,6 +1235,86 @@ void write_dec(size_t value);
 /// Write a hex number with "0x" prefix (stack-allocated, no heap).
 void write_hex(uintptr_t value);
 
+// #######################################
+//  LineBuilder — atomic low-level lines
+// #######################################
+
+/// Assembles one line from the low-level primitives in a fixed stack buffer
+/// and commits it with a single sink call under the logger's output lock,
+/// so lines from concurrent threads never interleave. Never allocates and
+/// never uses std::format, which makes it safe inside allocation hooks.
+/// Bytes past CAPACITY are dropped (see truncated()).
+///
+/// Example:
+///   coretrace::LineBuilder line;
+///   line.append_prefix(Level::Info)
+///       .append_str("malloc ptr=")
+///       .append_hex(reinterpret_cast<uintptr_t>(ptr))
+///       .append_str(" size=")
+///       .append_dec(size)
+///       .append_str("\n");
+///   line.commit();
+///
+class LineBuilder {
+public:
+  static constexpr size_t CAPACITY = 512;
+
+  explicit LineBuilder(Logger &logger = default_logger()) noexcept
+      : logger_(&logger) {}
+
+  LineBuilder(const LineBuilder &) = delete;
+  LineBuilder &operator=(const LineBuilder &) = delete;
+
+  /// Append the log prefix, same layout as write_prefix().
+  LineBuilder &append_prefix(Level level);
+
+  LineBuilder &append_str(std::string_view value);
+  LineBuilder &append_raw(const char *data, size_t size);
+
+  /// Append an integer in decimal (two digits per division).
+  template <std::integral T> LineBuilder &append_dec(T value) {
+    if constexpr (std::is_signed_v<T>) {
+      if (value < 0)
+        return append_udec(0ULL - static_cast<unsigned long long>(value),
+                           true);
+    }
+    return append_udec(static_cast<unsigned long long>(value), false);
+  }
+
+  /// Append an integer as "0x" + lowercase hex, no leading zeros.
+  LineBuilder &append_hex(unsigned long long value);
+
+  /// Append the shortest round-trip representation (std::to_chars).
+  LineBuilder &append_float(double value);
+
+  /// Append with a fixed number of decimals (std::to_chars).
+  LineBuilder &append_float(double value, int precision);
+
+  /// Write the line to the sink in one call, then clear the builder.
+  void commit();
+
+  /// Discard the current contents.
+  void clear() noexcept {
+    len_ = 0;
+    truncated_ = false;
+    level_ = Level::Info;
+  }
+
+  [[nodiscard]] std::string_view view() const noexcept { return {buf_, len_}; }
+
+  /// True if bytes were dropped because the line exceeded CAPACITY.
+  [[nodiscard]] bool truncated() const noexcept { return truncated_; }
+
+private:
+  LineBuilder &append_udec(unsigned long long value, bool negative);
+
+  Logger *logger_;
+  size_t len_ = 0;
+  bool truncated_ = false;
+  Level level_ = Level::Info; // from append_prefix(), for sink policies
+  char buf_[CAPACITY];
+};
+
 // #######################################
 //  System info
 // #######################################
@@ -247,6 +1338,17 @@ void write_log_line(Level level, std::string_view module_name,
 /// Lazy one-time initialization (env vars, etc.).
 void init_once();
 
+/// Buffer size required by format_timestamp().
+inline constexpr size_t TIMESTAMP_CAPACITY = 32;
+
+/// Render "[YYYY-MM-DDThh:mm:ss.mmm] " into buf (at least TIMESTAMP_CAPACITY
+/// bytes). Returns the number of bytes written, 0 if the clock is unavailable.
+size_t format_timestamp(char *buf);
+
+/// Write raw bytes to stderr with EINTR retry, bypassing any sink. Never
+/// blocks in non-blocking mode (see set_stderr_nonblocking()).
+void write_stderr(const char *data, size_t size);
+
 // #######################################
 //  Main logging function
 // #######################################
@@ -260,24 +1362,9 @@ void init_once();
 ///   coretrace::log(Level::Warn, "count={}\n", 42);
 ///
 template <typename... Args>
+  requires detail::FormatPack<Args...>
 inline void log(LogEntry entry, std::string_view fmt, Args &&...args) {
-  init_once();
-
-  if (!log_is_enabled())
-    return;
-  if (static_cast<int>(entry.level) < static_cast<int>(min_level()))
-    return;
-
-  try {
-    std::string msg = std::vformat(fmt, std::make_format_args(args...));
-    if (msg.empty())
-      return;
-
-    write_log_line(entry.level, {}, msg, entry.loc);
-  } catch (...) {
-    static const char fallback[] = "coretrace: log format error\n";
-    write_raw(fallback, sizeof(fallback) - 1);
-  }
+  default_logger().log(entry, fmt, std::forward<Args>(args)...);
 }
 
 /// Log a formatted message with a module tag.
@@ -287,28 +1374,175 @@ inline void log(LogEntry entry, std::string_view fmt, Args &&...args) {
 ///   coretrace::log(Level::Info, Module("alloc"), "malloc ptr={:p}\n", ptr);
 ///
 template <typename... Args>
+  requires detail::FormatPack<Args...>
 inline void log(LogEntry entry, Module mod, std::string_view fmt,
                 Args &&...args) {
-  init_once();
-
-  if (!log_is_enabled())
-    return;
-  if (static_cast<int>(entry.level) < static_cast<int>(min_level()))
-    return;
-  if (!mod.name.empty() && !module_is_enabled(mod.name))
-    return;
-
-  try {
-    std::string msg = std::vformat(fmt, std::make_format_args(args...));
-    if (msg.empty())
+  default_logger().log(entry, mod, fmt, std::forward<Args>(args)...);
+}
+
+/// Log a message with typed key/value fields (see kv()). Text output
+/// appends them to the message as " key=value" (strings with spaces,
+/// quotes, '=' or control characters are quoted and escaped) and ends the
+/// line; record-oriented sinks (syslog, journald) keep them as separate
+/// structured fields. Values are rendered straight into the line buffer,
+/// with no std::format and no temporary string.
+///
+/// Example:
+///   coretrace::log(Level::Info, Module("alloc"), "malloc",
+///                  kv("ptr", ptr), kv("size", 64));
+///   // ... (alloc) malloc ptr=0x7f3a5c001000 size=64
+///
+template <typename... Fields>
+  requires detail::FieldPack<Fields...>
+inline void log(LogEntry entry, std::string_view message,
+                const Fields &...fields) {
+  default_logger().log(entry, message, fields...);
+}
+
+template <typename... Fields>
+  requires detail::FieldPack<Fields...>
+inline void log(LogEntry entry, Module mod, std::string_view message,
+                const Fields &...fields) {
+  default_logger().log(entry, mod, message, fields...);
+}
+
+// #######################################
+//  Hex dumps
+// #######################################
+
+/// Bytes shown by log_hexdump() unless set_max_hexdump_size() says
+/// otherwise.
+inline constexpr size_t DEFAULT_HEXDUMP_SIZE = 4096;
+
+/// Log size bytes at data as canonical hex dump rows (offset, hex, ASCII;
+/// the layout of `hexdump -C`), as a single record written under one hold
+/// of the output lock, so rows of concurrent dumps never interleave.
+///
+/// Example:
+///   coretrace::log_hexdump(Level::Debug, Module("alloc"), ptr, 4);
+///   // |PID| ==ct== [DEBUG] (alloc) hexdump 0x7f3a5c001000, 4 bytes
+///   // 00000000  de ad be ef                                       |....|
+///
+/// Bytes are turned into hex 16 at a time (SSE2 on x86-64) and the rows
+/// are rendered in place, with no std::format. Dumps of up to about 700
+/// bytes are assembled on the stack; larger ones take one allocation.
+/// Past max_hexdump_size() bytes the dump ends with "…[+N bytes]". A null
+/// data shows no rows. The record is subject to set_max_record_size().
+inline void log_hexdump(LogEntry entry, Module mod, const void *data,
+                        size_t size) {
+  default_logger().log_hexdump(entry, mod.name, data, size);
+}
+
+inline void log_hexdump(LogEntry entry, const void *data, size_t size) {
+  default_logger().log_hexdump(entry, {}, data, size);
+}
+
+/// Cap the bytes shown by a hex dump (default DEFAULT_HEXDUMP_SIZE; 0: no
+/// cap).
+void set_max_hexdump_size(size_t max_bytes);
+
+/// Return the hex dump cap (0: none).
+[[nodiscard]] size_t max_hexdump_size();
+
+// #######################################
+//  LogBatch — bulk dumps in one write
+// #######################################
+
+/// Timestamping of batched records (when timestamps are enabled).
+enum class BatchTimestamp {
+  Shared,    // one clock read when the batch is created
+  PerRecord, // one clock read per record
+};
+
+/// Collects many records at one level (and optional module) and commits
+/// them with a single output-lock acquisition and a single sink write.
+/// Filters and the prefix snapshot are evaluated once, at construction; a
+/// filtered batch skips formatting entirely. Records accumulate in a heap
+/// buffer until commit() or destruction.
+///
+/// Example:
+///   coretrace::LogBatch dump(Level::Debug, Module("alloc"));
+///   for (const auto &blk : arena)
+///     dump.add("blk {:p} size={}\n", blk.ptr, blk.size);
+///   dump.commit(); // or let the destructor commit
+///
+class LogBatch {
+public:
+  explicit LogBatch(LogEntry entry, Logger &logger = default_logger(),
+                    BatchTimestamp stamping = BatchTimestamp::Shared);
+  LogBatch(LogEntry entry, Module mod, Logger &logger = default_logger(),
+           BatchTimestamp stamping = BatchTimestamp::Shared);
+  ~LogBatch();
+
+  LogBatch(const LogBatch &) = delete;
+  LogBatch &operator=(const LogBatch &) = delete;
+
+  /// Append one formatted record (std::format syntax), formatted straight
+  /// into the batch buffer.
+  template <typename... Args> void add(std::string_view fmt, Args &&...args) {
+    if (!active_)
       return;
 
-    write_log_line(entry.level, mod.name, msg, entry.loc);
-  } catch (...) {
-    static const char fallback[] = "coretrace: log format error\n";
-    write_raw(fallback, sizeof(fallback) - 1);
+    const size_t start = begin_record();
+    try {
+      std::vformat_to(std::back_inserter(buffer_), fmt,
+                      std::make_format_args(args...));
+    } catch (...) {
+      fail_record(start);
+      return;
+    }
+    end_record(start);
   }
-}
+
+  /// Append one preformatted record.
+  void add_line(std::string_view message);
+
+  /// Write every pending record in one sink call and empty the batch.
+  void commit();
+
+  /// False when the batch was filtered out at construction.
+  [[nodiscard]] bool active() const noexcept { return active_; }
+
+  /// Number of records pending commit.
+  [[nodiscard]] size_t size() const noexcept { return count_; }
+
+private:
+  size_t begin_record();
+  void end_record(size_t start);
+  void fail_record(size_t start);
+  void append_batch_pattern(std::string_view message);
+
+  Logger *logger_;
+  Level level_ = Level::Info;
+  bool active_ = false;
+  bool per_record_timestamp_ = false;
+  bool json_ = false; // Layout::Json records
+  bool cbor_ = false; // Layout::Cbor records
+  // The sink takes records (syslog): buffer_ holds bare bodies, handed
+  // over one by one with module_ and, when source locations are on, loc_.
+  bool records_ = false;
+  bool record_loc_ = false;
+  std::source_location loc_;
+  bool sanitize_ = false;
+  // The batch counts as a reader of the logger so that the pattern and
+  // the rules in effect when it began outlive it when replaced.
+  std::atomic<unsigned> *readers_ = nullptr;
+  const detail::redact::Matcher *redactor_ = nullptr;
+  LineFraming framing_ = LineFraming::Off; // text layouts
+  // Layout::Pattern: records are rendered whole by end_record() from the
+  // program and the context captured by the constructor.
+  const detail::pattern::Program *pattern_ = nullptr;
+  const char *file_ = nullptr; // null with source locations off
+  unsigned line_ = 0;
+  std::string module_;
+  std::string timestamp_; // shared timestamp
+  size_t count_ = 0;
+  size_t body_start_ = 0;
+  std::string prefix_;
+  std::string buffer_;
+  std::vector<size_t> ends_; // end of each record in buffer_
+  std::string scratch_;
+};
 
 } // namespace coretrace
 
@@ -1,12 +1,25 @@
 #include "coretrace/logger.hpp"
 
+#include "logger_cbor.hpp"
+#include "logger_hex.hpp"
+#include "logger_json.hpp"
+#include "logger_pattern.hpp"
 #include "logger_platform.hpp"
+#include "logger_redact.hpp"
+#include "logger_sanitize.hpp"
+#include "logger_sink.hpp"
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <bit>
+#include <charconv>
 #include <cstdlib>
 #include <cstring>
 #include <mutex>
+#include <new>
 #include <string_view>
+#include <system_error>
 
 namespace coretrace {
 
@@ -16,20 +29,11 @@ namespace {
 
 constexpr int MAX_MODULES = 32;
 constexpr int MODULE_NAME_LEN = 32;
+constexpr size_t PREFIX_CAPACITY = 64;
 
-// ── Enable / Disable ─────────────────────
-
-std::atomic<int> g_log_enabled{0};
-
-// ── Prefix ───────────────────────────────
-
-char g_prefix_buf[64] = "==ct==";
-size_t g_prefix_len = 6;
-
-// ── Level filtering ──────────────────────
-
-std::atomic<int> g_min_level{static_cast<int>(Level::Info)};
-std::atomic<int> g_min_level_set_explicitly{0};
+// Destructive interference size. Hard-coded because
+// std::hardware_destructive_interference_size is not available everywhere.
+constexpr size_t CACHE_LINE = 64;
 
 // ── Module filtering ─────────────────────
 
@@ -39,77 +43,217 @@ struct ModuleTable {
   int filter_active = 0; // 1 if at least one module was registered
 };
 
-ModuleTable g_modules{};
-std::atomic<int> g_modules_set_explicitly{0};
-
-// ── Synchronization ──────────────────────
-
-// Protects mutable logger state (prefix + modules table).
-std::mutex g_state_mutex;
-
-// Protects atomicity of one log line output when thread-safe mode is on.
-std::mutex g_output_mutex;
-std::atomic<int> g_thread_safe{1}; // enabled by default
-
-// ── Sink ─────────────────────────────────
-
-std::atomic<SinkFn> g_sink{nullptr};
-
-// ── Timestamps ───────────────────────────
+} // namespace
 
-std::atomic<int> g_timestamps_enabled{0};
+// ####################################
+//  Logger state
+// ####################################
 
-// ── Source location ──────────────────────
+// Per-instance state. Laid out in cache-line sized groups so that the flags
+// read on every log() call, the output lock hammered by writers and the
+// configuration written by set_*() never share a line, neither within one
+// instance nor across instances.
+struct alignas(CACHE_LINE) Logger::State {
+  constexpr explicit State(bool env_defaults) : apply_env(env_defaults) {}
+
+  // ── Hot: read on every log() call ────
+
+  std::atomic<int> log_enabled{0};
+  std::atomic<int> min_level{static_cast<int>(Level::Info)};
+  std::atomic<int> thread_safe{1}; // enabled by default
+  std::atomic<int> timestamps_enabled{0};
+  std::atomic<int> source_location_enabled{0};
+  std::atomic<int> layout{static_cast<int>(Layout::Text)};
+  std::atomic<detail::pattern::Program *> pattern{nullptr};
+  std::atomic<int> line_framing{static_cast<int>(LineFraming::Off)};
+  std::atomic<int> sanitize{0};
+  std::atomic<detail::redact::Matcher *> redactor{nullptr};
+  std::atomic<size_t> max_record_size{0}; // 0: no cap
+  std::atomic<size_t> max_hexdump_size{DEFAULT_HEXDUMP_SIZE};
+  std::atomic<int> blob_enabled{0};
+  std::atomic<SinkFn> sink{nullptr};
+  std::atomic<detail::SinkBackend *> backend{nullptr}; // built-in sink
+
+  // ── Output serialization ─────────────
+
+  // Protects atomicity of one log line output when thread-safe mode is on.
+  alignas(CACHE_LINE) std::mutex output_mutex;
+
+  // ── Reclamation ──────────────────────
+
+  // Writers that use the backend, pattern or rule set outside the state
+  // lock count themselves in readers[epoch & 1] (ReadGuard). The epoch
+  // only advances, under the state lock, while no writer is counted in
+  // the slot it moves to; an object retired in epoch e is freed from
+  // e + 2 on, when both slots have been seen empty since.
+  alignas(CACHE_LINE) std::atomic<unsigned> epoch{0};
+  std::atomic<unsigned> readers[2]{};
+
+  // ── Configuration ────────────────────
+
+  // Protects mutable logger state (prefix + modules table).
+  alignas(CACHE_LINE) std::mutex state_mutex;
+
+  char prefix_buf[PREFIX_CAPACITY] = "==ct==";
+  size_t prefix_len = 6;
+
+  ModuleTable modules{};
+
+  // Built-in sinks replaced at runtime. A writer that loaded the pointer
+  // just before the switch may still be inside write(), so retired backends
+  // are closed at once but deleted by reclaim_locked().
+  detail::SinkBackend *retired = nullptr;
+
+  // Name ids of the Layout::Cbor stream, created with the first record and
+  // used under the output lock.
+  detail::cbor::Interner *interner = nullptr;
+
+  // Patterns replaced by set_pattern() (see pattern::Program).
+  detail::pattern::Program *retired_patterns = nullptr;
+
+  // Rule sets replaced by set_redaction() (see redact::Matcher).
+  detail::redact::Matcher *retired_redactors = nullptr;
+
+  // ── Oversized records ────────────────
+
+  // Protects the blob file. Held while a payload is written, never
+  // together with the output lock.
+  alignas(CACHE_LINE) std::mutex blob_mutex;
+  int blob_fd = -1;
+  uint64_t blob_count = 0;
+
+  // ── Init ─────────────────────────────
+
+  std::atomic<int> min_level_set_explicitly{0};
+  std::atomic<int> modules_set_explicitly{0};
+  std::atomic<int> env_applied{0};
+  std::once_flag init_flag;
+  const bool apply_env; // seed from CT_LOG_LEVEL / CT_DEBUG
+};
 
-std::atomic<int> g_source_location_enabled{0};
+namespace {
 
-// ── Init ─────────────────────────────────
+using State = Logger::State;
 
-std::once_flag g_init_once;
+// Statically initialized so the default logger works before main() and
+// never touches the heap.
+constinit State g_default_state{true};
 
 // ── Small lock guards ────────────────────
 
 struct StateLockGuard {
-  StateLockGuard() { g_state_mutex.lock(); }
-  ~StateLockGuard() { g_state_mutex.unlock(); }
+  explicit StateLockGuard(State &state) : state(state) {
+    state.state_mutex.lock();
+  }
+  ~StateLockGuard() { state.state_mutex.unlock(); }
 
   StateLockGuard(const StateLockGuard &) = delete;
   StateLockGuard &operator=(const StateLockGuard &) = delete;
+
+  State &state;
 };
 
+// Takes the output lock when thread safety is on, unless the active
+// built-in sink accepts concurrent writes: that backend is then kept in
+// `concurrent` and the caller writes to it directly, so a sink switch
+// racing with the record cannot hand it to an unserialized destination.
 struct OutputLockGuard {
-  OutputLockGuard()
-      : locked(g_thread_safe.load(std::memory_order_acquire) != 0) {
-    if (locked)
-      g_output_mutex.lock();
+  explicit OutputLockGuard(State &state)
+      : state(state),
+        locked(state.thread_safe.load(std::memory_order_acquire) != 0) {
+    if (!locked)
+      return;
+    detail::SinkBackend *backend =
+        state.backend.load(std::memory_order_acquire);
+    if (backend && backend->concurrent_writes) {
+      concurrent = backend;
+      locked = false;
+      return;
+    }
+    state.output_mutex.lock();
   }
 
   ~OutputLockGuard() {
     if (locked)
-      g_output_mutex.unlock();
+      state.output_mutex.unlock();
   }
 
   OutputLockGuard(const OutputLockGuard &) = delete;
   OutputLockGuard &operator=(const OutputLockGuard &) = delete;
 
+  State &state;
   bool locked;
+  detail::SinkBackend *concurrent = nullptr;
+};
+
+// A writer about to load the backend, pattern or rule set counts itself
+// in; nothing retired meanwhile is freed before it leaves.
+[[nodiscard]] std::atomic<unsigned> *enter_readers(State &state) {
+  std::atomic<unsigned> *readers =
+      &state.readers[state.epoch.load(std::memory_order_relaxed) & 1];
+  readers->fetch_add(1, std::memory_order_relaxed);
+  // Pairs with the fence in reclaim_locked(): either the count is seen
+  // there, or the pointers loaded after this are the new ones.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  return readers;
+}
+
+void leave_readers(std::atomic<unsigned> *readers) {
+  readers->fetch_sub(1, std::memory_order_release);
+}
+
+struct ReadGuard {
+  explicit ReadGuard(State &state) : readers(enter_readers(state)) {}
+  ~ReadGuard() { leave_readers(readers); }
+
+  ReadGuard(const ReadGuard &) = delete;
+  ReadGuard &operator=(const ReadGuard &) = delete;
+
+  std::atomic<unsigned> *readers;
+};
+
+// Brackets the writes of one rendered record for a built-in sink that
+// frames records. Created under the output lock (or with the concurrent
+// backend it picked), so the backend cannot change meanwhile.
+struct RecordFrame {
+  RecordFrame(State &state, const OutputLockGuard &output_lock)
+      : backend(output_lock.concurrent
+                    ? output_lock.concurrent
+                    : state.backend.load(std::memory_order_acquire)) {
+    if (backend && backend->frames_records)
+      backend->begin_record();
+    else
+      backend = nullptr;
+  }
+  ~RecordFrame() {
+    if (backend)
+      backend->end_record();
+  }
+
+  RecordFrame(const RecordFrame &) = delete;
+  RecordFrame &operator=(const RecordFrame &) = delete;
+
+  detail::SinkBackend *backend;
 };
 
 struct PrefixSnapshot {
-  char value[sizeof(g_prefix_buf)];
+  char value[PREFIX_CAPACITY];
   size_t len = 0;
+  Layout layout = Layout::Text;
 };
 
-[[nodiscard]] PrefixSnapshot read_prefix_snapshot() {
+[[nodiscard]] PrefixSnapshot read_prefix_snapshot(State &state) {
   PrefixSnapshot snapshot{};
 
-  StateLockGuard guard;
+  StateLockGuard guard(state);
 
-  snapshot.len = g_prefix_len;
+  snapshot.len = state.prefix_len;
   if (snapshot.len > sizeof(snapshot.value))
     snapshot.len = sizeof(snapshot.value);
 
-  std::memcpy(snapshot.value, g_prefix_buf, snapshot.len);
+  std::memcpy(snapshot.value, state.prefix_buf, snapshot.len);
+  snapshot.layout =
+      static_cast<Layout>(state.layout.load(std::memory_order_acquire));
   return snapshot;
 }
 
@@ -140,6 +284,11 @@ struct PrefixSnapshot {
   return enabled;
 }
 
+// ANSI sequence of c, or empty with color output off. Rendered prefixes
+// use these directly: only the text layouts render one.
+[[nodiscard]] std::string_view ansi(Color c);
+[[nodiscard]] std::string_view ansi_level(Level level);
+
 // ── String helpers ───────────────────────
 
 [[nodiscard]] bool sv_eq(std::string_view a, std::string_view b) {
@@ -229,230 +378,1509 @@ void write_timestamp_to(char *buf, size_t &idx) {
   buf[idx++] = ' ';
 }
 
-// ── Extract basename from path ───────────
+// ── Number formatting ────────────────────
+
+// "00" "01" ... "99": emitting two digits per division halves the number
+// of divisions.
+constexpr auto DIGIT_PAIRS = [] {
+  std::array<char, 200> table{};
+  for (int i = 0; i < 100; ++i) {
+    table[static_cast<size_t>(i * 2)] = static_cast<char>('0' + i / 10);
+    table[static_cast<size_t>(i * 2 + 1)] = static_cast<char>('0' + i % 10);
+  }
+  return table;
+}();
+
+constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+// Largest outputs of format_dec() and format_hex().
+constexpr size_t DEC_CAPACITY = 20;
+constexpr size_t HEX_CAPACITY = 2 + 16;
+
+// Writes value in decimal. Returns the number of bytes written.
+size_t format_dec(char *out, unsigned long long value) {
+  char tmp[DEC_CAPACITY];
+  size_t idx = sizeof(tmp);
+
+  while (value >= 100) {
+    const size_t pair = static_cast<size_t>(value % 100) * 2;
+    value /= 100;
+    idx -= 2;
+    tmp[idx] = DIGIT_PAIRS[pair];
+    tmp[idx + 1] = DIGIT_PAIRS[pair + 1];
+  }
+
+  if (value >= 10) {
+    const size_t pair = static_cast<size_t>(value) * 2;
+    idx -= 2;
+    tmp[idx] = DIGIT_PAIRS[pair];
+    tmp[idx + 1] = DIGIT_PAIRS[pair + 1];
+  } else {
+    tmp[--idx] = static_cast<char>('0' + value);
+  }
+
+  const size_t len = sizeof(tmp) - idx;
+  std::memcpy(out, tmp + idx, len);
+  return len;
+}
 
-[[nodiscard]] const char *basename_of(const char *path) {
-  if (!path)
-    return "<unknown>";
+// Writes value as "0x" + lowercase hex without leading zeros.
+size_t format_hex(char *out, unsigned long long value) {
+  const int digits = value == 0 ? 1 : (std::bit_width(value) + 3) / 4;
 
-  const char *last = path;
-  for (const char *p = path; *p; ++p) {
-    if (*p == '/' || *p == '\\')
-      last = p + 1;
+  out[0] = '0';
+  out[1] = 'x';
+  for (int i = digits - 1; i >= 0; --i) {
+    out[2 + i] = HEX_DIGITS[value & 0xF];
+    value >>= 4;
   }
-  return last;
+  return 2 + static_cast<size_t>(digits);
 }
 
-// ── Module helpers (state lock required) ─
+// ── Line assembly ────────────────────────
 
-void add_module_locked(std::string_view name) {
-  // Check if already registered.
-  for (int i = 0; i < g_modules.count; ++i) {
-    if (sv_eq(name, std::string_view(g_modules.names[i])))
+// Bytes assembled on the stack per log line before the message body is
+// written separately.
+constexpr size_t LINE_CAPACITY = 1024;
+
+// Append cursor over a fixed buffer. Bytes past the end are dropped and
+// flagged instead of written out of bounds.
+struct LineCursor {
+  char *data;
+  size_t capacity;
+  size_t len = 0;
+  bool truncated = false;
+
+  void append(const char *src, size_t n) {
+    if (n > capacity - len) {
+      n = capacity - len;
+      truncated = true;
+    }
+    if (n == 0)
       return;
+    std::memcpy(data + len, src, n);
+    len += n;
   }
 
-  if (g_modules.count < MAX_MODULES) {
-    for (size_t i = 0; i < name.size(); ++i)
-      g_modules.names[g_modules.count][i] = name[i];
-    g_modules.names[g_modules.count][name.size()] = '\0';
-    g_modules.count++;
-    g_modules.filter_active = 1;
+  void append(std::string_view value) { append(value.data(), value.size()); }
+
+  void append_dec(unsigned long long value) {
+    char tmp[DEC_CAPACITY];
+    append(tmp, format_dec(tmp, value));
+  }
+};
+
+// |PID| prefix [LEVEL], or [LEVEL] alone with Layout::Short
+void append_level_prefix(LineCursor &line, const PrefixSnapshot &prefix,
+                         Level level) {
+  if (prefix.layout != Layout::Short) {
+    // |PID|
+    line.append(ansi(Color::Dim));
+    line.append("|", 1);
+    line.append_dec(static_cast<unsigned long long>(pid()));
+    line.append("|", 1);
+    line.append(ansi(Color::Reset));
+    line.append(" ", 1);
+
+    // Configurable prefix tag.
+    line.append(ansi(Color::Gray));
+    line.append(ansi(Color::Italic));
+    line.append(prefix.value, prefix.len);
+    line.append(" ", 1);
+    line.append(ansi(Color::Reset));
   }
+
+  // [LEVEL]
+  line.append(ansi_level(level));
+  line.append("[", 1);
+  line.append(level_label(level));
+  line.append("]", 1);
+  line.append(ansi(Color::Reset));
 }
 
-void init_from_env() {
-  // CT_LOG_LEVEL=debug|info|warn|error
-  // (startup default only, explicit API has priority)
-  if (g_min_level_set_explicitly.load(std::memory_order_acquire) == 0) {
-    const char *env_level = env_var("CT_LOG_LEVEL");
-    if (env_level)
-      g_min_level.store(parse_level_from_env(env_level),
-                        std::memory_order_release);
+// [ts] |PID| prefix [LEVEL] file:line (module) — everything before the
+// message body. Expects a fresh cursor (the timestamp is written in place).
+void append_record_prefix(LineCursor &line, State &state,
+                          const PrefixSnapshot &prefix, Level level,
+                          std::string_view module,
+                          const std::source_location &loc,
+                          bool with_timestamp) {
+  // Optional timestamp: [2025-01-15T10:45:23.456]
+  if (with_timestamp)
+    write_timestamp_to(line.data, line.len);
+
+  append_level_prefix(line, prefix, level);
+
+  // Optional source location: file.cpp:42
+  if (state.source_location_enabled.load(std::memory_order_acquire)) {
+    line.append(" ", 1);
+    line.append(ansi(Color::Dim));
+    const char *file = detail::source_basename(loc.file_name());
+    line.append(file, std::strlen(file));
+    line.append(":", 1);
+    line.append_dec(static_cast<unsigned long long>(loc.line()));
+    line.append(ansi(Color::Reset));
   }
 
-  // CT_DEBUG=mod1,mod2,... (default only, explicit API has priority)
-  if (g_modules_set_explicitly.load(std::memory_order_acquire) == 0) {
-    const char *env_debug = env_var("CT_DEBUG");
-    if (env_debug && env_debug[0] != '\0') {
-      StateLockGuard guard;
+  // Optional module tag: (alloc)
+  if (!module.empty()) {
+    line.append(" ", 1);
+    line.append(ansi(Color::Dim));
+    line.append("(", 1);
+    line.append(module);
+    line.append(")", 1);
+    line.append(ansi(Color::Reset));
+  }
 
-      // Parse comma-separated module names.
-      const char *start = env_debug;
-      while (*start) {
-        const char *end = start;
-        while (*end && *end != ',')
-          ++end;
+  line.append(" ", 1);
+}
 
-        size_t len = static_cast<size_t>(end - start);
-        if (len > 0 && len < MODULE_NAME_LEN)
-          add_module_locked(std::string_view(start, len));
+// ── Structured fields ────────────────────
 
-        start = *end ? end + 1 : end;
+// Append cursor that hands its buffer to emit each time it fills up, for
+// output of unbounded length.
+template <typename Emit> struct SpillCursor {
+  char *data;
+  size_t capacity;
+  Emit &emit;
+  size_t len = 0;
+
+  void append(const char *src, size_t n) {
+    while (n > 0) {
+      if (len == capacity) {
+        emit(data, len);
+        len = 0;
       }
+      const size_t chunk = std::min(n, capacity - len);
+      std::memcpy(data + len, src, chunk);
+      len += chunk;
+      src += chunk;
+      n -= chunk;
     }
   }
+
+  void append(std::string_view value) { append(value.data(), value.size()); }
+
+  void finish() {
+    if (len > 0)
+      emit(data, len);
+    len = 0;
+  }
+};
+
+[[nodiscard]] bool needs_quotes(std::string_view value) {
+  if (value.empty())
+    return true;
+  for (char c : value) {
+    const auto byte = static_cast<unsigned char>(c);
+    if (byte <= ' ' || byte == 0x7f || c == '"' || c == '=' || c == '\\')
+      return true;
+  }
+  return false;
 }
 
-} // namespace
+// A string value, quoted and escaped when it would not read back as one
+// token: \" \\ \n \r \t, other control bytes as \xHH.
+template <typename Cursor>
+void append_field_string(Cursor &out, std::string_view value) {
+  if (!needs_quotes(value)) {
+    out.append(value);
+    return;
+  }
 
-// ####################################
-//  Init
-// ####################################
+  out.append("\"", 1);
+  size_t run = 0;
+  for (size_t i = 0; i < value.size(); ++i) {
+    const auto byte = static_cast<unsigned char>(value[i]);
+    const bool plain = byte >= ' ' && byte != 0x7f && byte != '"' &&
+                       byte != '\\';
+    if (plain)
+      continue;
 
-void init_once() { std::call_once(g_init_once, init_from_env); }
+    out.append(value.data() + run, i - run);
+    run = i + 1;
+    char escape[4] = {'\\', static_cast<char>(byte), 0, 0};
+    size_t len = 2;
+    if (byte == '\n') {
+      escape[1] = 'n';
+    } else if (byte == '\r') {
+      escape[1] = 'r';
+    } else if (byte == '\t') {
+      escape[1] = 't';
+    } else if (byte != '"' && byte != '\\') {
+      escape[1] = 'x';
+      escape[2] = HEX_DIGITS[byte >> 4];
+      escape[3] = HEX_DIGITS[byte & 0xF];
+      len = 4;
+    }
+    out.append(escape, len);
+  }
+  out.append(value.data() + run, value.size() - run);
+  out.append("\"", 1);
+}
 
-// ####################################
-//  Enable / Disable
-// ####################################
+// " key=value" for every field.
+template <typename Cursor>
+void append_fields(Cursor &out, const Field *fields, size_t count) {
+  char buf[detail::FIELD_TEXT_CAPACITY];
+  for (size_t i = 0; i < count; ++i) {
+    const Field &field = fields[i];
+    out.append(" ", 1);
+    out.append(field.key);
+    out.append("=", 1);
+    if (field.kind == FieldKind::String)
+      append_field_string(out, field.string_value);
+    else
+      out.append(detail::field_text(field, buf));
+  }
+}
 
-void enable_logging() { g_log_enabled.store(1, std::memory_order_release); }
+// ── JSON layout ──────────────────────────
 
-void disable_logging() { g_log_enabled.store(0, std::memory_order_release); }
+template <typename Cursor>
+void append_json_string(Cursor &out, std::string_view value) {
+  out.append("\"", 1);
+  detail::json::append_escaped(out, value);
+  out.append("\"", 1);
+}
 
-[[nodiscard]] bool log_is_enabled() {
-  return g_log_enabled.load(std::memory_order_acquire) != 0;
+template <typename Cursor>
+void append_json_fields(Cursor &out, const Field *fields, size_t count) {
+  char buf[detail::FIELD_TEXT_CAPACITY];
+  out.append(",\"fields\":{", 11);
+  for (size_t i = 0; i < count; ++i) {
+    const Field &field = fields[i];
+    if (i > 0)
+      out.append(",", 1);
+    append_json_string(out, field.key);
+    out.append(":", 1);
+    switch (field.kind) {
+    case FieldKind::Bool:
+    case FieldKind::Int:
+    case FieldKind::Uint:
+      out.append(detail::field_text(field, buf));
+      break;
+    case FieldKind::Float:
+      // JSON has no inf or nan.
+      if (field.float_value - field.float_value == 0)
+        out.append(detail::field_text(field, buf));
+      else
+        out.append("null", 4);
+      break;
+    case FieldKind::String:
+    case FieldKind::Pointer:
+      append_json_string(out, detail::field_text(field, buf));
+      break;
+    }
+  }
+  out.append("}", 1);
 }
 
-// ####################################
-//  Prefix
-// ####################################
+// The members of a JSON record after "ts", up to the opening quote of
+// the message: "pid":N,"tid":N,"level":"..",...,"msg":"
+template <typename Cursor>
+void append_json_head(Cursor &out, State &state, const PrefixSnapshot &prefix,
+                      Level level, std::string_view module,
+                      const std::source_location &loc) {
+  char num[DEC_CAPACITY];
+  out.append("\"pid\":", 6);
+  out.append(num, format_dec(num, static_cast<unsigned long long>(pid())));
+  out.append(",\"tid\":", 7);
+  out.append(num, format_dec(num, thread_id()));
+  out.append(",\"level\":\"", 10);
+  out.append(level_label(level));
+  out.append("\",\"prefix\":", 11);
+  append_json_string(out, std::string_view(prefix.value, prefix.len));
+  if (!module.empty()) {
+    out.append(",\"module\":", 10);
+    append_json_string(out, module);
+  }
+  if (state.source_location_enabled.load(std::memory_order_acquire)) {
+    out.append(",\"file\":", 8);
+    append_json_string(out, detail::source_basename(loc.file_name()));
+    out.append(",\"line\":", 8);
+    out.append(num, format_dec(num, loc.line()));
+  }
+  out.append(",\"msg\":\"", 8);
+}
 
-void set_prefix(std::string_view prefix) {
-  size_t len = prefix.size();
-  if (len >= sizeof(g_prefix_buf))
-    len = sizeof(g_prefix_buf) - 1;
+// "ts":"YYYY-MM-DDThh:mm:ss.mmmZ", from the text timestamp.
+template <typename Cursor>
+void append_json_timestamp(Cursor &out) {
+  char ts[TIMESTAMP_CAPACITY];
+  size_t len = 0;
+  write_timestamp_to(ts, len);
+  if (len < 3)
+    return;
+  out.append("\"ts\":\"", 6);
+  out.append(ts + 1, len - 3); // drop "[" and "] "
+  out.append("Z\",", 3);
+}
 
-  StateLockGuard guard;
+// Records end the line themselves; a message's own newline is dropped.
+void trim_newline(std::string_view &message) {
+  if (!message.empty() && message.back() == '\n')
+    message.remove_suffix(1);
+}
 
-  for (size_t i = 0; i < len; ++i)
-    g_prefix_buf[i] = prefix[i];
-  g_prefix_buf[len] = '\0';
+// One whole JSON record, newline included.
+template <typename Cursor>
+void append_json_record(Cursor &out, State &state,
+                        const PrefixSnapshot &prefix, Level level,
+                        std::string_view module, std::string_view message,
+                        const Field *fields, size_t field_count,
+                        const std::source_location &loc, bool with_timestamp) {
+  out.append("{", 1);
+  if (with_timestamp)
+    append_json_timestamp(out);
+  append_json_head(out, state, prefix, level, module, loc);
+  trim_newline(message);
+  detail::json::append_escaped(out, message);
+  out.append("\"", 1);
+  if (fields)
+    append_json_fields(out, fields, field_count);
+  out.append("}\n", 2);
+}
 
-  g_prefix_len = len;
+// ── Multi-line framing ───────────────────
+
+// Printed width of rendered prefix bytes: ANSI sequences (ESC [ ... final
+// byte) and UTF-8 continuation bytes take none.
+[[nodiscard]] size_t visible_width(std::string_view text) {
+  size_t width = 0;
+  for (size_t i = 0; i < text.size(); ++i) {
+    const auto byte = static_cast<unsigned char>(text[i]);
+    if (byte == 0x1b) {
+      if (i + 1 < text.size() && text[i + 1] == '[')
+        ++i;
+      while (i + 1 < text.size() &&
+             (static_cast<unsigned char>(text[i + 1]) < 0x40 ||
+              static_cast<unsigned char>(text[i + 1]) > 0x7e))
+        ++i;
+      ++i; // final byte
+      continue;
+    }
+    if ((byte & 0xc0) != 0x80)
+      ++width;
+  }
+  return width;
 }
 
-// ####################################
-//  Level filtering
-// ####################################
+// The message with continuation(out) after each embedded newline, and a
+// newline added at the end if terminate is set and it has none.
+template <typename Cursor, typename Continuation>
+void append_framed(Cursor &out, std::string_view message,
+                   const Continuation &continuation, bool terminate) {
+  const char *p = message.data();
+  const char *end = p + message.size();
+  while (p != end) {
+    const auto *newline = static_cast<const char *>(
+        std::memchr(p, '\n', static_cast<size_t>(end - p)));
+    if (!newline) {
+      out.append(p, static_cast<size_t>(end - p));
+      break;
+    }
+    out.append(p, static_cast<size_t>(newline + 1 - p));
+    p = newline + 1;
+    if (p != end)
+      continuation(out);
+  }
+  if (terminate && (message.empty() || message.back() != '\n'))
+    out.append("\n", 1);
+}
 
-void set_min_level(Level level) {
-  g_min_level_set_explicitly.store(1, std::memory_order_release);
-  init_once();
-  g_min_level.store(static_cast<int>(level), std::memory_order_release);
+// ── Oversized records ────────────────────
+
+// "…[+N bytes, blob PID-N]" at most.
+constexpr size_t CLIP_MARKER_CAPACITY = 96;
+constexpr size_t BLOB_ID_CAPACITY = 2 * DEC_CAPACITY;
+
+// "…[+N bytes]", or "…[+N bytes, blob ID]".
+[[nodiscard]] size_t format_clip_marker(char *out, uint64_t dropped,
+                                        std::string_view blob) {
+  size_t len = 0;
+  const auto put = [&](std::string_view text) {
+    std::memcpy(out + len, text.data(), text.size());
+    len += text.size();
+  };
+  put("\xe2\x80\xa6[+");
+  len += format_dec(out + len, dropped);
+  put(" bytes");
+  if (!blob.empty()) {
+    put(", blob ");
+    put(blob);
+  }
+  put("]");
+  return len;
 }
 
-[[nodiscard]] Level min_level() {
-  return static_cast<Level>(g_min_level.load(std::memory_order_acquire));
+// Cut text[from..] (the first bytes of a payload of total bytes) so that
+// it ends with the clip marker within limit bytes, keeping the payload's
+// trailing newline. The cut never splits a UTF-8 sequence.
+void clip_tail(std::string &text, size_t from, size_t total, bool newline,
+               size_t limit, std::string_view blob) {
+  char marker[CLIP_MARKER_CAPACITY];
+  // The marker with every byte dropped is the longest it can get.
+  size_t marker_len = format_clip_marker(marker, total, blob);
+  size_t kept = limit - marker_len - (newline ? 1 : 0);
+  kept = std::min(kept, text.size() - from);
+  while (kept > 0 &&
+         (static_cast<unsigned char>(text[from + kept]) & 0xc0) == 0x80)
+    --kept;
+  marker_len =
+      format_clip_marker(marker, total - kept - (newline ? 1 : 0), blob);
+  text.resize(from + kept);
+  text.append(marker, marker_len);
+  if (newline)
+    text.push_back('\n');
 }
 
-// ####################################
-//  Module filtering
-// ####################################
+// Output iterator for std::vformat_to() that keeps the first limit bytes
+// and only counts the rest.
+struct ClipIterator {
+  using difference_type = std::ptrdiff_t;
+
+  std::string *out = nullptr;
+  size_t limit = 0;
+  size_t *total = nullptr;
+  char *last = nullptr;
+
+  ClipIterator &operator*() { return *this; }
+  ClipIterator &operator++() { return *this; }
+  ClipIterator &operator++(int) { return *this; }
+  // Const, as std::indirectly_writable asks of an output iterator.
+  const ClipIterator &operator=(char c) const {
+    if (out->size() < limit)
+      out->push_back(c);
+    ++*total;
+    *last = c;
+    return *this;
+  }
+};
 
-void enable_module(std::string_view name) {
-  if (name.empty() || name.size() >= MODULE_NAME_LEN)
-    return;
+// Append payload to the blob file and return its id, or an empty id
+// without a blob file or on a write error. id needs BLOB_ID_CAPACITY.
+[[nodiscard]] std::string_view store_blob(State &state,
+                                          std::string_view payload,
+                                          char *id) {
+  if (!state.blob_enabled.load(std::memory_order_acquire))
+    return {};
 
-  g_modules_set_explicitly.store(1, std::memory_order_release);
-  init_once();
+  std::lock_guard<std::mutex> guard(state.blob_mutex);
+  if (state.blob_fd < 0)
+    return {};
 
-  StateLockGuard guard;
-  add_module_locked(name);
+  size_t id_len = format_dec(id, static_cast<unsigned long long>(pid()));
+  id[id_len++] = '-';
+  id_len += format_dec(id + id_len, ++state.blob_count);
+
+  // #blob ID SIZE
+  char header[8 + BLOB_ID_CAPACITY + DEC_CAPACITY];
+  size_t len = 0;
+  std::memcpy(header, "#blob ", 6);
+  len += 6;
+  std::memcpy(header + len, id, id_len);
+  len += id_len;
+  header[len++] = ' ';
+  len += format_dec(header + len, payload.size());
+  header[len++] = '\n';
+
+  if (!platform::write_file(state.blob_fd, header, len) ||
+      !platform::write_file(state.blob_fd, payload.data(), payload.size()) ||
+      !platform::write_file(state.blob_fd, "\n", 1))
+    return {};
+  return {id, id_len};
 }
 
-void disable_module(std::string_view name) {
-  if (name.empty())
-    return;
+// ── Pattern layout ───────────────────────
+
+// What a compiled pattern refers to. Empty values write nothing but their
+// padding (or nothing at all for ops with a label).
+struct PatternRecord {
+  Level level = Level::Info;
+  std::string_view timestamp; // without brackets
+  std::string_view prefix;
+  std::string_view module;
+  std::string_view message; // without its trailing newline
+  std::string_view file;
+  unsigned line = 0; // 0 with source locations off
+  const Field *fields = nullptr;
+  size_t field_count = 0;
+};
 
-  g_modules_set_explicitly.store(1, std::memory_order_release);
-  init_once();
+// Counts the bytes appended instead of keeping them.
+struct CountCursor {
+  size_t len = 0;
 
-  StateLockGuard guard;
+  void append(const char *, size_t n) { len += n; }
+  void append(std::string_view value) { len += value.size(); }
+};
 
-  for (int i = 0; i < g_modules.count; ++i) {
-    if (sv_eq(name, std::string_view(g_modules.names[i]))) {
-      // Shift remaining entries.
-      for (int j = i; j < g_modules.count - 1; ++j)
-        std::memcpy(g_modules.names[j], g_modules.names[j + 1],
-                    MODULE_NAME_LEN);
-      g_modules.count--;
+template <typename Cursor> void append_padding(Cursor &out, size_t n) {
+  static constexpr char spaces[] = "                ";
+  while (n > 0) {
+    const size_t chunk = std::min(n, sizeof(spaces) - 1);
+    out.append(spaces, chunk);
+    n -= chunk;
+  }
+}
 
-      if (g_modules.count == 0)
-        g_modules.filter_active = 0;
+// One value with the op's label, truncation, quoting and padding.
+template <typename Cursor>
+void append_pattern_value(Cursor &out, const detail::pattern::Program &program,
+                          const detail::pattern::Op &op,
+                          std::string_view value) {
+  if (op.text_len > 0) {
+    if (value.empty())
+      return;
+    out.append(program.text_of(op));
+  }
+  if (value.size() > op.precision)
+    value = value.substr(0, op.precision);
+
+  size_t len = value.size();
+  if (op.quote) {
+    CountCursor counter;
+    append_field_string(counter, value);
+    len = counter.len;
+  }
+  const size_t pad = op.width > len ? op.width - len : 0;
+  if (!op.left)
+    append_padding(out, pad);
+  if (op.quote)
+    append_field_string(out, value);
+  else
+    out.append(value);
+  if (op.left)
+    append_padding(out, pad);
+}
 
+// Run a compiled pattern: one whole line, newline included.
+template <typename Cursor>
+void append_pattern_record(Cursor &out,
+                           const detail::pattern::Program &program,
+                           const PatternRecord &record) {
+  using detail::pattern::OpKind;
+  char num[DEC_CAPACITY];
+  for (const detail::pattern::Op &op : program.ops) {
+    switch (op.kind) {
+    case OpKind::Literal:
+      out.append(program.text_of(op));
+      break;
+    case OpKind::Timestamp:
+      append_pattern_value(out, program, op, record.timestamp);
+      break;
+    case OpKind::Level:
+      append_pattern_value(out, program, op, level_label(record.level));
+      break;
+    case OpKind::Pid:
+      append_pattern_value(
+          out, program, op,
+          {num, format_dec(num, static_cast<unsigned long long>(pid()))});
+      break;
+    case OpKind::Thread:
+      append_pattern_value(out, program, op,
+                           {num, format_dec(num, thread_id())});
+      break;
+    case OpKind::Prefix:
+      append_pattern_value(out, program, op, record.prefix);
+      break;
+    case OpKind::Module:
+      append_pattern_value(out, program, op, record.module);
+      break;
+    case OpKind::File:
+      append_pattern_value(out, program, op, record.file);
+      break;
+    case OpKind::Line:
+      append_pattern_value(out, program, op,
+                           record.line ? std::string_view(
+                                             num, format_dec(num, record.line))
+                                       : std::string_view());
+      break;
+    case OpKind::Message:
+      append_pattern_value(out, program, op, record.message);
+      break;
+    case OpKind::Fields:
+      // Several values: label only, no padding or truncation.
+      if (record.field_count == 0)
+        break;
+      out.append(program.text_of(op));
+      append_fields(out, record.fields, record.field_count);
       break;
     }
   }
+  out.append("\n", 1);
 }
 
-void enable_all_modules() {
-  g_modules_set_explicitly.store(1, std::memory_order_release);
-  init_once();
+// Timestamp text for %T: write_timestamp_to() without "[" and "] ".
+[[nodiscard]] std::string_view pattern_timestamp(char *buf) {
+  size_t len = 0;
+  write_timestamp_to(buf, len);
+  if (len < 3)
+    return {};
+  return {buf + 1, len - 3};
+}
+
+// ── CBOR layout ──────────────────────────
 
-  StateLockGuard guard;
-  g_modules.count = 0;
-  g_modules.filter_active = 0;
+template <typename Cursor>
+void append_cbor_head(Cursor &out, detail::cbor::Major major,
+                      uint64_t value) {
+  char head[detail::cbor::HEAD_CAPACITY];
+  out.append(head, detail::cbor::encode_head(major, value, head));
 }
 
-[[nodiscard]] bool module_is_enabled(std::string_view name) {
-  StateLockGuard guard;
+template <typename Cursor>
+void append_cbor_key(Cursor &out, detail::cbor::Key key) {
+  append_cbor_head(out, detail::cbor::UINT, key);
+}
 
-  // If no filter is active, everything passes.
-  if (!g_modules.filter_active)
-    return true;
+template <typename Cursor>
+void append_cbor_text(Cursor &out, std::string_view value) {
+  append_cbor_head(out, detail::cbor::TEXT, value.size());
+  out.append(value);
+}
 
-  for (int i = 0; i < g_modules.count; ++i) {
-    if (sv_eq(name, std::string_view(g_modules.names[i])))
-      return true;
+template <typename Cursor> void append_cbor_be64(Cursor &out, uint64_t bits) {
+  char bytes[8];
+  for (int i = 0; i < 8; ++i)
+    bytes[i] = static_cast<char>((bits >> (56 - 8 * i)) & 0xff);
+  out.append(bytes, sizeof(bytes));
+}
+
+// Ids of the names a record refers to; -1 writes the name inline.
+struct CborNames {
+  long long prefix = -1;
+  long long module = -1;
+  long long file = -1;
+};
+
+// Id of name in the stream, its definition written first when it is new.
+template <typename Cursor>
+long long define_cbor_name(Cursor &out, detail::cbor::Interner *interner,
+                           std::string_view name) {
+  if (!interner || name.empty())
+    return -1;
+  bool fresh = false;
+  const long long id = interner->lookup(name, fresh);
+  if (fresh) {
+    append_cbor_head(out, detail::cbor::MAP, 2);
+    append_cbor_key(out, detail::cbor::DEF_ID);
+    append_cbor_head(out, detail::cbor::UINT, static_cast<uint64_t>(id));
+    append_cbor_key(out, detail::cbor::DEF_NAME);
+    append_cbor_text(out, name);
   }
+  return id;
+}
 
-  return false;
+template <typename Cursor>
+void append_cbor_name(Cursor &out, detail::cbor::Key key,
+                      std::string_view name, long long id) {
+  append_cbor_key(out, key);
+  if (id >= 0)
+    append_cbor_head(out, detail::cbor::UINT, static_cast<uint64_t>(id));
+  else
+    append_cbor_text(out, name);
 }
 
-// ####################################
-//  Thread safety
-// ####################################
+// Map head and the members before the message. timed counts a time
+// member; it is written here when time is given (batches add their own
+// per record). file is null with source locations off.
+template <typename Cursor>
+void append_cbor_members(Cursor &out, const PrefixSnapshot &prefix,
+                         Level level, std::string_view module,
+                         const char *file, unsigned line,
+                         const CborNames &names, bool timed,
+                         const uint64_t *time, bool with_fields) {
+  namespace cbor = detail::cbor;
+  const size_t entries = 5 + (timed ? 1 : 0) + (module.empty() ? 0 : 1) +
+                         (file ? 2 : 0) + (with_fields ? 1 : 0);
+  append_cbor_head(out, cbor::MAP, entries);
+  append_cbor_key(out, cbor::LEVEL);
+  append_cbor_head(out, cbor::UINT, static_cast<uint64_t>(level));
+  if (time) {
+    append_cbor_key(out, cbor::TIME);
+    append_cbor_head(out, cbor::UINT, *time);
+  }
+  append_cbor_key(out, cbor::PID);
+  append_cbor_head(out, cbor::UINT, static_cast<uint64_t>(pid()));
+  append_cbor_key(out, cbor::TID);
+  append_cbor_head(out, cbor::UINT, thread_id());
+  append_cbor_name(out, cbor::PREFIX, {prefix.value, prefix.len},
+                   names.prefix);
+  if (!module.empty())
+    append_cbor_name(out, cbor::MODULE, module, names.module);
+  if (file) {
+    append_cbor_name(out, cbor::FILE, file, names.file);
+    append_cbor_key(out, cbor::LINE);
+    append_cbor_head(out, cbor::UINT, line);
+  }
+}
 
-void set_thread_safe(bool enabled) {
-  g_thread_safe.store(enabled ? 1 : 0, std::memory_order_release);
+template <typename Cursor>
+void append_cbor_fields(Cursor &out, const Field *fields, size_t count) {
+  namespace cbor = detail::cbor;
+  append_cbor_key(out, cbor::FIELDS);
+  append_cbor_head(out, cbor::MAP, count);
+  for (size_t i = 0; i < count; ++i) {
+    const Field &field = fields[i];
+    append_cbor_text(out, field.key);
+    switch (field.kind) {
+    case FieldKind::Bool: {
+      const char byte = static_cast<char>(field.bool_value ? cbor::TRUE_BYTE
+                                                           : cbor::FALSE_BYTE);
+      out.append(&byte, 1);
+      break;
+    }
+    case FieldKind::Int:
+      if (field.int_value < 0)
+        append_cbor_head(out, cbor::NEGINT,
+                         static_cast<uint64_t>(-(field.int_value + 1)));
+      else
+        append_cbor_head(out, cbor::UINT,
+                         static_cast<uint64_t>(field.int_value));
+      break;
+    case FieldKind::Uint:
+      append_cbor_head(out, cbor::UINT, field.uint_value);
+      break;
+    case FieldKind::Float: {
+      const char byte = static_cast<char>(cbor::FLOAT64_BYTE);
+      out.append(&byte, 1);
+      append_cbor_be64(out, std::bit_cast<uint64_t>(field.float_value));
+      break;
+    }
+    case FieldKind::String:
+      append_cbor_text(out, field.string_value);
+      break;
+    case FieldKind::Pointer:
+      append_cbor_head(out, cbor::BYTES, 8);
+      append_cbor_be64(out, reinterpret_cast<uintptr_t>(field.pointer_value));
+      break;
+    }
+  }
 }
 
-// ####################################
-//  Sink
-// ####################################
+// Definitions of new names, then the record. Without an interner every
+// name is written inline.
+template <typename Cursor>
+void append_cbor_record(Cursor &out, State &state,
+                        detail::cbor::Interner *interner,
+                        const PrefixSnapshot &prefix, Level level,
+                        std::string_view module, std::string_view message,
+                        const Field *fields, size_t field_count,
+                        const std::source_location &loc, bool with_timestamp) {
+  const char *file =
+      state.source_location_enabled.load(std::memory_order_acquire)
+          ? detail::source_basename(loc.file_name())
+          : nullptr;
+  CborNames names;
+  names.prefix = define_cbor_name(out, interner, {prefix.value, prefix.len});
+  names.module = define_cbor_name(out, interner, module);
+  if (file)
+    names.file = define_cbor_name(out, interner, file);
+
+  uint64_t time = 0;
+  const bool timed = with_timestamp && platform::realtime_ns(time);
+  append_cbor_members(out, prefix, level, module, file, loc.line(), names,
+                      timed, timed ? &time : nullptr, fields != nullptr);
+  trim_newline(message);
+  append_cbor_key(out, detail::cbor::MESSAGE);
+  append_cbor_text(out, message);
+  if (fields)
+    append_cbor_fields(out, fields, field_count);
+}
 
-void set_sink(SinkFn fn) { g_sink.store(fn, std::memory_order_release); }
+// The stream's name table, created on first use (output lock held). Null
+// if it cannot be allocated: names are then written inline.
+// Point the name table at the current output stream. Returns true if
+// that reset it (output lock held, interner allocated).
+bool rebind_interner(State &state) {
+  const detail::SinkBackend *backend =
+      state.backend.load(std::memory_order_acquire);
+  return state.interner->bind(
+      backend, state.sink.load(std::memory_order_acquire),
+      backend ? backend->stream_generation.load(std::memory_order_acquire)
+              : 0);
+}
 
-void reset_sink() { g_sink.store(nullptr, std::memory_order_release); }
+[[nodiscard]] detail::cbor::Interner *cbor_interner(State &state) {
+  if (!state.interner)
+    state.interner = new (std::nothrow) detail::cbor::Interner;
+  if (state.interner)
+    (void)rebind_interner(state);
+  return state.interner;
+}
 
-// ####################################
-//  Timestamps
-// ####################################
+// ── Module helpers (state lock required) ─
 
-void set_timestamps(bool enabled) {
-  g_timestamps_enabled.store(enabled ? 1 : 0, std::memory_order_release);
-}
+void add_module_locked(State &state, std::string_view name) {
+  ModuleTable &modules = state.modules;
 
-// ####################################
-//  Source location
-// ####################################
+  // Check if already registered.
+  for (int i = 0; i < modules.count; ++i) {
+    if (sv_eq(name, std::string_view(modules.names[i])))
+      return;
+  }
 
-void set_source_location(bool enabled) {
-  g_source_location_enabled.store(enabled ? 1 : 0, std::memory_order_release);
+  if (modules.count < MAX_MODULES) {
+    for (size_t i = 0; i < name.size(); ++i)
+      modules.names[modules.count][i] = name[i];
+    modules.names[modules.count][name.size()] = '\0';
+    modules.count++;
+    modules.filter_active = 1;
+  }
 }
 
-// ####################################
-//  Color
-// ####################################
-
-[[nodiscard]] std::string_view color(Color c) {
-  if (!use_color())
-    return {};
+void init_from_env(State &state) {
+  // CT_LOG_LEVEL=debug|info|warn|error
+  // (startup default only, explicit API has priority)
+  if (state.min_level_set_explicitly.load(std::memory_order_acquire) == 0) {
+    const char *env_level = env_var("CT_LOG_LEVEL");
+    if (env_level)
+      state.min_level.store(parse_level_from_env(env_level),
+                            std::memory_order_release);
+  }
 
-  switch (c) {
-  case Color::Reset:
-    return "\x1b[0m";
+  // CT_DEBUG=mod1,mod2,... (default only, explicit API has priority)
+  if (state.modules_set_explicitly.load(std::memory_order_acquire) == 0) {
+    const char *env_debug = env_var("CT_DEBUG");
+    if (env_debug && env_debug[0] != '\0') {
+      StateLockGuard guard(state);
+
+      // Parse comma-separated module names.
+      const char *start = env_debug;
+      while (*start) {
+        const char *end = start;
+        while (*end && *end != ',')
+          ++end;
+
+        size_t len = static_cast<size_t>(end - start);
+        if (len > 0 && len < MODULE_NAME_LEN)
+          add_module_locked(state, std::string_view(start, len));
+
+        start = *end ? end + 1 : end;
+      }
+    }
+  }
+}
+
+} // namespace
+
+// ####################################
+//  Construction
+// ####################################
+
+Logger::BasicLogger()
+    : filter_(FILTER_OFF), state_(new State(false)), owns_state_(true) {}
+
+Logger::~BasicLogger() {
+  if (!owns_state_)
+    return;
+
+  delete state_->backend.load(std::memory_order_acquire);
+  while (detail::SinkBackend *retired = state_->retired) {
+    state_->retired = retired->retired_next;
+    delete retired;
+  }
+  delete state_->pattern.load(std::memory_order_acquire);
+  while (detail::pattern::Program *retired = state_->retired_patterns) {
+    state_->retired_patterns = retired->retired_next;
+    delete retired;
+  }
+  delete state_->redactor.load(std::memory_order_acquire);
+  while (detail::redact::Matcher *retired = state_->retired_redactors) {
+    state_->retired_redactors = retired->retired_next;
+    delete retired;
+  }
+  delete state_->interner;
+  if (state_->blob_fd >= 0)
+    platform::close_file(state_->blob_fd);
+  delete state_;
+}
+
+constinit Logger Logger::default_instance_{&g_default_state};
+
+void Logger::refresh_filter() {
+  StateLockGuard guard(*state_);
+
+  // Until the environment defaults are applied, keep the filter open so
+  // that the next log() reaches vlog() and runs init_once().
+  if (state_->apply_env &&
+      state_->env_applied.load(std::memory_order_acquire) == 0) {
+    filter_.store(0, std::memory_order_relaxed);
+    return;
+  }
+
+  const int filter = state_->log_enabled.load(std::memory_order_acquire) != 0
+                         ? state_->min_level.load(std::memory_order_acquire)
+                         : FILTER_OFF;
+  filter_.store(filter, std::memory_order_relaxed);
+}
+
+// ####################################
+//  Init
+// ####################################
+
+void Logger::init_once() {
+  if (!state_->apply_env)
+    return;
+
+  std::call_once(state_->init_flag, [this]() {
+    init_from_env(*state_);
+    state_->env_applied.store(1, std::memory_order_release);
+    refresh_filter();
+  });
+}
+
+void init_once() { default_logger().init_once(); }
+
+// ####################################
+//  Enable / Disable
+// ####################################
+
+void Logger::enable() {
+  state_->log_enabled.store(1, std::memory_order_release);
+  refresh_filter();
+}
+
+void Logger::disable() {
+  state_->log_enabled.store(0, std::memory_order_release);
+  refresh_filter();
+}
+
+[[nodiscard]] bool Logger::is_enabled() const {
+  return state_->log_enabled.load(std::memory_order_acquire) != 0;
+}
+
+void enable_logging() { default_logger().enable(); }
+
+void disable_logging() { default_logger().disable(); }
+
+[[nodiscard]] bool log_is_enabled() { return default_logger().is_enabled(); }
+
+// ####################################
+//  Prefix
+// ####################################
+
+void Logger::set_prefix(std::string_view prefix) {
+  size_t len = prefix.size();
+  if (len >= PREFIX_CAPACITY)
+    len = PREFIX_CAPACITY - 1;
+
+  StateLockGuard guard(*state_);
+
+  for (size_t i = 0; i < len; ++i)
+    state_->prefix_buf[i] = prefix[i];
+  state_->prefix_buf[len] = '\0';
+
+  state_->prefix_len = len;
+}
+
+void set_prefix(std::string_view prefix) {
+  default_logger().set_prefix(prefix);
+}
+
+// ####################################
+//  Level filtering
+// ####################################
+
+void Logger::set_min_level(Level level) {
+  state_->min_level_set_explicitly.store(1, std::memory_order_release);
+  init_once();
+  state_->min_level.store(static_cast<int>(level), std::memory_order_release);
+  refresh_filter();
+}
+
+[[nodiscard]] Level Logger::min_level() const {
+  return static_cast<Level>(state_->min_level.load(std::memory_order_acquire));
+}
+
+void set_min_level(Level level) { default_logger().set_min_level(level); }
+
+[[nodiscard]] Level min_level() { return default_logger().min_level(); }
+
+// ####################################
+//  Module filtering
+// ####################################
+
+void Logger::enable_module(std::string_view name) {
+  if (name.empty() || name.size() >= MODULE_NAME_LEN)
+    return;
+
+  state_->modules_set_explicitly.store(1, std::memory_order_release);
+  init_once();
+
+  StateLockGuard guard(*state_);
+  add_module_locked(*state_, name);
+}
+
+void Logger::disable_module(std::string_view name) {
+  if (name.empty())
+    return;
+
+  state_->modules_set_explicitly.store(1, std::memory_order_release);
+  init_once();
+
+  StateLockGuard guard(*state_);
+  ModuleTable &modules = state_->modules;
+
+  for (int i = 0; i < modules.count; ++i) {
+    if (sv_eq(name, std::string_view(modules.names[i]))) {
+      // Shift remaining entries.
+      for (int j = i; j < modules.count - 1; ++j)
+        std::memcpy(modules.names[j], modules.names[j + 1], MODULE_NAME_LEN);
+      modules.count--;
+
+      if (modules.count == 0)
+        modules.filter_active = 0;
+
+      break;
+    }
+  }
+}
+
+void Logger::enable_all_modules() {
+  state_->modules_set_explicitly.store(1, std::memory_order_release);
+  init_once();
+
+  StateLockGuard guard(*state_);
+  state_->modules.count = 0;
+  state_->modules.filter_active = 0;
+}
+
+[[nodiscard]] bool Logger::module_is_enabled(std::string_view name) const {
+  StateLockGuard guard(*state_);
+  const ModuleTable &modules = state_->modules;
+
+  // If no filter is active, everything passes.
+  if (!modules.filter_active)
+    return true;
+
+  for (int i = 0; i < modules.count; ++i) {
+    if (sv_eq(name, std::string_view(modules.names[i])))
+      return true;
+  }
+
+  return false;
+}
+
+void enable_module(std::string_view name) {
+  default_logger().enable_module(name);
+}
+
+void disable_module(std::string_view name) {
+  default_logger().disable_module(name);
+}
+
+void enable_all_modules() { default_logger().enable_all_modules(); }
+
+[[nodiscard]] bool module_is_enabled(std::string_view name) {
+  return default_logger().module_is_enabled(name);
+}
+
+// ####################################
+//  Thread safety
+// ####################################
+
+void Logger::set_thread_safe(bool enabled) {
+  state_->thread_safe.store(enabled ? 1 : 0, std::memory_order_release);
+}
+
+void set_thread_safe(bool enabled) {
+  default_logger().set_thread_safe(enabled);
+}
+
+// ####################################
+//  Sink
+// ####################################
+
+namespace {
+
+// ── Reclamation (state lock held) ─
+
+template <typename T> void free_retired(T *&list, unsigned epoch) {
+  T **link = &list;
+  while (T *item = *link) {
+    if (epoch - item->retired_epoch >= 2) {
+      *link = item->retired_next;
+      delete item;
+    } else {
+      link = &item->retired_next;
+    }
+  }
+}
+
+// Move the epoch on as far as the writers allow and free what was retired
+// two epochs ago. Never waits: an object a writer may still hold is freed
+// by a later call, or with the logger.
+void reclaim_locked(State &state) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  unsigned epoch = state.epoch.load(std::memory_order_relaxed);
+  for (int step = 0; step < 2; ++step) {
+    if (state.readers[(epoch + 1) & 1].load(std::memory_order_acquire) != 0)
+      break;
+    state.epoch.store(++epoch, std::memory_order_relaxed);
+  }
+  free_retired(state.retired, epoch);
+  free_retired(state.retired_patterns, epoch);
+  free_retired(state.retired_redactors, epoch);
+}
+
+// Park an object unpublished from State and free what can be.
+template <typename T> void retire_locked(State &state, T *&list, T *item) {
+  item->retired_epoch = state.epoch.load(std::memory_order_relaxed);
+  item->retired_next = list;
+  list = item;
+  reclaim_locked(state);
+}
+
+// Swap the active built-in sink (possibly for none) and the SinkFn. The
+// previous backend is flushed, closed and retired. Returns false, and
+// closes next, if next is text_only while the layout is Layout::Cbor.
+bool install_backend(State &state, detail::SinkBackend *next, SinkFn fn) {
+  if (!next && !state.backend.load(std::memory_order_acquire)) {
+    state.sink.store(fn, std::memory_order_release);
+    return true;
+  }
+
+  detail::SinkBackend *previous = nullptr;
+  std::unique_ptr<detail::SinkBackend> refused; // closed after the lock
+  {
+    std::lock_guard<std::mutex> output_lock(state.output_mutex);
+    if (next && next->text_only &&
+        state.layout.load(std::memory_order_acquire) ==
+            static_cast<int>(Layout::Cbor)) {
+      refused.reset(next);
+      return false;
+    }
+    previous = state.backend.exchange(next, std::memory_order_acq_rel);
+    state.sink.store(fn, std::memory_order_release);
+    // A new backend may reuse the address of a freed one.
+    if (state.interner)
+      state.interner->reset();
+  }
+
+  if (!previous)
+    return true;
+
+  previous->close();
+
+  StateLockGuard guard(state);
+  retire_locked(state, state.retired, previous);
+  return true;
+}
+
+// The default logger is never destroyed: close its built-in sink at exit
+// so buffers are written and files get their final size. Later output
+// (static destructors) goes to stderr.
+void close_default_backend_at_exit() {
+  if (g_default_state.backend.load(std::memory_order_acquire))
+    install_backend(g_default_state, nullptr, nullptr);
+}
+
+[[nodiscard]] bool adopt_backend(State &state,
+                                 std::unique_ptr<detail::SinkBackend> backend) {
+  if (!backend)
+    return false;
+
+  if (&state == &g_default_state) {
+    static std::once_flag at_exit_flag;
+    std::call_once(at_exit_flag,
+                   []() { std::atexit(close_default_backend_at_exit); });
+  }
+
+  return install_backend(state, backend.release(), nullptr);
+}
+
+} // namespace
+
+void Logger::set_sink(SinkFn fn) { install_backend(*state_, nullptr, fn); }
+
+void Logger::reset_sink() { install_backend(*state_, nullptr, nullptr); }
+
+bool Logger::set_file_sink(std::string_view path,
+                           const FileSinkOptions &options) {
+  return adopt_backend(*state_, detail::make_file_sink(path, options));
+}
+
+bool Logger::set_mmap_sink(std::string_view path,
+                           const MmapSinkOptions &options) {
+  return adopt_backend(*state_, detail::make_mmap_sink(path, options));
+}
+
+bool Logger::set_sharded_sink(std::string_view base,
+                              const ShardedSinkOptions &options) {
+  return adopt_backend(*state_, detail::make_sharded_sink(base, options));
+}
+
+bool Logger::set_pipe_sink(std::string_view command,
+                           const PipeSinkOptions &options) {
+  return adopt_backend(*state_, detail::make_pipe_sink(command, options));
+}
+
+bool Logger::set_syslog_sink(const SyslogSinkOptions &options) {
+  return adopt_backend(*state_, detail::make_syslog_sink(options));
+}
+
+bool Logger::set_net_sink(std::string_view host, uint16_t port,
+                          const NetSinkOptions &options) {
+  return adopt_backend(*state_, detail::make_net_sink(host, port, options));
+}
+
+void Logger::flush() {
+  ReadGuard reading(*state_);
+  OutputLockGuard output_lock(*state_);
+  if (detail::SinkBackend *backend =
+          state_->backend.load(std::memory_order_acquire))
+    backend->flush();
+}
+
+SinkStats Logger::sink_stats() const {
+  ReadGuard reading(*state_);
+  OutputLockGuard output_lock(*state_);
+  if (const detail::SinkBackend *backend =
+          state_->backend.load(std::memory_order_acquire))
+    return backend->stats();
+  return {};
+}
+
+void set_sink(SinkFn fn) { default_logger().set_sink(fn); }
+
+void reset_sink() { default_logger().reset_sink(); }
+
+bool set_file_sink(std::string_view path, const FileSinkOptions &options) {
+  return default_logger().set_file_sink(path, options);
+}
+
+bool set_mmap_sink(std::string_view path, const MmapSinkOptions &options) {
+  return default_logger().set_mmap_sink(path, options);
+}
+
+bool set_sharded_sink(std::string_view base,
+                      const ShardedSinkOptions &options) {
+  return default_logger().set_sharded_sink(base, options);
+}
+
+bool set_pipe_sink(std::string_view command, const PipeSinkOptions &options) {
+  return default_logger().set_pipe_sink(command, options);
+}
+
+bool set_syslog_sink(const SyslogSinkOptions &options) {
+  return default_logger().set_syslog_sink(options);
+}
+
+bool set_net_sink(std::string_view host, uint16_t port,
+                  const NetSinkOptions &options) {
+  return default_logger().set_net_sink(host, port, options);
+}
+
+void flush() { default_logger().flush(); }
+
+SinkStats sink_stats() { return default_logger().sink_stats(); }
+
+// ####################################
+//  Timestamps
+// ####################################
+
+void Logger::set_timestamps(bool enabled) {
+  state_->timestamps_enabled.store(enabled ? 1 : 0, std::memory_order_release);
+}
+
+void set_timestamps(bool enabled) { default_logger().set_timestamps(enabled); }
+
+// ####################################
+//  Source location
+// ####################################
+
+void Logger::set_source_location(bool enabled) {
+  state_->source_location_enabled.store(enabled ? 1 : 0,
+                                        std::memory_order_release);
+}
+
+void set_source_location(bool enabled) {
+  default_logger().set_source_location(enabled);
+}
+
+// ####################################
+//  Layout
+// ####################################
+
+void Logger::set_layout(Layout layout) {
+  // Checked against the backend under the lock that install_backend()
+  // swaps it under.
+  std::lock_guard<std::mutex> output_lock(state_->output_mutex);
+  if (layout == Layout::Cbor) {
+    const detail::SinkBackend *backend =
+        state_->backend.load(std::memory_order_acquire);
+    if (backend && backend->text_only)
+      return;
+  }
+  state_->layout.store(static_cast<int>(layout), std::memory_order_release);
+}
+
+Layout Logger::layout() const {
+  return static_cast<Layout>(state_->layout.load(std::memory_order_acquire));
+}
+
+bool Logger::set_pattern(std::string_view pattern) {
+  std::unique_ptr<detail::pattern::Program> program =
+      detail::pattern::compile(pattern);
+  if (!program)
+    return false;
+
+  StateLockGuard guard(*state_);
+  detail::pattern::Program *previous =
+      state_->pattern.exchange(program.release(), std::memory_order_acq_rel);
+  if (previous)
+    retire_locked(*state_, state_->retired_patterns, previous);
+  state_->layout.store(static_cast<int>(Layout::Pattern),
+                       std::memory_order_release);
+  return true;
+}
+
+void Logger::set_line_framing(LineFraming framing) {
+  state_->line_framing.store(static_cast<int>(framing),
+                             std::memory_order_release);
+}
+
+LineFraming Logger::line_framing() const {
+  return static_cast<LineFraming>(
+      state_->line_framing.load(std::memory_order_acquire));
+}
+
+void Logger::set_max_record_size(size_t max_bytes) {
+  if (max_bytes != 0)
+    max_bytes = std::max(max_bytes, MIN_RECORD_SIZE);
+  state_->max_record_size.store(max_bytes, std::memory_order_relaxed);
+}
+
+size_t Logger::max_record_size() const {
+  return state_->max_record_size.load(std::memory_order_relaxed);
+}
+
+void Logger::set_sanitize(bool enabled) {
+  state_->sanitize.store(enabled ? 1 : 0, std::memory_order_relaxed);
+}
+
+bool Logger::sanitize_enabled() const {
+  return state_->sanitize.load(std::memory_order_relaxed) != 0;
+}
+
+namespace {
+
+// Publish a rule set (nullptr: none) and retire the one it replaces.
+void swap_redactor(Logger::State &state,
+                   std::unique_ptr<detail::redact::Matcher> matcher) {
+  StateLockGuard guard(state);
+  detail::redact::Matcher *previous =
+      state.redactor.exchange(matcher.release(), std::memory_order_acq_rel);
+  if (previous)
+    retire_locked(state, state.retired_redactors, previous);
+}
+
+} // namespace
+
+bool Logger::set_redaction(std::initializer_list<RedactRule> rules) {
+  return set_redaction(rules.begin(), rules.size());
+}
+
+bool Logger::set_redaction(const RedactRule *rules, size_t count) {
+  if (count == 0) {
+    clear_redaction();
+    return true;
+  }
+  std::unique_ptr<detail::redact::Matcher> matcher =
+      detail::redact::Matcher::compile(rules, count);
+  if (!matcher)
+    return false;
+  swap_redactor(*state_, std::move(matcher));
+  return true;
+}
+
+void Logger::clear_redaction() { swap_redactor(*state_, nullptr); }
+
+void Logger::set_max_hexdump_size(size_t max_bytes) {
+  state_->max_hexdump_size.store(max_bytes, std::memory_order_relaxed);
+}
+
+size_t Logger::max_hexdump_size() const {
+  return state_->max_hexdump_size.load(std::memory_order_relaxed);
+}
+
+bool Logger::set_blob_file(std::string_view path) {
+  int fd = -1;
+  if (!path.empty()) {
+    const std::string name(path);
+    fd = platform::open_log_file(name.c_str(), false);
+    if (fd < 0)
+      return false;
+  }
+
+  std::lock_guard<std::mutex> guard(state_->blob_mutex);
+  if (state_->blob_fd >= 0)
+    platform::close_file(state_->blob_fd);
+  state_->blob_fd = fd;
+  state_->blob_enabled.store(fd >= 0 ? 1 : 0, std::memory_order_release);
+  return true;
+}
+
+void set_layout(Layout layout) { default_logger().set_layout(layout); }
+
+Layout layout() { return default_logger().layout(); }
+
+bool set_pattern(std::string_view pattern) {
+  return default_logger().set_pattern(pattern);
+}
+
+void set_line_framing(LineFraming framing) {
+  default_logger().set_line_framing(framing);
+}
+
+LineFraming line_framing() { return default_logger().line_framing(); }
+
+void set_max_record_size(size_t max_bytes) {
+  default_logger().set_max_record_size(max_bytes);
+}
+
+size_t max_record_size() { return default_logger().max_record_size(); }
+
+bool set_blob_file(std::string_view path) {
+  return default_logger().set_blob_file(path);
+}
+
+void set_sanitize(bool enabled) { default_logger().set_sanitize(enabled); }
+
+bool sanitize_enabled() { return default_logger().sanitize_enabled(); }
+
+bool set_redaction(std::initializer_list<RedactRule> rules) {
+  return default_logger().set_redaction(rules);
+}
+
+bool set_redaction(const RedactRule *rules, size_t count) {
+  return default_logger().set_redaction(rules, count);
+}
+
+void clear_redaction() { default_logger().clear_redaction(); }
+
+void set_max_hexdump_size(size_t max_bytes) {
+  default_logger().set_max_hexdump_size(max_bytes);
+}
+
+size_t max_hexdump_size() { return default_logger().max_hexdump_size(); }
+
+// ####################################
+//  Color
+// ####################################
+
+namespace {
+
+[[nodiscard]] std::string_view ansi(Color c) {
+  if (!use_color())
+    return {};
+
+  switch (c) {
+  case Color::Reset:
+    return "\x1b[0m";
 
   case Color::Dim:
     return "\x1b[2m";
@@ -543,32 +1971,55 @@ void set_source_location(bool enabled) {
   return {};
 }
 
-[[nodiscard]] std::string_view level_label(Level level) {
+[[nodiscard]] std::string_view ansi_level(Level level) {
   switch (level) {
   case Level::Debug:
-    return "DEBUG";
+    return ansi(Color::Cyan);
   case Level::Info:
-    return "INFO";
+    return ansi(Color::Green);
   case Level::Warn:
-    return "WARN";
+    return ansi(Color::Yellow);
   case Level::Error:
-    return "ERROR";
+    return ansi(Color::Red);
   }
-  return "INFO";
+  return ansi(Color::Cyan);
+}
+
+} // namespace
+
+// Colors formatted into messages would corrupt a JSON or CBOR record.
+std::string_view Logger::color(Color c) const {
+  const Layout current = layout();
+  if (current == Layout::Json || current == Layout::Cbor)
+    return {};
+  return ansi(c);
+}
+
+std::string_view Logger::level_color(Level level) const {
+  const Layout current = layout();
+  if (current == Layout::Json || current == Layout::Cbor)
+    return {};
+  return ansi_level(level);
+}
+
+std::string_view color(Color c) { return default_logger().color(c); }
+
+std::string_view level_color(Level level) {
+  return default_logger().level_color(level);
 }
 
-[[nodiscard]] std::string_view level_color(Level level) {
+[[nodiscard]] std::string_view level_label(Level level) {
   switch (level) {
   case Level::Debug:
-    return color(Color::Cyan);
+    return "DEBUG";
   case Level::Info:
-    return color(Color::Green);
+    return "INFO";
   case Level::Warn:
-    return color(Color::Yellow);
+    return "WARN";
   case Level::Error:
-    return color(Color::Red);
+    return "ERROR";
   }
-  return color(Color::Cyan);
+  return "INFO";
 }
 
 // ####################################
@@ -588,171 +2039,955 @@ void set_source_location(bool enabled) {
 //  Low-level write
 // ####################################
 
-void write_raw(const char *data, size_t size) {
-  if (!data || size == 0)
+void Logger::deliver(const char *data, size_t size, Level level) {
+  // Built-in sink?
+  if (detail::SinkBackend *backend =
+          state_->backend.load(std::memory_order_acquire)) {
+    backend->write(data, size, level);
     return;
+  }
 
   // Custom sink?
-  SinkFn sink = g_sink.load(std::memory_order_acquire);
+  SinkFn sink = state_->sink.load(std::memory_order_acquire);
   if (sink) {
     sink(data, size);
     return;
   }
 
-  platform::write_stderr(data, size);
+  write_stderr(data, size);
+}
+
+void Logger::write_raw(const char *data, size_t size) {
+  if (!data || size == 0)
+    return;
+  ReadGuard reading(*state_);
+  deliver(data, size, Level::Info);
 }
 
-void write_str(std::string_view value) {
+void Logger::write_str(std::string_view value) {
   if (value.empty())
     return;
   write_raw(value.data(), value.size());
 }
 
-void write_dec(size_t value) {
-  char buf[32];
-  size_t idx = 0;
+void Logger::write_dec(size_t value) {
+  char buf[DEC_CAPACITY];
+  write_raw(buf, format_dec(buf, value));
+}
 
-  if (value == 0) {
-    buf[idx++] = '0';
-  } else {
-    while (value != 0 && idx < sizeof(buf)) {
-      buf[idx++] = static_cast<char>('0' + (value % 10));
-      value /= 10;
+void Logger::write_hex(uintptr_t value) {
+  char buf[HEX_CAPACITY];
+  write_raw(buf, format_hex(buf, value));
+}
+
+void Logger::write_atomic(const char *data, size_t size, Level level) {
+  if (!data || size == 0)
+    return;
+
+  ReadGuard reading(*state_);
+  OutputLockGuard output_lock(*state_);
+  if (output_lock.concurrent)
+    output_lock.concurrent->write(data, size, level);
+  else
+    deliver(data, size, level);
+}
+
+// Consecutive records ending at ends[0..count) (LogBatch): one sink call,
+// or one framed write per record where the sink frames records.
+void Logger::write_records(const char *data, const size_t *ends,
+                           size_t count, Level level) {
+  if (count == 0 || ends[count - 1] == 0)
+    return;
+
+  ReadGuard reading(*state_);
+  OutputLockGuard output_lock(*state_);
+  detail::SinkBackend *backend =
+      output_lock.concurrent ? output_lock.concurrent
+                             : state_->backend.load(std::memory_order_acquire);
+  if (!backend || !backend->frames_records) {
+    if (output_lock.concurrent)
+      output_lock.concurrent->write(data, ends[count - 1], level);
+    else
+      deliver(data, ends[count - 1], level);
+    return;
+  }
+
+  size_t start = 0;
+  for (size_t i = 0; i < count; ++i) {
+    backend->begin_record();
+    backend->write(data + start, ends[i] - start, level);
+    backend->end_record();
+    start = ends[i];
+  }
+}
+
+// A batch begun on a record sink. Its bodies are already sanitized,
+// redacted and cut; a byte sink installed since gets them as log lines.
+void Logger::write_bodies(const char *data, const size_t *ends,
+                          size_t count, Level level, std::string_view module,
+                          const std::source_location *loc) {
+  if (count == 0 || ends[count - 1] == 0)
+    return;
+
+  ReadGuard reading(*state_);
+  {
+    OutputLockGuard output_lock(*state_);
+    detail::SinkBackend *backend =
+        state_->backend.load(std::memory_order_acquire);
+    if (backend && backend->takes_records) {
+      detail::Record record;
+      record.level = level;
+      record.module = module;
+      record.loc = loc;
+      size_t start = 0;
+      for (size_t i = 0; i < count; ++i) {
+        record.message = std::string_view(data + start, ends[i] - start);
+        backend->write_record(record);
+        start = ends[i];
+      }
+      return;
     }
   }
 
-  // Reverse digits.
-  for (size_t i = 0; i < idx / 2; ++i) {
-    char tmp = buf[i];
-    buf[i] = buf[idx - 1 - i];
-    buf[idx - 1 - i] = tmp;
+  const std::source_location none;
+  size_t start = 0;
+  for (size_t i = 0; i < count; ++i) {
+    write_line(level, module, std::string_view(data + start, ends[i] - start),
+               nullptr, 0, loc ? *loc : none);
+    start = ends[i];
   }
+}
 
-  write_raw(buf, idx);
+void write_raw(const char *data, size_t size) {
+  default_logger().write_raw(data, size);
 }
 
-void write_hex(uintptr_t value) {
-  char buf[2 + sizeof(uintptr_t) * 2];
-  size_t idx = 0;
+void write_str(std::string_view value) { default_logger().write_str(value); }
 
-  buf[idx++] = '0';
-  buf[idx++] = 'x';
+void write_dec(size_t value) { default_logger().write_dec(value); }
 
-  bool started = false;
-  for (int shift = static_cast<int>(sizeof(uintptr_t) * 8 - 4); shift >= 0;
-       shift -= 4) {
-    unsigned int nibble = static_cast<unsigned int>((value >> shift) & 0xF);
-    if (!started && nibble == 0 && shift != 0)
-      continue;
+void write_hex(uintptr_t value) { default_logger().write_hex(value); }
+
+// ####################################
+//  Write prefix (non-mutex, for low-level use)
+// ####################################
+
+void Logger::write_prefix(Level level) {
+  PrefixSnapshot prefix = read_prefix_snapshot(*state_);
+
+  char buf[LINE_CAPACITY];
+  LineCursor line{buf, sizeof(buf)};
+  append_level_prefix(line, prefix, level);
+  line.append(" ", 1);
+
+  write_raw(buf, line.len);
+}
+
+void write_prefix(Level level) { default_logger().write_prefix(level); }
+
+// ####################################
+//  Atomic log line output
+// ####################################
+
+void Logger::write_log_line(Level level, std::string_view module,
+                            std::string_view message,
+                            const std::source_location &loc) {
+  write_line(level, module, message, nullptr, 0, loc);
+}
+
+void Logger::write_line(Level level, std::string_view module,
+                        std::string_view message, const Field *fields,
+                        size_t field_count, const std::source_location &loc) {
+  ReadGuard reading(*state_);
+
+  // Untrusted bytes are rewritten first. A clean message, the common
+  // case, is only scanned.
+  std::string sanitized;
+  if (state_->sanitize.load(std::memory_order_relaxed)) {
+    const size_t clean =
+        detail::sanitize::clean_prefix(message.data(), message.size());
+    if (clean != message.size()) {
+      sanitized.reserve(message.size() + 16);
+      sanitized.append(message.data(), clean);
+      detail::sanitize::append_sanitized(sanitized, message.substr(clean));
+      message = sanitized;
+    }
+  }
+
+  // Secrets are replaced before the message can reach the blob file.
+  std::string redacted;
+  if (const detail::redact::Matcher *redactor =
+          state_->redactor.load(std::memory_order_acquire);
+      redactor && redactor->redact(message, redacted))
+    message = redacted;
+
+  // An oversized message is cut before anything else; its full payload
+  // goes to the blob file first, outside the output lock.
+  std::string clipped;
+  if (const size_t limit =
+          state_->max_record_size.load(std::memory_order_relaxed);
+      limit != 0 && message.size() > limit) {
+    char id[BLOB_ID_CAPACITY];
+    const std::string_view blob = store_blob(*state_, message, id);
+    clipped.assign(message.data(), limit);
+    clip_tail(clipped, 0, message.size(), message.back() == '\n', limit,
+              blob);
+    message = clipped;
+  }
+
+  // Record-oriented sinks (syslog) frame the record themselves. The
+  // backend is loaded again under the output lock: install_backend()
+  // swaps it under that lock and closes the old one after.
+  if (const detail::SinkBackend *peek =
+          state_->backend.load(std::memory_order_acquire);
+      peek && peek->takes_records) {
+    detail::Record record;
+    record.level = level;
+    record.module = module;
+    record.message = message;
+    if (state_->source_location_enabled.load(std::memory_order_acquire))
+      record.loc = &loc;
+    record.fields = fields;
+    record.field_count = field_count;
+    OutputLockGuard output_lock(*state_);
+    if (detail::SinkBackend *backend =
+            state_->backend.load(std::memory_order_acquire);
+        backend && backend->takes_records) {
+      backend->write_record(record);
+      return;
+    }
+    // Switched to a byte sink meanwhile: format the line below.
+  }
+
+  PrefixSnapshot prefix = read_prefix_snapshot(*state_);
+  const bool timestamps =
+      state_->timestamps_enabled.load(std::memory_order_acquire) != 0;
+
+  // The whole line is assembled on the stack before the lock is taken and
+  // reaches the sink in one call. A message that does not fit follows the
+  // prefix as a second call under the same lock.
+  char buf[LINE_CAPACITY];
+
+  // CBOR records are encoded under the lock: the name table belongs to
+  // the output stream. A concurrent sink gets every name inline.
+  if (prefix.layout == Layout::Cbor) {
+    OutputLockGuard output_lock(*state_);
+    RecordFrame frame(*state_, output_lock);
+    const auto emit = [&](const char *data, size_t size) {
+      if (output_lock.concurrent)
+        output_lock.concurrent->write(data, size, level);
+      else
+        deliver(data, size, level);
+    };
+    detail::cbor::Interner *interner =
+        output_lock.concurrent ? nullptr : cbor_interner(*state_);
+    const auto encode = [&](auto &out) {
+      append_cbor_record(out, *state_, interner, prefix, level, module,
+                         message, fields, field_count, loc, timestamps);
+    };
+
+    // A sink that starts a new file for this record does so before it is
+    // written, and the record is then encoded again for the new stream.
+    LineCursor line{buf, sizeof(buf)};
+    encode(line);
+    if (!line.truncated && interner) {
+      if (detail::SinkBackend *backend =
+              state_->backend.load(std::memory_order_acquire)) {
+        backend->prepare_record(line.len);
+        if (rebind_interner(*state_)) {
+          line.len = 0;
+          encode(line);
+        }
+      }
+    }
+    if (!line.truncated) {
+      emit(buf, line.len);
+      return;
+    }
+
+    // Too large for buf: names that were only defined in the dropped
+    // bytes are defined again.
+    if (interner)
+      interner->reset();
+    SpillCursor<decltype(emit)> out{buf, sizeof(buf), emit};
+    encode(out);
+    out.finish();
+    return;
+  }
+
+  // Without a published pattern, Layout::Pattern writes the Text layout.
+  const detail::pattern::Program *pattern =
+      prefix.layout == Layout::Pattern
+          ? state_->pattern.load(std::memory_order_acquire)
+          : nullptr;
+  PatternRecord pattern_record;
+  char ts[TIMESTAMP_CAPACITY];
+  if (pattern) {
+    pattern_record.level = level;
+    if (timestamps)
+      pattern_record.timestamp = pattern_timestamp(ts);
+    pattern_record.prefix = {prefix.value, prefix.len};
+    pattern_record.module = module;
+    pattern_record.message = message;
+    trim_newline(pattern_record.message);
+    if (state_->source_location_enabled.load(std::memory_order_acquire)) {
+      pattern_record.file = detail::source_basename(loc.file_name());
+      pattern_record.line = loc.line();
+    }
+    pattern_record.fields = fields;
+    pattern_record.field_count = field_count;
+  }
+
+  LineCursor line{buf, sizeof(buf)};
+  const bool json = prefix.layout == Layout::Json;
+  if (pattern)
+    append_pattern_record(line, *pattern, pattern_record);
+  else if (json)
+    append_json_record(line, *state_, prefix, level, module, message, fields,
+                       field_count, loc, timestamps);
+  else
+    append_record_prefix(line, *state_, prefix, level, module, loc,
+                         timestamps);
+
+  // Fields follow the message on the same line, which then always ends.
+  const size_t prefix_len = line.len;
+  const auto framing = static_cast<LineFraming>(
+      state_->line_framing.load(std::memory_order_acquire));
+  const bool framed = framing != LineFraming::Off && !json && !pattern;
+
+  // Continuation lines of a framed message: the prefix at the start of
+  // buf (repeat bytes of it), or padding to its printed width.
+  size_t repeat = prefix_len;
+  const size_t indent = framing == LineFraming::Indent
+                            ? visible_width({buf, prefix_len})
+                            : 0;
+  const auto continuation = [&](auto &out) {
+    if (framing == LineFraming::Prefix)
+      out.append(buf, repeat);
+    else
+      append_padding(out, indent);
+  };
+
+  if (framed) {
+    if (fields)
+      trim_newline(message);
+    append_framed(line, message, continuation, !fields);
+    if (fields) {
+      append_fields(line, fields, field_count);
+      line.append("\n", 1);
+    }
+  } else if (fields && !json && !pattern) {
+    trim_newline(message);
+    line.append(message);
+    append_fields(line, fields, field_count);
+    line.append("\n", 1);
+  }
 
-    started = true;
-    if (nibble < 10)
-      buf[idx++] = static_cast<char>('0' + nibble);
+  OutputLockGuard output_lock(*state_);
+  RecordFrame frame(*state_, output_lock);
+  const auto emit = [&](const char *data, size_t size) {
+    if (output_lock.concurrent)
+      output_lock.concurrent->write(data, size, level);
     else
-      buf[idx++] = static_cast<char>('a' + (nibble - 10));
+      deliver(data, size, level);
+  };
+
+  if (json || pattern) {
+    if (!line.truncated) {
+      emit(buf, line.len);
+      return;
+    }
+    // Too long for one buffer: rendered again in buffer-sized pieces.
+    SpillCursor<decltype(emit)> rest{buf, sizeof(buf), emit};
+    if (pattern)
+      append_pattern_record(rest, *pattern, pattern_record);
+    else
+      append_json_record(rest, *state_, prefix, level, module, message,
+                         fields, field_count, loc, timestamps);
+    rest.finish();
+    return;
+  }
+
+  if (framed) {
+    if (!line.truncated) {
+      emit(buf, line.len);
+      return;
+    }
+    // Too long for one buffer: the prefix goes out first and stays at the
+    // start of buf for continuation lines; the rest is rendered in pieces
+    // behind it.
+    emit(buf, prefix_len);
+    repeat = std::min(prefix_len, sizeof(buf) / 2);
+    SpillCursor<decltype(emit)> rest{buf + repeat, sizeof(buf) - repeat,
+                                     emit};
+    append_framed(rest, message, continuation, !fields);
+    if (fields) {
+      append_fields(rest, fields, field_count);
+      rest.append("\n", 1);
+    }
+    rest.finish();
+    return;
+  }
+
+  if (fields) {
+    if (!line.truncated) {
+      emit(buf, line.len);
+      return;
+    }
+    // Too long for one buffer: prefix, message, then the fields in
+    // buffer-sized pieces.
+    emit(buf, prefix_len);
+    if (!message.empty())
+      emit(message.data(), message.size());
+    SpillCursor<decltype(emit)> rest{buf, sizeof(buf), emit};
+    append_fields(rest, fields, field_count);
+    rest.append("\n", 1);
+    rest.finish();
+    return;
   }
 
-  if (!started)
-    buf[idx++] = '0';
+  // Message body.
+  if (message.size() <= line.capacity - line.len) {
+    line.append(message);
+    emit(buf, line.len);
+  } else {
+    emit(buf, line.len);
+    emit(message.data(), message.size());
+  }
+}
 
-  write_raw(buf, idx);
+void write_log_line(Level level, std::string_view module,
+                    std::string_view message, const std::source_location &loc) {
+  default_logger().write_log_line(level, module, message, loc);
 }
 
 // ####################################
-//  Write prefix (non-mutex, for low-level use)
+//  Formatting (cold path behind log())
 // ####################################
 
-void write_prefix(Level level) {
-  PrefixSnapshot prefix = read_prefix_snapshot();
+void Logger::vlog(const LogEntry &entry, std::string_view module,
+                  std::string_view fmt, std::format_args args) {
+  init_once();
 
-  // |PID|
-  write_str(color(Color::Dim));
-  write_raw("|", 1);
-  write_dec(static_cast<size_t>(pid()));
-  write_raw("|", 1);
-  write_str(color(Color::Reset));
-  write_raw(" ", 1);
+  if (!is_enabled())
+    return;
+  if (static_cast<int>(entry.level) < static_cast<int>(min_level()))
+    return;
+  if (!module.empty() && !module_is_enabled(module))
+    return;
 
-  // Configurable prefix tag.
-  write_str(color(Color::Gray));
-  write_str(color(Color::Italic));
-  write_raw(prefix.value, prefix.len);
-  write_raw(" ", 1);
-  write_str(color(Color::Reset));
+  try {
+    std::string msg;
+    const size_t limit =
+        state_->max_record_size.load(std::memory_order_relaxed);
+    if (limit != 0 &&
+        state_->blob_enabled.load(std::memory_order_acquire) == 0 &&
+        !state_->redactor.load(std::memory_order_relaxed) &&
+        !state_->sanitize.load(std::memory_order_relaxed)) {
+      // Capped without a blob file: only the first limit bytes are kept
+      // while formatting. Not with redaction on: a secret cut in half
+      // at the limit would no longer match. Nor with sanitizing on:
+      // escapes grow the message, so write_line() cuts it after them.
+      size_t total = 0;
+      char last = 0;
+      std::vformat_to(ClipIterator{&msg, limit, &total, &last}, fmt, args);
+      if (total > limit)
+        clip_tail(msg, 0, total, last == '\n', limit, {});
+    } else {
+      msg = std::vformat(fmt, args);
+    }
+    if (msg.empty())
+      return;
 
-  // [LEVEL]
-  write_str(level_color(level));
-  write_raw("[", 1);
-  write_str(level_label(level));
-  write_raw("]", 1);
-  write_str(color(Color::Reset));
-  write_raw(" ", 1);
+    write_log_line(entry.level, module, msg, entry.loc);
+  } catch (...) {
+    static const char fallback[] = "coretrace: log format error\n";
+    write_raw(fallback, sizeof(fallback) - 1);
+  }
+}
+
+void Logger::vlog_fields(const LogEntry &entry, std::string_view module,
+                         std::string_view message, const Field *fields,
+                         size_t count) {
+  init_once();
+
+  if (!is_enabled())
+    return;
+  if (static_cast<int>(entry.level) < static_cast<int>(min_level()))
+    return;
+  if (!module.empty() && !module_is_enabled(module))
+    return;
+
+  write_line(entry.level, module, message, fields, count, entry.loc);
+}
+
+// "hexdump 0x..., N bytes\n"
+constexpr size_t HEXDUMP_HEADER_CAPACITY = 16 + HEX_CAPACITY + DEC_CAPACITY;
+
+// Dumps whose rendering fits here are assembled on the stack.
+constexpr size_t HEXDUMP_STACK_CAPACITY = 4096;
+
+void Logger::vlog_hexdump(const LogEntry &entry, std::string_view module,
+                          const void *data, size_t size) {
+  init_once();
+
+  if (!is_enabled())
+    return;
+  if (static_cast<int>(entry.level) < static_cast<int>(min_level()))
+    return;
+  if (!module.empty() && !module_is_enabled(module))
+    return;
+
+  namespace hex = detail::hex;
+  const size_t limit = state_->max_hexdump_size.load(std::memory_order_relaxed);
+  size_t shown = limit != 0 ? std::min(size, limit) : size;
+  if (data == nullptr)
+    shown = 0;
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  const int digits = hex::offset_digits(shown);
+  const size_t rows = (shown + hex::ROW_BYTES - 1) / hex::ROW_BYTES;
+  const size_t bound = HEXDUMP_HEADER_CAPACITY + rows * hex::ROW_CAPACITY +
+                       CLIP_MARKER_CAPACITY + 1;
+
+  try {
+    char stack[HEXDUMP_STACK_CAPACITY];
+    std::string heap;
+    char *out = stack;
+    if (bound > sizeof(stack)) {
+      heap.resize(bound);
+      out = heap.data();
+    }
+
+    size_t len = 0;
+    const auto put = [&](std::string_view text) {
+      std::memcpy(out + len, text.data(), text.size());
+      len += text.size();
+    };
+    put("hexdump ");
+    len += format_hex(out + len, reinterpret_cast<uintptr_t>(data));
+    put(", ");
+    len += format_dec(out + len, size);
+    put(" bytes\n");
+
+    for (size_t offset = 0; offset < shown; offset += hex::ROW_BYTES)
+      len += hex::render_row(bytes + offset,
+                             std::min(hex::ROW_BYTES, shown - offset), offset,
+                             digits, out + len);
+    if (shown < size) {
+      len += format_clip_marker(out + len, size - shown, {});
+      out[len++] = '\n';
+    }
+
+    write_line(entry.level, module, {out, len}, nullptr, 0, entry.loc);
+  } catch (...) {
+    static const char fallback[] = "coretrace: hexdump allocation failed\n";
+    write_raw(fallback, sizeof(fallback) - 1);
+  }
+}
+
+void detail::append_field_text(std::string &out, const Field &field) {
+  append_fields(out, &field, 1);
+}
+
+std::string_view detail::field_text(const Field &field, char *buf) {
+  switch (field.kind) {
+  case FieldKind::Bool:
+    return field.bool_value ? "true" : "false";
+  case FieldKind::Int: {
+    size_t len = 0;
+    unsigned long long value = static_cast<unsigned long long>(field.int_value);
+    if (field.int_value < 0) {
+      buf[len++] = '-';
+      value = 0ULL - value;
+    }
+    len += format_dec(buf + len, value);
+    return {buf, len};
+  }
+  case FieldKind::Uint:
+    return {buf, format_dec(buf, field.uint_value)};
+  case FieldKind::Float: {
+    const std::to_chars_result result =
+        std::to_chars(buf, buf + FIELD_TEXT_CAPACITY, field.float_value);
+    if (result.ec != std::errc())
+      return "nan";
+    return {buf, static_cast<size_t>(result.ptr - buf)};
+  }
+  case FieldKind::String:
+    return field.string_value;
+  case FieldKind::Pointer:
+    return {buf, format_hex(buf, reinterpret_cast<uintptr_t>(
+                                     field.pointer_value))};
+  }
+  return {};
+}
+
+size_t format_timestamp(char *buf) {
+  size_t idx = 0;
+  write_timestamp_to(buf, idx);
+  return idx;
 }
 
 // ####################################
-//  Atomic log line output
+//  LineBuilder
 // ####################################
 
-void write_log_line(Level level, std::string_view module,
-                    std::string_view message, const std::source_location &loc) {
-  PrefixSnapshot prefix = read_prefix_snapshot();
-  OutputLockGuard output_lock;
+LineBuilder &LineBuilder::append_prefix(Level level) {
+  PrefixSnapshot prefix = read_prefix_snapshot(*logger_->state_);
 
-  // Optional timestamp: [2025-01-15T10:45:23.456]
-  if (g_timestamps_enabled.load(std::memory_order_acquire)) {
-    char ts_buf[32];
-    size_t ts_idx = 0;
-    write_timestamp_to(ts_buf, ts_idx);
-    write_raw(ts_buf, ts_idx);
-  }
-
-  // |PID|
-  write_str(color(Color::Dim));
-  write_raw("|", 1);
-  write_dec(static_cast<size_t>(pid()));
-  write_raw("|", 1);
-  write_str(color(Color::Reset));
-  write_raw(" ", 1);
-
-  // Configurable prefix tag.
-  write_str(color(Color::Gray));
-  write_str(color(Color::Italic));
-  write_raw(prefix.value, prefix.len);
-  write_raw(" ", 1);
-  write_str(color(Color::Reset));
+  LineCursor line{buf_ + len_, CAPACITY - len_};
+  append_level_prefix(line, prefix, level);
+  line.append(" ", 1);
 
-  // [LEVEL]
-  write_str(level_color(level));
-  write_raw("[", 1);
-  write_str(level_label(level));
-  write_raw("]", 1);
-  write_str(color(Color::Reset));
+  len_ += line.len;
+  truncated_ = truncated_ || line.truncated;
+  level_ = level;
+  return *this;
+}
 
-  // Optional source location: file.cpp:42
-  if (g_source_location_enabled.load(std::memory_order_acquire)) {
-    write_raw(" ", 1);
-    write_str(color(Color::Dim));
-    const char *file = basename_of(loc.file_name());
-    write_raw(file, std::strlen(file));
-    write_raw(":", 1);
-    write_dec(static_cast<size_t>(loc.line()));
-    write_str(color(Color::Reset));
+LineBuilder &LineBuilder::append_raw(const char *data, size_t size) {
+  if (size > CAPACITY - len_) {
+    size = CAPACITY - len_;
+    truncated_ = true;
   }
+  if (size == 0)
+    return *this;
 
-  // Optional module tag: (alloc)
-  if (!module.empty()) {
-    write_raw(" ", 1);
-    write_str(color(Color::Dim));
-    write_raw("(", 1);
-    write_raw(module.data(), module.size());
-    write_raw(")", 1);
-    write_str(color(Color::Reset));
+  std::memcpy(buf_ + len_, data, size);
+  len_ += size;
+  return *this;
+}
+
+LineBuilder &LineBuilder::append_str(std::string_view value) {
+  return append_raw(value.data(), value.size());
+}
+
+LineBuilder &LineBuilder::append_udec(unsigned long long value,
+                                      bool negative) {
+  char buf[1 + DEC_CAPACITY];
+  size_t idx = 0;
+  if (negative)
+    buf[idx++] = '-';
+  idx += format_dec(buf + idx, value);
+  return append_raw(buf, idx);
+}
+
+LineBuilder &LineBuilder::append_hex(unsigned long long value) {
+  char buf[HEX_CAPACITY];
+  return append_raw(buf, format_hex(buf, value));
+}
+
+LineBuilder &LineBuilder::append_float(double value) {
+  char buf[32];
+  auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+  if (ec == std::errc())
+    append_raw(buf, static_cast<size_t>(end - buf));
+  return *this;
+}
+
+LineBuilder &LineBuilder::append_float(double value, int precision) {
+  char buf[64];
+  std::to_chars_result result = std::to_chars(
+      buf, buf + sizeof(buf), value, std::chars_format::fixed, precision);
+
+  // Very large magnitudes do not fit in fixed notation.
+  if (result.ec != std::errc())
+    result = std::to_chars(buf, buf + sizeof(buf), value,
+                           std::chars_format::general, precision);
+
+  if (result.ec == std::errc())
+    append_raw(buf, static_cast<size_t>(result.ptr - buf));
+  return *this;
+}
+
+void LineBuilder::commit() {
+  if (len_ != 0)
+    logger_->write_atomic(buf_, len_, level_);
+  clear();
+}
+
+// ####################################
+//  LogBatch
+// ####################################
+
+LogBatch::LogBatch(LogEntry entry, Logger &logger, BatchTimestamp stamping)
+    : LogBatch(entry, Module(std::string_view{}), logger, stamping) {}
+
+LogBatch::LogBatch(LogEntry entry, Module mod, Logger &logger,
+                   BatchTimestamp stamping)
+    : logger_(&logger) {
+  logger.init_once();
+
+  // Filters are evaluated once for the whole batch.
+  if (!logger.is_enabled())
+    return;
+  if (static_cast<int>(entry.level) < static_cast<int>(logger.min_level()))
+    return;
+  if (!mod.name.empty() && !logger.module_is_enabled(mod.name))
+    return;
+
+  active_ = true;
+  level_ = entry.level;
+
+  // The rule set and pattern are held until the destructor.
+  State &state = *logger.state_;
+  readers_ = enter_readers(state);
+  const bool timestamps =
+      state.timestamps_enabled.load(std::memory_order_acquire) != 0;
+  per_record_timestamp_ = timestamps && stamping == BatchTimestamp::PerRecord;
+
+  // A record sink (syslog) frames each record itself: keep the bodies
+  // and what the records share, nothing is rendered.
+  if (const detail::SinkBackend *backend =
+          state.backend.load(std::memory_order_acquire);
+      backend && backend->takes_records) {
+    records_ = true;
+    sanitize_ = state.sanitize.load(std::memory_order_relaxed) != 0;
+    redactor_ = state.redactor.load(std::memory_order_acquire);
+    module_.assign(mod.name);
+    record_loc_ =
+        state.source_location_enabled.load(std::memory_order_acquire);
+    loc_ = entry.loc;
+    per_record_timestamp_ = false;
+    return;
   }
 
-  write_raw(" ", 1);
+  // Every record shares level, module and call site: render the prefix
+  // (and, when shared, the timestamp) once.
+  PrefixSnapshot prefix = read_prefix_snapshot(state);
+  char buf[LINE_CAPACITY];
+  LineCursor line{buf, sizeof(buf)};
+  json_ = prefix.layout == Layout::Json;
+  sanitize_ = state.sanitize.load(std::memory_order_relaxed) != 0;
+  redactor_ = state.redactor.load(std::memory_order_acquire);
+  framing_ = static_cast<LineFraming>(
+      state.line_framing.load(std::memory_order_acquire));
+  cbor_ = prefix.layout == Layout::Cbor;
+  if (prefix.layout == Layout::Pattern)
+    pattern_ = state.pattern.load(std::memory_order_acquire);
+  if (pattern_) {
+    // Rendered whole per record; keep what every record shares. prefix_
+    // holds the prefix tag.
+    prefix_.assign(prefix.value, prefix.len);
+    module_.assign(mod.name);
+    if (state.source_location_enabled.load(std::memory_order_acquire)) {
+      file_ = detail::source_basename(entry.loc.file_name());
+      line_ = entry.loc.line();
+    }
+    if (timestamps && !per_record_timestamp_) {
+      char ts[TIMESTAMP_CAPACITY];
+      timestamp_.assign(pattern_timestamp(ts));
+    }
+    return;
+  }
+  if (cbor_) {
+    // Map head and members up to the message; a per-record time is added
+    // by begin_record(). The batch is built outside the output lock, so
+    // names are written inline rather than interned.
+    const char *file =
+        state.source_location_enabled.load(std::memory_order_acquire)
+            ? detail::source_basename(entry.loc.file_name())
+            : nullptr;
+    uint64_t time = 0;
+    const bool shared_time = timestamps && !per_record_timestamp_ &&
+                             platform::realtime_ns(time);
+    append_cbor_members(line, prefix, entry.level, mod.name, file,
+                        entry.loc.line(), CborNames{},
+                        shared_time || per_record_timestamp_,
+                        shared_time ? &time : nullptr, false);
+  } else if (json_) {
+    // Up to the opening quote of the message; "{" and a per-record
+    // timestamp are added by begin_record().
+    if (timestamps && !per_record_timestamp_)
+      append_json_timestamp(line);
+    append_json_head(line, state, prefix, entry.level, mod.name, entry.loc);
+  } else {
+    append_record_prefix(line, state, prefix, entry.level, mod.name,
+                         entry.loc, timestamps && !per_record_timestamp_);
+  }
+  prefix_.assign(buf, line.len);
+}
 
-  // Message body.
-  write_raw(message.data(), message.size());
+LogBatch::~LogBatch() {
+  commit();
+  if (readers_)
+    leave_readers(readers_);
+}
+
+void LogBatch::add_line(std::string_view message) {
+  if (!active_ || message.empty())
+    return;
+
+  const size_t start = begin_record();
+  buffer_.append(message);
+  end_record(start);
+}
+
+void LogBatch::commit() {
+  if (records_)
+    logger_->write_bodies(buffer_.data(), ends_.data(), ends_.size(),
+                          level_, module_, record_loc_ ? &loc_ : nullptr);
+  else if (!buffer_.empty())
+    logger_->write_records(buffer_.data(), ends_.data(), ends_.size(),
+                           level_);
+
+  buffer_.clear();
+  ends_.clear();
+  count_ = 0;
+}
+
+size_t LogBatch::begin_record() {
+  const size_t start = buffer_.size();
+
+  if (pattern_) {
+    body_start_ = start;
+    return start;
+  }
+
+  if (cbor_) {
+    buffer_.append(prefix_);
+    if (per_record_timestamp_) {
+      uint64_t time = 0; // stays 0 if the clock fails
+      static_cast<void>(platform::realtime_ns(time));
+      append_cbor_key(buffer_, detail::cbor::TIME);
+      append_cbor_head(buffer_, detail::cbor::UINT, time);
+    }
+    body_start_ = buffer_.size();
+    return start;
+  }
+
+  if (json_) {
+    buffer_.push_back('{');
+    if (per_record_timestamp_)
+      append_json_timestamp(buffer_);
+  } else if (per_record_timestamp_) {
+    char ts_buf[TIMESTAMP_CAPACITY];
+    size_t ts_len = 0;
+    write_timestamp_to(ts_buf, ts_len);
+    buffer_.append(ts_buf, ts_len);
+  }
+
+  buffer_.append(prefix_);
+  body_start_ = buffer_.size();
+  return start;
+}
+
+void LogBatch::end_record(size_t start) {
+  // Empty messages produce no record, as with log().
+  if (buffer_.size() == body_start_) {
+    buffer_.resize(start);
+    return;
+  }
+  if (sanitize_) {
+    const size_t size = buffer_.size() - body_start_;
+    const size_t clean =
+        detail::sanitize::clean_prefix(buffer_.data() + body_start_, size);
+    if (clean != size) {
+      scratch_.assign(buffer_, body_start_ + clean);
+      buffer_.resize(body_start_ + clean);
+      detail::sanitize::append_sanitized(buffer_, scratch_);
+    }
+  }
+  if (redactor_) {
+    scratch_.clear();
+    if (redactor_->redact(std::string_view(buffer_).substr(body_start_),
+                          scratch_)) {
+      buffer_.resize(body_start_);
+      buffer_.append(scratch_);
+    }
+  }
+  State &state = *logger_->state_;
+  if (const size_t limit =
+          state.max_record_size.load(std::memory_order_relaxed);
+      limit != 0 && buffer_.size() - body_start_ > limit) {
+    const std::string_view body(buffer_.data() + body_start_,
+                                buffer_.size() - body_start_);
+    char id[BLOB_ID_CAPACITY];
+    const std::string_view blob = store_blob(state, body, id);
+    clip_tail(buffer_, body_start_, body.size(), body.back() == '\n', limit,
+              blob);
+  }
+  if (json_) {
+    // The body was formatted in place; escape it through scratch_.
+    std::string_view body(buffer_.data() + body_start_,
+                          buffer_.size() - body_start_);
+    trim_newline(body);
+    scratch_.assign(body);
+    buffer_.resize(body_start_);
+    detail::json::append_escaped(buffer_, scratch_);
+    buffer_.append("\"}\n", 3);
+  } else if (pattern_) {
+    // The body was formatted in place; the pattern is run around it.
+    std::string_view body(buffer_.data() + body_start_,
+                          buffer_.size() - body_start_);
+    trim_newline(body);
+    scratch_.assign(body);
+    buffer_.resize(start);
+    append_batch_pattern(scratch_);
+  } else if (cbor_) {
+    // The body was formatted in place; it becomes a text string.
+    std::string_view body(buffer_.data() + body_start_,
+                          buffer_.size() - body_start_);
+    trim_newline(body);
+    scratch_.assign(body);
+    buffer_.resize(body_start_);
+    append_cbor_key(buffer_, detail::cbor::MESSAGE);
+    append_cbor_text(buffer_, scratch_);
+  } else if (framing_ != LineFraming::Off) {
+    // Prefix and body move to scratch_; continuation lines repeat this
+    // record's prefix (timestamp included) or are indented under it.
+    const size_t head = body_start_ - start;
+    scratch_.assign(buffer_, start, buffer_.size() - start);
+    buffer_.resize(body_start_);
+    const std::string_view repeat(scratch_.data(), head);
+    const size_t indent =
+        framing_ == LineFraming::Indent ? visible_width(repeat) : 0;
+    append_framed(
+        buffer_, std::string_view(scratch_).substr(head),
+        [&](std::string &out) {
+          if (framing_ == LineFraming::Prefix)
+            out.append(repeat);
+          else
+            append_padding(out, indent);
+        },
+        true);
+  }
+  ends_.push_back(buffer_.size());
+  ++count_;
+}
+
+void LogBatch::append_batch_pattern(std::string_view message) {
+  PatternRecord record;
+  record.level = level_;
+  char ts[TIMESTAMP_CAPACITY];
+  record.timestamp =
+      per_record_timestamp_ ? pattern_timestamp(ts) : timestamp_;
+  record.prefix = prefix_;
+  record.module = module_;
+  record.message = message;
+  if (file_) {
+    record.file = file_;
+    record.line = line_;
+  }
+  append_pattern_record(buffer_, *pattern_, record);
+}
+
+void LogBatch::fail_record(size_t start) {
+  static const char fallback[] = "coretrace: log format error\n";
+  static const char json_fallback[] =
+      "{\"msg\":\"coretrace: log format error\"}\n";
+  buffer_.resize(start);
+  if (pattern_) {
+    append_batch_pattern(std::string_view(fallback, sizeof(fallback) - 2));
+  } else if (cbor_) {
+    begin_record();
+    append_cbor_key(buffer_, detail::cbor::MESSAGE);
+    append_cbor_text(buffer_, std::string_view(fallback, sizeof(fallback) - 2));
+  } else if (json_) {
+    buffer_.append(json_fallback, sizeof(json_fallback) - 1);
+  } else {
+    buffer_.append(fallback, sizeof(fallback) - 1);
+  }
+  ends_.push_back(buffer_.size());
 }
 
 } // namespace coretrace
@@ -0,0 +1,388 @@
+#include "logger_cbor.hpp"
+
+#include "logger_sink.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace coretrace::detail::cbor {
+
+namespace {
+
+// Nesting accepted inside a record (field values are flat).
+constexpr int MAX_DEPTH = 8;
+
+// Largest definition id accepted; keeps a damaged stream from allocating.
+constexpr uint64_t MAX_ID = 1 << 20;
+
+// Bounds-checked reader over one item. Running out of data sets short_;
+// any other surprise sets bad_.
+class Parser {
+public:
+  Parser(const char *data, size_t size)
+      : data_(reinterpret_cast<const unsigned char *>(data)), size_(size) {}
+
+  [[nodiscard]] size_t offset() const { return pos_; }
+  [[nodiscard]] bool ok() const { return !short_ && !bad_; }
+  [[nodiscard]] bool ran_short() const { return short_; }
+
+  // Initial byte and argument. Indefinite lengths are not produced by the
+  // encoder and are rejected.
+  bool head(Major &major, uint64_t &value, unsigned &info) {
+    if (!ok())
+      return false;
+    if (pos_ >= size_)
+      return fail_short();
+    const unsigned char initial = data_[pos_++];
+    major = static_cast<Major>(initial >> 5);
+    info = initial & 31;
+    if (info < 24) {
+      value = info;
+      return true;
+    }
+    if (info > 27)
+      return fail_bad();
+    const size_t bytes = size_t{1} << (info - 24);
+    if (size_ - pos_ < bytes)
+      return fail_short();
+    value = 0;
+    for (size_t i = 0; i < bytes; ++i)
+      value = (value << 8) | data_[pos_++];
+    return true;
+  }
+
+  // Payload of a text or byte string of the given length.
+  bool bytes(uint64_t length, std::string_view &out) {
+    if (!ok())
+      return false;
+    if (size_ - pos_ < length)
+      return fail_short();
+    out = std::string_view(reinterpret_cast<const char *>(data_ + pos_),
+                           static_cast<size_t>(length));
+    pos_ += static_cast<size_t>(length);
+    return true;
+  }
+
+  bool uint(uint64_t &value) {
+    Major major;
+    unsigned info;
+    if (!head(major, value, info))
+      return false;
+    return major == UINT || fail_bad();
+  }
+
+  bool text(std::string_view &out) {
+    Major major;
+    uint64_t length;
+    unsigned info;
+    if (!head(major, length, info))
+      return false;
+    if (major != TEXT)
+      return fail_bad();
+    return bytes(length, out);
+  }
+
+  // A scalar field value.
+  bool value(Field &field) {
+    Major major;
+    uint64_t arg;
+    unsigned info;
+    if (!head(major, arg, info))
+      return false;
+    switch (major) {
+    case UINT:
+      field.kind = FieldKind::Uint;
+      field.uint_value = arg;
+      return true;
+    case NEGINT:
+      field.kind = FieldKind::Int;
+      field.int_value = -1 - static_cast<long long>(arg);
+      return true;
+    case TEXT:
+      field.kind = FieldKind::String;
+      return bytes(arg, field.string_value);
+    case BYTES: {
+      std::string_view raw;
+      if (!bytes(arg, raw) || raw.size() > 8)
+        return fail_bad();
+      uint64_t address = 0;
+      for (char c : raw)
+        address = (address << 8) | static_cast<unsigned char>(c);
+      field.kind = FieldKind::Pointer;
+      field.pointer_value =
+          reinterpret_cast<const void *>(static_cast<uintptr_t>(address));
+      return true;
+    }
+    case SIMPLE:
+      return simple(info, arg, field);
+    default:
+      return fail_bad();
+    }
+  }
+
+  // Skip any well-formed item.
+  bool skip(int depth = 0) {
+    Major major;
+    uint64_t arg;
+    unsigned info;
+    if (depth > MAX_DEPTH || !head(major, arg, info))
+      return ok() && fail_bad();
+    std::string_view ignored;
+    switch (major) {
+    case BYTES:
+    case TEXT:
+      return bytes(arg, ignored);
+    case ARRAY:
+      for (uint64_t i = 0; i < arg && ok(); ++i)
+        skip(depth + 1);
+      return ok();
+    case MAP:
+      for (uint64_t i = 0; i < arg * 2 && ok(); ++i)
+        skip(depth + 1);
+      return ok();
+    case TAG:
+      return skip(depth + 1);
+    default:
+      return true;
+    }
+  }
+
+private:
+  bool simple(unsigned info, uint64_t arg, Field &field) {
+    switch (info) {
+    case 20:
+    case 21:
+      field.kind = FieldKind::Bool;
+      field.bool_value = info == 21;
+      return true;
+    case 25:
+      field.kind = FieldKind::Float;
+      field.float_value = half_to_double(static_cast<uint16_t>(arg));
+      return true;
+    case 26: {
+      const auto bits = static_cast<uint32_t>(arg);
+      float value;
+      std::memcpy(&value, &bits, sizeof(value));
+      field.kind = FieldKind::Float;
+      field.float_value = value;
+      return true;
+    }
+    case 27:
+      field.kind = FieldKind::Float;
+      std::memcpy(&field.float_value, &arg, sizeof(arg));
+      return true;
+    default:
+      return fail_bad();
+    }
+  }
+
+  static double half_to_double(uint16_t half) {
+    const int exponent = (half >> 10) & 0x1f;
+    const int mantissa = half & 0x3ff;
+    double value;
+    if (exponent == 0)
+      value = std::ldexp(mantissa, -24);
+    else if (exponent != 31)
+      value = std::ldexp(mantissa + 1024, exponent - 25);
+    else
+      value = mantissa == 0 ? INFINITY : NAN;
+    return (half & 0x8000) ? -value : value;
+  }
+
+  bool fail_short() {
+    short_ = true;
+    return false;
+  }
+
+  bool fail_bad() {
+    bad_ = true;
+    return false;
+  }
+
+  const unsigned char *data_;
+  size_t size_;
+  size_t pos_ = 0;
+  bool short_ = false;
+  bool bad_ = false;
+};
+
+// Civil date of a day count since 1970-01-01 (H. Hinnant's algorithm).
+void civil_from_days(long long days, int &year, int &month, int &day) {
+  days += 719468;
+  const long long era = (days >= 0 ? days : days - 146096) / 146097;
+  const auto doe = static_cast<unsigned>(days - era * 146097);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+  month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+  year = static_cast<int>(static_cast<long long>(yoe) + era * 400 +
+                          (month <= 2 ? 1 : 0));
+}
+
+// "[YYYY-MM-DDThh:mm:ss.mmm] ", as the text layout writes it.
+void append_timestamp(std::string &out, uint64_t ns) {
+  const auto seconds = static_cast<long long>(ns / 1000000000u);
+  const auto millis = static_cast<int>((ns / 1000000u) % 1000);
+  int year;
+  int month;
+  int day;
+  civil_from_days(seconds / 86400, year, month, day);
+  const auto of_day = static_cast<int>(seconds % 86400);
+  char buf[TIMESTAMP_CAPACITY];
+  const int len = std::snprintf(
+      buf, sizeof(buf), "[%04d-%02d-%02dT%02d:%02d:%02d.%03d] ", year, month,
+      day, of_day / 3600, of_day / 60 % 60, of_day % 60, millis);
+  out.append(buf, static_cast<size_t>(len));
+}
+
+} // namespace
+
+TextDecoder::Result TextDecoder::next(const char *data, size_t size,
+                                      size_t &consumed, std::string &out) {
+  Parser parser(data, size);
+  const auto result = [&]() {
+    return parser.ran_short() ? Result::NeedMore : Result::Malformed;
+  };
+
+  Major major;
+  uint64_t entries;
+  unsigned info;
+  if (!parser.head(major, entries, info))
+    return result();
+  if (major != MAP || entries == 0 || entries > 32)
+    return Result::Malformed;
+
+  // Names arrive as ids of earlier definitions or inline text.
+  const auto name = [&](std::string_view &value) {
+    const size_t at = parser.offset();
+    if (at < size && (static_cast<unsigned char>(data[at]) >> 5) == TEXT)
+      return parser.text(value);
+    uint64_t id;
+    if (!parser.uint(id))
+      return false;
+    value = id < names_.size() ? std::string_view(names_[id]) : "?";
+    return true;
+  };
+
+  bool has_level = false;
+  bool has_def_id = false;
+  uint64_t level = 0;
+  uint64_t time = 0;
+  bool has_time = false;
+  uint64_t pid = 0;
+  uint64_t line = 0;
+  uint64_t def_id = 0;
+  std::string_view def_name;
+  std::string_view prefix;
+  std::string_view module;
+  std::string_view file;
+  std::string_view message;
+  std::vector<Field> fields;
+
+  for (uint64_t i = 0; i < entries; ++i) {
+    uint64_t key;
+    if (!parser.uint(key))
+      return result();
+    bool read = true;
+    switch (key) {
+    case DEF_ID:
+      read = parser.uint(def_id);
+      has_def_id = true;
+      break;
+    case DEF_NAME:
+      read = parser.text(def_name);
+      break;
+    case LEVEL:
+      read = parser.uint(level);
+      has_level = true;
+      break;
+    case TIME:
+      read = parser.uint(time);
+      has_time = true;
+      break;
+    case PID:
+      read = parser.uint(pid);
+      break;
+    case TID: {
+      uint64_t tid;
+      read = parser.uint(tid);
+      break;
+    }
+    case PREFIX:
+      read = name(prefix);
+      break;
+    case MODULE:
+      read = name(module);
+      break;
+    case FILE:
+      read = name(file);
+      break;
+    case LINE:
+      read = parser.uint(line);
+      break;
+    case MESSAGE:
+      read = parser.text(message);
+      break;
+    case FIELDS: {
+      uint64_t count;
+      read = parser.head(major, count, info);
+      if (read && (major != MAP || count > 1024))
+        return Result::Malformed;
+      for (uint64_t f = 0; f < count && read; ++f) {
+        Field field;
+        read = parser.text(field.key) && parser.value(field);
+        fields.push_back(field);
+      }
+      break;
+    }
+    default:
+      read = parser.skip(); // added by a newer writer
+    }
+    if (!read)
+      return result();
+  }
+
+  consumed = parser.offset();
+  if (has_def_id) {
+    if (def_id >= MAX_ID)
+      return Result::Malformed;
+    if (names_.size() <= def_id)
+      names_.resize(static_cast<size_t>(def_id) + 1);
+    names_[static_cast<size_t>(def_id)] = def_name;
+    return Result::Item;
+  }
+  if (!has_level || level > static_cast<uint64_t>(Level::Error))
+    return Result::Malformed;
+
+  // [ts] |PID| prefix [LEVEL] file:line (module) message fields
+  if (has_time)
+    append_timestamp(out, time);
+  out.push_back('|');
+  out.append(std::to_string(pid));
+  out.append("| ");
+  out.append(prefix);
+  out.append(" [");
+  out.append(level_label(static_cast<Level>(level)));
+  out.push_back(']');
+  if (!file.empty()) {
+    out.push_back(' ');
+    out.append(file);
+    out.push_back(':');
+    out.append(std::to_string(line));
+  }
+  if (!module.empty()) {
+    out.append(" (");
+    out.append(module);
+    out.push_back(')');
+  }
+  out.push_back(' ');
+  out.append(message);
+  for (const Field &field : fields)
+    append_field_text(out, field);
+  out.push_back('\n');
+  return Result::Item;
+}
+
+} // namespace coretrace::detail::cbor
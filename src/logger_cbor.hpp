@@ -0,0 +1,161 @@
+#ifndef CORETRACE_LOGGER_CBOR_HPP
+#define CORETRACE_LOGGER_CBOR_HPP
+
+#include "coretrace/logger.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// CBOR record encoding (RFC 8949) for Layout::Cbor.
+//
+// The output is a CBOR sequence (RFC 8742): one map per item, with small
+// unsigned integer keys. Two kinds of items:
+//
+//   definition  {0: id, 1: "name"}
+//   record      {2: level, 3: time, 4: pid, 5: tid, 6: prefix, 7: module,
+//                8: file, 9: line, 10: "message", 11: {"key": value, ...}}
+//
+// level is the Level value (0..3); time is nanoseconds since the Unix
+// epoch (only with timestamps on); file and line only with source
+// locations on; module and fields only when the record has them. prefix,
+// module and file are the id of an earlier definition in the same stream,
+// or a text string where no id could be given. The message has no
+// trailing newline. Field values keep their type: integers, float64,
+// true/false, text, and pointers as an 8-byte big-endian byte string.
+namespace coretrace::detail::cbor {
+
+enum Key : uint8_t {
+  DEF_ID = 0,
+  DEF_NAME = 1,
+  LEVEL = 2,
+  TIME = 3,
+  PID = 4,
+  TID = 5,
+  PREFIX = 6,
+  MODULE = 7,
+  FILE = 8,
+  LINE = 9,
+  MESSAGE = 10,
+  FIELDS = 11,
+};
+
+enum Major : uint8_t {
+  UINT = 0,
+  NEGINT = 1,
+  BYTES = 2,
+  TEXT = 3,
+  ARRAY = 4,
+  MAP = 5,
+  TAG = 6,
+  SIMPLE = 7,
+};
+
+constexpr unsigned char FALSE_BYTE = 0xf4;
+constexpr unsigned char TRUE_BYTE = 0xf5;
+constexpr unsigned char FLOAT64_BYTE = 0xfb;
+
+// Largest encoded head: initial byte plus an 8-byte argument.
+constexpr size_t HEAD_CAPACITY = 9;
+
+// Encode a head (major type and argument) in its shortest form. Returns
+// its length.
+inline size_t encode_head(Major major, uint64_t value, char *out) {
+  const auto initial = static_cast<unsigned char>(major << 5);
+  size_t bytes;
+  if (value < 24) {
+    out[0] = static_cast<char>(initial | value);
+    return 1;
+  }
+  if (value <= 0xff) {
+    out[0] = static_cast<char>(initial | 24);
+    bytes = 1;
+  } else if (value <= 0xffff) {
+    out[0] = static_cast<char>(initial | 25);
+    bytes = 2;
+  } else if (value <= 0xffffffffu) {
+    out[0] = static_cast<char>(initial | 26);
+    bytes = 4;
+  } else {
+    out[0] = static_cast<char>(initial | 27);
+    bytes = 8;
+  }
+  for (size_t i = 0; i < bytes; ++i)
+    out[bytes - i] = static_cast<char>((value >> (8 * i)) & 0xff);
+  return 1 + bytes;
+}
+
+// Ids of names defined in the current output stream. A new stream (the
+// sink changed, or the sink started a new file or connection) starts
+// over, so every stream decodes on its own.
+class Interner {
+public:
+  static constexpr size_t MAX_NAMES = 4096;
+
+  // Forget every name if the destination is not the one the table was
+  // built for. Returns true if the table was reset.
+  bool bind(const void *backend, SinkFn sink, uint64_t generation) {
+    if (backend == backend_ && sink == sink_ && generation == generation_)
+      return false;
+    backend_ = backend;
+    sink_ = sink;
+    generation_ = generation;
+    reset();
+    return true;
+  }
+
+  // Forget every name: the next records define them again.
+  void reset() {
+    ids_.clear();
+    names_.clear();
+  }
+
+  // Id of name, or -1 when the table is full. fresh is set when the name
+  // was just added: its definition must be written before its first use.
+  [[nodiscard]] long long lookup(std::string_view name, bool &fresh) {
+    fresh = false;
+    if (const auto it = ids_.find(name); it != ids_.end())
+      return static_cast<long long>(it->second);
+    if (names_.size() >= MAX_NAMES)
+      return -1;
+    names_.emplace_back(name);
+    const auto id = static_cast<uint32_t>(names_.size() - 1);
+    ids_.emplace(names_.back(), id);
+    fresh = true;
+    return id;
+  }
+
+private:
+  const void *backend_ = nullptr;
+  SinkFn sink_ = nullptr;
+  uint64_t generation_ = 0;
+  std::deque<std::string> names_; // stable storage behind the keys
+  std::unordered_map<std::string_view, uint32_t> ids_;
+};
+
+// Turns a CBOR record stream back into the text layout (without colors).
+class TextDecoder {
+public:
+  enum class Result {
+    Item,     // one item decoded
+    NeedMore, // data ends inside the item
+    Malformed // not an item of this format
+  };
+
+  // Decode the item at the start of data. On Item, consumed is its size
+  // and a record's text line (nothing for a definition) is appended to
+  // out.
+  Result next(const char *data, size_t size, size_t &consumed,
+              std::string &out);
+
+private:
+  std::vector<std::string> names_; // by id
+};
+
+} // namespace coretrace::detail::cbor
+
+#endif // CORETRACE_LOGGER_CBOR_HPP
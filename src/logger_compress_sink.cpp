@@ -0,0 +1,219 @@
+#include "logger_lz.hpp"
+#include "logger_sink.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace coretrace::detail {
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+// Collects lines into blocks of buffer_size and hands each completed block
+// to a background thread, which compresses it into a self-contained frame
+// (see logger_lz.hpp) and writes the frame to the file sink behind it.
+//
+// Two blocks alternate: producers fill one while the other is compressed.
+// A producer only waits when it fills a block before the previous one was
+// written; it never compresses. A block is also handed off early on
+// flush(), after an Error line (flush_on_error / SyncOnError), at
+// flush_bytes and every flush_interval, which bounds what a crash can
+// lose to the block being filled and the one in flight.
+class CompressSink final : public SinkBackend {
+public:
+  CompressSink(std::unique_ptr<SinkBackend> file,
+               const FileSinkOptions &options, size_t block_size)
+      : file_(std::move(file)), options_(options), capacity_(block_size),
+        active_(std::make_unique<char[]>(block_size)),
+        pending_(std::make_unique<char[]>(block_size)),
+        frame_(std::make_unique<char[]>(lz::FRAME_HEADER_SIZE +
+                                        lz::compress_bound(block_size))) {
+    handoff_threshold_ = capacity_;
+    if (options.flush_bytes != 0 && options.flush_bytes < capacity_)
+      handoff_threshold_ = options.flush_bytes;
+
+    worker_ = std::thread([this]() { worker_loop(); });
+  }
+
+  ~CompressSink() override { close(); }
+
+  CompressSink(const CompressSink &) = delete;
+  CompressSink &operator=(const CompressSink &) = delete;
+
+  void write(const char *data, size_t size, Level level) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (closed_) {
+      dropped_bytes_ += size;
+      return;
+    }
+
+    while (size > 0) {
+      if (len_ == capacity_)
+        handoff_locked(lock);
+      const size_t room = capacity_ - len_;
+      const size_t chunk = size < room ? size : room;
+      std::memcpy(active_.get() + len_, data, chunk);
+      len_ += chunk;
+      data += chunk;
+      size -= chunk;
+    }
+
+    if (level == Level::Error) {
+      active_error_ = true;
+      if (options_.flush_on_error ||
+          options_.durability == FileDurability::SyncOnError)
+        handoff_locked(lock);
+    } else if (len_ >= handoff_threshold_) {
+      handoff_locked(lock);
+    }
+  }
+
+  // Waits until everything written so far is compressed and in the file.
+  void flush() override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (closed_)
+      return;
+
+    handoff_locked(lock);
+    const uint64_t target = handed_;
+    idle_.wait(lock, [&]() { return written_ == target; });
+    lock.unlock();
+    file_->flush();
+  }
+
+  void close() override {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (closed_)
+        return;
+      closed_ = true;
+      handoff_locked(lock);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable())
+      worker_.join(); // writes the last block first
+
+    file_->close();
+  }
+
+  SinkStats stats() const override {
+    SinkStats stats = file_->stats();
+    std::lock_guard<std::mutex> guard(mutex_);
+    stats.dropped_bytes += dropped_bytes_;
+    return stats;
+  }
+
+private:
+  // Pass the active block to the worker, after the previous one is done.
+  void handoff_locked(std::unique_lock<std::mutex> &lock) {
+    if (len_ == 0)
+      return;
+    idle_.wait(lock, [&]() { return !has_pending_; });
+
+    std::swap(active_, pending_);
+    pending_len_ = len_;
+    pending_error_ = active_error_;
+    len_ = 0;
+    active_error_ = false;
+    has_pending_ = true;
+    ++handed_;
+    wake_.notify_one();
+  }
+
+  // ── Background thread ────────────────
+
+  void worker_loop() {
+    const bool timed = options_.flush_interval.count() > 0;
+    const bool sync_interval =
+        options_.durability == FileDurability::SyncInterval;
+    auto next_flush = SteadyClock::now() + options_.flush_interval;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      if (has_pending_) {
+        const char *block = pending_.get();
+        const size_t size = pending_len_;
+        const Level level = pending_error_ ? Level::Error : Level::Info;
+        lock.unlock();
+
+        // The block and frame_ belong to this thread until written_ moves.
+        const size_t frame_size = lz::encode_frame(block, size, frame_.get());
+        file_->write(frame_.get(), frame_size, level);
+
+        lock.lock();
+        has_pending_ = false;
+        ++written_;
+        idle_.notify_all();
+        continue;
+      }
+
+      if (stopping_)
+        break;
+
+      if (timed && SteadyClock::now() >= next_flush) {
+        handoff_locked(lock); // never waits: nothing is pending
+        next_flush = SteadyClock::now() + options_.flush_interval;
+        if (sync_interval) {
+          lock.unlock();
+          file_->flush();
+          lock.lock();
+        }
+        continue;
+      }
+
+      if (timed)
+        wake_.wait_until(lock, next_flush);
+      else
+        wake_.wait(lock);
+    }
+  }
+
+  const std::unique_ptr<SinkBackend> file_;
+  const FileSinkOptions options_;
+  const size_t capacity_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_; // worker: a block is pending, or stop
+  std::condition_variable idle_; // producers: the pending block is written
+  std::thread worker_;
+  bool stopping_ = false;
+  bool closed_ = false;
+
+  std::unique_ptr<char[]> active_; // filled by producers
+  size_t len_ = 0;
+  bool active_error_ = false;
+  size_t handoff_threshold_ = 0;
+
+  std::unique_ptr<char[]> pending_; // owned by the worker while pending
+  size_t pending_len_ = 0;
+  bool pending_error_ = false;
+  bool has_pending_ = false;
+
+  std::unique_ptr<char[]> frame_; // worker only
+  uint64_t handed_ = 0;
+  uint64_t written_ = 0;
+  uint64_t dropped_bytes_ = 0;
+};
+
+} // namespace
+
+std::unique_ptr<SinkBackend>
+make_compress_sink(std::unique_ptr<SinkBackend> file,
+                   const FileSinkOptions &options) {
+  if (!file)
+    return nullptr;
+  size_t block_size = options.buffer_size == 0 ? 64 * 1024
+                                               : options.buffer_size;
+  if (block_size > lz::MAX_BLOCK_SIZE)
+    block_size = lz::MAX_BLOCK_SIZE;
+  return std::make_unique<CompressSink>(std::move(file), options, block_size);
+}
+
+} // namespace coretrace::detail
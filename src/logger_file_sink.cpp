@@ -0,0 +1,698 @@
+#include "logger_platform.hpp"
+#include "logger_sink.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace coretrace::detail {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+using SteadyClock = std::chrono::steady_clock;
+using SystemClock = std::chrono::system_clock;
+
+// "YYYYMMDD-HHMMSS.NNN" appended to the active path by a rollover.
+constexpr size_t ARCHIVE_SUFFIX_LEN = 19;
+constexpr int MAX_ARCHIVE_SEQ = 999;
+
+[[nodiscard]] size_t round_up(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+[[nodiscard]] SystemClock::time_point next_boundary(SystemClock::time_point now,
+                                                    RotateInterval every) {
+  const std::chrono::seconds period = every == RotateInterval::Hourly
+                                          ? std::chrono::seconds(3600)
+                                          : std::chrono::seconds(86400);
+  const auto since_epoch =
+      std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch());
+  return SystemClock::time_point((since_epoch / period + 1) * period);
+}
+
+[[nodiscard]] bool is_archive_name(std::string_view name,
+                                   std::string_view base) {
+  if (name.size() != base.size() + 1 + ARCHIVE_SUFFIX_LEN ||
+      name.substr(0, base.size()) != base || name[base.size()] != '.')
+    return false;
+
+  const std::string_view suffix = name.substr(base.size() + 1);
+  for (size_t i = 0; i < suffix.size(); ++i) {
+    const char c = suffix[i];
+    if (i == 8 ? c != '-' : i == 15 ? c != '.' : (c < '0' || c > '9'))
+      return false;
+  }
+  return true;
+}
+
+// Free "<path>.YYYYMMDD-HHMMSS.NNN" for a rollover now, or empty. Sequence
+// numbers only grow within one second (last_stamp, last_seq), even after
+// retention freed a lower one, so names keep sorting in rollover order.
+[[nodiscard]] std::string archive_name(const std::string &path,
+                                       std::string &last_stamp,
+                                       int &last_seq) {
+  platform::UtcTimestamp ts;
+  if (!platform::utc_timestamp(ts))
+    return {};
+
+  char stamp[32];
+  std::snprintf(stamp, sizeof(stamp), ".%04d%02d%02d-%02d%02d%02d.", ts.year,
+                ts.month, ts.day, ts.hour, ts.minute, ts.second);
+
+  int seq = last_stamp == stamp ? last_seq + 1 : 0;
+  for (; seq <= MAX_ARCHIVE_SEQ; ++seq) {
+    char seq_buf[12];
+    std::snprintf(seq_buf, sizeof(seq_buf), "%03d", seq);
+    std::string candidate = path + stamp + seq_buf;
+
+    std::error_code ec;
+    if (!fs::exists(candidate, ec)) {
+      last_stamp = stamp;
+      last_seq = seq;
+      return candidate;
+    }
+  }
+  return {};
+}
+
+// A process that stopped between a rollover and the renames after it left
+// its newest records in "<path>.next". Finish that rollover, so that they
+// are neither truncated by the next prepare nor mixed into older ones: the
+// file under the stable name is archived and ".next" takes the name.
+void finish_rollover(const std::string &path) {
+  const std::string next = path + ".next";
+  std::error_code ec;
+  if (fs::file_size(next, ec) == 0 || ec)
+    return; // none, or prepared and never written
+
+  if (fs::exists(path, ec)) {
+    std::string stamp;
+    int seq = 0;
+    const std::string archive = archive_name(path, stamp, seq);
+    if (archive.empty())
+      return;
+    fs::rename(path, archive, ec);
+    if (ec)
+      return;
+  }
+  fs::rename(next, path, ec);
+}
+
+// Appends through a page-aligned staging buffer so that the file sees few,
+// large write(2) calls. Flushes when the buffer reaches flush_bytes, on an
+// Error line (optional), every flush_interval (background thread) and on
+// close. Durability is opt-in: fdatasync() per interval (per write with no
+// interval) or per Error line.
+//
+// With rotation enabled the background thread also keeps the next file
+// open ahead of time. Producers swap it in under the sink mutex; closing,
+// renaming and retention run on the background thread.
+//
+// direct_io keeps the output out of the page cache. With an O_DIRECT
+// descriptor every write covers whole aligned blocks from the buffer: an
+// unaligned tail is written zero-padded and stays at the front of the
+// buffer so the next drain rewrites that block. The file is cut back to
+// its real length only by flush(), close() and a rollover: a cut after
+// every drain would cost a system call and release the preallocated
+// blocks past the end. Where the file system refuses O_DIRECT, writes go
+// through the page cache; writeback of each range is started right away
+// and the range written before it is dropped with posix_fadvise().
+class FileSink final : public SinkBackend {
+public:
+  // tail: bytes of the file's last partial block preloaded into the
+  // buffer (direct mode).
+  FileSink(int fd, std::string path, const FileSinkOptions &options,
+           char *buffer, size_t capacity, bool direct, size_t tail)
+      : fd_(fd), path_(std::move(path)), next_path_(path_ + ".next"),
+        options_(options), buffer_(buffer), capacity_(capacity),
+        len_(tail),
+        sync_writes_(options.durability == FileDurability::SyncInterval &&
+                     options.flush_interval.count() <= 0),
+        offset_(platform::file_size(fd)),
+        direct_(direct), drop_cache_(options.direct_io && !direct),
+        align_(platform::direct_io_alignment()), base_(offset_ - tail),
+        synced_(tail),
+        rotating_(options.rotate_bytes != 0 ||
+                  options.rotate_every != RotateInterval::Never) {
+    flush_threshold_ = capacity;
+    if (options.flush_bytes != 0 && options.flush_bytes < capacity)
+      flush_threshold_ = options.flush_bytes;
+
+    if (options_.preallocate_bytes != 0)
+      reserve_ahead();
+
+    if (options_.rotate_every != RotateInterval::Never)
+      boundary_ = next_boundary(SystemClock::now(), options_.rotate_every);
+
+    if (rotating_ || options_.flush_interval.count() > 0)
+      worker_ = std::thread([this]() { worker_loop(); });
+  }
+
+  ~FileSink() override { close(); }
+
+  FileSink(const FileSink &) = delete;
+  FileSink &operator=(const FileSink &) = delete;
+
+  void write(const char *data, size_t size, Level level) override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (fd_ < 0) {
+      stats_.dropped_bytes += size;
+      return;
+    }
+
+    if (prepared_)
+      prepared_ = false;
+    else
+      rotate_due_locked(size);
+
+    if (direct_) {
+      append_direct_locked(data, size);
+    } else {
+      if (len_ + size > capacity_)
+        drain_locked();
+
+      if (size >= capacity_) {
+        // Larger than the whole buffer: bypass it.
+        write_through_locked(data, size);
+      } else {
+        std::memcpy(buffer_ + len_, data, size);
+        len_ += size;
+        if (len_ >= flush_threshold_)
+          drain_locked();
+      }
+    }
+
+    if (level == Level::Error) {
+      if (options_.flush_on_error ||
+          options_.durability == FileDurability::SyncOnError)
+        drain_locked();
+      if (options_.durability == FileDurability::SyncOnError)
+        sync_locked();
+    }
+  }
+
+  void prepare_record(size_t size) override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (fd_ < 0)
+      return;
+    rotate_due_locked(size);
+    prepared_ = true;
+  }
+
+  void flush() override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (fd_ < 0)
+      return;
+
+    drain_locked();
+    trim_direct_locked();
+    if (options_.durability != FileDurability::None && !sync_writes_)
+      sync_locked();
+  }
+
+  void close() override {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable())
+      worker_.join();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // The worker is gone: finish a pending rollover and drop the
+    // prepared file here.
+    const int retired = retired_fd_;
+    const int next = next_fd_;
+    retired_fd_ = -1;
+    next_fd_ = -1;
+    rotating_ = false;
+    if (retired >= 0 || next >= 0) {
+      lock.unlock();
+      if (retired >= 0)
+        (void)retire(retired);
+      if (next >= 0) {
+        platform::close_file(next);
+        std::error_code ec;
+        fs::remove(next_path_, ec);
+      }
+      lock.lock();
+    }
+
+    if (fd_ < 0)
+      return;
+
+    drain_locked();
+    trim_direct_locked();
+    if (options_.durability != FileDurability::None && !sync_writes_)
+      sync_locked();
+    if (drop_cache_)
+      platform::drop_file_cache(fd_, 0, 0);
+    platform::close_file(fd_);
+    fd_ = -1;
+
+    platform::free_aligned(buffer_);
+    buffer_ = nullptr;
+    capacity_ = 0;
+  }
+
+  SinkStats stats() const override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return stats_;
+  }
+
+private:
+  // Roll over before a write of size bytes if a boundary has passed or
+  // the write would take the file past rotate_bytes. Size rotation is
+  // decided per record, before it is buffered, so a file only passes
+  // rotate_bytes by a record larger than the limit.
+  void rotate_due_locked(size_t size) {
+    if (options_.rotate_every != RotateInterval::Never) {
+      const SystemClock::time_point now = SystemClock::now();
+      if (now >= boundary_) {
+        drain_locked();
+        if (rotate_locked())
+          boundary_ = next_boundary(now, options_.rotate_every);
+      }
+    }
+
+    if (options_.rotate_bytes != 0) {
+      const uint64_t end = (direct_ ? base_ : offset_) + len_;
+      if (end != 0 && end + size > options_.rotate_bytes) {
+        drain_locked();
+        rotate_locked();
+      }
+    }
+  }
+
+  void write_through_locked(const char *data, size_t size) {
+    ++stats_.syscalls;
+    if (!platform::write_file(fd_, data, size)) {
+      stats_.dropped_bytes += size;
+      return;
+    }
+    stats_.bytes_written += size;
+    if (sync_writes_)
+      sync_locked();
+    const uint64_t start = offset_;
+    offset_ += size;
+    if (options_.preallocate_bytes != 0 && offset_ >= reserved_)
+      reserve_ahead();
+
+    if (drop_cache_) {
+      // The previous range had its writeback started one drain ago.
+      stats_.syscalls += 2;
+      platform::start_file_writeback(fd_, start, size);
+      platform::drop_file_cache(fd_, dropped_, start - dropped_);
+      dropped_ = start;
+    }
+  }
+
+  // ── Direct I/O ───────────────────────
+
+  // Records may straddle buffer drains.
+  void append_direct_locked(const char *data, size_t size) {
+    while (size > 0) {
+      if (len_ == capacity_)
+        drain_locked();
+      const size_t room = capacity_ - len_;
+      const size_t chunk = size < room ? size : room;
+      std::memcpy(buffer_ + len_, data, chunk);
+      len_ += chunk;
+      data += chunk;
+      size -= chunk;
+    }
+    if (len_ - synced_ >= flush_threshold_)
+      drain_locked();
+  }
+
+  // Write buffer_[0, len_) at base_, whole blocks only. buffer_[0, synced_)
+  // is already in the file; it is rewritten because it shares a block with
+  // the new bytes.
+  void drain_direct_locked() {
+    if (len_ == synced_)
+      return;
+
+    const size_t fresh = len_ - synced_;
+    const size_t padded = round_up(len_, align_);
+    std::memset(buffer_ + len_, 0, padded - len_);
+
+    ++stats_.syscalls;
+    if (!platform::write_file_at(fd_, buffer_, padded, base_)) {
+      stats_.dropped_bytes += fresh;
+      len_ = synced_;
+      return;
+    }
+    stats_.bytes_written += fresh;
+    offset_ = base_ + len_;
+    if (padded != len_)
+      padded_ = true;
+    if (sync_writes_)
+      sync_locked();
+
+    const size_t whole = len_ / align_ * align_;
+    std::memmove(buffer_, buffer_ + whole, len_ - whole);
+    base_ += whole;
+    len_ -= whole;
+    synced_ = len_;
+
+    if (options_.preallocate_bytes != 0 && offset_ >= reserved_)
+      reserve_ahead();
+  }
+
+  // Cut the zero padding of the last drain off the end of the file, and
+  // reserve again the blocks the cut released.
+  void trim_direct_locked() {
+    if (!padded_)
+      return;
+    padded_ = false;
+    ++stats_.syscalls;
+    (void)platform::resize_file(fd_, offset_);
+    if (options_.preallocate_bytes != 0)
+      reserve_ahead();
+  }
+
+  void sync_locked() {
+    ++stats_.syscalls;
+    platform::sync_file_data(fd_);
+  }
+
+  void drain_locked() {
+    if (direct_) {
+      drain_direct_locked();
+      return;
+    }
+    if (len_ == 0)
+      return;
+    write_through_locked(buffer_, len_);
+    len_ = 0;
+  }
+
+  // Keep one preallocation chunk reserved past the current offset.
+  void reserve_ahead() {
+    reserved_ = offset_ + options_.preallocate_bytes;
+    platform::preallocate_file(fd_, offset_, options_.preallocate_bytes);
+  }
+
+  // Swap in the prepared file. Returns false (and keeps writing to the
+  // current file) if the worker has not opened it yet.
+  bool rotate_locked() {
+    if (!rotating_)
+      return false;
+
+    if (next_fd_ < 0) {
+      if (prepare_failed_) {
+        prepare_failed_ = false; // retry on the worker
+        wake_.notify_one();
+      }
+      return false;
+    }
+
+    // The retired file ends at its last record, not at a block boundary.
+    if (padded_) {
+      padded_ = false;
+      ++stats_.syscalls;
+      (void)platform::resize_file(fd_, offset_);
+    }
+    retired_fd_ = fd_;
+    fd_ = next_fd_;
+    next_fd_ = -1;
+    offset_ = 0;
+    reserved_ = options_.preallocate_bytes;
+    dropped_ = 0;
+    if (direct_) {
+      // Only bytes not yet written belong to the new file.
+      std::memmove(buffer_, buffer_ + synced_, len_ - synced_);
+      len_ -= synced_;
+      synced_ = 0;
+      base_ = 0;
+    }
+    stream_generation.fetch_add(1, std::memory_order_release);
+    wake_.notify_one();
+    return true;
+  }
+
+  // ── Background thread ────────────────
+
+  [[nodiscard]] bool housekeeping_pending_locked() const {
+    return retired_fd_ >= 0 ||
+           (rotating_ && next_fd_ < 0 && !prepare_failed_);
+  }
+
+  void worker_loop() {
+    const bool timed = options_.flush_interval.count() > 0;
+    auto next_flush = SteadyClock::now() + options_.flush_interval;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+      if (housekeeping_pending_locked()) {
+        housekeeping(lock);
+        continue;
+      }
+
+      if (timed)
+        wake_.wait_until(lock, next_flush);
+      else
+        wake_.wait(lock);
+      if (stopping_ || fd_ < 0)
+        break;
+
+      if (timed && SteadyClock::now() >= next_flush) {
+        drain_locked();
+        if (options_.durability == FileDurability::SyncInterval)
+          sync_locked();
+        next_flush = SteadyClock::now() + options_.flush_interval;
+      }
+    }
+  }
+
+  // Runs the file-system work of a rollover without holding the mutex.
+  void housekeeping(std::unique_lock<std::mutex> &lock) {
+    const int retired = retired_fd_;
+    retired_fd_ = -1;
+    bool prepare = rotating_ && next_fd_ < 0;
+    lock.unlock();
+
+    bool retired_ok = true;
+    if (retired >= 0)
+      retired_ok = retire(retired);
+    prepare = prepare && retired_ok;
+
+    int fd = -1;
+    if (prepare && stale_next()) {
+      // Records of an earlier run: archived, never truncated.
+      const std::string archive = archive_path();
+      std::error_code ec;
+      if (!archive.empty())
+        fs::rename(next_path_, archive, ec);
+      prepare = !archive.empty() && !ec;
+    }
+    if (prepare) {
+      fd = direct_ ? platform::open_direct_file(next_path_.c_str(), true)
+                   : platform::open_log_file(next_path_.c_str(), true);
+      if (fd >= 0 && options_.preallocate_bytes != 0)
+        platform::preallocate_file(fd, 0, options_.preallocate_bytes);
+    }
+
+    lock.lock();
+    if (!retired_ok)
+      rotating_ = false;
+    if (fd >= 0)
+      next_fd_ = fd;
+    else if (rotating_ && next_fd_ < 0)
+      prepare_failed_ = true;
+  }
+
+  // Close the file that was active, archive it and move the prepared file
+  // (already active) to the stable name. Returns false if a rename fails;
+  // the caller stops rotating then, so the active file keeps its ".next"
+  // name and is never truncated by a later prepare.
+  [[nodiscard]] bool retire(int fd) {
+    if (drop_cache_)
+      platform::drop_file_cache(fd, 0, 0);
+    platform::close_file(fd);
+
+    const std::string archive = archive_path();
+    if (archive.empty())
+      return false;
+
+    std::error_code ec;
+    fs::rename(path_, archive, ec);
+    if (ec)
+      return false;
+    fs::rename(next_path_, path_, ec);
+    if (ec)
+      return false;
+
+    enforce_retention();
+    return true;
+  }
+
+  [[nodiscard]] std::string archive_path() {
+    return archive_name(path_, last_stamp_, last_seq_);
+  }
+
+  // A non-empty ".next" before a prepare holds records: the active file
+  // always has the stable name by then (finish_rollover() at startup,
+  // retire() since).
+  [[nodiscard]] bool stale_next() const {
+    std::error_code ec;
+    return fs::file_size(next_path_, ec) != 0 && !ec;
+  }
+
+  void enforce_retention() const {
+    if (options_.max_files == 0)
+      return;
+
+    const fs::path active(path_);
+    const std::string base = active.filename().string();
+    fs::path dir = active.parent_path();
+    if (dir.empty())
+      dir = ".";
+
+    std::vector<fs::path> archives;
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end;
+         it.increment(ec)) {
+      if (is_archive_name(it->path().filename().string(), base))
+        archives.push_back(it->path());
+    }
+
+    if (archives.size() <= options_.max_files)
+      return;
+
+    // Names sort in rollover order.
+    std::sort(archives.begin(), archives.end());
+    const size_t excess = archives.size() - options_.max_files;
+    for (size_t i = 0; i < excess; ++i)
+      fs::remove(archives[i], ec);
+  }
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::thread worker_;
+  bool stopping_ = false;
+
+  int fd_;
+  const std::string path_;
+  const std::string next_path_;
+  FileSinkOptions options_;
+  char *buffer_;
+  size_t capacity_;
+  size_t len_;
+  size_t flush_threshold_ = 0;
+  SinkStats stats_;
+  const bool sync_writes_; // SyncInterval without an interval
+
+  // End of file as seen by this sink, and end of the reserved range.
+  uint64_t offset_;
+  uint64_t reserved_ = 0;
+
+  // ── Direct I/O ───────────────────────
+
+  const bool direct_;     // fd_ is O_DIRECT
+  const bool drop_cache_; // direct_io fallback: fadvise after writeback
+  const size_t align_;
+  uint64_t base_;       // file offset of buffer_[0] (direct_)
+  size_t synced_;       // buffer_[0, synced_) is in the file (direct_)
+  uint64_t dropped_ = 0; // cache dropped below this offset (drop_cache_)
+  bool padded_ = false;  // the file ends in zero padding (direct_)
+
+  // ── Rotation ─────────────────────────
+
+  bool rotating_;
+  int next_fd_ = -1;    // prepared by the worker
+  int retired_fd_ = -1; // handed to the worker for close + rename
+  bool prepare_failed_ = false;
+  bool prepared_ = false; // prepare_record() decided for the next write
+  SystemClock::time_point boundary_{};
+
+  // Last archive name, owned by the worker (or close() after it stopped).
+  std::string last_stamp_;
+  int last_seq_ = 0;
+};
+
+// Read the partial last block of an O_DIRECT file into the buffer so that
+// appends can rewrite it whole.
+[[nodiscard]] bool load_direct_tail(int fd, char *buffer, size_t &tail) {
+  const size_t align = platform::direct_io_alignment();
+  const uint64_t size = platform::file_size(fd);
+  tail = static_cast<size_t>(size % align);
+  if (tail == 0)
+    return true;
+  return platform::read_file_at(fd, buffer, align, size - tail) ==
+         static_cast<long long>(tail);
+}
+
+} // namespace
+
+std::unique_ptr<SinkBackend> make_file_sink(std::string_view path,
+                                            const FileSinkOptions &options) {
+  if (options.compress) {
+    // The file receives whole frames and writes each one right away.
+    FileSinkOptions file_options = options;
+    file_options.compress = false;
+    file_options.io_uring = false;
+    file_options.buffer_size = 0;
+    file_options.flush_bytes = 1;
+    file_options.flush_interval = std::chrono::milliseconds(0);
+    file_options.flush_on_error = false;
+    return make_compress_sink(make_file_sink(path, file_options), options);
+  }
+
+#if CORETRACE_LOGGER_HAS_IO_URING
+  // The io_uring engine neither rotates nor bypasses the page cache.
+  if (options.io_uring && !options.direct_io && options.rotate_bytes == 0 &&
+      options.rotate_every == RotateInterval::Never) {
+    if (std::unique_ptr<SinkBackend> sink = make_uring_file_sink(path, options))
+      return sink;
+  }
+#endif
+
+  std::string path_z(path);
+  if (options.rotate_bytes != 0 ||
+      options.rotate_every != RotateInterval::Never)
+    finish_rollover(path_z);
+
+  const size_t page = platform::page_size();
+  const size_t capacity =
+      round_up(options.buffer_size == 0 ? page : options.buffer_size, page);
+
+  auto *buffer =
+      static_cast<char *>(platform::allocate_aligned(page, capacity));
+  if (!buffer)
+    return nullptr;
+
+  int fd = -1;
+  size_t tail = 0;
+  if (options.direct_io) {
+    fd = platform::open_direct_file(path_z.c_str(), options.truncate);
+    if (fd >= 0 && !load_direct_tail(fd, buffer, tail)) {
+      platform::close_file(fd);
+      fd = -1;
+    }
+  }
+  const bool direct = fd >= 0;
+  if (!direct)
+    fd = platform::open_log_file(path_z.c_str(), options.truncate);
+  if (fd < 0) {
+    platform::free_aligned(buffer);
+    return nullptr;
+  }
+
+  return std::make_unique<FileSink>(fd, std::move(path_z), options, buffer,
+                                    capacity, direct, tail);
+}
+
+} // namespace coretrace::detail
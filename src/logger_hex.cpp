@@ -0,0 +1,101 @@
+#include "logger_hex.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CORETRACE_HEX_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace coretrace::detail::hex {
+
+namespace {
+
+constexpr char DIGITS[] = "0123456789abcdef";
+
+#if defined(CORETRACE_HEX_SSE2)
+
+// ASCII digit of each nibble in block: '0' + n, plus 'a' - '0' - 10 for
+// the nibbles above 9.
+[[nodiscard]] __m128i nibble_digits(__m128i nibbles) {
+  const __m128i above9 = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+  return _mm_add_epi8(
+      _mm_add_epi8(nibbles, _mm_set1_epi8('0')),
+      _mm_and_si128(above9, _mm_set1_epi8('a' - '0' - 10)));
+}
+
+#endif
+
+} // namespace
+
+void encode(const unsigned char *data, size_t size, char *out) noexcept {
+  size_t i = 0;
+#if defined(CORETRACE_HEX_SSE2)
+  const __m128i low_nibble = _mm_set1_epi8(0x0f);
+  for (; i + 16 <= size; i += 16) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    // No 8-bit shift in SSE2: shift 16-bit lanes and mask the spill.
+    const __m128i high =
+        nibble_digits(_mm_and_si128(_mm_srli_epi16(block, 4), low_nibble));
+    const __m128i low = nibble_digits(_mm_and_si128(block, low_nibble));
+    // Interleave to high, low digit per byte.
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i),
+                     _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i + 16),
+                     _mm_unpackhi_epi8(high, low));
+  }
+#endif
+  encode_scalar(data + i, size - i, out + 2 * i);
+}
+
+void encode_scalar(const unsigned char *data, size_t size,
+                   char *out) noexcept {
+  for (size_t i = 0; i < size; ++i) {
+    out[2 * i] = DIGITS[data[i] >> 4];
+    out[2 * i + 1] = DIGITS[data[i] & 0xf];
+  }
+}
+
+int offset_digits(size_t size) noexcept {
+  int digits = 8;
+  for (uint64_t last = size > 0 ? (size - 1) >> 32 : 0; last != 0;
+       last >>= 4)
+    ++digits;
+  return digits;
+}
+
+size_t render_row(const unsigned char *row, size_t count, uint64_t offset,
+                  int digits, char *out) noexcept {
+  size_t len = 0;
+  for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4)
+    out[len++] = DIGITS[(offset >> shift) & 0xf];
+  out[len++] = ' ';
+  out[len++] = ' ';
+
+  // Hex columns, blank-padded to full width for a short last row.
+  char pairs[2 * ROW_BYTES];
+  encode(row, count, pairs);
+  for (size_t i = 0; i < ROW_BYTES; ++i) {
+    if (i < count) {
+      out[len] = pairs[2 * i];
+      out[len + 1] = pairs[2 * i + 1];
+    } else {
+      out[len] = ' ';
+      out[len + 1] = ' ';
+    }
+    out[len + 2] = ' ';
+    len += 3;
+    if (i == ROW_BYTES / 2 - 1)
+      out[len++] = ' ';
+  }
+
+  out[len++] = ' ';
+  out[len++] = '|';
+  for (size_t i = 0; i < count; ++i)
+    out[len++] = row[i] >= 0x20 && row[i] < 0x7f ? static_cast<char>(row[i])
+                                                 : '.';
+  out[len++] = '|';
+  out[len++] = '\n';
+  return len;
+}
+
+} // namespace coretrace::detail::hex
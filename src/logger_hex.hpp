@@ -0,0 +1,43 @@
+#ifndef CORETRACE_LOGGER_HEX_HPP
+#define CORETRACE_LOGGER_HEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Canonical hex dump rows for coretrace::log_hexdump().
+//
+// A row shows up to ROW_BYTES bytes as offset, hex and printable ASCII,
+// in the layout of `hexdump -C`:
+//
+//   00000000  48 69 21 0a                                       |Hi!.|
+//
+// Bytes are turned into hex digits 16 at a time (SSE2 on x86-64) before
+// they are spaced out into the row.
+namespace coretrace::detail::hex {
+
+inline constexpr size_t ROW_BYTES = 16;
+
+// Longest row: a 16-digit offset, the hex columns, the ASCII column and
+// the newline.
+inline constexpr size_t ROW_CAPACITY = 16 + 2 + ROW_BYTES * 3 + 1 + 2 +
+                                       ROW_BYTES + 2;
+
+// Write two lowercase hex digits per byte of data to out (2 * size bytes).
+void encode(const unsigned char *data, size_t size, char *out) noexcept;
+
+// Byte-at-a-time reference of encode().
+void encode_scalar(const unsigned char *data, size_t size,
+                   char *out) noexcept;
+
+// Offset digits used by a dump of size bytes: 8, or more when the last
+// offset needs them.
+[[nodiscard]] int offset_digits(size_t size) noexcept;
+
+// Render one row of count (1..ROW_BYTES) bytes at the given offset into
+// out (ROW_CAPACITY bytes). Returns its length, newline included.
+size_t render_row(const unsigned char *row, size_t count, uint64_t offset,
+                  int digits, char *out) noexcept;
+
+} // namespace coretrace::detail::hex
+
+#endif // CORETRACE_LOGGER_HEX_HPP
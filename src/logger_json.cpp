@@ -0,0 +1,141 @@
+#include "logger_json.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CORETRACE_JSON_SSE2 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// AVX2 is compiled per function and picked at run time, so the library
+// still runs on CPUs without it.
+#if defined(CORETRACE_JSON_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define CORETRACE_JSON_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace coretrace::detail::json {
+
+namespace {
+
+[[nodiscard]] bool needs_escape(unsigned char byte) {
+  return byte < 0x20 || byte == '"' || byte == '\\';
+}
+
+#if defined(CORETRACE_JSON_SSE2)
+
+[[nodiscard]] unsigned first_bit(unsigned mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// Mask of the bytes in block that need escaping. Control bytes are those
+// for which min(byte, 0x1f) == byte (unsigned).
+[[nodiscard]] unsigned escape_mask_sse2(__m128i block) {
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i control = _mm_set1_epi8(0x1f);
+  const __m128i hits = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(block, quote),
+                   _mm_cmpeq_epi8(block, backslash)),
+      _mm_cmpeq_epi8(_mm_min_epu8(block, control), block));
+  return static_cast<unsigned>(_mm_movemask_epi8(hits));
+}
+
+size_t plain_run_sse2(const char *data, size_t size) noexcept {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    if (const unsigned mask = escape_mask_sse2(block))
+      return i + first_bit(mask);
+  }
+  return i + plain_run_scalar(data + i, size - i);
+}
+
+#endif
+
+#if defined(CORETRACE_JSON_AVX2)
+
+__attribute__((target("avx2"))) size_t plain_run_avx2(const char *data,
+                                                      size_t size) noexcept {
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i control = _mm256_set1_epi8(0x1f);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    const __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    const __m256i hits = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, quote),
+                        _mm256_cmpeq_epi8(block, backslash)),
+        _mm256_cmpeq_epi8(_mm256_min_epu8(block, control), block));
+    if (const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hits)))
+      return i + first_bit(mask);
+  }
+  // The tail stays in this function: calling out to SSE code with the
+  // upper halves of the ymm registers dirty costs a state transition.
+  if (i + 16 <= size) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    if (const unsigned mask = escape_mask_sse2(block))
+      return i + first_bit(mask);
+    i += 16;
+  }
+  for (; i < size; ++i) {
+    if (needs_escape(static_cast<unsigned char>(data[i])))
+      break;
+  }
+  return i;
+}
+
+#endif
+
+struct Engine {
+  ScanFn scan;
+  const char *name;
+};
+
+[[nodiscard]] Engine select_engine() {
+#if defined(CORETRACE_JSON_AVX2)
+  if (__builtin_cpu_supports("avx2"))
+    return {plain_run_avx2, "avx2"};
+#endif
+#if defined(CORETRACE_JSON_SSE2)
+  return {plain_run_sse2, "sse2"};
+#else
+  return {plain_run_scalar, "scalar"};
+#endif
+}
+
+const Engine &engine() {
+  static const Engine selected = select_engine();
+  return selected;
+}
+
+} // namespace
+
+size_t plain_run(const char *data, size_t size) noexcept {
+  // Short strings (levels, file names, most keys) skip the dispatch.
+  if (size < 16)
+    return plain_run_scalar(data, size);
+  return engine().scan(data, size);
+}
+
+size_t plain_run_scalar(const char *data, size_t size) noexcept {
+  for (size_t i = 0; i < size; ++i) {
+    if (needs_escape(static_cast<unsigned char>(data[i])))
+      return i;
+  }
+  return size;
+}
+
+const char *plain_run_engine() noexcept { return engine().name; }
+
+} // namespace coretrace::detail::json
@@ -0,0 +1,88 @@
+#ifndef CORETRACE_LOGGER_JSON_HPP
+#define CORETRACE_LOGGER_JSON_HPP
+
+#include <cstddef>
+#include <string_view>
+
+// JSON string escaping for Layout::Json.
+//
+// Bytes a JSON string cannot carry as they are: '"', '\' and the control
+// bytes below 0x20. Everything else, UTF-8 included, is copied through.
+// Escaping is a loop of "find the next such byte, copy the run before it,
+// escape it"; the search is the hot part and is vectorized on x86-64
+// (SSE2, or AVX2 when the CPU has it).
+namespace coretrace::detail::json {
+
+// Length of the leading run of data that needs no escaping (size when
+// none does). Scans 32 (AVX2) or 16 (SSE2) bytes per step where
+// available.
+[[nodiscard]] size_t plain_run(const char *data, size_t size) noexcept;
+
+// Byte-at-a-time reference of plain_run().
+[[nodiscard]] size_t plain_run_scalar(const char *data, size_t size) noexcept;
+
+// Name of the plain_run() implementation in use: "avx2", "sse2" or
+// "scalar".
+[[nodiscard]] const char *plain_run_engine() noexcept;
+
+using ScanFn = size_t (*)(const char *, size_t) noexcept;
+
+// Escape sequence of one byte that plain_run() stopped at: \" \\ \b \f
+// \n \r \t, or \u00XX. Returns its length (2 or 6).
+inline size_t escape_byte(unsigned char byte, char *out) {
+  static constexpr char HEX[] = "0123456789abcdef";
+  out[0] = '\\';
+  switch (byte) {
+  case '"':
+  case '\\':
+    out[1] = static_cast<char>(byte);
+    return 2;
+  case '\b':
+    out[1] = 'b';
+    return 2;
+  case '\f':
+    out[1] = 'f';
+    return 2;
+  case '\n':
+    out[1] = 'n';
+    return 2;
+  case '\r':
+    out[1] = 'r';
+    return 2;
+  case '\t':
+    out[1] = 't';
+    return 2;
+  default:
+    out[1] = 'u';
+    out[2] = '0';
+    out[3] = '0';
+    out[4] = HEX[byte >> 4];
+    out[5] = HEX[byte & 0xF];
+    return 6;
+  }
+}
+
+// Append the escaped contents of value (without the quotes) to out, any
+// type with append(const char *, size_t).
+template <typename Out>
+void append_escaped(Out &out, std::string_view value, ScanFn scan = plain_run) {
+  const char *data = value.data();
+  size_t size = value.size();
+  while (size > 0) {
+    const size_t run = scan(data, size);
+    if (run > 0)
+      out.append(data, run);
+    if (run == size)
+      return;
+
+    char escape[6];
+    out.append(escape, escape_byte(static_cast<unsigned char>(data[run]),
+                                   escape));
+    data += run + 1;
+    size -= run + 1;
+  }
+}
+
+} // namespace coretrace::detail::json
+
+#endif // CORETRACE_LOGGER_JSON_HPP
@@ -0,0 +1,218 @@
+#include "logger_lz.hpp"
+
+#include <cstring>
+
+namespace coretrace::detail::lz {
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t LAST_LITERALS = 5; // a match never ends closer to the end
+constexpr size_t MATCH_SEARCH_END = 12;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr int HASH_BITS = 14;
+
+[[nodiscard]] uint32_t read32(const unsigned char *p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+[[nodiscard]] uint32_t hash4(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void write_u32(char *dst, uint32_t value) {
+  for (int i = 0; i < 4; ++i)
+    dst[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+[[nodiscard]] uint32_t read_u32(const char *src) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i)
+    value |= static_cast<uint32_t>(static_cast<unsigned char>(src[i]))
+             << (8 * i);
+  return value;
+}
+
+// Remainder of a length whose nibble was saturated at 15.
+unsigned char *put_length(unsigned char *op, size_t extra) {
+  while (extra >= 255) {
+    *op++ = 255;
+    extra -= 255;
+  }
+  *op++ = static_cast<unsigned char>(extra);
+  return op;
+}
+
+unsigned char *put_sequence(unsigned char *op, const unsigned char *literals,
+                            size_t literal_len, size_t offset,
+                            size_t match_len) {
+  unsigned char *token = op++;
+  *token = 0;
+
+  if (literal_len >= 15) {
+    *token = 15 << 4;
+    op = put_length(op, literal_len - 15);
+  } else {
+    *token = static_cast<unsigned char>(literal_len << 4);
+  }
+  std::memcpy(op, literals, literal_len);
+  op += literal_len;
+
+  if (match_len == 0)
+    return op; // last sequence
+
+  *op++ = static_cast<unsigned char>(offset & 0xff);
+  *op++ = static_cast<unsigned char>(offset >> 8);
+
+  const size_t code = match_len - MIN_MATCH;
+  if (code >= 15) {
+    *token |= 15;
+    op = put_length(op, code - 15);
+  } else {
+    *token |= static_cast<unsigned char>(code);
+  }
+  return op;
+}
+
+[[nodiscard]] bool get_length(const unsigned char *&ip,
+                              const unsigned char *end, size_t &length) {
+  unsigned char byte;
+  do {
+    if (ip == end)
+      return false;
+    byte = *ip++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+} // namespace
+
+size_t compress(const char *src, size_t size, char *dst) {
+  const auto *in = reinterpret_cast<const unsigned char *>(src);
+  auto *op = reinterpret_cast<unsigned char *>(dst);
+
+  size_t anchor = 0;
+  if (size > MATCH_SEARCH_END) {
+    uint32_t table[1u << HASH_BITS] = {};
+    const size_t search_end = size - MATCH_SEARCH_END;
+    const size_t match_end = size - LAST_LITERALS;
+
+    size_t ip = 0;
+    while (ip < search_end) {
+      const uint32_t sequence = read32(in + ip);
+      const uint32_t h = hash4(sequence);
+      size_t ref = table[h];
+      table[h] = static_cast<uint32_t>(ip);
+
+      if (ref >= ip || ip - ref > MAX_OFFSET || read32(in + ref) != sequence) {
+        ++ip;
+        continue;
+      }
+
+      size_t len = MIN_MATCH;
+      while (ip + len < match_end && in[ref + len] == in[ip + len])
+        ++len;
+      while (ip > anchor && ref > 0 && in[ip - 1] == in[ref - 1]) {
+        --ip;
+        --ref;
+        ++len;
+      }
+
+      op = put_sequence(op, in + anchor, ip - anchor, ip - ref, len);
+      ip += len;
+      anchor = ip;
+    }
+  }
+
+  op = put_sequence(op, in + anchor, size - anchor, 0, 0);
+  return static_cast<size_t>(op - reinterpret_cast<unsigned char *>(dst));
+}
+
+bool decompress(const char *src, size_t size, char *dst, size_t raw_size) {
+  const auto *ip = reinterpret_cast<const unsigned char *>(src);
+  const unsigned char *const end = ip + size;
+  auto *op = reinterpret_cast<unsigned char *>(dst);
+  auto *const out = op;
+  unsigned char *const out_end = op + raw_size;
+
+  while (ip < end) {
+    const unsigned char token = *ip++;
+
+    size_t literal_len = token >> 4;
+    if (literal_len == 15 && !get_length(ip, end, literal_len))
+      return false;
+    if (literal_len > static_cast<size_t>(end - ip) ||
+        literal_len > static_cast<size_t>(out_end - op))
+      return false;
+    std::memcpy(op, ip, literal_len);
+    ip += literal_len;
+    op += literal_len;
+
+    if (ip == end)
+      break; // last sequence
+
+    if (end - ip < 2)
+      return false;
+    const size_t offset = static_cast<size_t>(ip[0]) |
+                          (static_cast<size_t>(ip[1]) << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<size_t>(op - out))
+      return false;
+
+    size_t match_len = token & 15;
+    if (match_len == 15 && !get_length(ip, end, match_len))
+      return false;
+    match_len += MIN_MATCH;
+    if (match_len > static_cast<size_t>(out_end - op))
+      return false;
+
+    const unsigned char *match = op - offset;
+    if (offset >= match_len) {
+      std::memcpy(op, match, match_len);
+      op += match_len;
+    } else {
+      for (size_t i = 0; i < match_len; ++i)
+        *op++ = *match++; // overlapping copy repeats the pattern
+    }
+  }
+
+  return op == out_end;
+}
+
+uint32_t checksum(const char *data, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+size_t encode_frame(const char *raw, size_t size, char *dst) {
+  char *payload = dst + FRAME_HEADER_SIZE;
+  size_t payload_size = compress(raw, size, payload);
+  if (payload_size >= size) {
+    std::memcpy(payload, raw, size); // incompressible: store
+    payload_size = size;
+  }
+
+  std::memcpy(dst, FRAME_MAGIC, sizeof(FRAME_MAGIC));
+  write_u32(dst + 4, static_cast<uint32_t>(size));
+  write_u32(dst + 8, static_cast<uint32_t>(payload_size));
+  write_u32(dst + 12, checksum(raw, size));
+  return FRAME_HEADER_SIZE + payload_size;
+}
+
+bool read_frame_header(const char *src, FrameHeader &out) {
+  if (std::memcmp(src, FRAME_MAGIC, sizeof(FRAME_MAGIC)) != 0)
+    return false;
+  out.raw_size = read_u32(src + 4);
+  out.payload_size = read_u32(src + 8);
+  out.checksum = read_u32(src + 12);
+  return true;
+}
+
+} // namespace coretrace::detail::lz
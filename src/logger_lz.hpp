@@ -0,0 +1,60 @@
+#ifndef CORETRACE_LOGGER_LZ_HPP
+#define CORETRACE_LOGGER_LZ_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Built-in LZ77 block codec and the frame format of compressed log files.
+//
+// Block: a sequence of (literals, match) pairs in the LZ4 style. A token
+// byte holds the literal length (high nibble) and the match length minus 4
+// (low nibble); 15 means "continued in the following bytes" (runs of 255
+// plus a final byte below 255). Literals follow, then a 2-byte
+// little-endian match offset (1..65535). The last sequence has literals
+// only and ends the block.
+//
+// Frame: a 16-byte header followed by the payload. Every frame decodes on
+// its own, so a reader can start at any frame and skip a damaged one.
+//
+//   "CTz1" | raw size (u32 LE) | payload size (u32 LE) | FNV-1a of raw (u32 LE)
+//
+// A payload as large as the raw size is stored uncompressed.
+namespace coretrace::detail::lz {
+
+constexpr size_t FRAME_HEADER_SIZE = 16;
+constexpr char FRAME_MAGIC[4] = {'C', 'T', 'z', '1'};
+constexpr size_t MAX_BLOCK_SIZE = 64u << 20; // larger frames are damage
+
+struct FrameHeader {
+  uint32_t raw_size = 0;
+  uint32_t payload_size = 0;
+  uint32_t checksum = 0;
+};
+
+// Worst-case compressed size of n input bytes.
+[[nodiscard]] constexpr size_t compress_bound(size_t n) {
+  return n + n / 255 + 16;
+}
+
+// Compress src into dst (capacity >= compress_bound(size)). Returns the
+// compressed size.
+size_t compress(const char *src, size_t size, char *dst);
+
+// Decode a whole block into exactly raw_size bytes. Returns false on
+// malformed input; never reads or writes out of bounds.
+[[nodiscard]] bool decompress(const char *src, size_t size, char *dst,
+                              size_t raw_size);
+
+[[nodiscard]] uint32_t checksum(const char *data, size_t size);
+
+// Build a frame for raw data: header plus compressed (or stored) payload
+// into dst, which needs FRAME_HEADER_SIZE + compress_bound(size) bytes.
+// Returns the frame size.
+size_t encode_frame(const char *raw, size_t size, char *dst);
+
+// Parse a frame header. Returns false if the magic does not match.
+[[nodiscard]] bool read_frame_header(const char *src, FrameHeader &out);
+
+} // namespace coretrace::detail::lz
+
+#endif // CORETRACE_LOGGER_LZ_HPP
@@ -0,0 +1,368 @@
+#include "logger_platform.hpp"
+#include "logger_sink.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace coretrace::detail {
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+[[nodiscard]] size_t round_up(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// One mapped window [start, start + size) of the file.
+struct Segment {
+  char *base = nullptr;
+  uint64_t start = 0;
+};
+
+// Grow the file to cover the segment at start (never shrink it) and map it.
+// Blocks are reserved first where supported, so that running out of disk
+// space fails here instead of faulting on a later memcpy().
+[[nodiscard]] Segment map_segment(int fd, uint64_t start, size_t size) {
+  const uint64_t end = start + size;
+  if (platform::file_size(fd) < end) {
+    platform::preallocate_file(fd, start, size);
+    if (!platform::resize_file(fd, end))
+      return {};
+  }
+
+  void *addr = platform::map_file(fd, start, size);
+  if (!addr)
+    return {};
+  return {static_cast<char *>(addr), start};
+}
+
+// Copies lines straight into a shared mapping of the file: no system call
+// per line, and the bytes sit in the page cache as soon as the copy ends.
+//
+// The background thread maps the next segment ahead of time, unmaps the
+// ones that were left (after starting their writeback) and, every
+// flush_interval, starts writeback of the written pages of the current
+// segment and drops them from the process. close() truncates the file to
+// the bytes actually written.
+//
+// The logical length is also kept in a shared mapping of "<path>.pos",
+// stored after every write, so that a crashed file is resumed at its real
+// end even when the last record ends in NUL bytes (Layout::Cbor).
+class MmapSink final : public SinkBackend {
+public:
+  MmapSink(int fd, const MmapSinkOptions &options, size_t segment_size,
+           Segment current, size_t pos, int length_fd, char *length)
+      : fd_(fd), options_(options), segment_size_(segment_size),
+        page_(platform::page_size()), current_(current), pos_(pos),
+        released_(pos / page_ * page_), length_fd_(length_fd),
+        length_(length) {
+    store_length_locked();
+    worker_ = std::thread([this]() { worker_loop(); });
+  }
+
+  ~MmapSink() override { close(); }
+
+  MmapSink(const MmapSink &) = delete;
+  MmapSink &operator=(const MmapSink &) = delete;
+
+  void write(const char *data, size_t size, Level) override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (!current_.base) {
+      stats_.dropped_bytes += size;
+      return;
+    }
+
+    while (size > 0) {
+      if (pos_ == segment_size_ && !advance_locked()) {
+        stats_.dropped_bytes += size; // cannot grow the file
+        return;
+      }
+      const size_t room = segment_size_ - pos_;
+      const size_t chunk = size < room ? size : room;
+      std::memcpy(current_.base + pos_, data, chunk);
+      pos_ += chunk;
+      data += chunk;
+      size -= chunk;
+      stats_.bytes_written += chunk;
+    }
+    store_length_locked();
+  }
+
+  void flush() override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (current_.base && pos_ != 0) {
+      ++stats_.syscalls;
+      platform::flush_mapping(current_.base, pos_, false);
+    }
+  }
+
+  SinkStats stats() const override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return stats_;
+  }
+
+  void close() override {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable())
+      worker_.join();
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (const Segment &segment : retired_)
+      unmap(segment);
+    retired_.clear();
+    if (next_.base) {
+      unmap(next_);
+      next_ = {};
+    }
+
+    if (!current_.base)
+      return;
+
+    const uint64_t end = current_.start + pos_;
+    unmap(current_);
+    current_ = {};
+
+    // Drop the unused tail of the last segment (and a segment mapped
+    // ahead).
+    (void)platform::resize_file(fd_, end);
+    platform::close_file(fd_);
+    fd_ = -1;
+
+    if (length_) {
+      platform::unmap_file(length_, sizeof(uint64_t));
+      platform::close_file(length_fd_);
+      length_ = nullptr;
+      length_fd_ = -1;
+    }
+  }
+
+private:
+  void store_length_locked() {
+    if (!length_)
+      return;
+    const uint64_t end = current_.start + pos_;
+    std::memcpy(length_, &end, sizeof(end));
+  }
+
+  // Switch to the segment after the current one: normally the one the
+  // worker mapped ahead, otherwise map it here.
+  bool advance_locked() {
+    const uint64_t next_start = current_.start + segment_size_;
+
+    Segment next = next_;
+    next_ = {};
+    if (!next.base || next.start != next_start) {
+      if (next.base)
+        retired_.push_back(next);
+      ++stats_.syscalls;
+      next = map_segment(fd_, next_start, segment_size_);
+      if (!next.base)
+        return false;
+    }
+
+    retired_.push_back(current_);
+    current_ = next;
+    pos_ = 0;
+    released_ = 0;
+    prepare_failed_ = false; // let the worker try again for the next one
+    wake_.notify_one();
+    return true;
+  }
+
+  void unmap(const Segment &segment) const {
+    platform::flush_mapping(segment.base, segment_size_, false);
+    platform::unmap_file(segment.base, segment_size_);
+  }
+
+  // ── Background thread ────────────────
+
+  void worker_loop() {
+    const bool timed = options_.flush_interval.count() > 0;
+    auto next_release = SteadyClock::now() + options_.flush_interval;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+      std::vector<Segment> retired;
+      retired.swap(retired_);
+      const bool prepare = !next_.base && !prepare_failed_;
+      const uint64_t next_start = current_.start + segment_size_;
+
+      // Whole pages below the write position are never touched again.
+      char *release_base = nullptr;
+      size_t release_len = 0;
+      if (timed && SteadyClock::now() >= next_release) {
+        const size_t written = pos_ / page_ * page_;
+        if (written > released_) {
+          release_base = current_.base + released_;
+          release_len = written - released_;
+          released_ = written;
+        }
+        next_release = SteadyClock::now() + options_.flush_interval;
+      }
+
+      if (retired.empty() && !prepare && !release_base) {
+        if (timed)
+          wake_.wait_until(lock, next_release);
+        else
+          wake_.wait(lock);
+        continue;
+      }
+
+      lock.unlock();
+
+      for (const Segment &segment : retired)
+        unmap(segment);
+
+      if (release_base) {
+        platform::flush_mapping(release_base, release_len, false);
+        platform::discard_mapping(release_base, release_len);
+      }
+
+      Segment prepared;
+      if (prepare)
+        prepared = map_segment(fd_, next_start, segment_size_);
+
+      lock.lock();
+      stats_.syscalls += retired.size() + (release_base ? 1 : 0) +
+                         (prepare ? 1 : 0);
+      if (!prepare)
+        continue;
+      if (!prepared.base) {
+        prepare_failed_ = true;
+      } else if (next_.base || current_.start + segment_size_ != next_start) {
+        retired_.push_back(prepared); // a producer advanced meanwhile
+      } else {
+        next_ = prepared;
+      }
+    }
+  }
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::thread worker_;
+  bool stopping_ = false;
+
+  int fd_;
+  MmapSinkOptions options_;
+  const size_t segment_size_;
+  const size_t page_;
+
+  Segment current_;
+  size_t pos_;       // write position in current_
+  size_t released_;  // pages of current_ below this were released
+  Segment next_;     // mapped ahead by the worker
+  bool prepare_failed_ = false;
+  std::vector<Segment> retired_; // left behind, unmapped by the worker
+  SinkStats stats_;
+
+  int length_fd_; // "<path>.pos", -1 if it could not be opened
+  char *length_;  // its mapping: the logical length, native byte order
+};
+
+// The length stored in "<path>.pos" (see MmapSink), mapped into length.
+// Returns the fd, or -1 if the file cannot be used; recorded is left
+// alone when it holds no length yet.
+[[nodiscard]] int open_length_file(const std::string &path, bool truncate,
+                                   char *&length, uint64_t &recorded) {
+  const int fd = platform::open_map_file(path.c_str(), truncate);
+  if (fd < 0)
+    return -1;
+  const bool fresh = platform::file_size(fd) < sizeof(uint64_t);
+  if (fresh && !platform::resize_file(fd, sizeof(uint64_t))) {
+    platform::close_file(fd);
+    return -1;
+  }
+  length = static_cast<char *>(platform::map_file(fd, 0, sizeof(uint64_t)));
+  if (!length) {
+    platform::close_file(fd);
+    return -1;
+  }
+  if (!fresh)
+    std::memcpy(&recorded, length, sizeof(recorded));
+  return fd;
+}
+
+// Offset just past the last non-NUL byte of the file's first size bytes,
+// or UINT64_MAX if a segment cannot be mapped.
+[[nodiscard]] uint64_t text_end(int fd, uint64_t size, size_t segment_size) {
+  uint64_t start = size == 0 ? 0 : (size - 1) / segment_size * segment_size;
+  size_t pos = static_cast<size_t>(size - start);
+  while (pos > 0 || start > 0) {
+    if (pos == 0) {
+      start -= segment_size;
+      pos = segment_size;
+    }
+    const Segment segment = map_segment(fd, start, segment_size);
+    if (!segment.base)
+      return UINT64_MAX;
+    while (pos > 0 && segment.base[pos - 1] == '\0')
+      --pos;
+    platform::unmap_file(segment.base, segment_size);
+    if (pos != 0)
+      break;
+  }
+  return start + pos;
+}
+
+} // namespace
+
+std::unique_ptr<SinkBackend> make_mmap_sink(std::string_view path,
+                                            const MmapSinkOptions &options) {
+  const std::string path_z(path);
+
+  const size_t granularity = platform::map_granularity();
+  const size_t segment_size = round_up(
+      options.segment_size == 0 ? granularity : options.segment_size,
+      granularity);
+
+  const int fd = platform::open_map_file(path_z.c_str(), options.truncate);
+  if (fd < 0)
+    return nullptr;
+
+  // Resume after the last byte written. A crash leaves the file at its
+  // mapped length with a zero-filled tail (possibly a whole segment mapped
+  // ahead). Everything after the last non-NUL byte is that tail, except
+  // for NULs a record ended with: the recorded length keeps those. A
+  // recorded length short of the last non-NUL byte belongs to another
+  // file and is ignored, so nothing written is ever overwritten.
+  char *length = nullptr;
+  uint64_t recorded = 0;
+  const int length_fd = open_length_file(path_z + ".pos", options.truncate,
+                                         length, recorded);
+  const uint64_t size = platform::file_size(fd);
+  uint64_t end = text_end(fd, size, segment_size);
+  if (end != UINT64_MAX && recorded > end && recorded <= size)
+    end = recorded;
+
+  const uint64_t start =
+      end == 0 || end == UINT64_MAX ? 0
+                                    : (end - 1) / segment_size * segment_size;
+  const Segment current = end == UINT64_MAX
+                              ? Segment{}
+                              : map_segment(fd, start, segment_size);
+  if (!current.base) {
+    if (length) {
+      platform::unmap_file(length, sizeof(uint64_t));
+      platform::close_file(length_fd);
+    }
+    platform::close_file(fd);
+    return nullptr;
+  }
+
+  return std::make_unique<MmapSink>(fd, options, segment_size, current,
+                                    static_cast<size_t>(end - start),
+                                    length_fd, length);
+}
+
+} // namespace coretrace::detail
@@ -0,0 +1,481 @@
+#include "logger_platform.hpp"
+#include "logger_sink.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace coretrace::detail {
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+// Frame: 4-byte big-endian payload length, then the payload.
+constexpr size_t FRAME_HEADER = 4;
+
+constexpr int CONNECT_TIMEOUT_MS = 1000;
+// Short, so that a stalled collector does not hide close() from the I/O
+// thread for long.
+constexpr int SEND_TIMEOUT_MS = 100;
+// Datagrams per send_datagrams() call in UDP mode.
+constexpr size_t UDP_BATCH = 64;
+
+// Forwards records to a collector. Producers append framed records to a
+// bounded ring and never touch the socket; the I/O thread owns the
+// connection and sends from the ring in place.
+//
+// A rendered record is one frame, whatever its bytes (the logger brackets
+// it with begin_record() and end_record()). Raw writes outside a record
+// are framed at line ends.
+//
+// Ring offsets only grow (index = offset % capacity):
+//   [head_, sealed_)  complete frames, not (fully) sent
+//   [sealed_, tail_)  the open frame: header placeholder and the part of
+//                     a record whose line has not ended yet
+// A TCP frame leaves the ring only once all of it was sent (partial_
+// counts what went out of the first one), so after a lost connection the
+// next one starts with that frame again, whole.
+class NetSink final : public SinkBackend {
+public:
+  NetSink(std::string host, uint16_t port, const NetSinkOptions &options,
+          size_t capacity)
+      : host_(std::move(host)), port_(port), options_(options),
+        capacity_(capacity),
+        batch_bytes_(std::max<size_t>(options.batch_bytes, 1)),
+        ring_(std::make_unique<char[]>(capacity)),
+        backoff_(options.reconnect_delay) {
+    frames_records = true;
+    worker_ = std::thread([this]() { worker_loop(); });
+  }
+
+  ~NetSink() override { close(); }
+
+  NetSink(const NetSink &) = delete;
+  NetSink &operator=(const NetSink &) = delete;
+
+  void write(const char *data, size_t size, Level level) override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (closed_) {
+      drop_locked(data, size);
+      return;
+    }
+    if (in_record_) {
+      write_record_part_locked(data, size, level);
+      return;
+    }
+
+    if (tail_ == sealed_) {
+      if (unreported_bytes_ != 0)
+        report_locked();
+      if (FRAME_HEADER + size > room_locked()) {
+        drop_locked(data, size);
+        return;
+      }
+      open_frame_locked();
+    } else if (size > room_locked()) {
+      // The rest of an open line does not fit: send what is there.
+      drop_locked(data, size);
+      seal_locked();
+      return;
+    }
+
+    put_locked(tail_, data, size);
+    tail_ += size;
+    if (size > 0 && data[size - 1] == '\n')
+      seal_locked();
+    nudge_locked(level);
+  }
+
+  void begin_record() override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    // A raw line left open ends here.
+    if (tail_ != sealed_)
+      seal_locked();
+    in_record_ = true;
+    record_dropped_ = false;
+    record_level_ = Level::Info;
+  }
+
+  void end_record() override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    in_record_ = false;
+    if (tail_ == sealed_)
+      return;
+    seal_locked();
+    nudge_locked(record_level_);
+  }
+
+  // Waits (at most drain_timeout) until every record so far was sent.
+  void flush() override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (closed_)
+      return;
+    if (tail_ != sealed_)
+      seal_locked();
+    const uint64_t target = sealed_;
+    urgent_ = true;
+    wake_.notify_one();
+    idle_.wait_for(lock, options_.drain_timeout,
+                   [&]() { return head_ >= target || closed_; });
+  }
+
+  void close() override {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (closed_)
+        return;
+      if (tail_ != sealed_)
+        seal_locked();
+      closed_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable())
+      worker_.join();
+  }
+
+  SinkStats stats() const override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return stats_;
+  }
+
+private:
+  // ── Ring ─────────────────────────────
+
+  [[nodiscard]] size_t room_locked() const {
+    return capacity_ - static_cast<size_t>(tail_ - head_);
+  }
+
+  void put_locked(uint64_t at, const char *data, size_t size) {
+    const auto index = static_cast<size_t>(at % capacity_);
+    const size_t first = std::min(size, capacity_ - index);
+    std::memcpy(ring_.get() + index, data, first);
+    std::memcpy(ring_.get(), data + first, size - first);
+  }
+
+  void get(uint64_t at, char *out, size_t size) const {
+    const auto index = static_cast<size_t>(at % capacity_);
+    const size_t first = std::min(size, capacity_ - index);
+    std::memcpy(out, ring_.get() + index, first);
+    std::memcpy(out + first, ring_.get(), size - first);
+  }
+
+  // Ring range [at, at + size) as one or two contiguous parts.
+  size_t parts_of(uint64_t at, size_t size, platform::Datagram *parts) const {
+    const auto index = static_cast<size_t>(at % capacity_);
+    const size_t first = std::min(size, capacity_ - index);
+    parts[0] = {ring_.get() + index, first};
+    if (first == size)
+      return 1;
+    parts[1] = {ring_.get(), size - first};
+    return 2;
+  }
+
+  [[nodiscard]] size_t frame_size(uint64_t at) const {
+    unsigned char header[FRAME_HEADER];
+    get(at, reinterpret_cast<char *>(header), FRAME_HEADER);
+    return FRAME_HEADER + ((size_t{header[0]} << 24) |
+                           (size_t{header[1]} << 16) |
+                           (size_t{header[2]} << 8) | size_t{header[3]});
+  }
+
+  void open_frame_locked() {
+    const char placeholder[FRAME_HEADER] = {};
+    put_locked(tail_, placeholder, FRAME_HEADER);
+    tail_ += FRAME_HEADER;
+  }
+
+  void seal_locked() {
+    const auto len = static_cast<uint32_t>(tail_ - sealed_ - FRAME_HEADER);
+    const char header[FRAME_HEADER] = {
+        static_cast<char>(len >> 24), static_cast<char>(len >> 16),
+        static_cast<char>(len >> 8), static_cast<char>(len)};
+    put_locked(sealed_, header, FRAME_HEADER);
+    sealed_ = tail_;
+  }
+
+  void drop_locked(const char *data, size_t size) {
+    const auto lines =
+        static_cast<uint64_t>(std::count(data, data + size, '\n'));
+    stats_.dropped_bytes += size;
+    stats_.dropped_lines += lines;
+    unreported_bytes_ += size;
+    unreported_lines_ += lines;
+  }
+
+  // Append part of a bracketed record to its frame. A record that does not
+  // fit is dropped whole: a cut frame could not be decoded.
+  void write_record_part_locked(const char *data, size_t size, Level level) {
+    record_level_ = level;
+    if (!record_dropped_ && tail_ == sealed_) {
+      if (unreported_bytes_ != 0)
+        report_locked();
+      if (FRAME_HEADER <= room_locked())
+        open_frame_locked();
+    }
+    if (!record_dropped_ && tail_ != sealed_ && size <= room_locked()) {
+      put_locked(tail_, data, size);
+      tail_ += size;
+      return;
+    }
+
+    uint64_t lost = size;
+    if (!record_dropped_) {
+      // First loss in this record: take back what was already buffered.
+      if (tail_ != sealed_)
+        lost += tail_ - sealed_ - FRAME_HEADER;
+      tail_ = sealed_;
+      record_dropped_ = true;
+      ++stats_.dropped_lines;
+      ++unreported_lines_;
+    }
+    stats_.dropped_bytes += lost;
+    unreported_bytes_ += lost;
+  }
+
+  // Wake the I/O thread once a batch is sealed, or for an Error record.
+  void nudge_locked(Level level) {
+    if (!urgent_ &&
+        (sealed_ - head_ >= batch_bytes_ ||
+         (level == Level::Error && options_.flush_on_error))) {
+      urgent_ = true;
+      wake_.notify_one();
+    }
+  }
+
+  // Drop the first sealed frame unsent.
+  void drop_frame_locked() {
+    const size_t frame = frame_size(head_);
+    stats_.dropped_bytes += frame - FRAME_HEADER;
+    ++stats_.dropped_lines;
+    head_ += frame;
+  }
+
+  void report_locked() {
+    char line[160];
+    const int len = std::snprintf(
+        line, sizeof(line),
+        "==ct== [WARN] net overflow: dropped %llu lines (%llu bytes)\n",
+        static_cast<unsigned long long>(unreported_lines_),
+        static_cast<unsigned long long>(unreported_bytes_));
+    if (len <= 0 || FRAME_HEADER + static_cast<size_t>(len) > room_locked())
+      return;
+    open_frame_locked();
+    put_locked(tail_, line, static_cast<size_t>(len));
+    tail_ += static_cast<size_t>(len);
+    seal_locked();
+    unreported_bytes_ = 0;
+    unreported_lines_ = 0;
+  }
+
+  // ── I/O thread ───────────────────────
+  //
+  // fd_, connected_, partial_, retry_at_, backoff_ and scratch_ belong to
+  // this thread.
+
+  void worker_loop() {
+    const bool timed = options_.flush_interval.count() > 0;
+    SteadyClock::time_point deadline = SteadyClock::time_point::max();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      const SteadyClock::time_point now = SteadyClock::now();
+      if (closed_ && deadline == SteadyClock::time_point::max())
+        deadline = now + options_.drain_timeout;
+      if (closed_ && (sealed_ == head_ || now >= deadline))
+        break;
+
+      if (fd_ < 0) {
+        if (now < retry_at_) {
+          wake_.wait_until(lock, std::min(retry_at_, deadline));
+          continue;
+        }
+        connect(lock);
+        continue;
+      }
+
+      const bool idle = sealed_ == head_;
+      if (idle || (!urgent_ && !closed_)) {
+        if (idle) {
+          urgent_ = false;
+          idle_.notify_all();
+        }
+        bool woke = true;
+        const auto ready = [this]() { return closed_ || urgent_; };
+        if (timed)
+          woke = wake_.wait_for(lock, options_.flush_interval, ready);
+        else
+          wake_.wait(lock, ready);
+        if (woke || sealed_ == head_)
+          continue;
+        urgent_ = true; // flush_interval elapsed: send it all
+      }
+
+      if (options_.protocol == NetProtocol::Udp)
+        send_datagrams(lock);
+      else
+        send_stream(lock);
+    }
+
+    // Closing: what did not go out in time is lost.
+    while (head_ < sealed_)
+      drop_frame_locked();
+    partial_ = 0;
+    if (fd_ >= 0)
+      platform::close_file(fd_);
+    fd_ = -1;
+    idle_.notify_all();
+  }
+
+  void connect(std::unique_lock<std::mutex> &lock) {
+    lock.unlock();
+    const int fd = platform::connect_socket(
+        host_.c_str(), port_, options_.protocol == NetProtocol::Tcp,
+        CONNECT_TIMEOUT_MS, SEND_TIMEOUT_MS);
+    lock.lock();
+    if (fd < 0) {
+      retry_at_ = SteadyClock::now() + backoff_;
+      backoff_ = std::min(backoff_ * 2, options_.max_reconnect_delay);
+      return;
+    }
+    fd_ = fd;
+    partial_ = 0;
+    backoff_ = options_.reconnect_delay;
+    if (connected_)
+      stream_generation.fetch_add(1, std::memory_order_release);
+    connected_ = true;
+  }
+
+  void disconnect_locked() {
+    platform::close_file(fd_);
+    fd_ = -1;
+    partial_ = 0; // the cut frame goes out again, whole
+    retry_at_ = SteadyClock::now();
+  }
+
+  // One write of up to batch_bytes from the ring.
+  void send_stream(std::unique_lock<std::mutex> &lock) {
+    const uint64_t from = head_ + partial_;
+    const size_t size =
+        static_cast<size_t>(std::min<uint64_t>(sealed_ - from, batch_bytes_));
+    platform::Datagram parts[2];
+    const size_t count = parts_of(from, size, parts);
+
+    lock.unlock();
+    const long long sent = platform::send_stream(fd_, parts, count);
+    lock.lock();
+
+    ++stats_.syscalls;
+    if (sent < 0) {
+      disconnect_locked();
+      return;
+    }
+
+    stats_.bytes_written += static_cast<uint64_t>(sent);
+    partial_ += static_cast<size_t>(sent);
+    while (head_ < sealed_) {
+      const size_t frame = frame_size(head_);
+      if (partial_ < frame)
+        break;
+      head_ += frame;
+      partial_ -= frame;
+    }
+    if (sent > 0)
+      idle_.notify_all();
+  }
+
+  // Up to UDP_BATCH frames, one datagram each. A frame that does not go
+  // out (e.g. larger than a datagram) is dropped. When the socket reports
+  // the collector gone, nothing was sent: the socket is opened again
+  // (with backoff if that fails) and the frames wait for it.
+  void send_datagrams(std::unique_lock<std::mutex> &lock) {
+    platform::Datagram datagrams[UDP_BATCH];
+    size_t count = 0;
+    for (uint64_t at = head_; count < UDP_BATCH && at < sealed_;) {
+      const size_t frame = frame_size(at);
+      platform::Datagram parts[2];
+      if (parts_of(at, frame, parts) == 1) {
+        datagrams[count++] = parts[0];
+      } else {
+        // Wraps around the ring end: at most one frame per pass does.
+        scratch_.resize(frame);
+        get(at, scratch_.data(), frame);
+        datagrams[count++] = {scratch_.data(), frame};
+      }
+      at += frame;
+    }
+
+    uint64_t syscalls = 0;
+    lock.unlock();
+    const long long sent =
+        platform::send_datagrams(fd_, datagrams, count, syscalls);
+    lock.lock();
+
+    stats_.syscalls += syscalls;
+    if (sent < 0) {
+      disconnect_locked();
+      return;
+    }
+    const auto done = static_cast<size_t>(sent);
+    for (size_t i = 0; i < done; ++i) {
+      stats_.bytes_written += datagrams[i].size;
+      head_ += datagrams[i].size;
+    }
+    if (done < count)
+      drop_frame_locked();
+    idle_.notify_all();
+  }
+
+  const std::string host_;
+  const uint16_t port_;
+  const NetSinkOptions options_;
+  const size_t capacity_;
+  const size_t batch_bytes_;
+  std::unique_ptr<char[]> ring_;
+
+  int fd_ = -1;
+  bool connected_ = false; // a connection was made before
+  size_t partial_ = 0;
+  SteadyClock::time_point retry_at_{};
+  std::chrono::milliseconds backoff_;
+  std::vector<char> scratch_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_; // I/O thread: batch ready, closing
+  std::condition_variable idle_; // flush(): frames sent
+  std::thread worker_;
+  bool closed_ = false;
+  bool urgent_ = false; // send without waiting for flush_interval
+  bool in_record_ = false;      // between begin_record() and end_record()
+  bool record_dropped_ = false; // this record is being dropped
+  Level record_level_ = Level::Info;
+  uint64_t head_ = 0;
+  uint64_t sealed_ = 0;
+  uint64_t tail_ = 0;
+
+  SinkStats stats_;
+  uint64_t unreported_bytes_ = 0;
+  uint64_t unreported_lines_ = 0;
+};
+
+} // namespace
+
+std::unique_ptr<SinkBackend> make_net_sink(std::string_view host,
+                                           uint16_t port,
+                                           const NetSinkOptions &options) {
+  if (host.empty() || port == 0 || !platform::sockets_available())
+    return nullptr;
+
+  const size_t capacity = std::max<size_t>(options.buffer_size, 4096);
+  return std::make_unique<NetSink>(std::string(host), port, options,
+                                   capacity);
+}
+
+} // namespace coretrace::detail
@@ -0,0 +1,143 @@
+#include "logger_pattern.hpp"
+
+namespace coretrace::detail::pattern {
+
+namespace {
+
+[[nodiscard]] bool conversion(char c, OpKind &kind) {
+  switch (c) {
+  case 'T':
+    kind = OpKind::Timestamp;
+    return true;
+  case 'L':
+    kind = OpKind::Level;
+    return true;
+  case 'P':
+    kind = OpKind::Pid;
+    return true;
+  case 't':
+    kind = OpKind::Thread;
+    return true;
+  case 'p':
+    kind = OpKind::Prefix;
+    return true;
+  case 'm':
+    kind = OpKind::Module;
+    return true;
+  case 'f':
+    kind = OpKind::File;
+    return true;
+  case 'l':
+    kind = OpKind::Line;
+    return true;
+  case 'v':
+    kind = OpKind::Message;
+    return true;
+  case 'k':
+    kind = OpKind::Fields;
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Decimal number at pattern[i]; false if it exceeds limit.
+[[nodiscard]] bool parse_number(std::string_view pattern, size_t &i,
+                                uint32_t limit, uint32_t &value) {
+  value = 0;
+  while (i < pattern.size() && pattern[i] >= '0' && pattern[i] <= '9') {
+    value = value * 10 + static_cast<uint32_t>(pattern[i] - '0');
+    if (value > limit)
+      return false;
+    ++i;
+  }
+  return true;
+}
+
+class Builder {
+public:
+  explicit Builder(Program &program) : program_(program) {}
+
+  // Literal bytes join the literal op before them.
+  void literal(std::string_view bytes) {
+    if (program_.ops.empty() ||
+        program_.ops.back().kind != OpKind::Literal) {
+      Op op;
+      op.text = static_cast<uint32_t>(program_.text.size());
+      program_.ops.push_back(op);
+    }
+    program_.text.append(bytes);
+    program_.ops.back().text_len += static_cast<uint32_t>(bytes.size());
+  }
+
+  void field(Op op, std::string_view label) {
+    op.text = static_cast<uint32_t>(program_.text.size());
+    op.text_len = static_cast<uint32_t>(label.size());
+    program_.text.append(label);
+    program_.ops.push_back(op);
+  }
+
+private:
+  Program &program_;
+};
+
+} // namespace
+
+// %[{label}][-]["][width][.precision]conversion, or %% for a '%'.
+std::unique_ptr<Program> compile(std::string_view pattern) {
+  auto program = std::make_unique<Program>();
+  Builder builder(*program);
+
+  size_t i = 0;
+  while (i < pattern.size()) {
+    const size_t percent = pattern.find('%', i);
+    if (percent == std::string_view::npos) {
+      builder.literal(pattern.substr(i));
+      break;
+    }
+    if (percent > i)
+      builder.literal(pattern.substr(i, percent - i));
+    i = percent + 1;
+    if (i < pattern.size() && pattern[i] == '%') {
+      builder.literal("%");
+      ++i;
+      continue;
+    }
+
+    std::string_view label;
+    if (i < pattern.size() && pattern[i] == '{') {
+      const size_t close = pattern.find('}', i + 1);
+      if (close == std::string_view::npos)
+        return nullptr;
+      label = pattern.substr(i + 1, close - i - 1);
+      i = close + 1;
+    }
+
+    Op op;
+    for (; i < pattern.size(); ++i) {
+      if (pattern[i] == '-')
+        op.left = true;
+      else if (pattern[i] == '"')
+        op.quote = true;
+      else
+        break;
+    }
+    uint32_t width = 0;
+    if (!parse_number(pattern, i, MAX_WIDTH, width))
+      return nullptr;
+    op.width = static_cast<uint16_t>(width);
+    if (i < pattern.size() && pattern[i] == '.') {
+      ++i;
+      if (!parse_number(pattern, i, MAX_PRECISION, op.precision))
+        return nullptr;
+    }
+
+    if (i >= pattern.size() || !conversion(pattern[i], op.kind))
+      return nullptr;
+    ++i;
+    builder.field(op, label);
+  }
+  return program;
+}
+
+} // namespace coretrace::detail::pattern
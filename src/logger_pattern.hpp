@@ -0,0 +1,72 @@
+#ifndef CORETRACE_LOGGER_PATTERN_HPP
+#define CORETRACE_LOGGER_PATTERN_HPP
+
+#include "coretrace/logger.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compiled line patterns for Layout::Pattern (see coretrace::set_pattern()).
+//
+// A pattern is parsed once into a flat list of ops: literal copies and
+// field writers with their padding, truncation and quoting already
+// decoded. Rendering a line walks the list; nothing is parsed per line.
+namespace coretrace::detail::pattern {
+
+enum class OpKind : uint8_t {
+  Literal,   // text
+  Timestamp, // %T  2025-01-15T10:45:23.456 (timestamps on)
+  Level,     // %L  INFO
+  Pid,       // %P
+  Thread,    // %t
+  Prefix,    // %p  prefix tag
+  Module,    // %m
+  File,      // %f  basename (source locations on)
+  Line,      // %l  (source locations on)
+  Message,   // %v  without its trailing newline
+  Fields,    // %k  " key=value" per structured field
+};
+
+// Largest width and precision accepted.
+inline constexpr uint32_t MAX_WIDTH = 1024;
+inline constexpr uint32_t MAX_PRECISION = 1 << 20;
+inline constexpr uint32_t NO_PRECISION = UINT32_MAX;
+
+struct Op {
+  OpKind kind = OpKind::Literal;
+  bool left = false;  // '-': pad after the value instead of before
+  bool quote = false; // '"': quote and escape the value when needed
+  uint16_t width = 0; // minimum width in bytes
+  uint32_t precision = NO_PRECISION; // maximum bytes of the value
+  // Literal text, or the label written before a non-empty value.
+  uint32_t text = 0;
+  uint32_t text_len = 0;
+};
+
+struct Program {
+  std::vector<Op> ops;
+  std::string text; // literal and label bytes of every op
+
+  // Programs replaced at runtime. A writer that loaded the pointer just
+  // before the swap may still be running it, so replaced programs are
+  // deleted once the logger's epoch has moved on (see State::epoch).
+  Program *retired_next = nullptr;
+  unsigned retired_epoch = 0;
+
+  [[nodiscard]] std::string_view text_of(const Op &op) const {
+    return {text.data() + op.text, op.text_len};
+  }
+};
+
+// Compile a pattern. Returns nullptr on a syntax error: a lone '%' at the
+// end, an unknown conversion, an unclosed '{', a width above MAX_WIDTH or
+// a precision above MAX_PRECISION.
+[[nodiscard]] std::unique_ptr<Program> compile(std::string_view pattern);
+
+} // namespace coretrace::detail::pattern
+
+#endif // CORETRACE_LOGGER_PATTERN_HPP
@@ -0,0 +1,423 @@
+#include "logger_platform.hpp"
+#include "logger_sink.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace coretrace::detail {
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+// Poll period of the writer thread while the pipe is full, while blocks
+// are still unread by the child, and between reap attempts.
+constexpr std::chrono::milliseconds POLL_PERIOD{10};
+
+struct Block {
+  char *data = nullptr;
+  size_t len = 0;
+  uint64_t end = 0; // stream offset just past the block, once in the pipe
+};
+
+// Streams records to the stdin of a child process. Producers copy records
+// into page-aligned blocks; a writer thread hands completed blocks to the
+// pipe, with vmsplice() where available, so the child reads the block
+// pages directly. Such a block stays referenced by the pipe until the
+// child has read it: it is recycled only once the pipe's unread byte
+// count (FIONREAD) shows the child got past its end.
+//
+// A producer never waits for the child. A record that finds no free block
+// is dropped and counted, and a report line goes out with the next record
+// that fits. When the child exits, what it had not read is counted as
+// dropped, the block being written is cut at the record boundary that
+// ends it, and the command is started again after restart_delay.
+class PipeSink final : public SinkBackend {
+public:
+  PipeSink(std::string command, const PipeSinkOptions &options,
+           size_t block_size, int pid, int fd)
+      : command_(std::move(command)), options_(options),
+        capacity_(block_size), pid_(pid), fd_(fd) {
+    blocks_.resize(options.buffer_count < 2 ? 2 : options.buffer_count);
+    for (Block &block : blocks_) {
+      block.data = static_cast<char *>(
+          platform::allocate_aligned(platform::page_size(), capacity_));
+      if (block.data)
+        free_.push_back(&block);
+    }
+    worker_ = std::thread([this]() { worker_loop(); });
+  }
+
+  ~PipeSink() override {
+    close();
+    for (Block &block : blocks_)
+      platform::free_aligned(block.data);
+  }
+
+  PipeSink(const PipeSink &) = delete;
+  PipeSink &operator=(const PipeSink &) = delete;
+
+  void write(const char *data, size_t size, Level level) override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (closed_) {
+      drop_locked(data, size);
+      return;
+    }
+
+    if (unreported_bytes_ != 0)
+      report_locked();
+    if (!append_locked(data, size)) {
+      drop_locked(data, size);
+      return;
+    }
+
+    if (level == Level::Error && options_.flush_on_error)
+      handoff_locked();
+  }
+
+  // Waits (at most drain_timeout) until everything written so far is in
+  // the pipe.
+  void flush() override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (closed_)
+      return;
+    handoff_locked();
+    idle_.wait_for(lock, options_.drain_timeout,
+                   [this]() { return queued_.empty() || closed_; });
+  }
+
+  void close() override {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (closed_)
+        return;
+      closed_ = true;
+      handoff_locked();
+    }
+    wake_.notify_all();
+    if (worker_.joinable())
+      worker_.join();
+  }
+
+  SinkStats stats() const override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return stats_;
+  }
+
+private:
+  // Copy a whole record into the active block and as many free ones as it
+  // needs. Returns false, copying nothing, when they are not enough.
+  bool append_locked(const char *data, size_t size) {
+    const size_t room = active_ ? capacity_ - active_->len : 0;
+    if (size > room + free_.size() * capacity_)
+      return false;
+
+    while (size > 0) {
+      if (!active_) {
+        active_ = free_.back();
+        free_.pop_back();
+        active_->len = 0;
+      }
+      const size_t chunk = std::min(size, capacity_ - active_->len);
+      std::memcpy(active_->data + active_->len, data, chunk);
+      active_->len += chunk;
+      data += chunk;
+      size -= chunk;
+      if (active_->len == capacity_)
+        handoff_locked();
+    }
+    return true;
+  }
+
+  // Queue the active block for the writer thread.
+  void handoff_locked() {
+    if (!active_ || active_->len == 0)
+      return;
+    queued_.push_back(active_);
+    active_ = nullptr;
+    wake_.notify_one();
+  }
+
+  void drop_locked(const char *data, size_t size) {
+    const auto lines =
+        static_cast<uint64_t>(std::count(data, data + size, '\n'));
+    stats_.dropped_bytes += size;
+    stats_.dropped_lines += lines;
+    unreported_bytes_ += size;
+    unreported_lines_ += lines;
+  }
+
+  void report_locked() {
+    char line[160];
+    const int len = std::snprintf(
+        line, sizeof(line),
+        "==ct== [WARN] pipe overflow: dropped %llu lines (%llu bytes)\n",
+        static_cast<unsigned long long>(unreported_lines_),
+        static_cast<unsigned long long>(unreported_bytes_));
+    if (len > 0 && append_locked(line, static_cast<size_t>(len))) {
+      unreported_bytes_ = 0;
+      unreported_lines_ = 0;
+    }
+  }
+
+  // ── Writer thread ────────────────────
+  //
+  // fd_, pid_, spliced_ and written_ belong to this thread; the block
+  // lists are shared with producers under mutex_.
+
+  void worker_loop() {
+    platform::block_sigpipe();
+    const bool timed = options_.flush_interval.count() > 0;
+    SteadyClock::time_point next_flush =
+        SteadyClock::now() + options_.flush_interval;
+    SteadyClock::time_point deadline = SteadyClock::time_point::max();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      const SteadyClock::time_point now = SteadyClock::now();
+      reclaim_locked();
+      if (closed_ && deadline == SteadyClock::time_point::max())
+        deadline = now + options_.drain_timeout;
+
+      if (fd_ < 0 && !closed_ && options_.restart && now >= respawn_at_) {
+        respawn(lock);
+        continue;
+      }
+
+      if (!queued_.empty()) {
+        if (fd_ < 0 && (closed_ || !options_.restart)) {
+          drop_queued_locked();
+          continue;
+        }
+        if (closed_ && now >= deadline)
+          break;
+        if (fd_ >= 0) {
+          write_front(lock);
+          continue;
+        }
+      }
+
+      if (closed_)
+        break;
+
+      if (timed && now >= next_flush) {
+        handoff_locked();
+        next_flush = now + options_.flush_interval;
+        continue;
+      }
+
+      SteadyClock::time_point wake_at =
+          timed ? next_flush : now + std::chrono::hours(1);
+      if (!in_flight_.empty())
+        wake_at = std::min(wake_at, now + POLL_PERIOD);
+      if (fd_ < 0 && options_.restart)
+        wake_at = std::min(wake_at, respawn_at_);
+      if (queued_.empty() || fd_ < 0)
+        wake_.wait_until(lock, wake_at);
+
+      if (fd_ >= 0 && platform::reap_child(pid_))
+        child_lost(lock, true);
+    }
+
+    // Closing: what is still queued could not be written in time.
+    drop_queued_locked();
+    if (fd_ >= 0) {
+      // EOF lets the child finish (e.g. a compressor's trailer). Blocks it
+      // has not read stay referenced by the pipe until it is gone.
+      platform::close_file(fd_);
+      fd_ = -1;
+      lock.unlock();
+      finish_child(pid_);
+      lock.lock();
+    }
+    free_.insert(free_.end(), in_flight_.begin(), in_flight_.end());
+    in_flight_.clear();
+  }
+
+  // One write attempt of the first queued block.
+  void write_front(std::unique_lock<std::mutex> &lock) {
+    Block *block = queued_.front();
+    lock.unlock();
+    const long long written =
+        platform::write_pipe(fd_, block->data + written_,
+                             block->len - written_);
+    if (written == 0)
+      platform::wait_pipe_writable(
+          fd_, static_cast<int>(POLL_PERIOD.count()));
+    lock.lock();
+
+    ++stats_.syscalls;
+    if (written < 0) {
+      child_lost(lock, false);
+      return;
+    }
+
+    const auto n = static_cast<size_t>(written);
+    stats_.bytes_written += n;
+    spliced_ += n;
+    written_ += n;
+    if (written_ < block->len)
+      return;
+
+    block->end = spliced_;
+    written_ = 0;
+    queued_.pop_front();
+    in_flight_.push_back(block);
+    if (queued_.empty())
+      idle_.notify_all();
+  }
+
+  // Return blocks the child has read to the free list.
+  void reclaim_locked() {
+    if (in_flight_.empty())
+      return;
+    uint64_t consumed = spliced_;
+    if (platform::pipe_zero_copy() && fd_ >= 0)
+      consumed -= std::min<uint64_t>(spliced_,
+                                     platform::pipe_unread_bytes(fd_));
+    while (!in_flight_.empty() && in_flight_.front()->end <= consumed) {
+      free_.push_back(in_flight_.front());
+      in_flight_.pop_front();
+    }
+  }
+
+  void drop_queued_locked() {
+    for (Block *block : queued_) {
+      drop_locked(block->data + written_, block->len - written_);
+      written_ = 0;
+      free_.push_back(block);
+    }
+    queued_.clear();
+    idle_.notify_all();
+  }
+
+  // The child exited or closed its stdin. Counts what it never read as
+  // dropped and schedules a restart.
+  void child_lost(std::unique_lock<std::mutex> &lock, bool reaped) {
+    // The unread bytes are the newest ones in the pipe: the written part
+    // of the front block, then the in-flight blocks backwards.
+    size_t unread = platform::pipe_unread_bytes(fd_);
+    const auto drop_tail = [&](const char *data, size_t len) {
+      const size_t take = std::min(unread, len);
+      drop_locked(data + len - take, take);
+      unread -= take;
+    };
+    if (written_ > 0) {
+      Block *front = queued_.front();
+      drop_tail(front->data, written_);
+      // The rest starts mid-record: the next child gets whole records.
+      drop_locked(front->data + written_, front->len - written_);
+      written_ = 0;
+      queued_.pop_front();
+      free_.push_back(front);
+    }
+    for (auto it = in_flight_.rbegin(); it != in_flight_.rend() && unread;
+         ++it)
+      drop_tail((*it)->data, (*it)->len);
+
+    platform::close_file(fd_);
+    fd_ = -1;
+    spliced_ = 0;
+    free_.insert(free_.end(), in_flight_.begin(), in_flight_.end());
+    in_flight_.clear();
+    if (queued_.empty())
+      idle_.notify_all();
+
+    if (!reaped) {
+      lock.unlock();
+      finish_child(pid_);
+      lock.lock();
+    }
+    pid_ = -1;
+    respawn_at_ = SteadyClock::now() +
+                  std::max<std::chrono::milliseconds>(options_.restart_delay,
+                                                      POLL_PERIOD);
+  }
+
+  void respawn(std::unique_lock<std::mutex> &lock) {
+    int pid = -1;
+    int fd = -1;
+    lock.unlock();
+    const bool started =
+        platform::spawn_piped_child(command_.c_str(), pid, fd);
+    lock.lock();
+    if (started) {
+      pid_ = pid;
+      fd_ = fd;
+      stream_generation.fetch_add(1, std::memory_order_release);
+      return;
+    }
+    respawn_at_ = SteadyClock::now() +
+                  std::max<std::chrono::milliseconds>(options_.restart_delay,
+                                                      POLL_PERIOD);
+  }
+
+  // Give the child drain_timeout to exit, then kill it.
+  void finish_child(int pid) const {
+    const SteadyClock::time_point deadline =
+        SteadyClock::now() + options_.drain_timeout;
+    while (!platform::reap_child(pid)) {
+      if (SteadyClock::now() >= deadline) {
+        platform::kill_child(pid);
+        return;
+      }
+      std::this_thread::sleep_for(POLL_PERIOD);
+    }
+  }
+
+  const std::string command_;
+  const PipeSinkOptions options_;
+  const size_t capacity_;
+
+  int pid_;
+  int fd_;
+  uint64_t spliced_ = 0; // bytes written to the current pipe
+  size_t written_ = 0;   // bytes of queued_.front() already written
+  SteadyClock::time_point respawn_at_{};
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_; // writer thread: blocks queued, closing
+  std::condition_variable idle_; // flush(): queue drained
+  std::thread worker_;
+  bool closed_ = false;
+
+  std::vector<Block> blocks_;
+  std::vector<Block *> free_;
+  Block *active_ = nullptr;
+  std::deque<Block *> queued_;    // full blocks, oldest first
+  std::deque<Block *> in_flight_; // in the pipe, maybe not read yet
+
+  SinkStats stats_;
+  uint64_t unreported_bytes_ = 0;
+  uint64_t unreported_lines_ = 0;
+};
+
+} // namespace
+
+std::unique_ptr<SinkBackend> make_pipe_sink(std::string_view command,
+                                            const PipeSinkOptions &options) {
+  if (command.empty())
+    return nullptr;
+
+  const std::string cmd(command);
+  int pid = -1;
+  int fd = -1;
+  if (!platform::spawn_piped_child(cmd.c_str(), pid, fd))
+    return nullptr;
+
+  const size_t page = platform::page_size();
+  size_t block_size = options.buffer_size < page ? page : options.buffer_size;
+  block_size = (block_size + page - 1) / page * page;
+  return std::make_unique<PipeSink>(cmd, options, block_size, pid, fd);
+}
+
+} // namespace coretrace::detail
@@ -2,6 +2,7 @@
 #define CORETRACE_LOGGER_PLATFORM_HPP
 
 #include <cstddef>
+#include <cstdint>
 
 namespace coretrace::platform {
 
@@ -17,9 +18,139 @@ struct UtcTimestamp {
 
 [[nodiscard]] bool stderr_supports_color();
 void write_stderr(const char *data, size_t size);
+// Switch stderr's O_NONBLOCK flag. Returns false where unsupported.
+bool set_stderr_nonblocking(bool enabled);
+// One write attempt to stderr (EINTR retried). Returns the bytes written,
+// 0 if it would block, -1 on an error.
+[[nodiscard]] long long try_write_stderr(const char *data, size_t size);
+// Wait up to timeout_ms for stderr to accept output.
+void wait_stderr_writable(int timeout_ms);
 [[nodiscard]] int process_id();
 [[nodiscard]] unsigned long long current_thread_id();
 [[nodiscard]] bool utc_timestamp(UtcTimestamp &out);
+// Wall-clock time in nanoseconds since the Unix epoch.
+[[nodiscard]] bool realtime_ns(uint64_t &out);
+
+// ── Files ─────────────────────────────────
+
+// Open for appending (or truncate), create with 0644. Returns -1 on failure.
+[[nodiscard]] int open_log_file(const char *path, bool truncate);
+// Write everything with EINTR retry. Returns false on a hard error.
+bool write_file(int fd, const char *data, size_t size);
+// Flush file data (not metadata) to stable storage.
+void sync_file_data(int fd);
+// Reserve [offset, offset + length) without changing the file size.
+// Best effort: no-op where unsupported.
+void preallocate_file(int fd, uint64_t offset, uint64_t length);
+[[nodiscard]] uint64_t file_size(int fd);
+// Grow or shrink the file to exactly size bytes.
+bool resize_file(int fd, uint64_t size);
+void close_file(int fd);
+
+// ── Direct I/O ───────────────────────────
+
+// Open read-write (no O_APPEND) bypassing the page cache: O_DIRECT, or
+// FILE_FLAG_NO_BUFFERING on Windows. Buffers, offsets and lengths must
+// then be multiples of direct_io_alignment(). Returns -1 on failure or
+// where the file system (or platform) does not support it.
+[[nodiscard]] int open_direct_file(const char *path, bool truncate);
+[[nodiscard]] size_t direct_io_alignment();
+// Positional write of everything, with EINTR retry.
+bool write_file_at(int fd, const char *data, size_t size, uint64_t offset);
+// Positional read. Returns the bytes read (short at end of file), or -1.
+[[nodiscard]] long long read_file_at(int fd, char *data, size_t size,
+                                     uint64_t offset);
+// Start writeback of [offset, offset + length) without waiting. Best
+// effort: no-op where unsupported.
+void start_file_writeback(int fd, uint64_t offset, uint64_t length);
+// Drop clean cached pages of [offset, offset + length) (length 0: up to
+// the end of the file). Best effort: no-op where unsupported.
+void drop_file_cache(int fd, uint64_t offset, uint64_t length);
+
+// ── Mapped files ─────────────────────────
+
+// Open read-write for mapping (no O_APPEND). Returns -1 on failure.
+[[nodiscard]] int open_map_file(const char *path, bool truncate);
+// Alignment required for mapping offsets.
+[[nodiscard]] size_t map_granularity();
+// Map [offset, offset + length) shared and writable. The file must already
+// cover the range. Returns nullptr on failure.
+[[nodiscard]] void *map_file(int fd, uint64_t offset, size_t length);
+void unmap_file(void *addr, size_t length);
+// Start writeback of a mapped range; wait for it when wait is true.
+void flush_mapping(void *addr, size_t length, bool wait);
+// Drop written pages of a mapped range from the process. The data stays
+// in the page cache. Best effort.
+void discard_mapping(void *addr, size_t length);
+
+// ── Child processes ──────────────────────
+
+// Start "/bin/sh -c command" reading its stdin from a new pipe, with
+// default signal handling. On success sets the child's pid and the write
+// end of the pipe (non-blocking, close-on-exec). False where unsupported.
+[[nodiscard]] bool spawn_piped_child(const char *command, int &pid, int &fd);
+// Reap the child if it has exited. Returns true once it is gone.
+bool reap_child(int pid);
+// Kill the child's process group and reap the child.
+void kill_child(int pid);
+// One non-blocking write to a pipe. Returns the bytes taken, 0 if the pipe
+// is full, -1 if the reader is gone or on an error. With pipe_zero_copy()
+// the pipe references the caller's pages instead of copying them (Linux
+// vmsplice()): they must stay untouched until pipe_unread_bytes() shows
+// the reader consumed them.
+[[nodiscard]] long long write_pipe(int fd, const char *data, size_t size);
+[[nodiscard]] bool pipe_zero_copy();
+// Bytes written to the pipe that its reader has not consumed yet.
+[[nodiscard]] size_t pipe_unread_bytes(int fd);
+// Wait up to timeout_ms for the pipe to accept output.
+void wait_pipe_writable(int fd, int timeout_ms);
+// Hold SIGPIPE on the calling thread, so that writing to a closed pipe
+// fails with EPIPE instead of killing the process, and discard the pending
+// signal after such a write.
+void block_sigpipe();
+void discard_sigpipe();
+
+// ── Local datagram sockets ───────────────
+
+struct Datagram {
+  const char *data = nullptr;
+  size_t size = 0;
+};
+
+// Unix datagram socket connected to path, sends time out after
+// send_timeout_ms. Returns -1 on failure or where unsupported.
+[[nodiscard]] int open_datagram_socket(const char *path,
+                                       int send_timeout_ms);
+// Send datagrams in order, in batches of sendmmsg() on Linux; syscalls
+// counts the system calls. Returns how many were sent before the first
+// that failed (which is not sent), or -1 if nothing was sent because the
+// peer is gone and the socket must be reopened.
+[[nodiscard]] long long send_datagrams(int fd, const Datagram *datagrams,
+                                       size_t count, uint64_t &syscalls);
+// Send data as the contents of a sealed memfd passed with SCM_RIGHTS
+// (journald's protocol for large entries). False where unsupported.
+bool send_memfd(int fd, const char *data, size_t size);
+
+// ── Network sockets ──────────────────────
+
+// False where the network sink is not supported.
+[[nodiscard]] bool sockets_available();
+// Connect a TCP (stream) or UDP socket to host:port within timeout_ms;
+// sends then time out after send_timeout_ms and never raise SIGPIPE.
+// Returns -1 on failure or where unsupported.
+[[nodiscard]] int connect_socket(const char *host, unsigned port,
+                                 bool stream, int timeout_ms,
+                                 int send_timeout_ms);
+// One gathered write of parts to a stream socket. Returns the bytes sent,
+// 0 on a send timeout, -1 if the connection is lost.
+[[nodiscard]] long long send_stream(int fd, const Datagram *parts,
+                                    size_t count);
+
+// ── Memory ───────────────────────────────
+
+[[nodiscard]] size_t page_size();
+[[nodiscard]] void *allocate_aligned(size_t alignment, size_t size);
+void free_aligned(void *ptr);
 
 } // namespace coretrace::platform
 
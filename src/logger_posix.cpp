@@ -3,14 +3,33 @@
 #include <cerrno>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #if defined(__linux__)
 #include <sys/syscall.h>
 #endif
 
+extern char **environ;
+
 namespace coretrace::platform {
 
 [[nodiscard]] bool stderr_supports_color() { return isatty(2) != 0; }
@@ -29,6 +48,32 @@ void write_stderr(const char *data, size_t size) {
   }
 }
 
+bool set_stderr_nonblocking(bool enabled) {
+  const int flags = fcntl(2, F_GETFL);
+  if (flags < 0)
+    return false;
+  const int next = enabled ? flags | O_NONBLOCK : flags & ~O_NONBLOCK;
+  return next == flags || fcntl(2, F_SETFL, next) == 0;
+}
+
+[[nodiscard]] long long try_write_stderr(const char *data, size_t size) {
+  for (;;) {
+    const ssize_t written = write(2, data, size);
+    if (written >= 0)
+      return static_cast<long long>(written);
+    if (errno == EINTR)
+      continue;
+    return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+  }
+}
+
+void wait_stderr_writable(int timeout_ms) {
+  pollfd pfd{};
+  pfd.fd = 2;
+  pfd.events = POLLOUT;
+  (void)poll(&pfd, 1, timeout_ms);
+}
+
 [[nodiscard]] int process_id() { return static_cast<int>(getpid()); }
 
 [[nodiscard]] unsigned long long current_thread_id() {
@@ -62,4 +107,547 @@ void write_stderr(const char *data, size_t size) {
   return true;
 }
 
+[[nodiscard]] bool realtime_ns(uint64_t &out) {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_REALTIME, &ts) != 0 || ts.tv_sec < 0)
+    return false;
+
+  out = static_cast<uint64_t>(ts.tv_sec) * 1000000000u +
+        static_cast<uint64_t>(ts.tv_nsec);
+  return true;
+}
+
+[[nodiscard]] int open_log_file(const char *path, bool truncate) {
+  int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+  flags |= truncate ? O_TRUNC : O_APPEND;
+
+  int fd;
+  do {
+    fd = open(path, flags, 0644);
+  } while (fd < 0 && errno == EINTR);
+  return fd;
+}
+
+bool write_file(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written > 0) {
+      data += static_cast<size_t>(written);
+      size -= static_cast<size_t>(written);
+      continue;
+    }
+    if (written < 0 && errno == EINTR)
+      continue;
+    return false;
+  }
+  return true;
+}
+
+void sync_file_data(int fd) {
+#if defined(__APPLE__)
+  (void)fsync(fd);
+#else
+  (void)fdatasync(fd);
+#endif
+}
+
+void preallocate_file(int fd, uint64_t offset, uint64_t length) {
+#if defined(__linux__)
+  (void)fallocate(fd, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(offset),
+                  static_cast<off_t>(length));
+#else
+  (void)fd;
+  (void)offset;
+  (void)length;
+#endif
+}
+
+[[nodiscard]] uint64_t file_size(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+    return 0;
+  return static_cast<uint64_t>(st.st_size);
+}
+
+bool resize_file(int fd, uint64_t size) {
+  int rc;
+  do {
+    rc = ftruncate(fd, static_cast<off_t>(size));
+  } while (rc != 0 && errno == EINTR);
+  return rc == 0;
+}
+
+void close_file(int fd) { (void)close(fd); }
+
+[[nodiscard]] int open_direct_file(const char *path, bool truncate) {
+#if defined(O_DIRECT)
+  int flags = O_RDWR | O_CREAT | O_CLOEXEC | O_DIRECT;
+  if (truncate)
+    flags |= O_TRUNC;
+
+  int fd;
+  do {
+    fd = open(path, flags, 0644);
+  } while (fd < 0 && errno == EINTR);
+  return fd;
+#else
+  (void)path;
+  (void)truncate;
+  return -1;
+#endif
+}
+
+[[nodiscard]] size_t direct_io_alignment() { return page_size(); }
+
+bool write_file_at(int fd, const char *data, size_t size, uint64_t offset) {
+  while (size > 0) {
+    ssize_t written = pwrite(fd, data, size, static_cast<off_t>(offset));
+    if (written > 0) {
+      data += static_cast<size_t>(written);
+      size -= static_cast<size_t>(written);
+      offset += static_cast<uint64_t>(written);
+      continue;
+    }
+    if (written < 0 && errno == EINTR)
+      continue;
+    return false;
+  }
+  return true;
+}
+
+[[nodiscard]] long long read_file_at(int fd, char *data, size_t size,
+                                     uint64_t offset) {
+  ssize_t got;
+  do {
+    got = pread(fd, data, size, static_cast<off_t>(offset));
+  } while (got < 0 && errno == EINTR);
+  return static_cast<long long>(got);
+}
+
+void start_file_writeback(int fd, uint64_t offset, uint64_t length) {
+#if defined(__linux__)
+  (void)sync_file_range(fd, static_cast<off_t>(offset),
+                        static_cast<off_t>(length), SYNC_FILE_RANGE_WRITE);
+#else
+  (void)fd;
+  (void)offset;
+  (void)length;
+#endif
+}
+
+void drop_file_cache(int fd, uint64_t offset, uint64_t length) {
+#if defined(POSIX_FADV_DONTNEED)
+  (void)posix_fadvise(fd, static_cast<off_t>(offset),
+                      static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+#else
+  (void)fd;
+  (void)offset;
+  (void)length;
+#endif
+}
+
+[[nodiscard]] int open_map_file(const char *path, bool truncate) {
+  int flags = O_RDWR | O_CREAT | O_CLOEXEC;
+  if (truncate)
+    flags |= O_TRUNC;
+
+  int fd;
+  do {
+    fd = open(path, flags, 0644);
+  } while (fd < 0 && errno == EINTR);
+  return fd;
+}
+
+[[nodiscard]] size_t map_granularity() { return page_size(); }
+
+[[nodiscard]] void *map_file(int fd, uint64_t offset, size_t length) {
+  void *addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                    static_cast<off_t>(offset));
+  return addr == MAP_FAILED ? nullptr : addr;
+}
+
+void unmap_file(void *addr, size_t length) { (void)munmap(addr, length); }
+
+void flush_mapping(void *addr, size_t length, bool wait) {
+  (void)msync(addr, length, wait ? MS_SYNC : MS_ASYNC);
+}
+
+void discard_mapping(void *addr, size_t length) {
+#if defined(MADV_DONTNEED)
+  (void)madvise(addr, length, MADV_DONTNEED);
+#else
+  (void)addr;
+  (void)length;
+#endif
+}
+
+[[nodiscard]] bool spawn_piped_child(const char *command, int &pid,
+                                     int &fd) {
+  int ends[2];
+#if defined(__linux__)
+  if (pipe2(ends, O_CLOEXEC) != 0)
+    return false;
+#else
+  if (pipe(ends) != 0)
+    return false;
+  (void)fcntl(ends[0], F_SETFD, FD_CLOEXEC);
+  (void)fcntl(ends[1], F_SETFD, FD_CLOEXEC);
+#endif
+
+  // The spawning thread may hold SIGPIPE (block_sigpipe()); the child
+  // starts with an empty mask and the default action. It leads its own
+  // process group, so kill_child() also reaches what the shell forked.
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attr;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawnattr_init(&attr);
+  posix_spawn_file_actions_adddup2(&actions, ends[0], 0);
+  sigset_t none;
+  sigset_t pipe_default;
+  sigemptyset(&none);
+  sigemptyset(&pipe_default);
+  sigaddset(&pipe_default, SIGPIPE);
+  posix_spawnattr_setsigmask(&attr, &none);
+  posix_spawnattr_setsigdefault(&attr, &pipe_default);
+  posix_spawnattr_setpgroup(&attr, 0);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK |
+                                      POSIX_SPAWN_SETSIGDEF |
+                                      POSIX_SPAWN_SETPGROUP);
+
+  char sh[] = "/bin/sh";
+  char dash_c[] = "-c";
+  char *argv[] = {sh, dash_c, const_cast<char *>(command), nullptr};
+  pid_t child = -1;
+  const int rc = posix_spawn(&child, sh, &actions, &attr, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attr);
+  (void)close(ends[0]);
+  if (rc != 0) {
+    (void)close(ends[1]);
+    return false;
+  }
+
+  const int flags = fcntl(ends[1], F_GETFL);
+  if (flags >= 0)
+    (void)fcntl(ends[1], F_SETFL, flags | O_NONBLOCK);
+  pid = static_cast<int>(child);
+  fd = ends[1];
+  return true;
+}
+
+bool reap_child(int pid) {
+  int status = 0;
+  for (;;) {
+    const pid_t rc = waitpid(static_cast<pid_t>(pid), &status, WNOHANG);
+    if (rc < 0 && errno == EINTR)
+      continue;
+    return rc != 0; // exited, or not our child (any more)
+  }
+}
+
+void kill_child(int pid) {
+  (void)kill(-static_cast<pid_t>(pid), SIGKILL);
+  int status = 0;
+  while (waitpid(static_cast<pid_t>(pid), &status, 0) < 0 && errno == EINTR) {
+  }
+}
+
+[[nodiscard]] long long write_pipe(int fd, const char *data, size_t size) {
+  for (;;) {
+#if defined(__linux__)
+    iovec iov{const_cast<char *>(data), size};
+    const ssize_t written = vmsplice(fd, &iov, 1, SPLICE_F_NONBLOCK);
+#else
+    const ssize_t written = write(fd, data, size);
+#endif
+    if (written >= 0)
+      return static_cast<long long>(written);
+    if (errno == EINTR)
+      continue;
+    return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+  }
+}
+
+[[nodiscard]] bool pipe_zero_copy() {
+#if defined(__linux__)
+  return true;
+#else
+  return false;
+#endif
+}
+
+[[nodiscard]] size_t pipe_unread_bytes(int fd) {
+  int unread = 0;
+  if (ioctl(fd, FIONREAD, &unread) != 0 || unread < 0)
+    return 0;
+  return static_cast<size_t>(unread);
+}
+
+void wait_pipe_writable(int fd, int timeout_ms) {
+  pollfd pfd{};
+  pfd.fd = fd;
+  pfd.events = POLLOUT;
+  (void)poll(&pfd, 1, timeout_ms);
+}
+
+void block_sigpipe() {
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGPIPE);
+  (void)pthread_sigmask(SIG_BLOCK, &set, nullptr);
+}
+
+void discard_sigpipe() {
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGPIPE);
+#if defined(__linux__)
+  const timespec zero{0, 0};
+  while (sigtimedwait(&set, nullptr, &zero) == SIGPIPE) {
+  }
+#else
+  sigset_t pending;
+  int sig = 0;
+  while (sigpending(&pending) == 0 && sigismember(&pending, SIGPIPE) &&
+         sigwait(&set, &sig) == 0) {
+  }
+#endif
+}
+
+[[nodiscard]] int open_datagram_socket(const char *path,
+                                       int send_timeout_ms) {
+  sockaddr_un addr{};
+  const size_t len = std::strlen(path);
+  if (len == 0 || len >= sizeof(addr.sun_path))
+    return -1;
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path, len);
+
+  const int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+  if (fd < 0)
+    return -1;
+  (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+  timeval timeout{};
+  timeout.tv_sec = send_timeout_ms / 1000;
+  timeout.tv_usec = (send_timeout_ms % 1000) * 1000;
+  (void)setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  if (connect(fd, reinterpret_cast<const sockaddr *>(&addr),
+              sizeof(addr)) != 0) {
+    (void)close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+namespace {
+
+// The daemon restarted or went away: reconnecting may help.
+bool peer_gone(int error) {
+  return error == ECONNREFUSED || error == ENOTCONN || error == EPIPE ||
+         error == ENOENT;
+}
+
+} // namespace
+
+[[nodiscard]] long long send_datagrams(int fd, const Datagram *datagrams,
+                                       size_t count, uint64_t &syscalls) {
+  size_t sent = 0;
+#if defined(__linux__)
+  constexpr size_t BATCH = 64;
+  mmsghdr headers[BATCH];
+  iovec iovs[BATCH];
+  while (sent < count) {
+    const size_t batch = count - sent < BATCH ? count - sent : BATCH;
+    for (size_t i = 0; i < batch; ++i) {
+      iovs[i].iov_base = const_cast<char *>(datagrams[sent + i].data);
+      iovs[i].iov_len = datagrams[sent + i].size;
+      headers[i] = mmsghdr{};
+      headers[i].msg_hdr.msg_iov = &iovs[i];
+      headers[i].msg_hdr.msg_iovlen = 1;
+    }
+    ++syscalls;
+    const int rc = sendmmsg(fd, headers, static_cast<unsigned>(batch),
+                            MSG_NOSIGNAL);
+    if (rc > 0) {
+      sent += static_cast<size_t>(rc);
+      continue;
+    }
+    if (rc < 0 && errno == EINTR)
+      continue;
+    if (rc < 0 && sent == 0 && peer_gone(errno))
+      return -1;
+    break;
+  }
+#else
+  while (sent < count) {
+    ++syscalls;
+    const ssize_t rc =
+        send(fd, datagrams[sent].data, datagrams[sent].size, 0);
+    if (rc >= 0) {
+      ++sent;
+      continue;
+    }
+    if (errno == EINTR)
+      continue;
+    if (sent == 0 && peer_gone(errno))
+      return -1;
+    break;
+  }
+#endif
+  return static_cast<long long>(sent);
+}
+
+bool send_memfd(int fd, const char *data, size_t size) {
+#if defined(__linux__) && defined(MFD_ALLOW_SEALING)
+  const int memfd =
+      memfd_create("coretrace-record", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (memfd < 0)
+    return false;
+
+  bool ok = write_file(memfd, data, size) &&
+            fcntl(memfd, F_ADD_SEALS,
+                  F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE |
+                      F_SEAL_SEAL) == 0;
+  if (ok) {
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg{};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+
+    ssize_t rc;
+    do {
+      rc = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    } while (rc < 0 && errno == EINTR);
+    ok = rc >= 0;
+  }
+  (void)close(memfd);
+  return ok;
+#else
+  (void)fd;
+  (void)data;
+  (void)size;
+  return false;
+#endif
+}
+
+[[nodiscard]] bool sockets_available() { return true; }
+
+namespace {
+
+#if defined(MSG_NOSIGNAL)
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+// Finish a non-blocking connect() within timeout_ms.
+bool finish_connect(int fd, int timeout_ms) {
+  pollfd pfd{};
+  pfd.fd = fd;
+  pfd.events = POLLOUT;
+  int rc;
+  do {
+    rc = poll(&pfd, 1, timeout_ms);
+  } while (rc < 0 && errno == EINTR);
+  if (rc <= 0)
+    return false;
+  int error = 0;
+  socklen_t len = sizeof(error);
+  return getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 &&
+         error == 0;
+}
+
+} // namespace
+
+[[nodiscard]] int connect_socket(const char *host, unsigned port,
+                                 bool stream, int timeout_ms,
+                                 int send_timeout_ms) {
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = stream ? SOCK_STREAM : SOCK_DGRAM;
+  char service[8];
+  std::snprintf(service, sizeof(service), "%u", port);
+  addrinfo *list = nullptr;
+  if (getaddrinfo(host, service, &hints, &list) != 0)
+    return -1;
+
+  int fd = -1;
+  for (addrinfo *ai = list; ai && fd < 0; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0)
+      continue;
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    const int flags = fcntl(fd, F_GETFL);
+    (void)fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    bool ok = connect(fd, ai->ai_addr, ai->ai_addrlen) == 0 ||
+              (errno == EINPROGRESS && finish_connect(fd, timeout_ms));
+    ok = ok && fcntl(fd, F_SETFL, flags) == 0;
+    if (!ok) {
+      (void)close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(list);
+  if (fd < 0)
+    return -1;
+
+  timeval timeout{};
+  timeout.tv_sec = send_timeout_ms / 1000;
+  timeout.tv_usec = (send_timeout_ms % 1000) * 1000;
+  (void)setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  const int one = 1;
+  if (stream)
+    (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#if defined(SO_NOSIGPIPE)
+  (void)setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+  return fd;
+}
+
+[[nodiscard]] long long send_stream(int fd, const Datagram *parts,
+                                    size_t count) {
+  constexpr size_t MAX_PARTS = 8;
+  iovec iovs[MAX_PARTS];
+  const size_t n = count < MAX_PARTS ? count : MAX_PARTS;
+  for (size_t i = 0; i < n; ++i) {
+    iovs[i].iov_base = const_cast<char *>(parts[i].data);
+    iovs[i].iov_len = parts[i].size;
+  }
+  msghdr msg{};
+  msg.msg_iov = iovs;
+  msg.msg_iovlen = n;
+
+  for (;;) {
+    const ssize_t sent = sendmsg(fd, &msg, SEND_FLAGS);
+    if (sent >= 0)
+      return static_cast<long long>(sent);
+    if (errno == EINTR)
+      continue;
+    return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+  }
+}
+
+[[nodiscard]] size_t page_size() {
+  static const size_t cached = [] {
+    long value = sysconf(_SC_PAGESIZE);
+    return value > 0 ? static_cast<size_t>(value) : size_t{4096};
+  }();
+  return cached;
+}
+
+[[nodiscard]] void *allocate_aligned(size_t alignment, size_t size) {
+  void *ptr = nullptr;
+  if (posix_memalign(&ptr, alignment, size) != 0)
+    return nullptr;
+  return ptr;
+}
+
+void free_aligned(void *ptr) { std::free(ptr); }
+
 } // namespace coretrace::platform
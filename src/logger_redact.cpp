@@ -0,0 +1,668 @@
+#include "logger_redact.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <deque>
+
+#if (defined(__x86_64__) || defined(_M_X64)) &&                               \
+    (defined(__GNUC__) || defined(__clang__))
+// AVX2 is compiled per function and picked at run time, so the library
+// still runs on CPUs without it.
+#define CORETRACE_REDACT_AVX2 1
+#include <immintrin.h>
+// Block helpers are folded into the loop that calls them.
+#define CORETRACE_REDACT_AVX2_INLINE                                           \
+  __attribute__((target("avx2"), always_inline)) inline
+#endif
+
+namespace coretrace::detail::redact {
+
+namespace {
+
+constexpr size_t NO_MATCH = SIZE_MAX;
+constexpr uint32_t NO_STATE = UINT32_MAX;
+
+// Atoms tried while verifying one candidate. Backtracking over several
+// open-ended repeats is polynomial in their lengths; this bounds a
+// pathological rule, which then misses that candidate.
+constexpr unsigned MAX_STEPS = 1u << 14;
+
+[[nodiscard]] bool digit(unsigned char c) { return c >= '0' && c <= '9'; }
+
+[[nodiscard]] bool word(unsigned char c) {
+  return digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         c == '_';
+}
+
+[[nodiscard]] bool space(unsigned char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+[[nodiscard]] bool hex(unsigned char c) {
+  return digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+void add_if(ByteSet &set, bool (*predicate)(unsigned char), bool negate) {
+  for (unsigned c = 0; c < 256; ++c)
+    if (predicate(static_cast<unsigned char>(c)) != negate)
+      set.add(static_cast<unsigned char>(c));
+}
+
+// \d \w \s \S \h into set; false for any other letter.
+[[nodiscard]] bool add_class(char letter, ByteSet &set) {
+  switch (letter) {
+  case 'd':
+    add_if(set, digit, false);
+    return true;
+  case 'w':
+    add_if(set, word, false);
+    return true;
+  case 's':
+    add_if(set, space, false);
+    return true;
+  case 'S':
+    add_if(set, space, true);
+    return true;
+  case 'h':
+    add_if(set, hex, false);
+    return true;
+  default:
+    return false;
+  }
+}
+
+[[nodiscard]] size_t count(const ByteSet &set) {
+  size_t n = 0;
+  for (uint64_t word : set.bits)
+    n += static_cast<size_t>(std::popcount(word));
+  return n;
+}
+
+[[nodiscard]] unsigned char only_byte(const ByteSet &set) {
+  for (unsigned c = 0; c < 256; ++c)
+    if (set.test(static_cast<unsigned char>(c)))
+      return static_cast<unsigned char>(c);
+  return 0;
+}
+
+// [set] at pattern[i], just after the '['.
+[[nodiscard]] bool parse_set(std::string_view pattern, size_t &i,
+                             ByteSet &set) {
+  bool negate = false;
+  if (i < pattern.size() && pattern[i] == '^') {
+    negate = true;
+    ++i;
+  }
+  ByteSet items;
+  bool any = false;
+  while (i < pattern.size() && pattern[i] != ']') {
+    unsigned char from = static_cast<unsigned char>(pattern[i++]);
+    if (from == '\\') {
+      if (i >= pattern.size())
+        return false;
+      if (add_class(pattern[i], items)) {
+        ++i;
+        any = true;
+        continue;
+      }
+      from = static_cast<unsigned char>(pattern[i++]);
+    }
+    unsigned char to = from;
+    if (i + 1 < pattern.size() && pattern[i] == '-' && pattern[i + 1] != ']') {
+      to = static_cast<unsigned char>(pattern[i + 1]);
+      i += 2;
+      if (to == '\\') {
+        if (i >= pattern.size())
+          return false;
+        to = static_cast<unsigned char>(pattern[i++]);
+      }
+      if (to < from)
+        return false;
+    }
+    for (unsigned c = from; c <= to; ++c)
+      items.add(static_cast<unsigned char>(c));
+    any = true;
+  }
+  if (i >= pattern.size() || !any)
+    return false;
+  ++i; // ']'
+  for (int w = 0; w < 4; ++w)
+    set.bits[w] = negate ? ~items.bits[w] : items.bits[w];
+  return true;
+}
+
+[[nodiscard]] bool parse_number(std::string_view pattern, size_t &i,
+                                uint16_t &value) {
+  if (i >= pattern.size() || !digit(static_cast<unsigned char>(pattern[i])))
+    return false;
+  uint32_t n = 0;
+  while (i < pattern.size() && digit(static_cast<unsigned char>(pattern[i]))) {
+    n = n * 10 + static_cast<uint32_t>(pattern[i] - '0');
+    if (n > MAX_REPEAT)
+      return false;
+    ++i;
+  }
+  value = static_cast<uint16_t>(n);
+  return true;
+}
+
+// ? * + {n} {n,} {n,m} at pattern[i], if any.
+[[nodiscard]] bool parse_repeat(std::string_view pattern, size_t &i,
+                                Atom &atom) {
+  if (i >= pattern.size())
+    return true;
+  switch (pattern[i]) {
+  case '?':
+    atom.min = 0;
+    ++i;
+    return true;
+  case '*':
+    atom.min = 0;
+    atom.max = MAX_REPEAT;
+    ++i;
+    return true;
+  case '+':
+    atom.max = MAX_REPEAT;
+    ++i;
+    return true;
+  case '{':
+    break;
+  default:
+    return true;
+  }
+  ++i;
+  if (!parse_number(pattern, i, atom.min))
+    return false;
+  atom.max = atom.min;
+  if (i < pattern.size() && pattern[i] == ',') {
+    ++i;
+    atom.max = MAX_REPEAT;
+    if (i < pattern.size() && pattern[i] != '}' &&
+        !parse_number(pattern, i, atom.max))
+      return false;
+  }
+  if (i >= pattern.size() || pattern[i] != '}' || atom.max < atom.min ||
+      atom.max == 0)
+    return false;
+  ++i;
+  return true;
+}
+
+[[nodiscard]] bool parse(std::string_view pattern, std::vector<Atom> &atoms) {
+  size_t i = 0;
+  while (i < pattern.size()) {
+    if (atoms.size() == MAX_ATOMS)
+      return false;
+    Atom atom;
+    const char c = pattern[i++];
+    switch (c) {
+    case '\\':
+      if (i >= pattern.size())
+        return false;
+      if (!add_class(pattern[i], atom.set))
+        atom.set.add(static_cast<unsigned char>(pattern[i]));
+      ++i;
+      break;
+    case '[':
+      if (!parse_set(pattern, i, atom.set))
+        return false;
+      break;
+    case '.':
+      for (unsigned b = 0; b < 256; ++b)
+        if (b != '\n')
+          atom.set.add(static_cast<unsigned char>(b));
+      break;
+    // Reserved so that a regular expression is not silently taken
+    // literally.
+    case '(':
+    case ')':
+    case '|':
+    case '?':
+    case '*':
+    case '+':
+    case '{':
+    case '}':
+    case ']':
+      return false;
+    default:
+      atom.set.add(static_cast<unsigned char>(c));
+      break;
+    }
+    if (!parse_repeat(pattern, i, atom))
+      return false;
+    atoms.push_back(atom);
+  }
+  return !atoms.empty();
+}
+
+[[nodiscard]] bool literal(const Atom &atom) {
+  return atom.min == 1 && atom.max == 1 && count(atom.set) == 1;
+}
+
+// Match atoms greedily from pos, towards the end of text or, Backward,
+// towards its start; a repeat gives bytes back when a later atom fails.
+// Returns the far end of the match, or NO_MATCH.
+template <bool Backward>
+size_t extend(const Atom *atoms, size_t n, std::string_view text, size_t pos,
+              unsigned &budget) {
+  if (n == 0)
+    return pos;
+  if (budget == 0)
+    return NO_MATCH;
+  --budget;
+  const Atom &atom = atoms[0];
+  const size_t room = Backward ? pos : text.size() - pos;
+  const size_t limit = std::min<size_t>(atom.max, room);
+  size_t run = 0;
+  while (run < limit &&
+         atom.set.test(static_cast<unsigned char>(
+             Backward ? text[pos - 1 - run] : text[pos + run])))
+    ++run;
+  if (run < atom.min)
+    return NO_MATCH;
+  for (size_t taken = run;; --taken) {
+    const size_t found = extend<Backward>(
+        atoms + 1, n - 1, text, Backward ? pos - taken : pos + taken, budget);
+    if (found != NO_MATCH || taken == atom.min)
+      return found;
+  }
+}
+
+// ── Start bytes ──
+
+#if defined(CORETRACE_REDACT_AVX2)
+
+CORETRACE_REDACT_AVX2_INLINE __m256i table_avx2(const uint8_t *values) {
+  return _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(values)));
+}
+
+// Bucket bits of each byte: low[byte & 15] & high[byte >> 4].
+CORETRACE_REDACT_AVX2_INLINE __m256i buckets_avx2(__m256i block, __m256i low,
+                                                  __m256i high) {
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  return _mm256_and_si256(
+      _mm256_shuffle_epi8(low, _mm256_and_si256(block, nibble)),
+      _mm256_shuffle_epi8(
+          high, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble)));
+}
+
+struct TablesAvx2 {
+  __m256i low[SHUFTI_BYTES];
+  __m256i high[SHUFTI_BYTES];
+};
+
+// Candidate offsets of the 32 starting at data, one bit each; reads
+// SHUFTI_BYTES - 1 bytes past them.
+CORETRACE_REDACT_AVX2_INLINE unsigned candidates_avx2(const unsigned char *data,
+                                                      const TablesAvx2 &t) {
+  __m256i all = _mm256_set1_epi8(-1);
+  for (size_t k = 0; k < SHUFTI_BYTES; ++k) {
+    const __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + k));
+    all = _mm256_and_si256(all, buckets_avx2(block, t.low[k], t.high[k]));
+  }
+  return ~static_cast<unsigned>(_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(all, _mm256_setzero_si256())));
+}
+
+__attribute__((target("avx2"))) size_t
+next_start_avx2(const StartSet &set, const char *data, size_t size,
+                size_t pos) noexcept {
+  const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+  TablesAvx2 tables;
+  for (size_t k = 0; k < SHUFTI_BYTES; ++k) {
+    tables.low[k] = table_avx2(set.low[k]);
+    tables.high[k] = table_avx2(set.high[k]);
+  }
+  constexpr size_t WINDOW = 32 + SHUFTI_BYTES - 1;
+  for (; pos + WINDOW <= size; pos += 32) {
+    for (unsigned mask = candidates_avx2(bytes + pos, tables); mask != 0;
+         mask &= mask - 1) {
+      const size_t at = pos + static_cast<size_t>(__builtin_ctz(mask));
+      if (set.starts_at(bytes, size, at))
+        return at;
+    }
+  }
+  if (pos >= size)
+    return size;
+
+  // The tail, short messages included, as one block padded with zeros.
+  // Offsets whose anchor would run past the end cannot match; one-byte
+  // anchors accept any byte after them, padding included.
+  unsigned char tail[WINDOW + 1] = {};
+  const size_t rest = size - pos;
+  std::memcpy(tail, bytes + pos, rest);
+  unsigned mask = candidates_avx2(tail, tables);
+  if (rest < 32)
+    mask &= (1u << rest) - 1;
+  for (; mask != 0; mask &= mask - 1) {
+    const size_t at = pos + static_cast<size_t>(__builtin_ctz(mask));
+    if (set.starts_at(bytes, size, at))
+      return at;
+  }
+  for (pos += 32; pos < size && !set.starts_at(bytes, size, pos); ++pos) {
+  }
+  return std::min(pos, size);
+}
+
+#endif
+
+using NextStartFn = size_t (*)(const StartSet &, const char *, size_t,
+                               size_t) noexcept;
+
+struct Engine {
+  NextStartFn next_start;
+  const char *name;
+};
+
+[[nodiscard]] Engine select_engine() {
+#if defined(CORETRACE_REDACT_AVX2)
+  if (__builtin_cpu_supports("avx2"))
+    return {next_start_avx2, "avx2"};
+#endif
+  return {next_start_scalar, "scalar"};
+}
+
+const Engine &engine() {
+  static const Engine selected = select_engine();
+  return selected;
+}
+
+} // namespace
+
+void StartSet::build(const std::vector<std::string> &anchors) {
+  // The shortest anchor longer than a byte bounds the bytes hashed.
+  gram = 4;
+  for (const std::string &anchor : anchors)
+    if (anchor.size() >= 2)
+      gram = std::min(gram, anchor.size());
+  gram_mask = gram == 4 ? UINT32_MAX : (uint32_t{1} << (8 * gram)) - 1;
+
+  // One-byte anchors accept any byte after them: they get a bucket of
+  // their own when there are any, so that they do not make the others'
+  // buckets accept any byte too.
+  bool has_single = false;
+  for (const std::string &anchor : anchors)
+    has_single |= anchor.size() == 1;
+  const int shared = has_single ? 7 : 8;
+  int bucket_of[256];
+  std::fill(std::begin(bucket_of), std::end(bucket_of), -1);
+  int buckets = 0;
+  for (const std::string &anchor : anchors) {
+    if (anchor.empty())
+      continue;
+    const auto *data = reinterpret_cast<const unsigned char *>(anchor.data());
+    byte[data[0]] = true;
+    int bucket = 7;
+    if (anchor.size() > 1) {
+      int &assigned = bucket_of[data[0]];
+      if (assigned < 0)
+        assigned = buckets++ % shared;
+      bucket = assigned;
+    }
+    const auto bit = static_cast<uint8_t>(1u << bucket);
+    for (size_t k = 0; k < SHUFTI_BYTES; ++k) {
+      if (k < anchor.size()) {
+        low[k][data[k] & 15] |= bit;
+        high[k][data[k] >> 4] |= bit;
+        continue;
+      }
+      for (int n = 0; n < 16; ++n) {
+        low[k][n] |= bit;
+        high[k][n] |= bit;
+      }
+    }
+    if (anchor.size() == 1) {
+      single[data[0]] = true;
+      continue;
+    }
+    const unsigned h = hash(head(data, gram));
+    grams[h >> 6] |= uint64_t{1} << (h & 63);
+  }
+}
+
+size_t next_start_scalar(const StartSet &set, const char *data, size_t size,
+                         size_t pos) noexcept {
+  const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+  for (; pos < size && !set.starts_at(bytes, size, pos); ++pos) {
+  }
+  return pos;
+}
+
+size_t next_start(const StartSet &set, const char *data, size_t size,
+                  size_t pos) noexcept {
+  return engine().next_start(set, data, size, pos);
+}
+
+const char *next_start_engine() noexcept { return engine().name; }
+
+// ── Matcher ──
+
+std::unique_ptr<Matcher> Matcher::compile(const RedactRule *rules,
+                                          size_t count) {
+  if (count == 0)
+    return nullptr;
+  auto matcher = std::make_unique<Matcher>();
+  std::vector<std::string> anchors(count);
+  std::vector<Atom> atoms;
+  for (size_t r = 0; r < count; ++r) {
+    atoms.clear();
+    if (!parse(rules[r].pattern, atoms))
+      return nullptr;
+
+    // The anchor is the longest run of single literal bytes.
+    size_t best = 0, best_len = 0;
+    for (size_t i = 0; i < atoms.size();) {
+      size_t j = i;
+      while (j < atoms.size() && literal(atoms[j]))
+        ++j;
+      if (j - i > best_len) {
+        best = i;
+        best_len = j - i;
+      }
+      i = j == i ? i + 1 : j;
+    }
+
+    Rule rule;
+    rule.replacement = std::string(rules[r].replacement);
+    rule.anchor_len = best_len;
+    if (best_len == 0) {
+      // Tried where its first class occurs, so the first atom must
+      // consume a byte.
+      if (atoms[0].min == 0)
+        return nullptr;
+      rule.first = atoms[0].set;
+      rule.after = atoms;
+      for (const Atom &atom : atoms)
+        rule.min_len += atom.min;
+      matcher->class_rules_.push_back(static_cast<uint32_t>(r));
+    } else {
+      for (size_t i = best; i < best + best_len; ++i)
+        anchors[r].push_back(static_cast<char>(only_byte(atoms[i].set)));
+      rule.before.assign(atoms.rbegin() + static_cast<ptrdiff_t>(
+                                              atoms.size() - best),
+                         atoms.rend());
+      rule.after.assign(atoms.begin() +
+                            static_cast<ptrdiff_t>(best + best_len),
+                        atoms.end());
+    }
+    matcher->rules_.push_back(std::move(rule));
+  }
+  matcher->build_automaton(anchors);
+  matcher->start_.build(anchors);
+  return matcher;
+}
+
+void Matcher::build_automaton(const std::vector<std::string> &anchors) {
+  for (const std::string &anchor : anchors)
+    for (char c : anchor) {
+      uint16_t &cls = byte_class_[static_cast<unsigned char>(c)];
+      if (cls == 0)
+        cls = static_cast<uint16_t>(classes_++);
+    }
+
+  // Trie of the anchors.
+  next_.assign(classes_, NO_STATE);
+  std::vector<std::vector<uint32_t>> outputs(1);
+  for (size_t r = 0; r < anchors.size(); ++r) {
+    if (anchors[r].empty())
+      continue;
+    uint32_t state = 0;
+    for (char c : anchors[r]) {
+      uint32_t &edge =
+          next_[state * classes_ + byte_class_[static_cast<unsigned char>(c)]];
+      if (edge == NO_STATE) {
+        edge = static_cast<uint32_t>(outputs.size());
+        outputs.emplace_back();
+        next_.resize(next_.size() + classes_, NO_STATE);
+      }
+      // next_ may have moved; reload through the index.
+      state = next_[state * classes_ +
+                    byte_class_[static_cast<unsigned char>(c)]];
+    }
+    outputs[state].push_back(static_cast<uint32_t>(r));
+  }
+
+  // Breadth first: complete every transition through the failure links
+  // and inherit the outputs of the failure state.
+  std::vector<uint32_t> fail(outputs.size(), 0);
+  std::deque<uint32_t> queue;
+  for (size_t c = 0; c < classes_; ++c) {
+    uint32_t &edge = next_[c];
+    if (edge == NO_STATE)
+      edge = 0;
+    else
+      queue.push_back(edge);
+  }
+  while (!queue.empty()) {
+    const uint32_t state = queue.front();
+    queue.pop_front();
+    const std::vector<uint32_t> &inherited = outputs[fail[state]];
+    outputs[state].insert(outputs[state].end(), inherited.begin(),
+                          inherited.end());
+    for (size_t c = 0; c < classes_; ++c) {
+      const uint32_t via_fail = next_[fail[state] * classes_ + c];
+      uint32_t &edge = next_[state * classes_ + c];
+      if (edge == NO_STATE) {
+        edge = via_fail;
+      } else {
+        fail[edge] = via_fail;
+        queue.push_back(edge);
+      }
+    }
+  }
+
+  output_start_.reserve(outputs.size() + 1);
+  for (const std::vector<uint32_t> &rules : outputs) {
+    output_start_.push_back(static_cast<uint32_t>(output_rules_.size()));
+    output_rules_.insert(output_rules_.end(), rules.begin(), rules.end());
+  }
+  output_start_.push_back(static_cast<uint32_t>(output_rules_.size()));
+}
+
+void Matcher::match_anchor(uint32_t rule, std::string_view text, size_t end,
+                           std::vector<Span> &spans) const {
+  const Rule &r = rules_[rule];
+  unsigned budget = MAX_STEPS;
+  const size_t last =
+      extend<false>(r.after.data(), r.after.size(), text, end, budget);
+  if (last == NO_MATCH)
+    return;
+  const size_t first = extend<true>(r.before.data(), r.before.size(), text,
+                                    end - r.anchor_len, budget);
+  if (first == NO_MATCH)
+    return;
+  spans.push_back({first, last, rule});
+}
+
+void Matcher::match_classes(std::string_view text,
+                            std::vector<Span> &spans) const {
+  const size_t size = text.size();
+  for (uint32_t rule : class_rules_) {
+    const Rule &r = rules_[rule];
+    const auto in_class = [&](size_t i) {
+      return r.first.test(static_cast<unsigned char>(text[i]));
+    };
+    // Runs of the first class that are long enough for the first atom
+    // cover one of every need consecutive offsets, so only those are
+    // probed. Within a run the rule is tried at every offset ("0555-1234"
+    // holds "555-1234"), moving on after a match or once the rest of the
+    // text is shorter than the rule. from keeps a run found after a match
+    // from reaching back into it.
+    const size_t need = r.after[0].min;
+    size_t from = 0;
+    for (size_t pos = need - 1; pos < size;) {
+      if (!in_class(pos)) {
+        pos += need;
+        continue;
+      }
+      size_t begin = pos;
+      while (begin > from && in_class(begin - 1))
+        --begin;
+      size_t end = pos + 1;
+      while (end < size && in_class(end))
+        ++end;
+      from = end + 1; // text[end] is not in the class
+      for (size_t start = begin;
+           start + need <= end && size - start >= r.min_len;) {
+        unsigned budget = MAX_STEPS;
+        const size_t last = extend<false>(r.after.data(), r.after.size(),
+                                          text, start, budget);
+        if (last == NO_MATCH) {
+          ++start;
+          continue;
+        }
+        spans.push_back({start, last, rule});
+        if (last >= end) {
+          from = last;
+          break;
+        }
+        start = last;
+      }
+      pos = from + need - 1;
+    }
+  }
+}
+
+bool Matcher::redact(std::string_view text, std::string &out) const {
+  std::vector<Span> spans;
+  const auto *bytes = reinterpret_cast<const unsigned char *>(text.data());
+  const size_t size = text.size();
+  uint32_t state = 0;
+  for (size_t pos = 0; pos < size; ++pos) {
+    if (state == 0) {
+      pos = next_start(start_, text.data(), size, pos);
+      if (pos == size)
+        break;
+    }
+    state = next_[state * classes_ + byte_class_[bytes[pos]]];
+    for (uint32_t i = output_start_[state]; i < output_start_[state + 1]; ++i)
+      match_anchor(output_rules_[i], text, pos + 1, spans);
+  }
+  match_classes(text, spans);
+  if (spans.empty())
+    return false;
+
+  // Leftmost first, longest first; overlapping spans merge and take the
+  // replacement of the first.
+  std::sort(spans.begin(), spans.end(), [](const Span &a, const Span &b) {
+    return a.begin != b.begin ? a.begin < b.begin : a.end > b.end;
+  });
+  out.reserve(out.size() + size);
+  size_t copied = 0;
+  for (size_t i = 0; i < spans.size();) {
+    const Span &span = spans[i];
+    size_t end = span.end;
+    for (++i; i < spans.size() && spans[i].begin < end; ++i)
+      end = std::max(end, spans[i].end);
+    out.append(text.data() + copied, span.begin - copied);
+    out.append(rules_[span.rule].replacement);
+    copied = end;
+  }
+  out.append(text.data() + copied, size - copied);
+  return true;
+}
+
+} // namespace coretrace::detail::redact
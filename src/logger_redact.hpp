@@ -0,0 +1,165 @@
+#ifndef CORETRACE_LOGGER_REDACT_HPP
+#define CORETRACE_LOGGER_REDACT_HPP
+
+#include "coretrace/logger.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Redaction of message bodies (see coretrace::set_redaction()).
+//
+// Each rule is a sequence of atoms: a literal byte or a byte class, with a
+// repeat count. The longest run of single literal bytes in a rule is its
+// anchor. The anchors of every rule are compiled into one Aho-Corasick
+// automaton that scans a message in a single pass; a hit is then extended
+// over the atoms before and after the anchor. Rules without a literal
+// (such as \d{13,19}) take a pass of their own and are tried where a run
+// of their first class is long enough.
+//
+// While the automaton is in its root state, nothing can match before the
+// next place an anchor can start (see StartSet); on CPUs with AVX2 that
+// search runs 32 bytes at a time.
+namespace coretrace::detail::redact {
+
+// Longest rule, in atoms.
+inline constexpr size_t MAX_ATOMS = 64;
+
+// Largest repeat count; also the longest stretch one atom can cover.
+inline constexpr uint16_t MAX_REPEAT = 1024;
+
+struct ByteSet {
+  uint64_t bits[4] = {};
+
+  void add(unsigned char byte) {
+    bits[byte >> 6] |= uint64_t{1} << (byte & 63);
+  }
+  [[nodiscard]] bool test(unsigned char byte) const {
+    return (bits[byte >> 6] >> (byte & 63)) & 1;
+  }
+};
+
+struct Atom {
+  ByteSet set;
+  uint16_t min = 1;
+  uint16_t max = 1;
+};
+
+// Where an anchor can start, found 32 offsets at a time with nibble
+// tables ("shufti" and "Teddy", as in Hyperscan). Each anchor is put in one
+// of eight buckets by its first byte; an offset is a candidate when, for
+// some bucket, low[k][byte & 15] & high[k][byte >> 4] has the bucket's bit
+// for each of the next SHUFTI_BYTES bytes k (any byte past the end of a
+// short anchor). A candidate is then confirmed with the lookup tables and
+// a hash of its first few bytes, so that many rules sharing first letters
+// do not stop the search on every letter.
+inline constexpr size_t SHUFTI_BYTES = 3;
+
+struct StartSet {
+  bool byte[256] = {};
+  bool single[256] = {};     // one-byte anchors
+  size_t gram = 2;           // bytes hashed per candidate, 2 to 4
+  uint32_t gram_mask = 0xffff;
+  uint64_t grams[1024] = {}; // hashes of the longer anchors' first bytes
+  uint8_t low[SHUFTI_BYTES][16] = {};
+  uint8_t high[SHUFTI_BYTES][16] = {};
+
+  // Fill the tables; empty anchors are skipped.
+  void build(const std::vector<std::string> &anchors);
+
+  [[nodiscard]] uint32_t head(const unsigned char *data, size_t size) const {
+    uint32_t value = 0;
+    if (size >= 4) {
+      std::memcpy(&value, data, 4);
+      return value & gram_mask;
+    }
+    std::memcpy(&value, data, size < gram ? size : gram);
+    return value & gram_mask;
+  }
+
+  [[nodiscard]] static unsigned hash(uint32_t head) {
+    return (head * 0x9e3779b1u) >> 16;
+  }
+
+  [[nodiscard]] bool starts_at(const unsigned char *data, size_t size,
+                               size_t pos) const {
+    const unsigned char c = data[pos];
+    if (!byte[c])
+      return false;
+    if (single[c] || size - pos < gram)
+      return true;
+    const unsigned h = hash(head(data + pos, size - pos));
+    return (grams[h >> 6] >> (h & 63)) & 1;
+  }
+};
+
+// First offset at or after pos where an anchor can start, or size.
+[[nodiscard]] size_t next_start(const StartSet &set, const char *data,
+                                size_t size, size_t pos) noexcept;
+[[nodiscard]] size_t next_start_scalar(const StartSet &set, const char *data,
+                                       size_t size, size_t pos) noexcept;
+
+// Name of the next_start() implementation in use: "avx2" or "scalar".
+[[nodiscard]] const char *next_start_engine() noexcept;
+
+class Matcher {
+public:
+  // Compile rules. Returns nullptr if a pattern is invalid (see
+  // coretrace::set_redaction() for the syntax) or there are no rules.
+  [[nodiscard]] static std::unique_ptr<Matcher> compile(const RedactRule *rules,
+                                                        size_t count);
+
+  // Append text to out with every match replaced by its rule's
+  // replacement; overlapping matches are replaced once. Returns false,
+  // leaving out untouched, when nothing matches.
+  bool redact(std::string_view text, std::string &out) const;
+
+  // Matchers replaced at runtime. A writer that loaded the pointer just
+  // before the swap may still be running it, so replaced matchers are
+  // deleted once the logger's epoch has moved on (see State::epoch).
+  Matcher *retired_next = nullptr;
+  unsigned retired_epoch = 0;
+
+private:
+  struct Rule {
+    std::vector<Atom> before; // atoms before the anchor, last first
+    std::vector<Atom> after;  // atoms after the anchor; class-only: all
+    ByteSet first;            // class-only: the class of the first atom
+    size_t min_len = 0;       // class-only: bytes of the shortest match
+    size_t anchor_len = 0;    // 0: class-only
+    std::string replacement;
+  };
+
+  struct Span {
+    size_t begin;
+    size_t end;
+    uint32_t rule;
+  };
+
+  void build_automaton(const std::vector<std::string> &anchors);
+  void match_anchor(uint32_t rule, std::string_view text, size_t end,
+                    std::vector<Span> &spans) const;
+  void match_classes(std::string_view text, std::vector<Span> &spans) const;
+
+  std::vector<Rule> rules_;
+  std::vector<uint32_t> class_rules_; // rules without an anchor
+
+  // Automaton over byte classes: bytes that occur in no anchor share
+  // class 0. State 0 is the root.
+  uint16_t byte_class_[256] = {};
+  size_t classes_ = 1;
+  std::vector<uint32_t> next_;         // state * classes_ + class
+  std::vector<uint32_t> output_start_; // per state, into output_rules_
+  std::vector<uint32_t> output_rules_; // rules whose anchor ends there
+
+  // Where the automaton can leave its root state.
+  StartSet start_;
+};
+
+} // namespace coretrace::detail::redact
+
+#endif // CORETRACE_LOGGER_REDACT_HPP
@@ -0,0 +1,447 @@
+#include "logger_sanitize.hpp"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CORETRACE_SANITIZE_SSE2 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// AVX2 is compiled per function and picked at run time, so the library
+// still runs on CPUs without it.
+#if defined(CORETRACE_SANITIZE_SSE2) &&                                        \
+    (defined(__GNUC__) || defined(__clang__))
+#define CORETRACE_SANITIZE_AVX2 1
+#include <immintrin.h>
+// Block helpers are folded into the loops that call them.
+#define CORETRACE_SANITIZE_AVX2_INLINE                                         \
+  __attribute__((target("avx2"), always_inline)) inline
+#endif
+
+namespace coretrace::detail::sanitize {
+
+namespace {
+
+[[nodiscard]] bool plain(unsigned char byte) {
+  return (byte >= 0x20 && byte < 0x7f) || byte == '\t' || byte == '\n';
+}
+
+// Length of the well-formed UTF-8 sequence at data (2-4), or 0 with the
+// length of its maximal ill-formed subpart in bad (Unicode 3.9, table
+// 3-7).
+[[nodiscard]] size_t utf8_sequence(const unsigned char *data, size_t size,
+                                   size_t &bad) {
+  const unsigned char lead = data[0];
+  size_t length;
+  unsigned char low = 0x80; // range of the second byte
+  unsigned char high = 0xbf;
+  if (lead >= 0xc2 && lead <= 0xdf) {
+    length = 2;
+  } else if (lead >= 0xe0 && lead <= 0xef) {
+    length = 3;
+    if (lead == 0xe0)
+      low = 0xa0; // overlong
+    else if (lead == 0xed)
+      high = 0x9f; // surrogates
+  } else if (lead >= 0xf0 && lead <= 0xf4) {
+    length = 4;
+    if (lead == 0xf0)
+      low = 0x90; // overlong
+    else if (lead == 0xf4)
+      high = 0x8f; // above U+10FFFF
+  } else {
+    bad = 1;
+    return 0;
+  }
+
+  for (size_t i = 1; i < length; ++i) {
+    if (i >= size || data[i] < low || data[i] > high) {
+      bad = i;
+      return 0;
+    }
+    low = 0x80;
+    high = 0xbf;
+  }
+  return length;
+}
+
+#if defined(CORETRACE_SANITIZE_SSE2)
+
+[[nodiscard]] unsigned first_bit(unsigned mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// Mask of the bytes in block that are not plain. As signed bytes, printable
+// ASCII and DEL are those above 0x1f; bytes from 0x80 are negative.
+[[nodiscard]] unsigned special_mask_sse2(__m128i block) {
+  const __m128i printable = _mm_andnot_si128(
+      _mm_cmpeq_epi8(block, _mm_set1_epi8(0x7f)),
+      _mm_cmpgt_epi8(block, _mm_set1_epi8(0x1f)));
+  const __m128i kept =
+      _mm_or_si128(printable, _mm_or_si128(
+                                  _mm_cmpeq_epi8(block, _mm_set1_epi8('\t')),
+                                  _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))));
+  return static_cast<unsigned>(_mm_movemask_epi8(kept)) ^ 0xffffu;
+}
+
+size_t ascii_run_sse2(const char *data, size_t size) noexcept {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    if (const unsigned mask = special_mask_sse2(block))
+      return i + first_bit(mask);
+  }
+  return i + ascii_run_scalar(data + i, size - i);
+}
+
+#endif
+
+#if defined(CORETRACE_SANITIZE_AVX2)
+
+__attribute__((target("avx2"))) size_t ascii_run_avx2(const char *data,
+                                                      size_t size) noexcept {
+  const __m256i del = _mm256_set1_epi8(0x7f);
+  const __m256i space = _mm256_set1_epi8(0x1f);
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i newline = _mm256_set1_epi8('\n');
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    const __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    const __m256i kept = _mm256_or_si256(
+        _mm256_andnot_si256(_mm256_cmpeq_epi8(block, del),
+                            _mm256_cmpgt_epi8(block, space)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, tab),
+                        _mm256_cmpeq_epi8(block, newline)));
+    if (const auto mask =
+            ~static_cast<unsigned>(_mm256_movemask_epi8(kept)))
+      return i + first_bit(mask);
+  }
+  // The tail stays in this function: calling out to SSE code with the
+  // upper halves of the ymm registers dirty costs a state transition.
+  if (i + 16 <= size) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    if (const unsigned mask = special_mask_sse2(block))
+      return i + first_bit(mask);
+    i += 16;
+  }
+  for (; i < size; ++i) {
+    if (!plain(static_cast<unsigned char>(data[i])))
+      break;
+  }
+  return i;
+}
+
+// ── UTF-8 blocks ─────────────────────────
+//
+// Whole-block validation for text that is not pure ASCII, after Keiser
+// and Lemire, "Validating UTF-8 in less than one instruction per byte"
+// (2021). Three 16-entry lookups, on the high and low nibble of the
+// previous byte and the high nibble of the current one, each give a set
+// of error classes the byte pair could belong to; a pair is ill-formed
+// when the three sets share a class. A third or fourth byte that is not
+// a continuation is caught by comparing against the lead two or three
+// bytes back.
+
+constexpr uint8_t TOO_SHORT = 1 << 0;      // lead, then no continuation
+constexpr uint8_t TOO_LONG = 1 << 1;       // ASCII, then a continuation
+constexpr uint8_t OVERLONG_3 = 1 << 2;     // E0 80..9F
+constexpr uint8_t TOO_LARGE = 1 << 3;      // F4 90..BF, F5..FF
+constexpr uint8_t SURROGATE = 1 << 4;      // ED A0..BF
+constexpr uint8_t OVERLONG_2 = 1 << 5;     // C0..C1
+constexpr uint8_t TOO_LARGE_1000 = 1 << 6; // F5..FF 80..8F
+constexpr uint8_t OVERLONG_4 = 1 << 6;     // F0 80..8F
+constexpr uint8_t TWO_CONTS = 1 << 7;      // continuation after one
+constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+CORETRACE_SANITIZE_AVX2_INLINE __m256i lookup(__m256i nibbles,
+                                              const uint8_t (&table)[16]) {
+  const __m128i half =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(table));
+  return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(half), nibbles);
+}
+
+// Bytes of input shifted right by N, the first N taken from the end of
+// previous.
+template <int N>
+CORETRACE_SANITIZE_AVX2_INLINE __m256i prev(__m256i input, __m256i previous) {
+  return _mm256_alignr_epi8(
+      input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - N);
+}
+
+CORETRACE_SANITIZE_AVX2_INLINE __m256i utf8_errors(__m256i input,
+                                                   __m256i previous) {
+  static constexpr uint8_t BYTE_1_HIGH[16] = {
+      TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+      TOO_LONG, TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+      TOO_SHORT | OVERLONG_2, TOO_SHORT,
+      TOO_SHORT | OVERLONG_3 | SURROGATE,
+      TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4};
+  static constexpr uint8_t BYTE_1_LOW[16] = {
+      CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+      CARRY | OVERLONG_2,
+      CARRY,
+      CARRY,
+      CARRY | TOO_LARGE,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000};
+  static constexpr uint8_t BYTE_2_HIGH[16] = {
+      TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+      TOO_SHORT, TOO_SHORT,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 |
+          OVERLONG_4,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+      TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT};
+
+  const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+  const __m256i prev1 = prev<1>(input, previous);
+  const __m256i special = _mm256_and_si256(
+      _mm256_and_si256(
+          lookup(_mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble),
+                 BYTE_1_HIGH),
+          lookup(_mm256_and_si256(prev1, low_nibble), BYTE_1_LOW)),
+      lookup(_mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble),
+             BYTE_2_HIGH));
+
+  // 0x80 where a lead two or three bytes back needs a continuation here.
+  const __m256i third = _mm256_subs_epu8(prev<2>(input, previous),
+                                         _mm256_set1_epi8(0xe0 - 0x80));
+  const __m256i fourth = _mm256_subs_epu8(prev<3>(input, previous),
+                                          _mm256_set1_epi8(0xf0 - 0x80));
+  const __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth),
+                                          _mm256_set1_epi8(char(0x80)));
+  return _mm256_xor_si256(must23, special);
+}
+
+// Bytes that clean_prefix() stops at besides ill-formed UTF-8: C0 controls
+// other than tab and newline, DEL, and the second byte of a C1 control
+// (C2 80..9F).
+CORETRACE_SANITIZE_AVX2_INLINE __m256i controls(__m256i input,
+                                                __m256i previous) {
+  const __m256i ascii = _mm256_cmpgt_epi8(input, _mm256_set1_epi8(-1));
+  const __m256i below_space = _mm256_andnot_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(input, _mm256_set1_epi8('\t')),
+                      _mm256_cmpeq_epi8(input, _mm256_set1_epi8('\n'))),
+      _mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), input));
+  const __m256i c1 = _mm256_and_si256(
+      _mm256_cmpeq_epi8(prev<1>(input, previous),
+                        _mm256_set1_epi8(char(0xc2))),
+      _mm256_cmpgt_epi8(_mm256_set1_epi8(char(0xa0)), input));
+  return _mm256_or_si256(
+      _mm256_or_si256(_mm256_and_si256(ascii, below_space),
+                      _mm256_cmpeq_epi8(input, _mm256_set1_epi8(0x7f))),
+      c1);
+}
+
+// Start of the sequence that covers offset i: a lead byte among the three
+// bytes before i whose continuations reach i, or i.
+size_t sequence_start(const unsigned char *bytes, size_t i) {
+  for (size_t back = 1; back <= 3 && back <= i; ++back) {
+    const unsigned char byte = bytes[i - back];
+    if (byte >= 0xc0)
+      return i - back;
+    if (byte < 0x80)
+      break;
+  }
+  return i;
+}
+
+// Check one block against the bytes before it. False if it has anything
+// to rewrite; otherwise incomplete tells whether it ends inside a
+// sequence. A pure-ASCII block is only wrong after one left open.
+CORETRACE_SANITIZE_AVX2_INLINE bool clean_block(__m256i input,
+                                               __m256i previous,
+                                               bool &incomplete) {
+  // The last three bytes of a block may not end a sequence.
+  const __m256i incomplete_limit = _mm256_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, char(0xf0 - 1),
+      char(0xe0 - 1), char(0xc0 - 1));
+  __m256i bad = controls(input, previous);
+  if (_mm256_movemask_epi8(input) == 0) {
+    if (incomplete || !_mm256_testz_si256(bad, bad))
+      return false;
+    incomplete = false;
+    return true;
+  }
+  bad = _mm256_or_si256(bad, utf8_errors(input, previous));
+  if (!_mm256_testz_si256(bad, bad))
+    return false;
+  const __m256i open = _mm256_subs_epu8(input, incomplete_limit);
+  incomplete = !_mm256_testz_si256(open, open);
+  return true;
+}
+
+// Length of the leading part of data (at least 32 bytes) that is clean,
+// ending on a sequence boundary, checked 32 bytes per step. Stops at the
+// first block with anything to rewrite and leaves it to the byte loop of
+// clean_prefix(). A partial last block is checked as the last 32 bytes,
+// overlapping the block before.
+__attribute__((target("avx2"))) size_t clean_blocks_avx2(const char *data,
+                                                         size_t size) noexcept {
+  const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+  __m256i previous = _mm256_setzero_si256();
+  bool incomplete = false;
+
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    const __m256i input =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    if (!clean_block(input, previous, incomplete))
+      return sequence_start(bytes, i);
+    previous = input;
+  }
+  if (i < size) {
+    // Only the three bytes before the window matter as its context; the
+    // bytes it shares with the block before are checked again.
+    const size_t at = size - 32;
+    const auto before = [&](size_t back) {
+      return static_cast<char>(at >= back ? bytes[at - back] : 0);
+    };
+    previous = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                before(3), before(2), before(1));
+    incomplete = false;
+    const __m256i input =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + at));
+    if (!clean_block(input, previous, incomplete))
+      return sequence_start(bytes, at);
+  }
+  // The data may end inside a sequence.
+  return incomplete ? sequence_start(bytes, size) : size;
+}
+
+#endif
+
+using ScanFn = size_t (*)(const char *, size_t) noexcept;
+
+// No whole-block pass: clean_prefix() starts with its byte loop.
+size_t no_blocks(const char *, size_t) noexcept { return 0; }
+
+struct Engine {
+  ScanFn scan;
+  ScanFn blocks; // leading clean blocks, UTF-8 included
+  const char *name;
+};
+
+[[nodiscard]] Engine select_engine() {
+#if defined(CORETRACE_SANITIZE_AVX2)
+  if (__builtin_cpu_supports("avx2"))
+    return {ascii_run_avx2, clean_blocks_avx2, "avx2"};
+#endif
+#if defined(CORETRACE_SANITIZE_SSE2)
+  return {ascii_run_sse2, no_blocks, "sse2"};
+#else
+  return {ascii_run_scalar, no_blocks, "scalar"};
+#endif
+}
+
+const Engine &engine() {
+  static const Engine selected = select_engine();
+  return selected;
+}
+
+// clean_prefix() from offset i, a sequence boundary: ASCII runs found by
+// scan, other sequences checked one at a time.
+size_t clean_from(const char *data, size_t size, size_t i, ScanFn scan) {
+  const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+  while (true) {
+    i += scan(data + i, size - i);
+    if (i == size || bytes[i] < 0x80)
+      return i;
+    // Well-formed UTF-8 other than a C1 control passes.
+    size_t bad = 0;
+    const size_t length = utf8_sequence(bytes + i, size - i, bad);
+    if (length == 0 || (bytes[i] == 0xc2 && bytes[i + 1] < 0xa0))
+      return i;
+    i += length;
+  }
+}
+
+} // namespace
+
+size_t ascii_run(const char *data, size_t size) noexcept {
+  // Short strings skip the dispatch.
+  if (size < 16)
+    return ascii_run_scalar(data, size);
+  return engine().scan(data, size);
+}
+
+size_t ascii_run_scalar(const char *data, size_t size) noexcept {
+  for (size_t i = 0; i < size; ++i) {
+    if (!plain(static_cast<unsigned char>(data[i])))
+      return i;
+  }
+  return size;
+}
+
+const char *ascii_run_engine() noexcept { return engine().name; }
+
+size_t clean_prefix(const char *data, size_t size) noexcept {
+  const size_t blocks = size < 32 ? 0 : engine().blocks(data, size);
+  if (blocks == size)
+    return size;
+  return clean_from(data, size, blocks, ascii_run);
+}
+
+size_t clean_prefix_scalar(const char *data, size_t size) noexcept {
+  return clean_from(data, size, 0, ascii_run_scalar);
+}
+
+size_t replace(const char *data, size_t size, size_t &consumed,
+               char *out) noexcept {
+  static constexpr char HEX[] = "0123456789abcdef";
+  const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+  const unsigned char byte = bytes[0];
+  if (byte < 0x80) {
+    consumed = 1;
+    out[0] = '\\';
+    out[1] = 'x';
+    out[2] = HEX[byte >> 4];
+    out[3] = HEX[byte & 0xf];
+    return 4;
+  }
+
+  size_t bad = 0;
+  if (utf8_sequence(bytes, size, bad) == 2) {
+    // C1 control
+    consumed = 2;
+    out[0] = '\\';
+    out[1] = 'u';
+    out[2] = '0';
+    out[3] = '0';
+    out[4] = HEX[bytes[1] >> 4];
+    out[5] = HEX[bytes[1] & 0xf];
+    return 6;
+  }
+
+  consumed = bad;
+  out[0] = '\xef'; // U+FFFD
+  out[1] = '\xbf';
+  out[2] = '\xbd';
+  return 3;
+}
+
+} // namespace coretrace::detail::sanitize
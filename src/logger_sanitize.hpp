@@ -0,0 +1,70 @@
+#ifndef CORETRACE_LOGGER_SANITIZE_HPP
+#define CORETRACE_LOGGER_SANITIZE_HPP
+
+#include <cstddef>
+#include <string_view>
+
+// Message sanitization (see coretrace::set_sanitize()).
+//
+// Printable ASCII, tab, newline and well-formed UTF-8 pass unchanged.
+// Other control bytes (C0 and DEL) become "\xHH", C1 control characters
+// (U+0080-U+009F, which some terminals act on) become "\u00HH", and each
+// maximal ill-formed UTF-8 subpart becomes U+FFFD. The search for the
+// first byte to rewrite is the hot part and is vectorized on x86-64: ASCII
+// runs with SSE2, ASCII and UTF-8 with AVX2 when the CPU has it. Clean
+// messages are never copied.
+namespace coretrace::detail::sanitize {
+
+// Length of the leading run of printable ASCII, tab and newline (size when
+// all of data is). Scans 32 (AVX2) or 16 (SSE2) bytes per step where
+// available.
+[[nodiscard]] size_t ascii_run(const char *data, size_t size) noexcept;
+
+// Byte-at-a-time reference of ascii_run().
+[[nodiscard]] size_t ascii_run_scalar(const char *data, size_t size) noexcept;
+
+// Name of the ascii_run() implementation in use: "avx2", "sse2" or
+// "scalar".
+[[nodiscard]] const char *ascii_run_engine() noexcept;
+
+// Length of the leading part of data that sanitization leaves unchanged
+// (size when it is all clean). With AVX2, UTF-8 is validated 32 bytes per
+// step as well; elsewhere, each non-ASCII sequence is checked on its own.
+[[nodiscard]] size_t clean_prefix(const char *data, size_t size) noexcept;
+
+// clean_prefix() with the byte-at-a-time scan only.
+[[nodiscard]] size_t clean_prefix_scalar(const char *data,
+                                         size_t size) noexcept;
+
+// Rewrite the bytes at data where clean_prefix() stopped (size > 0): their
+// count in consumed, the replacement in out (at most REPLACEMENT_CAPACITY
+// bytes). Returns the replacement length.
+inline constexpr size_t REPLACEMENT_CAPACITY = 6;
+size_t replace(const char *data, size_t size, size_t &consumed,
+               char *out) noexcept;
+
+// Append the sanitized contents of value to out, any type with
+// append(const char *, size_t).
+template <typename Out>
+void append_sanitized(Out &out, std::string_view value) {
+  const char *data = value.data();
+  size_t size = value.size();
+  while (size > 0) {
+    const size_t run = clean_prefix(data, size);
+    if (run > 0)
+      out.append(data, run);
+    if (run == size)
+      return;
+
+    size_t consumed = 0;
+    char replacement[REPLACEMENT_CAPACITY];
+    out.append(replacement,
+               replace(data + run, size - run, consumed, replacement));
+    data += run + consumed;
+    size -= run + consumed;
+  }
+}
+
+} // namespace coretrace::detail::sanitize
+
+#endif // CORETRACE_LOGGER_SANITIZE_HPP
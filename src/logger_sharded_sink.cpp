@@ -0,0 +1,273 @@
+#include "logger_platform.hpp"
+#include "logger_sink.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace coretrace::detail {
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+// "@" + 20 digits + " " + up to 20 digits + " "
+constexpr size_t HEADER_CAPACITY = 48;
+
+[[nodiscard]] uint64_t count_lines(const char *data, size_t size) {
+  return static_cast<uint64_t>(std::count(data, data + size, '\n'));
+}
+
+std::atomic<uint64_t> g_next_sink_id{1};
+
+// One thread's file. Only its thread writes to it; flush() and close()
+// from other threads take the (otherwise uncontended) mutex to drain it.
+struct Shard {
+  std::mutex mutex;
+  int fd = -1;
+  unsigned long long tid = 0;
+  std::unique_ptr<char[]> buffer;
+  size_t len = 0;
+  uint64_t seq = 0;
+  bool line_start = true; // the last byte written was a newline
+  SinkStats stats;
+};
+
+// Last shard used by this thread, tagged with the sink it belongs to.
+// Sink ids are never reused, so a stale entry cannot match a new sink.
+struct ShardCache {
+  uint64_t sink_id = 0;
+  Shard *shard = nullptr;
+};
+
+thread_local ShardCache t_shard_cache;
+
+// Appends each thread's records to "<base>.<tid>.log" through a private
+// buffer. A record that starts a line gets a "@<ns> <seq> " header: the
+// steady clock in nanoseconds and a per-thread sequence number, which is
+// all ct-logmerge needs to interleave the shards again. Records are found
+// by their newlines, so the logger refuses Layout::Cbor for this sink
+// (text_only). Shards are created
+// on a thread's first record (the only time the registry mutex is taken)
+// and kept until close(); a background thread drains them every
+// flush_interval.
+class ShardedSink final : public SinkBackend {
+public:
+  ShardedSink(std::string base, const ShardedSinkOptions &options)
+      : base_(std::move(base)), options_(options),
+        capacity_(options.buffer_size == 0 ? 4096 : options.buffer_size),
+        id_(g_next_sink_id.fetch_add(1, std::memory_order_relaxed)) {
+    concurrent_writes = true;
+    text_only = true;
+    if (options_.flush_interval.count() > 0)
+      worker_ = std::thread([this]() { worker_loop(); });
+  }
+
+  ~ShardedSink() override { close(); }
+
+  ShardedSink(const ShardedSink &) = delete;
+  ShardedSink &operator=(const ShardedSink &) = delete;
+
+  void write(const char *data, size_t size, Level level) override {
+    Shard *shard = local_shard();
+    if (!shard) {
+      dropped_bytes_.fetch_add(size, std::memory_order_relaxed);
+      dropped_lines_.fetch_add(count_lines(data, size),
+                               std::memory_order_relaxed);
+      return;
+    }
+
+    std::lock_guard<std::mutex> guard(shard->mutex);
+    if (shard->fd < 0) {
+      shard->stats.dropped_bytes += size;
+      shard->stats.dropped_lines += count_lines(data, size);
+      return;
+    }
+
+    if (shard->line_start && size > 0) {
+      char header[HEADER_CAPACITY];
+      const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          SteadyClock::now().time_since_epoch());
+      const int len = std::snprintf(
+          header, sizeof(header), "@%020llu %llu ",
+          static_cast<unsigned long long>(ns.count()),
+          static_cast<unsigned long long>(shard->seq++));
+      append(*shard, header, static_cast<size_t>(len));
+    }
+    append(*shard, data, size);
+    if (size > 0)
+      shard->line_start = data[size - 1] == '\n';
+
+    if (level == Level::Error && options_.flush_on_error)
+      drain(*shard);
+  }
+
+  void flush() override {
+    std::lock_guard<std::mutex> registry(registry_mutex_);
+    for (const std::unique_ptr<Shard> &shard : shards_) {
+      std::lock_guard<std::mutex> guard(shard->mutex);
+      drain(*shard);
+    }
+  }
+
+  void close() override {
+    {
+      std::lock_guard<std::mutex> registry(registry_mutex_);
+      if (closed_)
+        return;
+      closed_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable())
+      worker_.join();
+
+    std::lock_guard<std::mutex> registry(registry_mutex_);
+    for (const std::unique_ptr<Shard> &shard : shards_) {
+      std::lock_guard<std::mutex> guard(shard->mutex);
+      if (shard->fd < 0)
+        continue;
+      drain(*shard);
+      platform::close_file(shard->fd);
+      shard->fd = -1;
+      shard->buffer.reset();
+    }
+  }
+
+  SinkStats stats() const override {
+    SinkStats total;
+    total.dropped_bytes = dropped_bytes_.load(std::memory_order_relaxed);
+    total.dropped_lines = dropped_lines_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> registry(registry_mutex_);
+    for (const std::unique_ptr<Shard> &shard : shards_) {
+      std::lock_guard<std::mutex> guard(shard->mutex);
+      total.bytes_written += shard->stats.bytes_written;
+      total.syscalls += shard->stats.syscalls;
+      total.dropped_bytes += shard->stats.dropped_bytes;
+      total.dropped_lines += shard->stats.dropped_lines;
+    }
+    return total;
+  }
+
+private:
+  Shard *local_shard() {
+    ShardCache &cache = t_shard_cache;
+    if (cache.sink_id == id_)
+      return cache.shard;
+
+    const unsigned long long tid = platform::current_thread_id();
+    std::lock_guard<std::mutex> registry(registry_mutex_);
+    if (closed_)
+      return nullptr;
+
+    Shard *found = nullptr;
+    for (const std::unique_ptr<Shard> &shard : shards_) {
+      if (shard->tid == tid) {
+        found = shard.get(); // a thread id reused after its thread exited
+        break;
+      }
+    }
+
+    if (!found) {
+      const std::string path =
+          base_ + "." + std::to_string(tid) + ".log";
+      const int fd = platform::open_log_file(path.c_str(), options_.truncate);
+      if (fd < 0)
+        return nullptr;
+
+      auto shard = std::make_unique<Shard>();
+      shard->fd = fd;
+      shard->tid = tid;
+      shard->buffer = std::make_unique<char[]>(capacity_);
+      found = shard.get();
+      shards_.push_back(std::move(shard));
+    }
+
+    cache.sink_id = id_;
+    cache.shard = found;
+    return found;
+  }
+
+  void append(Shard &shard, const char *data, size_t size) {
+    if (shard.len + size > capacity_)
+      drain(shard);
+    if (size >= capacity_) {
+      write_out(shard, data, size);
+      return;
+    }
+    std::memcpy(shard.buffer.get() + shard.len, data, size);
+    shard.len += size;
+  }
+
+  void drain(Shard &shard) {
+    if (shard.len == 0)
+      return;
+    write_out(shard, shard.buffer.get(), shard.len);
+    shard.len = 0;
+  }
+
+  static void write_out(Shard &shard, const char *data, size_t size) {
+    ++shard.stats.syscalls;
+    if (platform::write_file(shard.fd, data, size)) {
+      shard.stats.bytes_written += size;
+    } else {
+      shard.stats.dropped_bytes += size;
+      shard.stats.dropped_lines += count_lines(data, size);
+    }
+  }
+
+  // ── Background thread ────────────────
+
+  void worker_loop() {
+    std::unique_lock<std::mutex> lock(registry_mutex_);
+    while (!closed_) {
+      wake_.wait_for(lock, options_.flush_interval);
+      if (closed_)
+        break;
+      for (const std::unique_ptr<Shard> &shard : shards_) {
+        std::lock_guard<std::mutex> guard(shard->mutex);
+        drain(*shard);
+      }
+    }
+  }
+
+  const std::string base_;
+  const ShardedSinkOptions options_;
+  const size_t capacity_;
+  const uint64_t id_;
+
+  // Guards shards_ and closed_; never taken on the write path once a
+  // thread knows its shard.
+  mutable std::mutex registry_mutex_;
+  std::condition_variable wake_;
+  std::thread worker_;
+  bool closed_ = false;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<uint64_t> dropped_bytes_{0}; // no shard for the thread
+  std::atomic<uint64_t> dropped_lines_{0};
+};
+
+} // namespace
+
+std::unique_ptr<SinkBackend> make_sharded_sink(
+    std::string_view base, const ShardedSinkOptions &options) {
+  std::filesystem::path dir = std::filesystem::path(base).parent_path();
+  if (dir.empty())
+    dir = ".";
+  std::error_code ec;
+  if (base.empty() || !std::filesystem::is_directory(dir, ec))
+    return nullptr;
+
+  return std::make_unique<ShardedSink>(std::string(base), options);
+}
+
+} // namespace coretrace::detail
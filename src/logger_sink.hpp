@@ -0,0 +1,135 @@
+#ifndef CORETRACE_LOGGER_SINK_HPP
+#define CORETRACE_LOGGER_SINK_HPP
+
+#include "coretrace/logger.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <source_location>
+#include <string>
+#include <string_view>
+
+namespace coretrace::detail {
+
+// A log record before rendering, for backends that frame records
+// themselves (SinkBackend::takes_records). loc is null when source
+// locations are off.
+struct Record {
+  Level level = Level::Info;
+  std::string_view module;
+  std::string_view message;
+  const std::source_location *loc = nullptr;
+  const Field *fields = nullptr; // structured log(): typed key/values
+  size_t field_count = 0;
+};
+
+// Buffer size required by field_text().
+inline constexpr size_t FIELD_TEXT_CAPACITY = 32;
+
+// Text of a field value: string values as they are, everything else
+// rendered into buf ("true"/"false", decimal, shortest round-trip float,
+// 0x-prefixed hex pointer).
+[[nodiscard]] std::string_view field_text(const Field &field, char *buf);
+
+// " key=value" as the text layout writes it (string values quoted and
+// escaped when needed).
+void append_field_text(std::string &out, const Field &field);
+
+// Built-in output destination owned by a Logger. write() receives complete
+// records (or raw low-level writes tagged Level::Info) in order; it is
+// called under the logger's output lock when thread safety is on (unless
+// concurrent_writes is set), but implementations with background threads
+// must still lock internally.
+class SinkBackend {
+public:
+  virtual ~SinkBackend() = default;
+
+  virtual void write(const char *data, size_t size, Level level) = 0;
+
+  // Push buffered bytes to the destination.
+  virtual void flush() {}
+
+  // Flush and release the destination. Later writes are dropped; the
+  // object itself stays valid until no writer can still hold it.
+  virtual void close() {}
+
+  virtual SinkStats stats() const { return {}; }
+
+  // Intrusive list of backends retired by a sink switch, and the logger
+  // epoch they were retired in.
+  SinkBackend *retired_next = nullptr;
+  unsigned retired_epoch = 0;
+
+  // write() is safe on several threads at once and keeps records whole on
+  // its own: the logger skips its output lock for this backend. Set by the
+  // constructor, never changed.
+  bool concurrent_writes = false;
+
+  // Log records (Logger::log(), write_log_line()) arrive through
+  // write_record() instead, one call each, without the rendered prefix;
+  // raw writes still use write(). Set by the constructor, never changed.
+  bool takes_records = false;
+
+  // The write() calls that make up one rendered record (a log() line or
+  // one record of a batch) are bracketed by begin_record() and
+  // end_record(); raw writes are not. Set by the constructor, never
+  // changed.
+  bool frames_records = false;
+
+  // The output is read back as lines (sharded shards and ct-logmerge): the
+  // logger keeps Layout::Cbor off while this backend is installed. Set by
+  // the constructor, never changed.
+  bool text_only = false;
+
+  // Bumped each time the backend starts a new output stream on its own (a
+  // rotated file, a restarted pipe child, a new connection), so that state
+  // kept per stream, such as CBOR name ids, starts over.
+  std::atomic<uint64_t> stream_generation{0};
+
+  virtual void write_record(const Record &record) { (void)record; }
+
+  // See frames_records.
+  virtual void begin_record() {}
+  virtual void end_record() {}
+
+  // Called under the output lock before a record of size bytes is
+  // written in one call. A backend that would start a new stream for it
+  // does so now, and the following write() does not.
+  virtual void prepare_record(size_t size) { (void)size; }
+};
+
+[[nodiscard]] std::unique_ptr<SinkBackend>
+make_file_sink(std::string_view path, const FileSinkOptions &options);
+
+// io_uring engine for make_file_sink(). Returns nullptr when io_uring
+// cannot be set up; only built with CORETRACE_LOGGER_HAS_IO_URING.
+[[nodiscard]] std::unique_ptr<SinkBackend>
+make_uring_file_sink(std::string_view path, const FileSinkOptions &options);
+
+// Compression stage in front of a file sink (FileSinkOptions::compress).
+// Returns nullptr if file is null.
+[[nodiscard]] std::unique_ptr<SinkBackend>
+make_compress_sink(std::unique_ptr<SinkBackend> file,
+                   const FileSinkOptions &options);
+
+[[nodiscard]] std::unique_ptr<SinkBackend>
+make_mmap_sink(std::string_view path, const MmapSinkOptions &options);
+
+[[nodiscard]] std::unique_ptr<SinkBackend>
+make_sharded_sink(std::string_view base, const ShardedSinkOptions &options);
+
+[[nodiscard]] std::unique_ptr<SinkBackend>
+make_pipe_sink(std::string_view command, const PipeSinkOptions &options);
+
+[[nodiscard]] std::unique_ptr<SinkBackend>
+make_syslog_sink(const SyslogSinkOptions &options);
+
+[[nodiscard]] std::unique_ptr<SinkBackend>
+make_net_sink(std::string_view host, uint16_t port,
+              const NetSinkOptions &options);
+
+} // namespace coretrace::detail
+
+#endif // CORETRACE_LOGGER_SINK_HPP
@@ -0,0 +1,268 @@
+#include "coretrace/logger.hpp"
+
+#include "logger_platform.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace coretrace {
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+// Poll period of the drain thread while stderr is full.
+constexpr int DRAIN_POLL_MS = 100;
+// How long disabling (or exit) keeps trying to write what is parked.
+constexpr std::chrono::milliseconds FINAL_DRAIN_TIMEOUT{1000};
+
+// Bytes stderr did not take yet, in arrival order. Everything below is
+// guarded by mutex; writes to the descriptor happen under it too, but
+// they never block.
+struct StderrRing {
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::thread drainer;
+  bool active = false;
+  bool stopping = false;
+  // The last write failed hard (EPIPE, EBADF): nothing is queued for the
+  // drain thread, loss reports included, until a write goes through.
+  bool broken = false;
+
+  std::unique_ptr<char[]> data;
+  size_t capacity = 0;
+  size_t head = 0; // oldest byte
+  size_t size = 0;
+
+  SinkStats stats;
+  uint64_t unreported_bytes = 0;
+  uint64_t unreported_lines = 0;
+
+  [[nodiscard]] size_t room() const { return capacity - size; }
+
+  void push(const char *bytes, size_t len) {
+    size_t tail = (head + size) % capacity;
+    size += len;
+    while (len > 0) {
+      const size_t chunk = len < capacity - tail ? len : capacity - tail;
+      std::memcpy(data.get() + tail, bytes, chunk);
+      bytes += chunk;
+      len -= chunk;
+      tail = 0;
+    }
+  }
+
+  // Write the oldest contiguous run. Returns what try_write_stderr() did.
+  long long write_some() {
+    const size_t run = size < capacity - head ? size : capacity - head;
+    ++stats.syscalls;
+    const long long written = platform::try_write_stderr(data.get() + head,
+                                                         run);
+    broken = written < 0;
+    if (written > 0) {
+      const auto n = static_cast<size_t>(written);
+      head = (head + n) % capacity;
+      size -= n;
+      stats.bytes_written += n;
+    }
+    return written;
+  }
+
+  void drop(const char *bytes, size_t len) {
+    size_t lines = 0;
+    for (size_t i = 0; i < len; ++i)
+      lines += bytes[i] == '\n' ? 1 : 0;
+    stats.dropped_bytes += len;
+    stats.dropped_lines += lines;
+    unreported_bytes += len;
+    unreported_lines += lines;
+  }
+
+  // Discard everything parked (hard error, or out of time).
+  void drop_parked() {
+    while (size > 0) {
+      const size_t run = size < capacity - head ? size : capacity - head;
+      drop(data.get() + head, run);
+      head = (head + run) % capacity;
+      size -= run;
+    }
+  }
+
+  // Queue the loss report once everything before it went out. A ring too
+  // small for the report loses it; the counters still have the totals.
+  void queue_report() {
+    char line[160];
+    const int len = std::snprintf(
+        line, sizeof(line),
+        "==ct== [WARN] stderr overflow: dropped %llu lines (%llu bytes)\n",
+        static_cast<unsigned long long>(unreported_lines),
+        static_cast<unsigned long long>(unreported_bytes));
+    if (len > 0 && static_cast<size_t>(len) <= room())
+      push(line, static_cast<size_t>(len));
+    unreported_bytes = 0;
+    unreported_lines = 0;
+  }
+};
+
+// Never destroyed: stderr may be written from static destructors.
+StderrRing &ring() {
+  static StderrRing *instance = new StderrRing;
+  return *instance;
+}
+
+std::atomic<bool> g_nonblocking{false};
+
+void drain_loop(StderrRing &r) {
+  std::unique_lock<std::mutex> lock(r.mutex);
+  while (!r.stopping) {
+    if (r.size == 0) {
+      if (r.unreported_bytes != 0 && !r.broken) {
+        r.queue_report();
+        continue;
+      }
+      r.wake.wait(lock);
+      continue;
+    }
+
+    const long long written = r.write_some();
+    if (written > 0)
+      continue;
+    if (written < 0) {
+      // Writing again at once would fail the same way: drop what is
+      // parked and let producers find out whether stderr is back.
+      r.drop_parked();
+      r.wake.wait_for(lock, std::chrono::milliseconds(DRAIN_POLL_MS));
+      continue;
+    }
+
+    lock.unlock();
+    platform::wait_stderr_writable(DRAIN_POLL_MS);
+    lock.lock();
+  }
+}
+
+// Stop the drain thread, give parked bytes a bounded last chance and
+// restore blocking mode.
+void disable_locked(StderrRing &r, std::unique_lock<std::mutex> &lock) {
+  g_nonblocking.store(false, std::memory_order_release);
+  r.active = false;
+  r.stopping = true;
+  r.wake.notify_all();
+  std::thread drainer = std::move(r.drainer);
+  lock.unlock();
+  if (drainer.joinable())
+    drainer.join();
+  lock.lock();
+
+  const SteadyClock::time_point deadline =
+      SteadyClock::now() + FINAL_DRAIN_TIMEOUT;
+  if (r.unreported_bytes != 0 && !r.broken)
+    r.queue_report();
+  while (r.size > 0 && SteadyClock::now() < deadline) {
+    const long long written = r.write_some();
+    if (written < 0)
+      break;
+    if (written == 0) {
+      lock.unlock();
+      platform::wait_stderr_writable(DRAIN_POLL_MS);
+      lock.lock();
+    }
+  }
+  r.drop_parked();
+
+  (void)platform::set_stderr_nonblocking(false);
+  r.data.reset();
+  r.capacity = 0;
+  r.head = 0;
+}
+
+void disable_at_exit() { (void)set_stderr_nonblocking(false); }
+
+} // namespace
+
+bool set_stderr_nonblocking(bool enabled, const StderrOptions &options) {
+  StderrRing &r = ring();
+  std::unique_lock<std::mutex> lock(r.mutex);
+
+  if (r.active)
+    disable_locked(r, lock);
+  if (!enabled)
+    return true;
+
+  const size_t capacity = options.overflow_bytes == 0
+                              ? size_t{4096}
+                              : options.overflow_bytes;
+  if (!platform::set_stderr_nonblocking(true))
+    return false;
+
+  static std::once_flag at_exit_flag;
+  std::call_once(at_exit_flag, []() { std::atexit(disable_at_exit); });
+
+  r.data = std::make_unique<char[]>(capacity);
+  r.capacity = capacity;
+  r.head = 0;
+  r.size = 0;
+  r.stopping = false;
+  r.broken = false;
+  r.active = true;
+  r.drainer = std::thread([&r]() { drain_loop(r); });
+  g_nonblocking.store(true, std::memory_order_release);
+  return true;
+}
+
+SinkStats stderr_stats() {
+  StderrRing &r = ring();
+  std::lock_guard<std::mutex> guard(r.mutex);
+  return r.stats;
+}
+
+void write_stderr(const char *data, size_t size) {
+  if (!g_nonblocking.load(std::memory_order_acquire)) {
+    platform::write_stderr(data, size);
+    return;
+  }
+
+  StderrRing &r = ring();
+  std::unique_lock<std::mutex> lock(r.mutex);
+  if (!r.active) {
+    lock.unlock();
+    platform::write_stderr(data, size);
+    return;
+  }
+
+  // Straight to the descriptor unless older bytes are still parked.
+  if (r.size == 0) {
+    ++r.stats.syscalls;
+    const long long written = platform::try_write_stderr(data, size);
+    if (written < 0) {
+      r.broken = true;
+      r.drop(data, size);
+      return;
+    }
+    if (r.broken) {
+      r.broken = false; // stderr is back: report what was lost
+      r.wake.notify_one();
+    }
+    r.stats.bytes_written += static_cast<uint64_t>(written);
+    data += written;
+    size -= static_cast<size_t>(written);
+    if (size == 0)
+      return;
+  }
+
+  if (size > r.room()) {
+    r.drop(data, size);
+    return;
+  }
+  r.push(data, size);
+  r.wake.notify_one();
+}
+
+} // namespace coretrace
@@ -0,0 +1,449 @@
+#include "logger_platform.hpp"
+#include "logger_sink.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace coretrace::detail {
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+constexpr const char *SYSLOG_PATH = "/dev/log";
+constexpr const char *JOURNAL_PATH = "/run/systemd/journal/socket";
+
+// A daemon that stops reading costs at most this per batch.
+constexpr int SEND_TIMEOUT_MS = 1000;
+
+// RFC 5424 structured data element of the module; 32473 is the private
+// enterprise number RFC 5612 reserves for documentation and examples.
+constexpr std::string_view SD_ID = "coretrace@32473";
+
+[[nodiscard]] int severity(Level level) {
+  switch (level) {
+  case Level::Debug:
+    return 7;
+  case Level::Info:
+    return 6;
+  case Level::Warn:
+    return 4;
+  case Level::Error:
+    return 3;
+  }
+  return 6;
+}
+
+// One encoded record inside Batch::bytes.
+struct Entry {
+  size_t offset = 0;
+  size_t size = 0;
+  bool large = false; // sent through a memfd
+};
+
+struct Batch {
+  std::string bytes;
+  std::vector<Entry> entries;
+};
+
+// journald field: KEY=value, or the binary form (KEY, newline, 64-bit
+// little-endian length, value) when the value spans lines.
+void append_field(std::string &out, std::string_view key,
+                  std::string_view value) {
+  out.append(key);
+  if (value.find('\n') == std::string_view::npos) {
+    out.push_back('=');
+    out.append(value);
+    out.push_back('\n');
+    return;
+  }
+  out.push_back('\n');
+  uint64_t size = value.size();
+  for (int i = 0; i < 8; ++i) {
+    out.push_back(static_cast<char>(size & 0xff));
+    size >>= 8;
+  }
+  out.append(value);
+  out.push_back('\n');
+}
+
+// RFC 5424 PARAM-NAME: at most 32 printable ASCII bytes other than '=',
+// ' ', ']' and '"'; anything else becomes '_'.
+void append_sd_name(std::string &out, std::string_view name) {
+  if (name.size() > 32)
+    name = name.substr(0, 32);
+  for (char c : name) {
+    const bool valid =
+        c > ' ' && c < 0x7f && c != '=' && c != ']' && c != '"';
+    out.push_back(valid ? c : '_');
+  }
+}
+
+// journald field name of a structured field: upper case letters, digits
+// and '_', starting with a letter, at most 64 bytes.
+void append_journal_name(std::string &out, std::string_view name) {
+  const size_t start = out.size();
+  if (name.empty() || !((name[0] >= 'a' && name[0] <= 'z') ||
+                        (name[0] >= 'A' && name[0] <= 'Z')))
+    out.push_back('F');
+  for (char c : name) {
+    if (out.size() - start == 64)
+      break;
+    if (c >= 'a' && c <= 'z')
+      c = static_cast<char>(c - 'a' + 'A');
+    else if (!((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')))
+      c = '_';
+    out.push_back(c);
+  }
+}
+
+// RFC 5424 PARAM-VALUE: '"', '\' and ']' are escaped.
+void append_sd_value(std::string &out, std::string_view value) {
+  for (char c : value) {
+    if (c == '"' || c == '\\' || c == ']')
+      out.push_back('\\');
+    out.push_back(c);
+  }
+}
+
+// Sends each record as one datagram to the local syslog socket. Producers
+// encode records into the active batch; a full batch (batch_size records),
+// an Error record and the flush_interval timer hand it to a background
+// thread, which sends it with sendmmsg() while producers fill the other
+// one. A producer waits only when it fills a batch before the previous
+// one is out.
+class SyslogSink final : public SinkBackend {
+public:
+  SyslogSink(int fd, std::string path, const SyslogSinkOptions &options)
+      : path_(std::move(path)), options_(options),
+        batch_size_(options.batch_size == 0 ? 1 : options.batch_size),
+        pid_(platform::process_id()), fd_(fd) {
+    takes_records = true;
+    worker_ = std::thread([this]() { worker_loop(); });
+  }
+
+  ~SyslogSink() override { close(); }
+
+  SyslogSink(const SyslogSink &) = delete;
+  SyslogSink &operator=(const SyslogSink &) = delete;
+
+  // Raw output: one record per call, at the given level, without module.
+  void write(const char *data, size_t size, Level level) override {
+    Record record;
+    record.level = level;
+    record.message = std::string_view(data, size);
+    write_record(record);
+  }
+
+  void write_record(const Record &record) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (closed_) {
+      stats_.dropped_bytes += record.message.size();
+      ++stats_.dropped_lines;
+      return;
+    }
+
+    encode_locked(record);
+    if (active_.entries.size() >= batch_size_ ||
+        (record.level == Level::Error && options_.flush_on_error))
+      handoff_locked(lock);
+  }
+
+  // Waits until every record so far was sent.
+  void flush() override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (closed_)
+      return;
+    handoff_locked(lock);
+    idle_.wait(lock, [this]() { return !busy_; });
+  }
+
+  void close() override {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (closed_)
+        return;
+      handoff_locked(lock);
+      closed_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable())
+      worker_.join();
+    if (fd_ >= 0)
+      platform::close_file(fd_);
+    fd_ = -1;
+  }
+
+  SinkStats stats() const override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return stats_;
+  }
+
+private:
+  // ── Encoding ─────────────────────────
+
+  void encode_locked(const Record &record) {
+    std::string_view message = record.message;
+    while (!message.empty() && message.back() == '\n')
+      message.remove_suffix(1);
+
+    std::string &out = active_.bytes;
+    Entry entry;
+    entry.offset = out.size();
+    if (options_.format == SyslogFormat::Journald)
+      encode_journald(out, record, message);
+    else
+      encode_rfc5424(out, record, message);
+    entry.size = out.size() - entry.offset;
+    entry.large = entry.size > options_.max_datagram;
+    active_.entries.push_back(entry);
+  }
+
+  // <PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID SD MSG, with the
+  // host left to the daemon and the message cut to max_datagram.
+  void encode_rfc5424(std::string &out, const Record &record,
+                      std::string_view message) {
+    const size_t start = out.size();
+    platform::UtcTimestamp ts;
+    char head[96];
+    int len;
+    if (platform::utc_timestamp(ts))
+      len = std::snprintf(
+          head, sizeof(head), "<%d>1 %04d-%02d-%02dT%02d:%02d:%02d.%03dZ - ",
+          options_.facility * 8 + severity(record.level), ts.year, ts.month,
+          ts.day, ts.hour, ts.minute, ts.second, ts.millisecond);
+    else
+      len = std::snprintf(head, sizeof(head), "<%d>1 - - ",
+                          options_.facility * 8 + severity(record.level));
+    out.append(head, static_cast<size_t>(len));
+    out.append(options_.ident.empty() ? std::string_view("-")
+                                      : std::string_view(options_.ident));
+    len = std::snprintf(head, sizeof(head), " %d - ", pid_);
+    out.append(head, static_cast<size_t>(len));
+
+    if (record.module.empty() && record.field_count == 0) {
+      out.push_back('-');
+    } else {
+      out.push_back('[');
+      out.append(SD_ID);
+      if (!record.module.empty()) {
+        out.append(" module=\"");
+        append_sd_value(out, record.module);
+        out.push_back('"');
+      }
+      char text[FIELD_TEXT_CAPACITY];
+      for (size_t i = 0; i < record.field_count; ++i) {
+        const Field &field = record.fields[i];
+        out.push_back(' ');
+        append_sd_name(out, field.key);
+        out.append("=\"");
+        append_sd_value(out, field_text(field, text));
+        out.push_back('"');
+      }
+      out.push_back(']');
+    }
+    out.push_back(' ');
+
+    const size_t used = out.size() - start;
+    const size_t room =
+        options_.max_datagram > used ? options_.max_datagram - used : 0;
+    if (message.size() > room) {
+      stats_.dropped_bytes += message.size() - room;
+      message = message.substr(0, room);
+    }
+    out.append(message);
+  }
+
+  void encode_journald(std::string &out, const Record &record,
+                       std::string_view message) {
+    char number[24];
+    int len = std::snprintf(number, sizeof(number), "%d",
+                            severity(record.level));
+    append_field(out, "PRIORITY",
+                 std::string_view(number, static_cast<size_t>(len)));
+    len = std::snprintf(number, sizeof(number), "%d", options_.facility);
+    append_field(out, "SYSLOG_FACILITY",
+                 std::string_view(number, static_cast<size_t>(len)));
+    if (!options_.ident.empty())
+      append_field(out, "SYSLOG_IDENTIFIER", options_.ident);
+    if (!record.module.empty())
+      append_field(out, "CORETRACE_MODULE", record.module);
+    char text[FIELD_TEXT_CAPACITY];
+    for (size_t i = 0; i < record.field_count; ++i) {
+      const Field &field = record.fields[i];
+      name_.clear();
+      append_journal_name(name_, field.key);
+      append_field(out, name_, field_text(field, text));
+    }
+    if (record.loc) {
+      append_field(out, "CODE_FILE", record.loc->file_name());
+      len = std::snprintf(number, sizeof(number), "%u",
+                          static_cast<unsigned>(record.loc->line()));
+      append_field(out, "CODE_LINE",
+                   std::string_view(number, static_cast<size_t>(len)));
+      append_field(out, "CODE_FUNC", record.loc->function_name());
+    }
+    append_field(out, "MESSAGE", message);
+  }
+
+  // Hand the active batch to the worker, waiting for the previous one.
+  void handoff_locked(std::unique_lock<std::mutex> &lock) {
+    if (active_.entries.empty())
+      return;
+    idle_.wait(lock, [this]() { return !busy_; });
+    std::swap(active_, pending_);
+    busy_ = true;
+    wake_.notify_one();
+  }
+
+  // ── Background thread ────────────────
+  //
+  // fd_ and datagrams_ belong to this thread until close() joins it.
+
+  void worker_loop() {
+    const bool timed = options_.flush_interval.count() > 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      if (!busy_ && !closed_) {
+        if (timed)
+          wake_.wait_for(lock, options_.flush_interval,
+                         [this]() { return busy_ || closed_; });
+        else
+          wake_.wait(lock, [this]() { return busy_ || closed_; });
+      }
+
+      if (!busy_ && !active_.entries.empty() && !closed_) {
+        std::swap(active_, pending_); // flush_interval elapsed
+        busy_ = true;
+      }
+
+      if (busy_) {
+        SinkStats sent;
+        lock.unlock();
+        send_batch(pending_, sent);
+        lock.lock();
+        stats_.bytes_written += sent.bytes_written;
+        stats_.syscalls += sent.syscalls;
+        stats_.dropped_bytes += sent.dropped_bytes;
+        stats_.dropped_lines += sent.dropped_lines;
+        pending_.bytes.clear();
+        pending_.entries.clear();
+        busy_ = false;
+        idle_.notify_all();
+        continue;
+      }
+
+      if (closed_)
+        break;
+    }
+  }
+
+  void send_batch(const Batch &batch, SinkStats &sent) {
+    datagrams_.clear();
+    bool reopened = false;
+    for (const Entry &entry : batch.entries) {
+      const char *data = batch.bytes.data() + entry.offset;
+      if (!entry.large) {
+        datagrams_.push_back({data, entry.size});
+        continue;
+      }
+
+      // Keep the order: what came before goes out first.
+      send_datagrams(sent, reopened);
+      datagrams_.clear();
+      if (fd_ < 0 && !reopened) {
+        reopened = true;
+        reopen();
+      }
+      sent.syscalls += 4; // memfd_create, write, seal, sendmsg
+      if (fd_ >= 0 && platform::send_memfd(fd_, data, entry.size)) {
+        sent.bytes_written += entry.size;
+      } else {
+        sent.dropped_bytes += entry.size;
+        ++sent.dropped_lines;
+      }
+    }
+    send_datagrams(sent, reopened);
+  }
+
+  // Send datagrams_, reconnecting once if the daemon went away. A datagram
+  // that fails otherwise (e.g. send timeout) is dropped.
+  void send_datagrams(SinkStats &sent, bool &reopened) {
+    const size_t count = datagrams_.size();
+    size_t done = 0;
+    while (done < count) {
+      const long long rc =
+          fd_ < 0 ? -1
+                  : platform::send_datagrams(fd_, datagrams_.data() + done,
+                                             count - done, sent.syscalls);
+      if (rc < 0) {
+        if (!reopened) {
+          reopened = true;
+          reopen();
+          continue;
+        }
+        for (; done < count; ++done) {
+          sent.dropped_bytes += datagrams_[done].size;
+          ++sent.dropped_lines;
+        }
+        break;
+      }
+
+      for (long long i = 0; i < rc; ++i)
+        sent.bytes_written += datagrams_[done++].size;
+      if (done < count) {
+        sent.dropped_bytes += datagrams_[done++].size;
+        ++sent.dropped_lines;
+      }
+    }
+  }
+
+  void reopen() {
+    if (fd_ >= 0)
+      platform::close_file(fd_);
+    fd_ = platform::open_datagram_socket(path_.c_str(), SEND_TIMEOUT_MS);
+  }
+
+  const std::string path_;
+  const SyslogSinkOptions options_;
+  const size_t batch_size_;
+  const int pid_;
+  std::string name_; // journald field name scratch, under mutex_
+  int fd_;
+  std::vector<platform::Datagram> datagrams_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_; // worker: batch handed off, closing
+  std::condition_variable idle_; // producers: worker finished a batch
+  std::thread worker_;
+  bool closed_ = false;
+  bool busy_ = false; // pending_ holds a batch being sent
+  Batch active_;
+  Batch pending_;
+  SinkStats stats_;
+};
+
+} // namespace
+
+std::unique_ptr<SinkBackend> make_syslog_sink(
+    const SyslogSinkOptions &options) {
+  std::string path = options.path;
+  if (path.empty())
+    path = options.format == SyslogFormat::Journald ? JOURNAL_PATH
+                                                     : SYSLOG_PATH;
+
+  const int fd = platform::open_datagram_socket(path.c_str(),
+                                                SEND_TIMEOUT_MS);
+  if (fd < 0)
+    return nullptr;
+  return std::make_unique<SyslogSink>(fd, std::move(path), options);
+}
+
+} // namespace coretrace::detail
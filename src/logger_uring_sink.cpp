@@ -0,0 +1,486 @@
+// io_uring engine of the file sink (Linux). Talks to the kernel through the
+// raw system calls so that no liburing dependency is needed.
+#include "logger_platform.hpp"
+#include "logger_sink.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace coretrace::detail {
+
+namespace {
+
+constexpr unsigned RING_ENTRIES = 16;
+constexpr size_t BUFFER_COUNT = 4;
+// Full buffers queued before entering the kernel on the fill path.
+constexpr unsigned SUBMIT_BATCH = 2;
+constexpr uint64_t FSYNC_TAG = ~uint64_t{0};
+
+[[nodiscard]] size_t round_up(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// ── Minimal ring ──────────────────────────
+
+// One submission queue and one completion queue shared with the kernel.
+// Not thread-safe: the owner serializes access.
+class Ring {
+public:
+  Ring() = default;
+  ~Ring() { destroy(); }
+
+  Ring(const Ring &) = delete;
+  Ring &operator=(const Ring &) = delete;
+
+  [[nodiscard]] bool init(unsigned entries) {
+    io_uring_params params{};
+    fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0)
+      return false;
+
+    sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap)
+      sq_size_ = cq_size_ = sq_size_ > cq_size_ ? sq_size_ : cq_size_;
+
+    sq_ptr_ = map(sq_size_, IORING_OFF_SQ_RING);
+    if (!sq_ptr_)
+      return false;
+    cq_ptr_ = single_mmap ? sq_ptr_ : map(cq_size_, IORING_OFF_CQ_RING);
+    if (!cq_ptr_)
+      return false;
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(map(sqes_size_, IORING_OFF_SQES));
+    if (!sqes_)
+      return false;
+
+    char *sq = static_cast<char *>(sq_ptr_);
+    sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+    char *cq = static_cast<char *>(cq_ptr_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    entries_ = params.sq_entries;
+    return true;
+  }
+
+  [[nodiscard]] bool register_buffers(const iovec *iov, unsigned count) {
+    return syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, iov,
+                   count) == 0;
+  }
+
+  // Next free submission entry, zeroed, or nullptr if the queue is full.
+  [[nodiscard]] io_uring_sqe *get_sqe() {
+    const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (local_tail_ - head >= entries_)
+      return nullptr;
+
+    const unsigned index = local_tail_ & sq_mask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    ++local_tail_;
+    return sqe;
+  }
+
+  // Publish queued entries and enter the kernel once for all of them,
+  // optionally waiting for min_complete completions.
+  int submit(unsigned min_complete) {
+    const unsigned to_submit =
+        local_tail_ - __atomic_load_n(sq_tail_, __ATOMIC_RELAXED);
+    __atomic_store_n(sq_tail_, local_tail_, __ATOMIC_RELEASE);
+
+    const unsigned flags = min_complete != 0 ? IORING_ENTER_GETEVENTS : 0;
+    int rc;
+    do {
+      rc = static_cast<int>(syscall(__NR_io_uring_enter, fd_, to_submit,
+                                    min_complete, flags, nullptr, 0));
+    } while (rc < 0 && errno == EINTR);
+    return rc;
+  }
+
+  // Pop one completion without entering the kernel.
+  [[nodiscard]] bool pop_cqe(io_uring_cqe &out) {
+    const unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+      return false;
+    out = cqes_[head & cq_mask_];
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+private:
+  [[nodiscard]] void *map(size_t size, off_t offset) const {
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd_, offset);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+  }
+
+  void destroy() {
+    if (sqes_)
+      munmap(sqes_, sqes_size_);
+    if (cq_ptr_ && cq_ptr_ != sq_ptr_)
+      munmap(cq_ptr_, cq_size_);
+    if (sq_ptr_)
+      munmap(sq_ptr_, sq_size_);
+    if (fd_ >= 0)
+      ::close(fd_);
+  }
+
+  int fd_ = -1;
+  unsigned entries_ = 0;
+  unsigned local_tail_ = 0;
+
+  void *sq_ptr_ = nullptr;
+  size_t sq_size_ = 0;
+  void *cq_ptr_ = nullptr;
+  size_t cq_size_ = 0;
+  io_uring_sqe *sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  unsigned *sq_head_ = nullptr;
+  unsigned *sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned *sq_array_ = nullptr;
+  unsigned *cq_head_ = nullptr;
+  unsigned *cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe *cqes_ = nullptr;
+};
+
+// ── Sink ──────────────────────────────────
+
+// Stages lines in a small pool of registered buffers. A full buffer (or
+// one due by flush_bytes, an Error line or the timer) is handed to the
+// kernel as one write at an explicit file offset and the producer moves on
+// to the next buffer; completions are reaped from shared memory and
+// recycle buffers. A producer only enters the kernel to submit, or to wait
+// when every buffer is still in flight.
+class UringFileSink final : public SinkBackend {
+public:
+  UringFileSink(int fd, const FileSinkOptions &options, char *memory,
+                size_t buffer_size)
+      : fd_(fd), options_(options), memory_(memory),
+        buffer_size_(buffer_size), offset_(platform::file_size(fd)) {
+    flush_threshold_ = buffer_size;
+    if (options.flush_bytes != 0 && options.flush_bytes < buffer_size)
+      flush_threshold_ = options.flush_bytes;
+
+    for (size_t i = 0; i < BUFFER_COUNT; ++i)
+      buffers_[i].data = memory_ + i * buffer_size_;
+  }
+
+  ~UringFileSink() override { close(); }
+
+  UringFileSink(const UringFileSink &) = delete;
+  UringFileSink &operator=(const UringFileSink &) = delete;
+
+  [[nodiscard]] bool init() {
+    if (!ring_.init(RING_ENTRIES))
+      return false;
+
+    // Registered buffers skip the per-write page pinning. Optional: the
+    // registration needs locked memory (RLIMIT_MEMLOCK).
+    iovec iov[BUFFER_COUNT];
+    for (size_t i = 0; i < BUFFER_COUNT; ++i)
+      iov[i] = {buffers_[i].data, buffer_size_};
+    registered_ = ring_.register_buffers(iov, BUFFER_COUNT);
+
+    ready_ = true;
+    if (options_.flush_interval.count() > 0)
+      flusher_ = std::thread([this]() { flusher_loop(); });
+    return true;
+  }
+
+  void write(const char *data, size_t size, Level level) override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (closed_) {
+      stats_.dropped_bytes += size;
+      return;
+    }
+
+    while (size > 0) {
+      Buffer &buffer = acquire_current_locked();
+      const size_t room = buffer_size_ - buffer.len;
+      const size_t chunk = size < room ? size : room;
+      std::memcpy(buffer.data + buffer.len, data, chunk);
+      buffer.len += chunk;
+      data += chunk;
+      size -= chunk;
+      if (buffer.len >= flush_threshold_)
+        submit_current_locked(false, false);
+    }
+
+    if (level == Level::Error &&
+        (options_.flush_on_error ||
+         options_.durability == FileDurability::SyncOnError))
+      submit_current_locked(
+          options_.durability == FileDurability::SyncOnError, true);
+  }
+
+  void flush() override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (closed_)
+      return;
+    submit_current_locked(options_.durability != FileDurability::None,
+                          true);
+    wait_idle_locked();
+  }
+
+  void close() override {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    if (flusher_.joinable())
+      flusher_.join();
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (closed_)
+      return;
+
+    if (ready_) {
+      submit_current_locked(options_.durability != FileDurability::None,
+                          true);
+      wait_idle_locked();
+    }
+    closed_ = true;
+
+    platform::close_file(fd_);
+    fd_ = -1;
+    platform::free_aligned(memory_);
+    memory_ = nullptr;
+  }
+
+  SinkStats stats() const override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return stats_;
+  }
+
+private:
+  struct Buffer {
+    char *data = nullptr;
+    size_t len = 0;      // staged bytes
+    size_t done = 0;     // bytes completed by the kernel
+    uint64_t offset = 0; // file offset of data[0]
+    bool in_flight = false;
+  };
+
+  // The buffer producers append to; waits for its previous write if it is
+  // still in flight.
+  Buffer &acquire_current_locked() {
+    Buffer &buffer = buffers_[current_];
+    if (!buffer.in_flight)
+      return buffer;
+
+    reap_locked();
+    while (buffer.in_flight)
+      enter_locked(1);
+    return buffer;
+  }
+
+  // Queue the current buffer (and a datasync after it). Full buffers are
+  // submitted in batches of SUBMIT_BATCH; now submits at once (flush,
+  // timer, Error line).
+  void submit_current_locked(bool sync, bool now) {
+    Buffer &buffer = buffers_[current_];
+    if (buffer.len != 0 && !buffer.in_flight) {
+      buffer.offset = offset_;
+      buffer.done = 0;
+      buffer.in_flight = true;
+      offset_ += buffer.len;
+      queue_write_locked(current_);
+      current_ = (current_ + 1) % BUFFER_COUNT;
+    }
+
+    if (sync) {
+      io_uring_sqe *sqe = next_sqe_locked();
+      sqe->opcode = IORING_OP_FSYNC;
+      sqe->flags = IOSQE_IO_DRAIN; // after every earlier write
+      sqe->fd = fd_;
+      sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+      sqe->user_data = FSYNC_TAG;
+      ++pending_syncs_;
+      ++queued_;
+    }
+
+    if (queued_ == 0)
+      return;
+
+    // When the producer's next buffer is still in flight, wait for it in
+    // the same system call.
+    reap_locked();
+    const bool next_busy = buffers_[current_].in_flight;
+    if (now || next_busy || queued_ >= SUBMIT_BATCH)
+      enter_locked(next_busy ? 1 : 0);
+  }
+
+  // Queue the remaining bytes of buffers_[index].
+  void queue_write_locked(size_t index) {
+    Buffer &buffer = buffers_[index];
+    io_uring_sqe *sqe = next_sqe_locked();
+    sqe->opcode = registered_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer.data + buffer.done);
+    sqe->len = static_cast<uint32_t>(buffer.len - buffer.done);
+    sqe->off = buffer.offset + buffer.done;
+    if (registered_)
+      sqe->buf_index = static_cast<uint16_t>(index);
+    sqe->user_data = index;
+    ++queued_;
+  }
+
+  io_uring_sqe *next_sqe_locked() {
+    io_uring_sqe *sqe = ring_.get_sqe();
+    while (!sqe) {
+      enter_locked(1); // submission queue full: let the kernel catch up
+      sqe = ring_.get_sqe();
+    }
+    return sqe;
+  }
+
+  void enter_locked(unsigned min_complete) {
+    ++stats_.syscalls;
+    ring_.submit(min_complete);
+    queued_ = 0;
+    reap_locked();
+  }
+
+  void reap_locked() {
+    io_uring_cqe cqe;
+    while (ring_.pop_cqe(cqe)) {
+      if (cqe.user_data == FSYNC_TAG) {
+        --pending_syncs_;
+        continue;
+      }
+
+      const size_t index = static_cast<size_t>(cqe.user_data);
+      Buffer &buffer = buffers_[index];
+      if (cqe.res > 0 &&
+          buffer.done + static_cast<size_t>(cqe.res) < buffer.len) {
+        buffer.done += static_cast<size_t>(cqe.res); // short write
+        queue_write_locked(index);
+        continue;
+      }
+
+      if (cqe.res < 0 || (cqe.res == 0 && buffer.done < buffer.len)) {
+        stats_.bytes_written += buffer.done;
+        stats_.dropped_bytes += buffer.len - buffer.done;
+      } else {
+        stats_.bytes_written += buffer.len;
+      }
+      buffer.len = 0;
+      buffer.done = 0;
+      buffer.in_flight = false;
+    }
+  }
+
+  [[nodiscard]] bool busy_locked() const {
+    if (pending_syncs_ != 0)
+      return true;
+    for (const Buffer &buffer : buffers_)
+      if (buffer.in_flight)
+        return true;
+    return false;
+  }
+
+  void wait_idle_locked() {
+    reap_locked();
+    while (busy_locked())
+      enter_locked(1);
+  }
+
+  void flusher_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+      wake_.wait_for(lock, options_.flush_interval);
+      if (stopping_)
+        break;
+
+      submit_current_locked(
+          options_.durability == FileDurability::SyncInterval, true);
+    }
+  }
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::thread flusher_;
+  bool stopping_ = false;
+  bool closed_ = false;
+
+  int fd_;
+  FileSinkOptions options_;
+  Ring ring_;
+  bool ready_ = false; // ring set up by init()
+  bool registered_ = false;
+
+  char *memory_;
+  const size_t buffer_size_;
+  size_t flush_threshold_ = 0;
+  Buffer buffers_[BUFFER_COUNT];
+  size_t current_ = 0;
+  size_t pending_syncs_ = 0;
+  unsigned queued_ = 0; // entries queued since the last system call
+
+  uint64_t offset_; // next file offset to write
+  SinkStats stats_;
+};
+
+} // namespace
+
+std::unique_ptr<SinkBackend>
+make_uring_file_sink(std::string_view path, const FileSinkOptions &options) {
+  const std::string path_z(path);
+
+  // Every buffer of the pool has the configured size.
+  const size_t page = platform::page_size();
+  const size_t buffer_size =
+      round_up(options.buffer_size == 0 ? page : options.buffer_size, page);
+
+  auto *memory = static_cast<char *>(
+      platform::allocate_aligned(page, buffer_size * BUFFER_COUNT));
+  if (!memory)
+    return nullptr;
+
+  // Writes carry explicit offsets (no O_APPEND): completions may arrive
+  // out of order, the file contents may not.
+  int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+  if (options.truncate)
+    flags |= O_TRUNC;
+  int fd;
+  do {
+    fd = open(path_z.c_str(), flags, 0644);
+  } while (fd < 0 && errno == EINTR);
+  if (fd < 0) {
+    platform::free_aligned(memory);
+    return nullptr;
+  }
+
+  auto sink =
+      std::make_unique<UringFileSink>(fd, options, memory, buffer_size);
+  if (!sink->init())
+    return nullptr; // the destructor closes fd and frees memory
+  return sink;
+}
+
+} // namespace coretrace::detail
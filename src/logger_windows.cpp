@@ -6,6 +6,9 @@
 #include <cstdio>
 #include <ctime>
 #include <limits>
+#include <malloc.h>
+
+#include <fcntl.h>
 
 #ifndef NOMINMAX
 #define NOMINMAX
@@ -56,6 +59,16 @@ void write_stderr(const char *data, size_t size) {
   }
 }
 
+// Console and pipe handles have no usable non-blocking mode.
+bool set_stderr_nonblocking(bool) { return false; }
+
+[[nodiscard]] long long try_write_stderr(const char *data, size_t size) {
+  write_stderr(data, size);
+  return static_cast<long long>(size);
+}
+
+void wait_stderr_writable(int) {}
+
 [[nodiscard]] int process_id() { return static_cast<int>(GetCurrentProcessId()); }
 
 [[nodiscard]] unsigned long long current_thread_id() {
@@ -85,4 +98,219 @@ void write_stderr(const char *data, size_t size) {
   return true;
 }
 
+[[nodiscard]] bool realtime_ns(uint64_t &out) {
+  const auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch());
+  if (since_epoch.count() < 0)
+    return false;
+
+  out = static_cast<uint64_t>(since_epoch.count());
+  return true;
+}
+
+[[nodiscard]] int open_log_file(const char *path, bool truncate) {
+  // FILE_SHARE_DELETE lets rotation rename the file while it is open, as
+  // on POSIX. The handle is not inheritable (no security attributes).
+  HANDLE handle =
+      CreateFileA(path, truncate ? GENERIC_WRITE : FILE_APPEND_DATA,
+                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                  nullptr, truncate ? CREATE_ALWAYS : OPEN_ALWAYS,
+                  FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (handle == INVALID_HANDLE_VALUE)
+    return -1;
+
+  const int flags = _O_BINARY | (truncate ? 0 : _O_APPEND);
+  const int fd = _open_osfhandle(reinterpret_cast<intptr_t>(handle), flags);
+  if (fd < 0)
+    CloseHandle(handle);
+  return fd;
+}
+
+bool write_file(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    const size_t chunk =
+        std::min(size, static_cast<size_t>((std::numeric_limits<int>::max)()));
+    const int written = _write(fd, data, static_cast<unsigned int>(chunk));
+    if (written <= 0)
+      return false;
+    data += static_cast<size_t>(written);
+    size -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+void sync_file_data(int fd) { (void)_commit(fd); }
+
+void preallocate_file(int, uint64_t, uint64_t) {}
+
+[[nodiscard]] uint64_t file_size(int fd) {
+  const __int64 size = _filelengthi64(fd);
+  return size < 0 ? 0 : static_cast<uint64_t>(size);
+}
+
+bool resize_file(int fd, uint64_t size) {
+  return _chsize_s(fd, static_cast<__int64>(size)) == 0;
+}
+
+void close_file(int fd) { (void)_close(fd); }
+
+[[nodiscard]] int open_direct_file(const char *path, bool truncate) {
+  HANDLE handle =
+      CreateFileA(path, GENERIC_READ | GENERIC_WRITE,
+                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                  nullptr, truncate ? CREATE_ALWAYS : OPEN_ALWAYS,
+                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING, nullptr);
+  if (handle == INVALID_HANDLE_VALUE)
+    return -1;
+
+  const int fd = _open_osfhandle(reinterpret_cast<intptr_t>(handle), _O_BINARY);
+  if (fd < 0)
+    CloseHandle(handle);
+  return fd;
+}
+
+// Sector sizes divide the page size on all supported volumes.
+[[nodiscard]] size_t direct_io_alignment() { return page_size(); }
+
+bool write_file_at(int fd, const char *data, size_t size, uint64_t offset) {
+  HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+  while (size > 0) {
+    const DWORD chunk = static_cast<DWORD>(
+        std::min(size, static_cast<size_t>(1u << 30)));
+    OVERLAPPED ov = {};
+    ov.Offset = static_cast<DWORD>(offset & 0xffffffffu);
+    ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD written = 0;
+    if (!WriteFile(handle, data, chunk, &written, &ov) || written == 0)
+      return false;
+    data += written;
+    size -= written;
+    offset += written;
+  }
+  return true;
+}
+
+[[nodiscard]] long long read_file_at(int fd, char *data, size_t size,
+                                     uint64_t offset) {
+  HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+  OVERLAPPED ov = {};
+  ov.Offset = static_cast<DWORD>(offset & 0xffffffffu);
+  ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+  DWORD got = 0;
+  const DWORD chunk =
+      static_cast<DWORD>(std::min(size, static_cast<size_t>(1u << 30)));
+  if (!ReadFile(handle, data, chunk, &got, &ov))
+    return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+  return static_cast<long long>(got);
+}
+
+void start_file_writeback(int, uint64_t, uint64_t) {}
+
+void drop_file_cache(int, uint64_t, uint64_t) {}
+
+[[nodiscard]] int open_map_file(const char *path, bool truncate) {
+  HANDLE handle =
+      CreateFileA(path, GENERIC_READ | GENERIC_WRITE,
+                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                  nullptr, truncate ? CREATE_ALWAYS : OPEN_ALWAYS,
+                  FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (handle == INVALID_HANDLE_VALUE)
+    return -1;
+
+  const int fd = _open_osfhandle(reinterpret_cast<intptr_t>(handle), _O_BINARY);
+  if (fd < 0)
+    CloseHandle(handle);
+  return fd;
+}
+
+[[nodiscard]] size_t map_granularity() {
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return static_cast<size_t>(info.dwAllocationGranularity);
+}
+
+[[nodiscard]] void *map_file(int fd, uint64_t offset, size_t length) {
+  HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+  if (file == INVALID_HANDLE_VALUE)
+    return nullptr;
+
+  // The view keeps the mapping object alive after its handle is closed.
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+  if (mapping == nullptr)
+    return nullptr;
+
+  void *addr = MapViewOfFile(mapping, FILE_MAP_WRITE,
+                             static_cast<DWORD>(offset >> 32),
+                             static_cast<DWORD>(offset & 0xffffffffu), length);
+  CloseHandle(mapping);
+  return addr;
+}
+
+void unmap_file(void *addr, size_t) { (void)UnmapViewOfFile(addr); }
+
+// FlushViewOfFile() only queues the writes; waiting would need the file
+// handle (FlushFileBuffers), which callers sync separately.
+void flush_mapping(void *addr, size_t length, bool) {
+  (void)FlushViewOfFile(addr, length);
+}
+
+// Unlocking pages that are not locked removes them from the working set.
+void discard_mapping(void *addr, size_t length) {
+  (void)VirtualUnlock(addr, length);
+}
+
+// Piped children are not supported: the pipe sink reports failure.
+[[nodiscard]] bool spawn_piped_child(const char *, int &, int &) {
+  return false;
+}
+
+bool reap_child(int) { return true; }
+
+void kill_child(int) {}
+
+[[nodiscard]] long long write_pipe(int, const char *, size_t) { return -1; }
+
+[[nodiscard]] bool pipe_zero_copy() { return false; }
+
+[[nodiscard]] size_t pipe_unread_bytes(int) { return 0; }
+
+void wait_pipe_writable(int, int) {}
+
+void block_sigpipe() {}
+
+void discard_sigpipe() {}
+
+// No local syslog socket: the syslog sink reports failure.
+[[nodiscard]] int open_datagram_socket(const char *, int) { return -1; }
+
+[[nodiscard]] long long send_datagrams(int, const Datagram *, size_t,
+                                       uint64_t &) {
+  return -1;
+}
+
+bool send_memfd(int, const char *, size_t) { return false; }
+
+[[nodiscard]] bool sockets_available() { return false; }
+
+[[nodiscard]] int connect_socket(const char *, unsigned, bool, int, int) {
+  return -1;
+}
+
+[[nodiscard]] long long send_stream(int, const Datagram *, size_t) {
+  return -1;
+}
+
+[[nodiscard]] size_t page_size() {
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return static_cast<size_t>(info.dwPageSize);
+}
+
+[[nodiscard]] void *allocate_aligned(size_t alignment, size_t size) {
+  return _aligned_malloc(size, alignment);
+}
+
+void free_aligned(void *ptr) { _aligned_free(ptr); }
+
 } // namespace coretrace::platform
@@ -0,0 +1,79 @@
+#include <coretrace/basic_logger.hpp>
+
+#include <cstdio>
+#include <string>
+#include <type_traits>
+
+namespace {
+
+std::string g_capture;
+int g_sink_calls = 0;
+
+void capture_sink(const char *data, size_t size) {
+  g_capture.append(data, size);
+  ++g_sink_calls;
+}
+
+struct ShortPolicy
+    : coretrace::StaticPolicy<false, true, false, false,
+                              coretrace::Layout::Short> {
+  static constexpr coretrace::Level min_level = coretrace::Level::Debug;
+};
+
+struct TaggedPolicy : coretrace::StaticPolicy<> {
+  static constexpr std::string_view prefix = "==alloc==";
+  static constexpr coretrace::Level min_level = coretrace::Level::Warn;
+};
+
+bool contains(const char *needle) {
+  return g_capture.find(needle) != std::string::npos;
+}
+
+} // namespace
+
+static_assert(
+    std::is_same_v<coretrace::Logger,
+                   coretrace::BasicLogger<coretrace::RuntimePolicy>>);
+
+int main() {
+  using namespace coretrace;
+
+  BasicLogger<ShortPolicy> short_log(capture_sink);
+  short_log.log(Level::Error, "disabled by default\n");
+  short_log.enable();
+
+  // Layout::Short: no PID, no prefix; source location compiled in.
+  short_log.log(Level::Debug, Module("alloc"), "size={}\n", 64);
+  const bool short_ok =
+      g_capture.rfind("[DEBUG] test_basic_logger.cpp:", 0) == 0 &&
+      contains(" (alloc) size=64\n") && !contains("|") && g_sink_calls == 1;
+
+  g_capture.clear();
+  g_sink_calls = 0;
+
+  BasicLogger<TaggedPolicy> tagged(capture_sink);
+  tagged.enable();
+  tagged.log(Level::Info, "info below policy floor\n");
+  tagged.log(Level::Warn, "warn {}\n", "kept");
+
+  // A message larger than the line buffer moves to the heap and still
+  // reaches the sink in one call.
+  const std::string big(2000, 'x');
+  g_sink_calls = 0;
+  tagged.log(Level::Error, "{}\n", big);
+  const bool big_whole = g_sink_calls == 1;
+
+  const bool tagged_ok = contains("==alloc== [WARN] warn kept\n") &&
+                         !contains("below policy floor") &&
+                         !contains("\x1b[") && big_whole &&
+                         contains(("[ERROR] " + big + "\n").c_str());
+
+  if (!short_ok || !tagged_ok) {
+    std::fprintf(stderr, "short_ok=%d tagged_ok=%d calls=%d\n%s\n",
+                 short_ok ? 1 : 0, tagged_ok ? 1 : 0, g_sink_calls,
+                 g_capture.c_str());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,65 @@
+#include <coretrace/logger.hpp>
+
+#include <cstdio>
+#include <string>
+
+namespace {
+
+std::string g_capture;
+
+void capture_sink(const char *data, size_t size) {
+  g_capture.append(data, size);
+}
+
+// Formatting this (one argument for two fields) throws and emits the
+// fallback line, which reveals whether a filtered call was formatted.
+constexpr const char *BAD_FORMAT = "{} {}\n";
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+
+  Logger logger;
+  logger.set_sink(capture_sink);
+
+  // Disabled: the inline pre-filter rejects every level.
+  const bool disabled_ok =
+      !logger.may_log(Level::Error) && !logger.may_log(Level::Debug);
+  logger.log(Level::Error, BAD_FORMAT, 1);
+
+  logger.enable();
+  logger.set_min_level(Level::Warn);
+  const bool level_ok = !logger.may_log(Level::Info) &&
+                        logger.may_log(Level::Warn) &&
+                        logger.may_log(Level::Error);
+  logger.log(Level::Info, BAD_FORMAT, 1);
+
+  // Module filtering happens behind the pre-filter, before formatting.
+  logger.enable_module("alloc");
+  logger.log(Level::Warn, Module("net"), BAD_FORMAT, 1);
+
+  const bool nothing_formatted = g_capture.empty();
+
+  logger.log(Level::Warn, Module("alloc"), "passed={}\n", 1);
+  logger.log(Level::Error, BAD_FORMAT, 1);
+
+  logger.disable();
+  const bool off_ok = !logger.may_log(Level::Error);
+
+  const bool output_ok =
+      g_capture.find("(alloc) passed=1\n") != std::string::npos &&
+      g_capture.find("coretrace: log format error\n") != std::string::npos;
+
+  if (!disabled_ok || !level_ok || !off_ok || !nothing_formatted ||
+      !output_ok) {
+    std::fprintf(stderr,
+                 "disabled=%d level=%d off=%d silent=%d output=%d\n%s\n",
+                 disabled_ok ? 1 : 0, level_ok ? 1 : 0, off_ok ? 1 : 0,
+                 nothing_formatted ? 1 : 0, output_ok ? 1 : 0,
+                 g_capture.c_str());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,185 @@
+#include <coretrace/logger.hpp>
+
+#include "logger_cbor.hpp"
+
+#include <cstdio>
+#include <string>
+
+namespace {
+
+std::string g_capture;
+std::string g_other;
+
+void capture_sink(const char *data, size_t size) {
+  g_capture.append(data, size);
+}
+
+void other_sink(const char *data, size_t size) { g_other.append(data, size); }
+
+// Decoder of the stream written to capture_sink: definitions seen in
+// earlier chunks stay known.
+coretrace::detail::cbor::TextDecoder g_decoder;
+
+// Decode a chunk of whole items; false if any item is incomplete.
+bool decode(const std::string &stream, std::string &text,
+            coretrace::detail::cbor::TextDecoder &decoder = g_decoder) {
+  using Result = coretrace::detail::cbor::TextDecoder::Result;
+  size_t at = 0;
+  while (at < stream.size()) {
+    size_t consumed = 0;
+    if (decoder.next(stream.data() + at, stream.size() - at, consumed,
+                     text) != Result::Item)
+      return false;
+    at += consumed;
+  }
+  return true;
+}
+
+std::string head(coretrace::Level level) {
+  return "|" + std::to_string(coretrace::pid()) + "| ==ct== [" +
+         std::string(coretrace::level_label(level)) + "]";
+}
+
+size_t count(const std::string &text, const std::string &needle) {
+  size_t n = 0;
+  for (size_t at = text.find(needle); at != std::string::npos;
+       at = text.find(needle, at + 1))
+    ++n;
+  return n;
+}
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+  namespace cbor = detail::cbor;
+
+  set_sink(capture_sink);
+  enable_logging();
+  set_layout(Layout::Cbor);
+
+  // ── Records ──────────────────────────
+  log(Level::Info, "hello {}\n", "world");
+  std::string text;
+  const bool basic_ok = decode(g_capture, text) &&
+                        text == head(Level::Info) + " hello world\n" &&
+                        static_cast<unsigned char>(g_capture[0]) == 0xa2;
+
+  g_capture.clear();
+  set_source_location(true);
+  const int line = __LINE__ + 1;
+  log(Level::Warn, Module("alloc"), "q\"b\n");
+  set_source_location(false);
+  text.clear();
+  const bool location_ok =
+      decode(g_capture, text) &&
+      text == head(Level::Warn) + " test_cbor_layout.cpp:" +
+                  std::to_string(line) + " (alloc) q\"b\n";
+
+  g_capture.clear();
+  log(Level::Info, "m", kv("size", 64), kv("neg", -3), kv("ok", false),
+      kv("r", 0.25), kv("name", "a b"), kv("p", reinterpret_cast<void *>(16)));
+  text.clear();
+  const bool structured_ok =
+      decode(g_capture, text) &&
+      text == head(Level::Info) +
+                  " m size=64 neg=-3 ok=false r=0.25 name=\"a b\" p=0x10\n";
+
+  // ── Interning ────────────────────────
+  // Names are defined once per stream; later records carry their ids.
+  g_capture.clear();
+  for (int i = 0; i < 100; ++i)
+    log(Level::Info, Module("alloc"), "n {}\n", i);
+  text.clear();
+  const bool interned_ok = decode(g_capture, text) &&
+                           count(g_capture, "alloc") == 0 &&
+                           count(text, "(alloc) n ") == 100;
+
+  // Much smaller than the text layout of the same records.
+  set_timestamps(true);
+  set_source_location(true);
+  g_capture.clear();
+  for (int i = 0; i < 100; ++i)
+    log(Level::Info, Module("alloc"), "n {}\n", i);
+  const size_t cbor_size = g_capture.size();
+  text.clear();
+  const bool decoded = decode(g_capture, text);
+  set_layout(Layout::Text);
+  g_capture.clear();
+  for (int i = 0; i < 100; ++i)
+    log(Level::Info, Module("alloc"), "n {}\n", i);
+  const bool size_ok = decoded && cbor_size * 2 < g_capture.size();
+  set_layout(Layout::Cbor);
+  set_timestamps(false);
+  set_source_location(false);
+
+  // A new sink starts a new stream that decodes on its own.
+  set_sink(other_sink);
+  log(Level::Info, Module("alloc"), "o\n");
+  text.clear();
+  cbor::TextDecoder other_decoder;
+  const bool restart_ok = decode(g_other, text, other_decoder) &&
+                          text == head(Level::Info) + " (alloc) o\n";
+  set_sink(capture_sink);
+  g_decoder = cbor::TextDecoder();
+
+  // Timestamps are nanoseconds, decoded to the text timestamp.
+  g_capture.clear();
+  set_timestamps(true);
+  log(Level::Info, "t\n");
+  set_timestamps(false);
+  text.clear();
+  const bool ts_ok = decode(g_capture, text) && text.size() > 26 &&
+                     text[0] == '[' && text[11] == 'T' &&
+                     text.compare(26, std::string::npos,
+                                  head(Level::Info) + " t\n") == 0;
+
+  // Long messages go out in several pieces and still decode.
+  g_capture.clear();
+  const std::string big(5000, 'x');
+  log(Level::Error, "{}", big);
+  text.clear();
+  const bool long_ok =
+      decode(g_capture, text) && text == head(Level::Error) + " " + big + "\n";
+
+  // ── Batches ──────────────────────────
+  g_capture.clear();
+  {
+    LogBatch batch(Level::Info, Module("b"));
+    batch.add("a {}\n", 1);
+    batch.add_line("b\n");
+  }
+  text.clear();
+  const bool batch_ok = decode(g_capture, text) &&
+                        text == head(Level::Info) + " (b) a 1\n" +
+                                    head(Level::Info) + " (b) b\n";
+
+  // ── Damage ───────────────────────────
+  size_t consumed = 0;
+  cbor::TextDecoder decoder;
+  const std::string record = g_capture;
+  const bool damage_ok =
+      decoder.next(record.data(), 3, consumed, text) ==
+          cbor::TextDecoder::Result::NeedMore &&
+      decoder.next("\xff", 1, consumed, text) ==
+          cbor::TextDecoder::Result::Malformed;
+
+  const bool color_ok = color(Color::Red).empty();
+
+  set_layout(Layout::Text);
+  reset_sink();
+
+  if (!basic_ok || !location_ok || !structured_ok || !interned_ok ||
+      !size_ok || !restart_ok || !ts_ok || !long_ok || !batch_ok ||
+      !damage_ok || !color_ok) {
+    std::fprintf(stderr,
+                 "basic=%d line=%d structured=%d interned=%d size=%d "
+                 "restart=%d ts=%d long=%d batch=%d damage=%d color=%d\n"
+                 "  last: %.300s\n",
+                 basic_ok, location_ok, structured_ok, interned_ok, size_ok,
+                 restart_ok, ts_ok, long_ok, batch_ok, damage_ok, color_ok,
+                 text.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,179 @@
+#include <coretrace/logger.hpp>
+
+#include "logger_lz.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace lz = coretrace::detail::lz;
+
+std::string read_file(const std::filesystem::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream out;
+  out << in.rdbuf();
+  return out.str();
+}
+
+size_t count_of(const std::string &haystack, const char *needle) {
+  size_t count = 0;
+  for (size_t pos = haystack.find(needle); pos != std::string::npos;
+       pos = haystack.find(needle, pos + 1))
+    ++count;
+  return count;
+}
+
+bool round_trips(const std::string &input) {
+  std::vector<char> frame(lz::FRAME_HEADER_SIZE +
+                          lz::compress_bound(input.size()));
+  const size_t size = lz::encode_frame(input.data(), input.size(),
+                                       frame.data());
+  lz::FrameHeader header;
+  if (!lz::read_frame_header(frame.data(), header) ||
+      header.raw_size != input.size() ||
+      size != lz::FRAME_HEADER_SIZE + header.payload_size)
+    return false;
+
+  std::string output(input.size(), '\0');
+  const char *payload = frame.data() + lz::FRAME_HEADER_SIZE;
+  if (header.payload_size == header.raw_size)
+    output.assign(payload, header.raw_size);
+  else if (!lz::decompress(payload, header.payload_size, output.data(),
+                           output.size()))
+    return false;
+  return output == input &&
+         lz::checksum(output.data(), output.size()) == header.checksum;
+}
+
+// Decode every frame of a file; stops (ok = false) at the first bad one.
+std::string unpack(const std::string &file, bool &ok, size_t &frames) {
+  std::string text;
+  ok = true;
+  frames = 0;
+  size_t pos = 0;
+  while (pos < file.size()) {
+    lz::FrameHeader header;
+    if (file.size() - pos < lz::FRAME_HEADER_SIZE ||
+        !lz::read_frame_header(file.data() + pos, header) ||
+        file.size() - pos - lz::FRAME_HEADER_SIZE < header.payload_size) {
+      ok = false;
+      break;
+    }
+
+    const char *payload = file.data() + pos + lz::FRAME_HEADER_SIZE;
+    std::string raw(header.raw_size, '\0');
+    if (header.payload_size == header.raw_size)
+      raw.assign(payload, header.raw_size);
+    else if (!lz::decompress(payload, header.payload_size, raw.data(),
+                             raw.size()))
+      ok = false;
+    if (!ok || lz::checksum(raw.data(), raw.size()) != header.checksum) {
+      ok = false;
+      break;
+    }
+
+    text += raw;
+    pos += lz::FRAME_HEADER_SIZE + header.payload_size;
+    ++frames;
+  }
+  return text;
+}
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+
+  // ── Codec ─────────────────────────────
+  std::mt19937 rng(42);
+  std::string noise(100000, '\0');
+  for (char &c : noise)
+    c = static_cast<char>(rng());
+  std::string text;
+  for (int i = 0; i < 2000; ++i)
+    text += "[INFO] request " + std::to_string(i % 37) + " served\n";
+
+  const bool codec_ok = round_trips("") && round_trips("abc") &&
+                        round_trips(std::string(100000, 'a')) &&
+                        round_trips(noise) && round_trips(text) &&
+                        round_trips(text + noise + text);
+
+  // Damaged input never decodes out of bounds (the frame checksum catches
+  // what still decodes); a cut block is rejected.
+  std::vector<char> packed(lz::compress_bound(text.size()));
+  const size_t packed_size = lz::compress(text.data(), text.size(),
+                                          packed.data());
+  std::string out(text.size(), '\0');
+  for (size_t i = 0; i < 200; ++i) {
+    std::vector<char> bad(packed.begin(), packed.begin() + packed_size);
+    bad[rng() % bad.size()] ^= static_cast<char>(1 + rng() % 255);
+    (void)lz::decompress(bad.data(), bad.size(), out.data(), out.size());
+  }
+  const bool damage_ok =
+      packed_size < text.size() / 4 &&
+      !lz::decompress(packed.data(), packed_size / 2, out.data(), out.size());
+
+  // ── Sink ──────────────────────────────
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "coretrace_test_compress.log";
+  std::filesystem::remove(path);
+
+  Logger logger;
+  logger.enable();
+  logger.set_prefix("==lz==");
+
+  FileSinkOptions opts;
+  opts.compress = true;
+  opts.buffer_size = 4096;
+  opts.flush_interval = std::chrono::milliseconds(0);
+  opts.truncate = true;
+  if (!logger.set_file_sink(path.string(), opts))
+    return 1;
+
+  for (int i = 0; i < 2000; ++i)
+    logger.log(Level::Info, "request {} served\n", i % 37);
+  logger.flush();
+
+  bool frames_ok = false;
+  size_t frames = 0;
+  const std::string packed_file = read_file(path);
+  const std::string unpacked = unpack(packed_file, frames_ok, frames);
+  const bool sink_ok =
+      frames_ok && frames > 10 &&
+      count_of(unpacked, "==lz== [INFO] request ") == 2000 &&
+      packed_file.size() * 4 < unpacked.size();
+
+  // An Error line is compressed and written without flush().
+  logger.log(Level::Error, "boom\n");
+  bool error_ok = false;
+  for (int i = 0; i < 200 && !error_ok; ++i) {
+    bool ok = false;
+    error_ok = count_of(unpack(read_file(path), ok, frames), "boom\n") == 1;
+    if (!error_ok)
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  // reset_sink() writes the last partial block.
+  logger.log(Level::Info, "last\n");
+  logger.reset_sink();
+  const std::string final_text = unpack(read_file(path), frames_ok, frames);
+  const bool close_ok = frames_ok && count_of(final_text, "last\n") == 1;
+
+  std::filesystem::remove(path);
+
+  if (!codec_ok || !damage_ok || !sink_ok || !error_ok || !close_ok) {
+    std::fprintf(stderr, "codec=%d damage=%d sink=%d error=%d close=%d\n",
+                 codec_ok, damage_ok, sink_ok, error_ok, close_ok);
+    return 1;
+  }
+
+  return 0;
+}
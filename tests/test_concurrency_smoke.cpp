@@ -1,6 +1,7 @@
 #include <coretrace/logger.hpp>
 
 #include <atomic>
+#include <filesystem>
 #include <thread>
 #include <vector>
 
@@ -17,6 +18,9 @@ int main() {
   enable_logging();
   set_min_level(Level::Info);
 
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "coretrace_smoke_swap.log";
+
   std::atomic<bool> start{false};
   std::atomic<int> ready{0};
 
@@ -28,7 +32,35 @@ int main() {
     for (int i = 0; i < 12000; ++i) {
       log(Level::Info, "msg {}\n", i);
       log(Level::Info, Module("stress"), "module {}\n", i);
+      if ((i % 64) == 0) {
+        LogBatch batch(Level::Info);
+        batch.add("batch {} token=abc\n", i);
+        batch.add_line("batch token=def\n");
+      }
+    }
+  };
+
+  // Patterns, rule sets and sinks replaced under the writers are freed
+  // while the writers run (checked by the sanitizer builds).
+  auto swap_worker = [&]() {
+    ready.fetch_add(1, std::memory_order_relaxed);
+    while (!start.load(std::memory_order_acquire))
+      std::this_thread::yield();
+
+    for (int i = 0; i < 2000; ++i) {
+      set_layout((i % 2) == 0 ? Layout::Pattern : Layout::Text);
+      (void)set_pattern((i % 2) == 0 ? "%L %m" : "%p %L %m");
+      if ((i % 3) == 0)
+        clear_redaction();
+      else
+        (void)set_redaction({{"token=\\w+", "token=***"}});
+      if ((i % 50) == 0)
+        (void)set_file_sink(path.string());
+      else if ((i % 50) == 25)
+        set_sink(noop_sink);
     }
+
+    set_sink(noop_sink);
   };
 
   auto config_worker = [&]() {
@@ -54,8 +86,9 @@ int main() {
   threads.emplace_back(logger_worker);
   threads.emplace_back(logger_worker);
   threads.emplace_back(config_worker);
+  threads.emplace_back(swap_worker);
 
-  while (ready.load(std::memory_order_acquire) != 3)
+  while (ready.load(std::memory_order_acquire) != 4)
     std::this_thread::yield();
   start.store(true, std::memory_order_release);
 
@@ -63,5 +96,6 @@ int main() {
     t.join();
 
   reset_sink();
+  std::filesystem::remove(path);
   return 0;
 }
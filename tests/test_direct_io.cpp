@@ -0,0 +1,142 @@
+#include <coretrace/logger.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+namespace fs = std::filesystem;
+
+std::string read_file(const fs::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream out;
+  out << in.rdbuf();
+  return out.str();
+}
+
+size_t count_of(const std::string &haystack, const char *needle) {
+  size_t count = 0;
+  for (size_t pos = haystack.find(needle); pos != std::string::npos;
+       pos = haystack.find(needle, pos + 1))
+    ++count;
+  return count;
+}
+
+// Unaligned flushes, reopening an unaligned file and size rotation must
+// all leave exactly the lines written: no padding, no repeated bytes.
+bool run_in(const fs::path &dir) {
+  const fs::path path = dir / "coretrace_test_direct_io.log";
+  fs::remove(path);
+
+  coretrace::Logger logger;
+  logger.enable();
+  logger.set_prefix("==dio==");
+
+  coretrace::FileSinkOptions opts;
+  opts.direct_io = true;
+  opts.buffer_size = 8192;
+  opts.flush_interval = std::chrono::milliseconds(0);
+  opts.truncate = true;
+  if (!logger.set_file_sink(path.string(), opts))
+    return false;
+
+  for (int i = 0; i < 1000; ++i) {
+    logger.log(coretrace::Level::Info, "line {}\n", i);
+    if (i % 97 == 0)
+      logger.flush();
+  }
+  logger.reset_sink();
+
+  opts.truncate = false;
+  if (!logger.set_file_sink(path.string(), opts))
+    return false;
+  logger.log(coretrace::Level::Info, "appended\n");
+  logger.reset_sink();
+
+  const std::string text = read_file(path);
+  const std::string tag = "==dio== [INFO] line ";
+  const bool append_ok =
+      count_of(text, "\n") == 1001 && count_of(text, tag.c_str()) == 1000 &&
+      count_of(text, " line 999\n") == 1 &&
+      text.find(" line 500\n") < text.find(" line 501\n") &&
+      text.find('\0') == std::string::npos &&
+      text.compare(text.size() - 9, 9, "appended\n") == 0;
+
+  // Rotation by size: every archive holds whole lines.
+  coretrace::FileSinkOptions rotating = opts;
+  rotating.truncate = true;
+  rotating.rotate_bytes = 16 * 1024;
+  if (!logger.set_file_sink(path.string(), rotating))
+    return false;
+  for (int i = 0; i < 3000; ++i)
+    logger.log(coretrace::Level::Info, "line {}\n", i);
+  logger.reset_sink();
+
+  size_t lines = 0;
+  bool clean = true;
+  std::vector<fs::path> created;
+  for (const fs::directory_entry &entry : fs::directory_iterator(dir)) {
+    const std::string name = entry.path().filename().string();
+    if (name.rfind("coretrace_test_direct_io.log", 0) != 0)
+      continue;
+    const std::string part = read_file(entry.path());
+    lines += count_of(part, tag.c_str());
+    clean = clean && part.find('\0') == std::string::npos &&
+            (part.empty() || part.back() == '\n');
+    created.push_back(entry.path());
+  }
+  for (const fs::path &file : created)
+    fs::remove(file);
+
+  const bool rotate_ok = clean && lines == 3000 && created.size() > 2;
+
+  // Unaligned drains keep the preallocated blocks past the end; the
+  // padding is cut when the sink closes.
+  bool reserve_ok = true;
+#if defined(__linux__)
+  coretrace::FileSinkOptions reserving = opts;
+  reserving.truncate = true;
+  reserving.flush_bytes = 100;
+  reserving.preallocate_bytes = 1 << 20;
+  if (!logger.set_file_sink(path.string(), reserving))
+    return false;
+  for (int i = 0; i < 200; ++i)
+    logger.log(coretrace::Level::Info, "line {}\n", i);
+  struct stat open_stat {};
+  reserve_ok = stat(path.c_str(), &open_stat) == 0 &&
+               static_cast<uint64_t>(open_stat.st_blocks) * 512 >=
+                   static_cast<uint64_t>(open_stat.st_size) + (1 << 19);
+  logger.reset_sink();
+  const std::string reserved = read_file(path);
+  reserve_ok = reserve_ok && count_of(reserved, tag.c_str()) == 200 &&
+               reserved.find('\0') == std::string::npos;
+  fs::remove(path);
+#endif
+
+  if (!append_ok || !rotate_ok || !reserve_ok)
+    std::fprintf(stderr,
+                 "%s: append=%d rotate=%d reserve=%d (size %zu, lines %zu)\n",
+                 dir.string().c_str(), append_ok, rotate_ok, reserve_ok,
+                 text.size(), lines);
+  return append_ok && rotate_ok && reserve_ok;
+}
+
+} // namespace
+
+int main() {
+  // tmpfs (when present) rejects O_DIRECT and exercises the fallback.
+  bool ok = run_in(fs::temp_directory_path());
+  if (fs::is_directory("/dev/shm"))
+    ok = run_in("/dev/shm") && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+#include <coretrace/logger.hpp>
+
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+std::string g_capture;
+int g_sink_calls = 0;
+
+void capture_sink(const char *data, size_t size) {
+  g_capture.append(data, size);
+  ++g_sink_calls;
+}
+
+// The part of the captured line after the "[INFO] " tag.
+std::string body() {
+  const size_t pos = g_capture.find("] ");
+  return pos == std::string::npos ? g_capture : g_capture.substr(pos + 2);
+}
+
+enum class Kind : uint8_t { Small = 3 };
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+
+  set_sink(capture_sink);
+  enable_logging();
+
+  // ── Value rendering ──────────────────
+  const std::string name = "heap";
+  log(Level::Info, "alloc", kv("ptr", reinterpret_cast<void *>(0x1000)),
+      kv("size", size_t{64}), kv("delta", -3), kv("min", LLONG_MIN),
+      kv("max", ULLONG_MAX), kv("ok", true), kv("ratio", 0.5),
+      kv("kind", Kind::Small), kv("arena", name), kv("null", nullptr));
+  const bool values_ok =
+      body() == "alloc ptr=0x1000 size=64 delta=-3 "
+                "min=-9223372036854775808 max=18446744073709551615 "
+                "ok=true ratio=0.5 kind=3 arena=heap null=0x0\n" &&
+      g_sink_calls == 1;
+
+  // ── Quoting ──────────────────────────
+  g_capture.clear();
+  const char *missing = nullptr;
+  log(Level::Info, "q\n", kv("a", "two words"), kv("b", "x=\"y\"\\"),
+      kv("c", ""), kv("d", "l1\nl2\t\x01"), kv("e", missing));
+  const bool quoting_ok =
+      body() == "q a=\"two words\" b=\"x=\\\"y\\\"\\\\\" c=\"\" "
+                "d=\"l1\\nl2\\t\\x01\" e=(null)\n";
+
+  // ── Module, filters ──────────────────
+  g_capture.clear();
+  log(Level::Warn, Module("alloc"), "free", kv("ptr", uintptr_t{16}));
+  const bool module_ok = g_capture.find("(alloc) free ptr=16\n") !=
+                         std::string::npos;
+
+  g_capture.clear();
+  log(Level::Debug, "hidden", kv("x", 1));
+  enable_module("net");
+  log(Level::Info, Module("alloc"), "hidden", kv("x", 1));
+  enable_all_modules();
+  const bool filter_ok = g_capture.empty();
+
+  // ── Longer than one line buffer ──────
+  g_capture.clear();
+  g_sink_calls = 0;
+  const std::string big(3000, 'z');
+  const std::string message(1500, 'm');
+  log(Level::Info, message, kv("big", big), kv("n", 7));
+  const bool long_ok = body() == message + " big=" + big + " n=7\n" &&
+                       g_sink_calls > 1;
+
+  // Formatted logging is unchanged.
+  g_capture.clear();
+  log(Level::Info, "fmt {}\n", 42);
+  const bool format_ok = body() == "fmt 42\n";
+
+  reset_sink();
+
+  if (!values_ok || !quoting_ok || !module_ok || !filter_ok || !long_ok ||
+      !format_ok) {
+    std::fprintf(stderr,
+                 "values=%d quoting=%d module=%d filter=%d long=%d "
+                 "format=%d\n  last: %.200s\n",
+                 values_ok, quoting_ok, module_ok, filter_ok, long_ok,
+                 format_ok, g_capture.c_str());
+    return 1;
+  }
+  return 0;
+}
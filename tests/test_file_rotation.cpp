@@ -0,0 +1,234 @@
+#include <coretrace/logger.hpp>
+
+#include "logger_cbor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+std::string read_file(const fs::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream out;
+  out << in.rdbuf();
+  return out.str();
+}
+
+// Rotated files ("app.log.YYYYMMDD-HHMMSS.NNN"), oldest first.
+std::vector<fs::path> archives(const fs::path &dir) {
+  std::vector<fs::path> found;
+  for (const fs::directory_entry &entry : fs::directory_iterator(dir)) {
+    const std::string name = entry.path().filename().string();
+    if (name.size() == std::string("app.log.").size() + 19 &&
+        name.rfind("app.log.", 0) == 0)
+      found.push_back(entry.path());
+  }
+  std::sort(found.begin(), found.end());
+  return found;
+}
+
+// Rollovers only swap in a file the background thread has prepared; wait
+// for it so every rollover happens exactly at the size limit. Right after
+// a rollover the active file still carries the ".next" name until the
+// background thread renames it; a prepared file is empty. While records
+// stay buffered the active file is empty too, so with buffered set the
+// file under the stable name must be the empty one.
+bool wait_for_next(const fs::path &path, bool buffered = false) {
+  fs::path next = path;
+  next += ".next";
+  for (int i = 0; i < 500; ++i) {
+    std::error_code ec;
+    if (fs::exists(next, ec) && fs::file_size(next, ec) == 0 && !ec &&
+        (!buffered || (fs::file_size(path, ec) == 0 && !ec)))
+      return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  return false;
+}
+
+// Text of a whole CBOR stream; empty if it does not decode.
+std::string decode(const std::string &stream) {
+  using Result = coretrace::detail::cbor::TextDecoder::Result;
+  coretrace::detail::cbor::TextDecoder decoder;
+  std::string text;
+  size_t at = 0;
+  while (at < stream.size()) {
+    size_t consumed = 0;
+    if (decoder.next(stream.data() + at, stream.size() - at, consumed,
+                     text) != Result::Item)
+      return {};
+    at += consumed;
+  }
+  return text;
+}
+
+std::string record(int i) {
+  char buf[16];
+  std::snprintf(buf, sizeof(buf), "record %02d\n", i);
+  return buf;
+}
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+
+  const fs::path dir = fs::temp_directory_path() / "coretrace_test_rotation";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  const fs::path path = dir / "app.log";
+
+  Logger logger;
+  logger.enable();
+
+  FileSinkOptions opts;
+  opts.flush_bytes = 1; // every record reaches the file immediately
+  opts.flush_interval = std::chrono::milliseconds(0);
+  opts.rotate_bytes = 200;
+
+  // Size rotation: no file exceeds the limit, nothing is lost, and the
+  // archive names sort in write order.
+  if (!logger.set_file_sink(path.string(), opts))
+    return 1;
+  bool prepared_ok = true;
+  for (int i = 0; i < 50; ++i) {
+    prepared_ok = wait_for_next(path) && prepared_ok;
+    logger.log(Level::Info, "{}", record(i));
+  }
+  logger.reset_sink();
+
+  std::string all;
+  bool size_ok = true;
+  const std::vector<fs::path> rotated = archives(dir);
+  for (const fs::path &file : rotated) {
+    const std::string content = read_file(file);
+    size_ok = size_ok && content.size() <= opts.rotate_bytes;
+    all += content;
+  }
+  all += read_file(path);
+
+  std::string expected_order;
+  for (int i = 0; i < 50; ++i)
+    expected_order += record(i);
+  std::string records_only;
+  for (size_t pos = all.find("record "); pos != std::string::npos;
+       pos = all.find("record ", pos + 1))
+    records_only += all.substr(pos, 10);
+
+  const bool rotate_ok = rotated.size() >= 5 && size_ok &&
+                         records_only == expected_order &&
+                         !fs::exists(dir / "app.log.next");
+
+  // Buffered records are held to the limit too: the size is checked as
+  // each record arrives, not when the buffer is written.
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  FileSinkOptions buffered = opts;
+  buffered.flush_bytes = 0;
+  if (!logger.set_file_sink(path.string(), buffered))
+    return 1;
+  for (int i = 0; i < 50; ++i) {
+    prepared_ok = wait_for_next(path, true) && prepared_ok;
+    logger.log(Level::Info, "{}", record(i));
+  }
+  logger.reset_sink();
+
+  const std::vector<fs::path> buffered_files = archives(dir);
+  bool buffered_ok = buffered_files.size() >= 5;
+  for (const fs::path &file : buffered_files)
+    buffered_ok = buffered_ok && fs::file_size(file) <= opts.rotate_bytes;
+
+  // Retention keeps only the newest rotated files.
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  opts.max_files = 2;
+  if (!logger.set_file_sink(path.string(), opts))
+    return 1;
+  for (int i = 0; i < 50; ++i) {
+    prepared_ok = wait_for_next(path) && prepared_ok;
+    logger.log(Level::Info, "{}", record(i));
+  }
+  logger.reset_sink();
+
+  const std::vector<fs::path> kept = archives(dir);
+  const bool retention_ok =
+      kept.size() == 2 &&
+      read_file(kept[1]).find("record 4") != std::string::npos &&
+      read_file(kept[0]).find("record 00") == std::string::npos;
+
+  // CBOR names are defined again in every file: each one decodes on its
+  // own, with the module name and not an unknown id.
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  FileSinkOptions cbor_opts;
+  cbor_opts.rotate_bytes = 4096;
+  if (!logger.set_file_sink(path.string(), cbor_opts))
+    return 1;
+  logger.set_layout(Layout::Cbor);
+  for (int i = 0; i < 400; ++i) {
+    prepared_ok = wait_for_next(path) && prepared_ok;
+    logger.log(Level::Info, Module("alloc"), "{}", record(i));
+  }
+  logger.reset_sink();
+  logger.set_layout(Layout::Text);
+
+  std::vector<fs::path> cbor_files = archives(dir);
+  cbor_files.push_back(path);
+  bool cbor_ok = cbor_files.size() >= 3;
+  int decoded = 0;
+  for (const fs::path &file : cbor_files) {
+    std::istringstream lines(decode(read_file(file)));
+    for (std::string line; std::getline(lines, line); ++decoded) {
+      std::string expected = " (alloc) " + record(decoded);
+      expected.pop_back();
+      cbor_ok = cbor_ok && line.ends_with(expected);
+    }
+  }
+  cbor_ok = cbor_ok && decoded == 400;
+
+  // A ".next" file left with records by a run that stopped mid-rollover
+  // finishes that rollover: the older file is archived, ".next" becomes
+  // the active file and new records follow its contents.
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  fs::path stale = path;
+  stale += ".next";
+  std::ofstream(path, std::ios::binary) << "older\n";
+  std::ofstream(stale, std::ios::binary) << "newest before the stop\n";
+  if (!logger.set_file_sink(path.string(), opts))
+    return 1;
+  prepared_ok = wait_for_next(path) && prepared_ok;
+  logger.set_layout(Layout::Short);
+  logger.log(Level::Info, "after\n");
+  logger.reset_sink();
+  logger.set_layout(Layout::Text);
+  const std::vector<fs::path> recovered = archives(dir);
+  const bool stale_ok =
+      recovered.size() == 1 && read_file(recovered[0]) == "older\n" &&
+      read_file(path) == "newest before the stop\n[INFO] after\n";
+
+  fs::remove_all(dir);
+
+  if (!prepared_ok || !rotate_ok || !buffered_ok || !retention_ok ||
+      !cbor_ok || !stale_ok) {
+    std::fprintf(stderr, "prepared=%d rotate=%d (files=%zu size=%d) "
+                         "buffered=%d retention=%d (kept=%zu) cbor=%d "
+                         "(files=%zu decoded=%d) stale=%d\n%s\n",
+                 prepared_ok, rotate_ok, rotated.size(), size_ok,
+                 buffered_ok, retention_ok, kept.size(), cbor_ok,
+                 cbor_files.size(), decoded, stale_ok, all.c_str());
+    return 1;
+  }
+
+  return 0;
+}
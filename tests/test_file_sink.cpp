@@ -0,0 +1,121 @@
+#include <coretrace/logger.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::string read_file(const std::filesystem::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream out;
+  out << in.rdbuf();
+  return out.str();
+}
+
+size_t count_of(const std::string &haystack, const char *needle) {
+  size_t count = 0;
+  for (size_t pos = haystack.find(needle); pos != std::string::npos;
+       pos = haystack.find(needle, pos + 1))
+    ++count;
+  return count;
+}
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+
+  const std::filesystem::path dir = std::filesystem::temp_directory_path();
+  const std::filesystem::path path = dir / "coretrace_test_file_sink.log";
+  std::filesystem::remove(path);
+
+  Logger logger;
+  logger.enable();
+  logger.set_prefix("==fs==");
+
+  // Lines stay buffered until flush().
+  FileSinkOptions opts;
+  opts.flush_interval = std::chrono::milliseconds(0);
+  opts.truncate = true;
+  if (!logger.set_file_sink(path.string(), opts))
+    return 1;
+
+  for (int i = 0; i < 100; ++i)
+    logger.log(Level::Info, "line {}\n", i);
+
+  const bool buffered_ok = read_file(path).empty();
+  logger.flush();
+  const std::string flushed = read_file(path);
+  const bool flush_ok = count_of(flushed, "==fs== [INFO] line ") == 100 &&
+                        count_of(flushed, "line 99\n") == 1;
+
+  // An Error line flushes everything before it.
+  logger.log(Level::Warn, "before error\n");
+  logger.log(Level::Error, "boom\n");
+  const std::string after_error = read_file(path);
+  const bool error_ok = count_of(after_error, "before error\n") == 1 &&
+                        count_of(after_error, "[ERROR] boom\n") == 1;
+
+  // Small flush_bytes and a timed flush both drain without flush().
+  FileSinkOptions eager;
+  eager.flush_bytes = 64;
+  eager.flush_interval = std::chrono::milliseconds(0);
+  eager.preallocate_bytes = 1 << 16;
+  if (!logger.set_file_sink(path.string(), eager))
+    return 1;
+  const std::string wide(80, 'x');
+  logger.log(Level::Info, "{}\n", wide);
+  const bool bytes_ok = count_of(read_file(path), wide.c_str()) == 1;
+
+  FileSinkOptions timed;
+  timed.flush_interval = std::chrono::milliseconds(10);
+  timed.durability = FileDurability::SyncInterval;
+  if (!logger.set_file_sink(path.string(), timed))
+    return 1;
+  logger.log(Level::Info, "timed\n");
+  bool timed_ok = false;
+  for (int i = 0; i < 200 && !timed_ok; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    timed_ok = count_of(read_file(path), "timed\n") == 1;
+  }
+
+  // SyncInterval without an interval syncs after every write to the file.
+  FileSinkOptions synced;
+  synced.flush_bytes = 1;
+  synced.flush_interval = std::chrono::milliseconds(0);
+  synced.durability = FileDurability::SyncInterval;
+  if (!logger.set_file_sink(path.string(), synced))
+    return 1;
+  for (int i = 0; i < 3; ++i)
+    logger.log(Level::Info, "synced {}\n", i);
+  logger.flush();
+  const bool sync_ok = logger.sink_stats().syscalls == 6;
+
+  // reset_sink() flushes and closes the file; output goes back to stderr.
+  logger.log(Level::Info, "last\n");
+  logger.reset_sink();
+  const bool reset_ok = count_of(read_file(path), "last\n") == 1;
+
+  // A path that cannot be opened keeps the current sink.
+  const bool bad_path_ok =
+      !logger.set_file_sink((dir / "no-such-dir" / "x.log").string());
+
+  std::filesystem::remove(path);
+
+  if (!buffered_ok || !flush_ok || !error_ok || !bytes_ok || !timed_ok ||
+      !sync_ok || !reset_ok || !bad_path_ok) {
+    std::fprintf(stderr,
+                 "buffered=%d flush=%d error=%d bytes=%d timed=%d sync=%d "
+                 "reset=%d bad_path=%d\n",
+                 buffered_ok, flush_ok, error_ok, bytes_ok, timed_ok, sync_ok,
+                 reset_ok, bad_path_ok);
+    return 1;
+  }
+
+  return 0;
+}
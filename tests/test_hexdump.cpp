@@ -0,0 +1,129 @@
+#include <coretrace/logger.hpp>
+
+#include "logger_hex.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> g_calls;
+
+void capture_sink(const char *data, size_t size) {
+  g_calls.emplace_back(data, size);
+}
+
+std::string hex_of(const void *ptr) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "0x%llx",
+                static_cast<unsigned long long>(
+                    reinterpret_cast<uintptr_t>(ptr)));
+  return buf;
+}
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+  namespace hex = detail::hex;
+
+  set_sink(capture_sink);
+  enable_logging();
+  const std::string head = "|" + std::to_string(pid()) + "| ==ct== [INFO] ";
+
+  // ── Kernel ───────────────────────────
+  // Every byte value, at every alignment, matches the scalar reference.
+  std::vector<unsigned char> all(300);
+  for (size_t i = 0; i < all.size(); ++i)
+    all[i] = static_cast<unsigned char>(i * 7);
+  bool kernel_ok = true;
+  for (size_t skew = 0; skew < 17; ++skew) {
+    const size_t n = all.size() - skew;
+    std::string fast(2 * n, '?');
+    std::string slow(2 * n, '!');
+    hex::encode(all.data() + skew, n, fast.data());
+    hex::encode_scalar(all.data() + skew, n, slow.data());
+    kernel_ok = kernel_ok && fast == slow;
+  }
+  char pair[2];
+  hex::encode_scalar(all.data() + 37, 1, pair); // 37 * 7 = 259 -> 0x03
+  kernel_ok = kernel_ok && pair[0] == '0' && pair[1] == '3';
+
+  const bool digits_ok = hex::offset_digits(0) == 8 &&
+                         hex::offset_digits(size_t{1} << 32) == 8 &&
+                         hex::offset_digits((size_t{1} << 32) + 1) == 9;
+
+  // ── Rows ─────────────────────────────
+  const char text[] = "Hello, world!\n\x01\xff"
+                      "abcdef";
+  log_hexdump(Level::Info, text, 22);
+  const std::string dump =
+      head + "hexdump " + hex_of(text) + ", 22 bytes\n" +
+      "00000000  48 65 6c 6c 6f 2c 20 77  6f 72 6c 64 21 0a 01 ff  "
+      "|Hello, world!...|\n"
+      "00000010  61 62 63 64 65 66                                 "
+      "|abcdef|\n";
+  const bool rows_ok = g_calls.size() == 1 && g_calls[0] == dump;
+
+  // Module tag and filter.
+  g_calls.clear();
+  log_hexdump(Level::Info, Module("alloc"), text, 1);
+  enable_module("alloc");
+  log_hexdump(Level::Info, Module("trace"), text, 1);
+  enable_all_modules();
+  log_hexdump(Level::Debug, text, 1);
+  const bool filter_ok =
+      g_calls.size() == 1 &&
+      g_calls[0] == head + "(alloc) hexdump " + hex_of(text) +
+                        ", 1 bytes\n00000000  48" + std::string(47, ' ') +
+                        " |H|\n";
+
+  // ── Cap ──────────────────────────────
+  g_calls.clear();
+  set_max_hexdump_size(16);
+  log_hexdump(Level::Info, all.data(), all.size());
+  const std::string capped = g_calls.empty() ? "" : g_calls[0];
+  const bool cap_ok =
+      max_hexdump_size() == 16 && g_calls.size() == 1 &&
+      capped.find("\n00000000  ") != std::string::npos &&
+      capped.find("\n00000010") == std::string::npos &&
+      capped.ends_with("\n\xe2\x80\xa6[+284 bytes]\n");
+
+  // Large dumps leave the stack buffer and still form one record.
+  g_calls.clear();
+  set_max_hexdump_size(0);
+  std::vector<unsigned char> big(64 * 1024, 0x5a);
+  log_hexdump(Level::Info, big.data(), big.size());
+  std::string joined;
+  for (const std::string &call : g_calls)
+    joined += call;
+  size_t rows = 0;
+  for (char c : joined)
+    rows += c == '\n';
+  const bool big_ok = rows == 1 + big.size() / 16 &&
+                      joined.ends_with("0000fff0  5a 5a 5a 5a 5a 5a 5a 5a  "
+                                       "5a 5a 5a 5a 5a 5a 5a 5a  "
+                                       "|ZZZZZZZZZZZZZZZZ|\n");
+
+  // Null data shows no rows.
+  g_calls.clear();
+  set_max_hexdump_size(DEFAULT_HEXDUMP_SIZE);
+  log_hexdump(Level::Info, nullptr, 4);
+  const bool null_ok =
+      g_calls.size() == 1 &&
+      g_calls[0] == head + "hexdump 0x0, 4 bytes\n\xe2\x80\xa6[+4 bytes]\n";
+
+  reset_sink();
+
+  if (!kernel_ok || !digits_ok || !rows_ok || !filter_ok || !cap_ok ||
+      !big_ok || !null_ok) {
+    std::fprintf(stderr,
+                 "kernel=%d digits=%d rows=%d filter=%d cap=%d big=%d "
+                 "null=%d\n  first: %.400s\n",
+                 kernel_ok, digits_ok, rows_ok, filter_ok, cap_ok, big_ok,
+                 null_ok, g_calls.empty() ? "" : g_calls[0].c_str());
+    return 1;
+  }
+  return 0;
+}
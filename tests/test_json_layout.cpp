@@ -0,0 +1,242 @@
+#include <coretrace/logger.hpp>
+
+#include "logger_json.hpp"
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::string g_capture;
+
+void capture_sink(const char *data, size_t size) {
+  g_capture.append(data, size);
+}
+
+// Byte-at-a-time JSON escaping, the reference for the vectorized path.
+std::string reference_escape(std::string_view value) {
+  static const char hex[] = "0123456789abcdef";
+  std::string out;
+  for (char c : value) {
+    const auto byte = static_cast<unsigned char>(c);
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\b':
+      out += "\\b";
+      break;
+    case '\f':
+      out += "\\f";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      if (byte < 0x20) {
+        out += "\\u00";
+        out += hex[byte >> 4];
+        out += hex[byte & 0xF];
+      } else {
+        out += c;
+      }
+    }
+  }
+  return out;
+}
+
+std::string head(coretrace::Level level) {
+  return "{\"pid\":" + std::to_string(coretrace::pid()) +
+         ",\"tid\":" + std::to_string(coretrace::thread_id()) +
+         ",\"level\":\"" + std::string(coretrace::level_label(level)) +
+         "\",\"prefix\":\"==ct==\"";
+}
+
+bool contains(const std::string &text, const std::string &needle) {
+  return text.find(needle) != std::string::npos;
+}
+
+// Color output is detected once, from stderr: make it a terminal for that
+// first check, then put it back. False without a pty (or with NO_COLOR).
+bool colors_on_terminal() {
+#if defined(__linux__)
+  const int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0)
+    return false;
+  const int slave = grantpt(master) == 0 && unlockpt(master) == 0
+                        ? open(ptsname(master), O_RDWR | O_NOCTTY)
+                        : -1;
+  bool on = false;
+  if (slave >= 0) {
+    const int saved = dup(2);
+    dup2(slave, 2);
+    on = !coretrace::color(coretrace::Color::Red).empty();
+    dup2(saved, 2);
+    close(saved);
+    close(slave);
+  }
+  close(master);
+  return on;
+#else
+  return false;
+#endif
+}
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+  namespace json = detail::json;
+
+  const bool terminal = colors_on_terminal();
+
+  // ── Scanner ──────────────────────────
+  // Every length and every position of a byte to escape, around the 16
+  // and 32 byte steps.
+  bool scan_ok = true;
+  const char specials[] = {'"', '\\', '\n', '\x01', '\x1f', '\0'};
+  for (size_t len = 0; len <= 80 && scan_ok; ++len) {
+    std::string text(len, 'a');
+    scan_ok = json::plain_run(text.data(), len) == len;
+    for (size_t at = 0; at < len && scan_ok; ++at) {
+      for (char special : specials) {
+        text[at] = special;
+        scan_ok = scan_ok && json::plain_run(text.data(), len) == at &&
+                  json::plain_run_scalar(text.data(), len) == at;
+        text[at] = at % 2 ? ' ' : '\x7f'; // plain: space, DEL, high bytes
+      }
+      text[at] = '\xc3';
+    }
+  }
+  std::mt19937 rng(42);
+  for (int round = 0; round < 2000 && scan_ok; ++round) {
+    std::string text(rng() % 300, '\0');
+    for (char &c : text) {
+      const unsigned byte = rng() % 8 == 0 ? rng() % 0x20 : 0x20 + rng() % 0xe0;
+      c = static_cast<char>(byte);
+    }
+    scan_ok = json::plain_run(text.data(), text.size()) ==
+              json::plain_run_scalar(text.data(), text.size());
+  }
+
+  set_sink(capture_sink);
+  enable_logging();
+  set_layout(Layout::Json);
+
+  // ── Records ──────────────────────────
+  log(Level::Info, "hello {}\n", "world");
+  const bool basic_ok = g_capture == head(Level::Info) +
+                                         ",\"msg\":\"hello world\"}\n";
+
+  g_capture.clear();
+  set_source_location(true);
+  const int line = __LINE__ + 1;
+  log(Level::Warn, Module("alloc"), "q\"b\\s\tc\x01\n");
+  set_source_location(false);
+  const bool location_ok =
+      g_capture == head(Level::Warn) +
+                       ",\"module\":\"alloc\",\"file\":\"test_json_layout."
+                       "cpp\",\"line\":" +
+                       std::to_string(line) +
+                       ",\"msg\":\"q\\\"b\\\\s\\tc\\u0001\"}\n";
+
+  g_capture.clear();
+  log(Level::Info, "m", kv("size", 64), kv("ok", false), kv("r", 0.25),
+      kv("name", "a\"b"), kv("p", reinterpret_cast<void *>(0x10)));
+  const bool structured_ok =
+      g_capture == head(Level::Info) +
+                       ",\"msg\":\"m\",\"fields\":{\"size\":64,\"ok\":false,"
+                       "\"r\":0.25,\"name\":\"a\\\"b\",\"p\":\"0x10\"}}\n";
+
+  // Long messages with escapes spread over several buffers.
+  g_capture.clear();
+  std::string big;
+  for (int i = 0; i < 500; ++i)
+    big += "chunk \"" + std::to_string(i) + "\"\t";
+  log(Level::Info, "{}\n", big);
+  const bool long_ok =
+      g_capture == head(Level::Info) + ",\"msg\":\"" +
+                       reference_escape(big) + "\"}\n";
+
+  // Timestamps lead the object.
+  g_capture.clear();
+  set_timestamps(true);
+  log(Level::Info, "t\n");
+  set_timestamps(false);
+  const bool ts_ok = g_capture.rfind("{\"ts\":\"", 0) == 0 &&
+                     g_capture.find("Z\",\"pid\":") == 30;
+
+  // Colors are off while the default logger writes JSON.
+  bool color_ok = color(Color::Red).empty() &&
+                  level_color(Level::Error).empty();
+
+  // Other loggers follow their own layout.
+  {
+    static std::string text_capture;
+    Logger text_logger;
+    text_logger.enable();
+    text_logger.set_sink([](const char *data, size_t size) {
+      text_capture.append(data, size);
+    });
+    Logger json_logger;
+    json_logger.set_layout(Layout::Json);
+    text_logger.log(Level::Error, "colored\n");
+    color_ok = color_ok && json_logger.color(Color::Red).empty() &&
+               json_logger.level_color(Level::Error).empty();
+    if (terminal)
+      color_ok = color_ok && text_logger.color(Color::Red) == "\x1b[31m" &&
+                 text_logger.level_color(Level::Error) == "\x1b[31m" &&
+                 contains(text_capture, "\x1b[31m[ERROR]");
+  }
+
+  // ── Batches ──────────────────────────
+  g_capture.clear();
+  {
+    LogBatch batch(Level::Info);
+    batch.add("a {}\n", 1);
+    batch.add_line("b\"\n");
+  }
+  const bool batch_ok =
+      g_capture == head(Level::Info) + ",\"msg\":\"a 1\"}\n" +
+                       head(Level::Info) + ",\"msg\":\"b\\\"\"}\n";
+
+  // ── Short layout ─────────────────────
+  g_capture.clear();
+  set_layout(Layout::Short);
+  log(Level::Info, "s\n");
+  const std::string label = std::string(level_color(Level::Info)) +
+                            "[INFO]" + std::string(color(Color::Reset));
+  const bool short_ok = contains(g_capture, label + " s\n") &&
+                        !contains(g_capture, "==ct==");
+
+  set_layout(Layout::Text);
+  reset_sink();
+
+  if (!scan_ok || !basic_ok || !location_ok || !structured_ok ||
+      !long_ok || !ts_ok || !color_ok || !batch_ok || !short_ok) {
+    std::fprintf(stderr,
+                 "scan=%d (%s) basic=%d line=%d structured=%d long=%d ts=%d "
+                 "color=%d batch=%d short=%d\n  last: %.300s\n",
+                 scan_ok, json::plain_run_engine(), basic_ok, location_ok,
+                 structured_ok, long_ok, ts_ok, color_ok, batch_ok, short_ok,
+                 g_capture.c_str());
+    return 1;
+  }
+  return 0;
+}
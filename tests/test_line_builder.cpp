@@ -0,0 +1,127 @@
+#include <coretrace/logger.hpp>
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string g_capture;
+int g_sink_calls = 0;
+
+void capture_sink(const char *data, size_t size) {
+  g_capture.append(data, size);
+  ++g_sink_calls;
+}
+
+std::atomic<int> g_torn_lines{0};
+std::atomic<int> g_lines{0};
+
+// Every sink call must carry exactly one complete line.
+void checking_sink(const char *data, size_t size) {
+  const std::string_view chunk(data, size);
+  if (chunk.find("==ct==") == std::string_view::npos)
+    g_torn_lines.fetch_add(1, std::memory_order_relaxed);
+  if (chunk.empty() || chunk.back() != '\n' ||
+      chunk.find('\n') != chunk.size() - 1)
+    g_torn_lines.fetch_add(1, std::memory_order_relaxed);
+  g_lines.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+
+  set_sink(capture_sink);
+  enable_logging();
+
+  // Primitive rendering.
+  LineBuilder line;
+  line.append_str("d=")
+      .append_dec(0)
+      .append_str(",")
+      .append_dec(-42)
+      .append_str(",")
+      .append_dec(ULLONG_MAX)
+      .append_str(",")
+      .append_dec(LLONG_MIN)
+      .append_str(" h=")
+      .append_hex(0)
+      .append_str(",")
+      .append_hex(0xDEADBEEFu)
+      .append_str(" f=")
+      .append_float(0.1)
+      .append_str(",")
+      .append_float(2.5, 3)
+      .append_str("\n");
+
+  const bool render_ok =
+      line.view() == "d=0,-42,18446744073709551615,-9223372036854775808 "
+                     "h=0x0,0xdeadbeef f=0.1,2.500\n";
+
+  line.commit();
+  const bool commit_ok =
+      g_sink_calls == 1 && line.view().empty() &&
+      g_capture.find("h=0x0,0xdeadbeef") != std::string::npos;
+
+  // Prefix + body in one sink call.
+  g_sink_calls = 0;
+  line.append_prefix(Level::Warn).append_str("hooked\n").commit();
+  const bool prefix_ok = g_sink_calls == 1 &&
+                         g_capture.find("[WARN] hooked\n") != std::string::npos;
+
+  // Overflow drops bytes instead of allocating.
+  const std::string big(LineBuilder::CAPACITY + 10, 'x');
+  line.append_str(big);
+  const bool truncate_ok =
+      line.truncated() && line.view().size() == LineBuilder::CAPACITY;
+  line.clear();
+
+  // write_log_line() is a single sink call as well.
+  g_sink_calls = 0;
+  log(Level::Info, "formatted {}\n", 7);
+  const bool log_ok = g_sink_calls == 1;
+
+  // Concurrent builders never interleave.
+  set_sink(checking_sink);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([t]() {
+      for (int i = 0; i < 2000; ++i) {
+        LineBuilder local;
+        local.append_prefix(Level::Info)
+            .append_str("thread=")
+            .append_dec(t)
+            .append_str(" i=")
+            .append_dec(i)
+            .append_str("\n")
+            .commit();
+      }
+    });
+  }
+  for (auto &th : threads)
+    th.join();
+
+  reset_sink();
+
+  const bool concurrency_ok =
+      g_torn_lines.load() == 0 && g_lines.load() == 8000;
+
+  if (!render_ok || !commit_ok || !prefix_ok || !truncate_ok || !log_ok ||
+      !concurrency_ok) {
+    std::fprintf(stderr,
+                 "render=%d commit=%d prefix=%d truncate=%d log=%d "
+                 "concurrency=%d\n%s\n",
+                 render_ok ? 1 : 0, commit_ok ? 1 : 0, prefix_ok ? 1 : 0,
+                 truncate_ok ? 1 : 0, log_ok ? 1 : 0, concurrency_ok ? 1 : 0,
+                 g_capture.c_str());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,101 @@
+#include <coretrace/logger.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> g_calls;
+
+void capture_sink(const char *data, size_t size) {
+  g_calls.emplace_back(data, size);
+}
+
+std::string joined() {
+  std::string all;
+  for (const std::string &call : g_calls)
+    all += call;
+  return all;
+}
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+
+  set_sink(capture_sink);
+  enable_logging();
+  const std::string head = "|" + std::to_string(pid()) + "| ==ct== [INFO] ";
+  const std::string pad(head.size(), ' ');
+
+  // ── Off ──────────────────────────────
+  log(Level::Info, "a\nb\n");
+  const bool off_ok = joined() == head + "a\nb\n";
+
+  // ── Prefix ───────────────────────────
+  // One sink call per record, every line attributed.
+  g_calls.clear();
+  set_line_framing(LineFraming::Prefix);
+  log(Level::Info, "a\nb\n\nc");
+  const bool prefix_ok =
+      g_calls.size() == 1 &&
+      g_calls[0] == head + "a\n" + head + "b\n" + head + "\n" + head + "c\n";
+
+  // ── Indent ───────────────────────────
+  g_calls.clear();
+  set_line_framing(LineFraming::Indent);
+  log(Level::Info, "a\nb\n");
+  const bool indent_ok =
+      g_calls.size() == 1 && g_calls[0] == head + "a\n" + pad + "b\n";
+
+  // ── Terminate ────────────────────────
+  g_calls.clear();
+  set_line_framing(LineFraming::Terminate);
+  log(Level::Info, "x");
+  log(Level::Info, "y\nz\n");
+  const bool terminate_ok = joined() == head + "x\n" + head + "y\nz\n";
+
+  // Structured fields stay on the last line.
+  g_calls.clear();
+  set_line_framing(LineFraming::Prefix);
+  log(Level::Info, "p\nq\n", kv("n", 1));
+  const bool fields_ok = joined() == head + "p\n" + head + "q n=1\n";
+
+  // A record larger than the line buffer still repeats the prefix.
+  g_calls.clear();
+  std::string big;
+  std::string expected;
+  for (int i = 0; i < 200; ++i) {
+    big += "line " + std::to_string(i) + "\n";
+    expected += head + "line " + std::to_string(i) + "\n";
+  }
+  log(Level::Info, "{}", big);
+  const bool long_ok = g_calls.size() > 1 && joined() == expected;
+
+  // ── Batches ──────────────────────────
+  g_calls.clear();
+  {
+    LogBatch batch(Level::Info);
+    batch.add("m\nn");
+    batch.add_line("o");
+  }
+  const bool batch_ok = g_calls.size() == 1 &&
+                        g_calls[0] == head + "m\n" + head + "n\n" + head +
+                                          "o\n";
+
+  const bool getter_ok = line_framing() == LineFraming::Prefix;
+  set_line_framing(LineFraming::Off);
+  reset_sink();
+
+  if (!off_ok || !prefix_ok || !indent_ok || !terminate_ok || !fields_ok ||
+      !long_ok || !batch_ok || !getter_ok) {
+    std::fprintf(stderr,
+                 "off=%d prefix=%d indent=%d terminate=%d fields=%d long=%d "
+                 "batch=%d getter=%d\n  last: %.300s\n",
+                 off_ok, prefix_ok, indent_ok, terminate_ok, fields_ok,
+                 long_ok, batch_ok, getter_ok, joined().c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include <coretrace/logger.hpp>
+
+#include <cstdio>
+#include <string>
+
+namespace {
+
+std::string g_capture;
+int g_sink_calls = 0;
+
+void capture_sink(const char *data, size_t size) {
+  g_capture.append(data, size);
+  ++g_sink_calls;
+}
+
+size_t count_of(const std::string &haystack, const char *needle) {
+  size_t count = 0;
+  for (size_t pos = haystack.find(needle); pos != std::string::npos;
+       pos = haystack.find(needle, pos + 1))
+    ++count;
+  return count;
+}
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+
+  set_sink(capture_sink);
+  enable_logging();
+  set_min_level(Level::Info);
+  set_timestamps(true);
+
+  // 200 records, one sink call, one shared timestamp.
+  {
+    LogBatch dump(Level::Info, Module("alloc"));
+    for (int i = 0; i < 200; ++i)
+      dump.add("blk={} size={}\n", i, i * 16);
+    dump.add("{}", ""); // empty records are dropped
+    dump.add_line("tail\n");
+
+    if (dump.size() != 201 || g_sink_calls != 0)
+      return 1;
+    dump.commit();
+  }
+
+  const bool batch_ok = g_sink_calls == 1 &&
+                        count_of(g_capture, "[INFO] (alloc) blk=") == 200 &&
+                        count_of(g_capture, "(alloc) tail\n") == 1 &&
+                        count_of(g_capture, "blk=199 size=3184\n") == 1;
+
+  // All records carry the same timestamp.
+  const std::string first_ts = g_capture.substr(0, g_capture.find(']') + 1);
+  const bool shared_ts_ok = first_ts.size() > 2 && first_ts[0] == '[' &&
+                            count_of(g_capture, first_ts.c_str()) == 201;
+
+  // Filtered batches do nothing; the destructor commits pending records.
+  g_capture.clear();
+  g_sink_calls = 0;
+  set_timestamps(false);
+  {
+    LogBatch filtered(Level::Debug);
+    filtered.add("never {}\n", 1);
+    if (filtered.active() || filtered.size() != 0)
+      return 1;
+
+    LogBatch scoped(Level::Warn, default_logger(), BatchTimestamp::PerRecord);
+    scoped.add("one\n");
+    scoped.add("two\n");
+  }
+
+  const bool scope_ok = g_sink_calls == 1 &&
+                        count_of(g_capture, "[WARN] one\n") == 1 &&
+                        count_of(g_capture, "[WARN] two\n") == 1 &&
+                        count_of(g_capture, "never") == 0;
+
+  reset_sink();
+
+  if (!batch_ok || !shared_ts_ok || !scope_ok) {
+    std::fprintf(stderr, "batch=%d shared_ts=%d scope=%d calls=%d\n%s\n",
+                 batch_ok ? 1 : 0, shared_ts_ok ? 1 : 0, scope_ok ? 1 : 0,
+                 g_sink_calls, g_capture.c_str());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include <coretrace/logger.hpp>
+
+#include <cstdio>
+#include <string>
+
+namespace {
+
+std::string g_default_capture;
+std::string g_net_capture;
+std::string g_disk_capture;
+
+void default_sink(const char *data, size_t size) {
+  g_default_capture.append(data, size);
+}
+
+void net_sink(const char *data, size_t size) {
+  g_net_capture.append(data, size);
+}
+
+void disk_sink(const char *data, size_t size) {
+  g_disk_capture.append(data, size);
+}
+
+bool contains(const std::string &haystack, const char *needle) {
+  return haystack.find(needle) != std::string::npos;
+}
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+
+  set_sink(default_sink);
+  enable_logging();
+  set_min_level(Level::Info);
+
+  Logger net;
+  net.set_sink(net_sink);
+  net.set_prefix("==net==");
+  net.enable();
+
+  Logger disk;
+  disk.set_sink(disk_sink);
+  disk.set_min_level(Level::Warn);
+  disk.enable_module("io");
+  disk.enable();
+
+  // New instances start disabled until enable() is called.
+  Logger idle;
+  const bool idle_enabled = idle.is_enabled();
+
+  log(Level::Info, "default line\n");
+  net.log(Level::Info, "net line {}\n", 1);
+  disk.log(Level::Info, Module("io"), "disk info filtered\n");
+  disk.log(Level::Warn, Module("io"), "disk warn {}\n", 2);
+  disk.log(Level::Warn, Module("cache"), "disk module filtered\n");
+
+  // Configuring an instance must not leak into the default logger.
+  log(Level::Info, Module("cache"), "default module passes\n");
+
+  net.disable();
+  net.log(Level::Error, "net disabled\n");
+
+  reset_sink();
+
+  const bool ok =
+      !idle_enabled && contains(g_default_capture, "default line") &&
+      contains(g_default_capture, "==ct==") &&
+      contains(g_default_capture, "default module passes") &&
+      !contains(g_default_capture, "net line") &&
+      contains(g_net_capture, "==net==") &&
+      contains(g_net_capture, "net line 1") &&
+      !contains(g_net_capture, "net disabled") &&
+      !contains(g_net_capture, "default line") &&
+      contains(g_disk_capture, "disk warn 2") &&
+      !contains(g_disk_capture, "disk info filtered") &&
+      !contains(g_disk_capture, "disk module filtered");
+
+  if (!ok) {
+    std::fprintf(stderr, "default:\n%s\nnet:\n%s\ndisk:\n%s\n",
+                 g_default_capture.c_str(), g_net_capture.c_str(),
+                 g_disk_capture.c_str());
+    return 1;
+  }
+
+  return 0;
+}
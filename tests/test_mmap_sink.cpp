@@ -0,0 +1,158 @@
+#include <coretrace/logger.hpp>
+
+#include "logger_cbor.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+std::string read_file(const fs::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream out;
+  out << in.rdbuf();
+  return out.str();
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << content;
+}
+
+// Text of a whole CBOR stream; empty if it does not decode.
+std::string decode(const std::string &stream) {
+  using Result = coretrace::detail::cbor::TextDecoder::Result;
+  coretrace::detail::cbor::TextDecoder decoder;
+  std::string text;
+  size_t at = 0;
+  while (at < stream.size()) {
+    size_t consumed = 0;
+    if (decoder.next(stream.data() + at, stream.size() - at, consumed,
+                     text) != Result::Item)
+      return {};
+    at += consumed;
+  }
+  return text;
+}
+
+std::string record(int i) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "record %04d\n", i);
+  return buf;
+}
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+
+  const fs::path path = fs::temp_directory_path() / "coretrace_test_mmap.log";
+  fs::remove(path);
+
+  Logger logger;
+  logger.enable();
+  logger.set_prefix("==mm==");
+
+  // Small segments: the run crosses many segment switches; the timed
+  // release runs while records are written.
+  MmapSinkOptions opts;
+  opts.segment_size = 1; // rounded up to the mapping granularity
+  opts.flush_interval = std::chrono::milliseconds(1);
+  opts.truncate = true;
+  if (!logger.set_mmap_sink(path.string(), opts))
+    return 1;
+
+  const std::string tag = "|" + std::to_string(pid()) + "| ==mm== ";
+
+  std::string expected;
+  for (int i = 0; i < 5000; ++i) {
+    logger.log(Level::Info, "{}", record(i));
+    expected += tag + "[INFO] " + record(i);
+  }
+
+  // Visible to readers before the sink is closed (page cache).
+  logger.flush();
+  const bool live_ok =
+      read_file(path).compare(0, expected.size(), expected) == 0;
+
+  // Closing truncates the file to the bytes written.
+  logger.reset_sink();
+  const bool close_ok = read_file(path) == expected &&
+                        fs::file_size(path) == expected.size();
+
+  // Reopening appends after the last byte.
+  if (!logger.set_mmap_sink(path.string()))
+    return 1;
+  logger.log(Level::Warn, "reopened\n");
+  logger.reset_sink();
+  expected += tag + "[WARN] reopened\n";
+  const bool append_ok = read_file(path) == expected;
+
+  // A crash leaves a zero-filled tail; it is skipped on reopen. This file
+  // was not written by the sink: its recorded length does not apply.
+  fs::path pos_path = path;
+  pos_path += ".pos";
+  fs::remove(pos_path);
+  write_file(path, "before crash\n" + std::string(100000, '\0'));
+  if (!logger.set_mmap_sink(path.string()))
+    return 1;
+  logger.log(Level::Info, "after crash\n");
+  logger.reset_sink();
+  const bool recover_ok =
+      read_file(path) == "before crash\n" + tag + "[INFO] after crash\n";
+
+  // CBOR records can end in NUL bytes (here the field value 0). Reopening
+  // after a clean close and after a crash resumes at the recorded length;
+  // the crash is a copy of the file taken while the sink had it mapped.
+  const fs::path crash = fs::temp_directory_path() / "coretrace_crash.log";
+  fs::path crash_pos = crash;
+  crash_pos += ".pos";
+  logger.set_layout(Layout::Cbor);
+  if (!logger.set_mmap_sink(path.string(), opts))
+    return 1;
+  logger.log(Level::Info, "a", kv("n", 0));
+  logger.reset_sink();
+  if (!logger.set_mmap_sink(path.string()))
+    return 1;
+  logger.log(Level::Info, "b", kv("n", 0));
+  logger.flush();
+  fs::copy_file(path, crash, fs::copy_options::overwrite_existing);
+  fs::copy_file(pos_path, crash_pos, fs::copy_options::overwrite_existing);
+  logger.reset_sink();
+  const std::string head = "|" + std::to_string(pid()) + "| ==mm== [INFO] ";
+  const bool cbor_ok =
+      decode(read_file(path)) == head + "a n=0\n" + head + "b n=0\n";
+
+  const bool crash_tail = fs::file_size(crash) > fs::file_size(path);
+  if (!logger.set_mmap_sink(crash.string()))
+    return 1;
+  logger.log(Level::Info, "c", kv("n", 0));
+  logger.reset_sink();
+  const bool cbor_crash_ok =
+      crash_tail && decode(read_file(crash)) == head + "a n=0\n" + head +
+                                                    "b n=0\n" + head +
+                                                    "c n=0\n";
+
+  fs::remove(path);
+  fs::remove(pos_path);
+  fs::remove(crash);
+  fs::remove(crash_pos);
+
+  if (!live_ok || !close_ok || !append_ok || !recover_ok || !cbor_ok ||
+      !cbor_crash_ok) {
+    std::fprintf(stderr,
+                 "live=%d close=%d append=%d recover=%d cbor=%d "
+                 "cbor_crash=%d\n",
+                 live_ok, close_ok, append_ok, recover_ok, cbor_ok,
+                 cbor_crash_ok);
+    return 1;
+  }
+
+  return 0;
+}
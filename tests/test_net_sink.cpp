@@ -0,0 +1,318 @@
+#include <coretrace/logger.hpp>
+
+#include "logger_cbor.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#if !defined(_WIN32)
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Loopback socket standing in for the collector; port 0 picks one.
+int open_loopback(int type, uint16_t &port) {
+  const int fd = socket(AF_INET, type, 0);
+  const int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  socklen_t len = sizeof(addr);
+  if (fd < 0 ||
+      bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+      getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) != 0 ||
+      (type == SOCK_STREAM && listen(fd, 4) != 0)) {
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  port = ntohs(addr.sin_port);
+  return fd;
+}
+
+bool readable(int fd, int timeout_ms) {
+  pollfd pfd{};
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  return poll(&pfd, 1, timeout_ms) > 0;
+}
+
+int accept_within(int listener, int timeout_ms) {
+  return readable(listener, timeout_ms) ? accept(listener, nullptr, nullptr)
+                                        : -1;
+}
+
+// Reads frames from a stream until one contains stop, the peer closes or
+// nothing arrives for a second. ok turns false on a malformed frame; with
+// lines set, a frame must be exactly one line.
+std::vector<std::string> read_frames(int fd, const std::string &stop,
+                                     bool &ok, bool lines = true) {
+  std::vector<std::string> frames;
+  std::string pending;
+  ok = true;
+  while (readable(fd, 1000)) {
+    char buf[8192];
+    const ssize_t got = recv(fd, buf, sizeof(buf), 0);
+    if (got <= 0)
+      break;
+    pending.append(buf, static_cast<size_t>(got));
+
+    bool done = false;
+    while (pending.size() >= 4) {
+      const auto *p = reinterpret_cast<const unsigned char *>(pending.data());
+      const size_t len = (size_t{p[0]} << 24) | (size_t{p[1]} << 16) |
+                         (size_t{p[2]} << 8) | size_t{p[3]};
+      if (pending.size() < 4 + len)
+        break;
+      std::string frame = pending.substr(4, len);
+      pending.erase(0, 4 + len);
+      ok = ok && !frame.empty() &&
+           (!lines || (frame.back() == '\n' &&
+                       frame.find('\n') == frame.size() - 1));
+      done = done || frame.find(stop) != std::string::npos;
+      frames.push_back(std::move(frame));
+    }
+    if (done)
+      break;
+  }
+  return frames;
+}
+
+// Text of the CBOR items in one frame (definitions, then one record);
+// empty if the frame does not hold whole items.
+std::string decode_frame(coretrace::detail::cbor::TextDecoder &decoder,
+                         const std::string &frame) {
+  using Result = coretrace::detail::cbor::TextDecoder::Result;
+  std::string text;
+  size_t at = 0;
+  while (at < frame.size()) {
+    size_t consumed = 0;
+    if (decoder.next(frame.data() + at, frame.size() - at, consumed,
+                     text) != Result::Item)
+      return {};
+    at += consumed;
+  }
+  return text;
+}
+
+bool has(const std::vector<std::string> &frames, const std::string &text) {
+  for (const std::string &frame : frames)
+    if (frame.find(text) != std::string::npos)
+      return true;
+  return false;
+}
+
+} // namespace
+
+#endif
+
+int main() {
+#if defined(_WIN32)
+  return 0;
+#else
+  using namespace coretrace;
+
+  Logger logger;
+  logger.enable();
+  logger.set_prefix("==net==");
+
+  // ── TCP: frames, coalescing ──────────
+  uint16_t port = 0;
+  const int listener = open_loopback(SOCK_STREAM, port);
+  if (listener < 0)
+    return 1;
+
+  NetSinkOptions opts;
+  opts.flush_interval = std::chrono::milliseconds(10);
+  opts.reconnect_delay = std::chrono::milliseconds(10);
+  opts.max_reconnect_delay = std::chrono::milliseconds(50);
+  if (!logger.set_net_sink("127.0.0.1", port, opts))
+    return 1;
+  for (int i = 0; i < 1000; ++i)
+    logger.log(Level::Info, "line {}\n", i);
+  logger.log(Level::Info, "end\n");
+  logger.flush();
+
+  int conn = accept_within(listener, 3000);
+  bool frames_ok = false;
+  std::vector<std::string> frames = read_frames(conn, "end\n", frames_ok);
+  const SinkStats tcp = logger.sink_stats();
+  const bool tcp_ok = frames_ok && frames.size() == 1001 &&
+                      has({frames[0]}, "==net== [INFO] line 0\n") &&
+                      has({frames[999]}, " line 999\n") &&
+                      tcp.syscalls < 100;
+
+  // ── Reconnect ────────────────────────
+  // The collector drops the connection; records keep flowing and reach
+  // the next one as whole frames.
+  close(conn);
+  int second = -1;
+  for (int i = 0; i < 300 && second < 0; ++i) {
+    logger.log(Level::Info, "after {}\n", i);
+    logger.flush();
+    second = accept_within(listener, 10);
+  }
+  logger.log(Level::Info, "final\n");
+  logger.flush();
+  bool again_ok = false;
+  frames = read_frames(second, "final\n", again_ok);
+  const bool reconnect_ok =
+      second >= 0 && again_ok && has(frames, "final\n");
+  logger.reset_sink();
+  if (second >= 0)
+    close(second);
+
+  // ── Record framing ───────────────────
+  // A record is one frame whatever its bytes: a multi-line message, CBOR
+  // records (newline bytes inside, none at the end) and each record of a
+  // batch. Raw writes are framed at line ends.
+  if (!logger.set_net_sink("127.0.0.1", port, opts))
+    return 1;
+  logger.log(Level::Info, "two\nlines\n");
+  logger.set_layout(Layout::Cbor);
+  logger.log(Level::Info, "cbor\nsplit", kv("n", 10));
+  logger.log(Level::Info, "cbor end", kv("n", 0));
+  {
+    LogBatch batch(Level::Info, logger);
+    batch.add("batch {}", 1);
+    batch.add_line("batch 2");
+  }
+  logger.set_layout(Layout::Text);
+  logger.write_raw("raw\n", 4);
+  logger.log(Level::Info, "stop\n");
+  logger.flush();
+  conn = accept_within(listener, 3000);
+  bool framed_ok = false;
+  frames = read_frames(conn, "stop\n", framed_ok, false);
+  detail::cbor::TextDecoder decoder;
+  const std::string head = "|" + std::to_string(pid()) + "| ==net== [INFO] ";
+  const bool framing_ok =
+      framed_ok && frames.size() == 7 &&
+      frames[0] == head + "two\nlines\n" &&
+      decode_frame(decoder, frames[1]) == head + "cbor\nsplit n=10\n" &&
+      decode_frame(decoder, frames[2]) == head + "cbor end n=0\n" &&
+      decode_frame(decoder, frames[3]) == head + "batch 1\n" &&
+      decode_frame(decoder, frames[4]) == head + "batch 2\n" &&
+      frames[5] == "raw\n" && frames[6] == head + "stop\n";
+  logger.reset_sink();
+  if (conn >= 0)
+    close(conn);
+  close(listener);
+
+  // ── Bounded buffer, backoff ──────────
+  // Nobody listens yet: logging keeps its pace, the buffer drops the
+  // excess, and once a collector appears the loss is reported.
+  uint16_t late_port = 0;
+  const int probe = open_loopback(SOCK_STREAM, late_port);
+  close(probe);
+  NetSinkOptions small = opts;
+  small.buffer_size = 16 << 10;
+  if (!logger.set_net_sink("127.0.0.1", late_port, small))
+    return 1;
+  const Clock::time_point start = Clock::now();
+  for (int i = 0; i < 10000; ++i)
+    logger.log(Level::Info, "offline {} padding padding padding\n", i);
+  const std::chrono::duration<double> elapsed = Clock::now() - start;
+  const SinkStats offline = logger.sink_stats();
+
+  const int late = open_loopback(SOCK_STREAM, late_port);
+  conn = late < 0 ? -1 : accept_within(late, 3000);
+  logger.flush(); // the buffered records go out first
+  logger.log(Level::Info, "back\n");
+  logger.flush();
+  bool late_ok = false;
+  frames = read_frames(conn, "back\n", late_ok);
+  const bool buffer_ok =
+      elapsed.count() < 2.0 && offline.dropped_lines > 0 && late_ok &&
+      has(frames, " offline 0 ") && has(frames, "net overflow: dropped") &&
+      has(frames, "back\n");
+  logger.reset_sink();
+  if (conn >= 0)
+    close(conn);
+  if (late >= 0)
+    close(late);
+
+  // ── UDP ──────────────────────────────
+  uint16_t udp_port = 0;
+  const int udp = open_loopback(SOCK_DGRAM, udp_port);
+  NetSinkOptions datagram = opts;
+  datagram.protocol = NetProtocol::Udp;
+  if (udp < 0 || !logger.set_net_sink("127.0.0.1", udp_port, datagram))
+    return 1;
+  for (int i = 0; i < 200; ++i)
+    logger.log(Level::Info, "dgram {}\n", i);
+  logger.flush();
+  const SinkStats udp_stats = logger.sink_stats();
+  size_t datagrams = 0;
+  bool udp_frames_ok = true;
+  while (datagrams < 200 && readable(udp, 1000)) {
+    unsigned char buf[2048];
+    const ssize_t got = recv(udp, buf, sizeof(buf), 0);
+    const size_t len = (size_t{buf[0]} << 24) | (size_t{buf[1]} << 16) |
+                       (size_t{buf[2]} << 8) | size_t{buf[3]};
+    udp_frames_ok = udp_frames_ok && got >= 4 &&
+                    len + 4 == static_cast<size_t>(got) &&
+                    buf[got - 1] == '\n';
+    ++datagrams;
+  }
+  logger.reset_sink();
+  close(udp);
+  bool udp_ok = udp_frames_ok && datagrams == 200;
+#if defined(__linux__)
+  udp_ok = udp_ok && udp_stats.syscalls < 50;
+#endif
+
+  // Nobody listens at first: the refused sends make the sink reopen its
+  // socket, and records reach the collector once it is there.
+  uint16_t gone_port = 0;
+  close(open_loopback(SOCK_DGRAM, gone_port));
+  if (!logger.set_net_sink("127.0.0.1", gone_port, datagram))
+    return 1;
+  for (int i = 0; i < 20; ++i) {
+    logger.log(Level::Info, "refused {}\n", i);
+    logger.flush();
+  }
+  const int found = open_loopback(SOCK_DGRAM, gone_port);
+  bool udp_back_ok = false;
+  for (int i = 0; i < 100 && found >= 0 && !udp_back_ok; ++i) {
+    logger.log(Level::Info, "found\n");
+    logger.flush();
+    udp_back_ok = readable(found, 10);
+  }
+  logger.reset_sink();
+  if (found >= 0)
+    close(found);
+
+  const bool invalid_ok = !logger.set_net_sink("", 1) &&
+                          !logger.set_net_sink("127.0.0.1", 0);
+
+  if (!tcp_ok || !reconnect_ok || !framing_ok || !buffer_ok || !udp_ok ||
+      !udp_back_ok || !invalid_ok) {
+    std::fprintf(stderr,
+                 "tcp=%d (%zu frames, %llu syscalls) reconnect=%d "
+                 "framing=%d buffer=%d (%.2fs, %llu dropped) udp=%d (%zu) "
+                 "udp_back=%d invalid=%d\n",
+                 tcp_ok, frames.size(),
+                 static_cast<unsigned long long>(tcp.syscalls),
+                 reconnect_ok, framing_ok, buffer_ok, elapsed.count(),
+                 static_cast<unsigned long long>(offline.dropped_lines),
+                 udp_ok, datagrams, udp_back_ok, invalid_ok);
+    return 1;
+  }
+  return 0;
+#endif
+}
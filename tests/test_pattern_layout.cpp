@@ -0,0 +1,135 @@
+#include <coretrace/logger.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::mutex g_mutex;
+std::string g_capture;
+
+void capture_sink(const char *data, size_t size) {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  g_capture.append(data, size);
+}
+
+std::string pid_text() { return std::to_string(coretrace::pid()); }
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+
+  set_sink(capture_sink);
+  enable_logging();
+
+  // ── Compilation ──────────────────────
+  const bool reject_ok = !set_pattern("%") && !set_pattern("%q") &&
+                         !set_pattern("%{x") && !set_pattern("%2000v") &&
+                         layout() == Layout::Text;
+
+  // ── Conversions ──────────────────────
+  bool set_ok = set_pattern("%L %P %p: %v%%") &&
+                      layout() == Layout::Pattern;
+  log(Level::Warn, "hello {}\n", 1);
+  const bool basic_ok =
+      g_capture == "WARN " + pid_text() + " ==ct==: hello 1%\n";
+
+  // Padding, truncation, labels.
+  g_capture.clear();
+  set_ok = set_pattern("[%-5L|%5L|%.3v|%{mod=}m|%{mod=}m]") && set_ok;
+  log(Level::Info, Module("alloc"), "abcdef");
+  log(Level::Info, "abcdef");
+  const bool pad_ok = g_capture == "[INFO | INFO|abc|mod=alloc|mod=alloc]\n"
+                                   "[INFO | INFO|abc||]\n";
+
+  // Source location and timestamps follow their switches.
+  g_capture.clear();
+  set_ok = set_pattern("%f:%l%{ ts=}T %v") && set_ok;
+  log(Level::Info, "off");
+  set_source_location(true);
+  const int line = __LINE__ + 1;
+  log(Level::Info, "on");
+  set_source_location(false);
+  set_timestamps(true);
+  log(Level::Info, "t");
+  set_timestamps(false);
+  const size_t ts_at = g_capture.find(": ts=");
+  const bool switch_ok =
+      g_capture.rfind(": off\ntest_pattern_layout.cpp:" +
+                          std::to_string(line) + " on\n",
+                      0) == 0 &&
+      ts_at != std::string::npos && g_capture.size() == ts_at + 5 + 23 + 3 &&
+      g_capture[ts_at + 5 + 10] == 'T';
+
+  // ── logfmt ───────────────────────────
+  g_capture.clear();
+  set_ok = set_pattern(LOGFMT_PATTERN) && set_ok;
+  log(Level::Info, Module("net"), "peer up", kv("fd", 7), kv("host", "a b"));
+  const bool logfmt_ok =
+      g_capture == "level=INFO pid=" + pid_text() + " tid=" +
+                       std::to_string(thread_id()) +
+                       " prefix=\"==ct==\" module=net msg=\"peer up\" fd=7 "
+                       "host=\"a b\"\n";
+
+  // Long lines spill over several sink calls, still whole.
+  g_capture.clear();
+  set_ok = set_pattern("<%v>") && set_ok;
+  const std::string big(3000, 'x');
+  log(Level::Info, "{}", big);
+  const bool long_ok = g_capture == "<" + big + ">\n";
+
+  // ── Batches ──────────────────────────
+  g_capture.clear();
+  set_ok = set_pattern("%L %m %v.") && set_ok;
+  {
+    LogBatch batch(Level::Error, Module("b"));
+    batch.add("a {}\n", 1);
+    batch.add_line("b");
+  }
+  const bool batch_ok = g_capture == "ERROR b a 1.\nERROR b b.\n";
+
+  // ── Swaps under load ─────────────────
+  // Threads keep logging while the pattern changes; every line must come
+  // from one of the two programs.
+  set_ok = set_pattern("A %v") && set_ok;
+  g_capture.clear();
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 4; ++t) {
+    writers.emplace_back([&stop]() {
+      while (!stop.load(std::memory_order_relaxed))
+        log(Level::Info, "m");
+    });
+  }
+  for (int i = 0; i < 200; ++i)
+    set_ok = set_pattern(i % 2 ? "A %v" : "B %v") && set_ok;
+  stop.store(true);
+  for (std::thread &writer : writers)
+    writer.join();
+  bool swap_ok = true;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    for (size_t at = 0; at < g_capture.size() && swap_ok; at += 4)
+      swap_ok = g_capture.compare(at, 4, "A m\n") == 0 ||
+                g_capture.compare(at, 4, "B m\n") == 0;
+  }
+
+  set_layout(Layout::Text);
+  reset_sink();
+
+  if (!reject_ok || !set_ok || !basic_ok || !pad_ok || !switch_ok ||
+      !logfmt_ok || !long_ok || !batch_ok || !swap_ok) {
+    std::fprintf(stderr,
+                 "reject=%d set=%d basic=%d pad=%d switch=%d logfmt=%d "
+                 "long=%d batch=%d swap=%d\n  last: %.300s\n",
+                 reject_ok, set_ok, basic_ok, pad_ok, switch_ok, logfmt_ok,
+                 long_ok, batch_ok, swap_ok, g_capture.c_str());
+    return 1;
+  }
+  return 0;
+}
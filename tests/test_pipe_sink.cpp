@@ -0,0 +1,120 @@
+#include <coretrace/logger.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+std::string read_file(const fs::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream out;
+  out << in.rdbuf();
+  return out.str();
+}
+
+size_t count_of(const std::string &haystack, const char *needle) {
+  size_t count = 0;
+  for (size_t pos = haystack.find(needle); pos != std::string::npos;
+       pos = haystack.find(needle, pos + 1))
+    ++count;
+  return count;
+}
+
+} // namespace
+
+int main() {
+#if defined(_WIN32)
+  return 0;
+#else
+  using namespace coretrace;
+
+  const fs::path dir = fs::temp_directory_path();
+  const fs::path out = dir / "coretrace_test_pipe.log";
+  const fs::path restarted = dir / "coretrace_test_pipe_restart.log";
+  fs::remove(out);
+  fs::remove(restarted);
+
+  Logger logger;
+  logger.enable();
+  logger.set_prefix("==pipe==");
+
+  // ── Streaming through cat ────────────
+  PipeSinkOptions opts;
+  opts.buffer_size = 8192;
+  if (!logger.set_pipe_sink("cat > '" + out.string() + "'", opts))
+    return 1;
+  for (int i = 0; i < 5000; ++i)
+    logger.log(Level::Info, "line {}\n", i);
+  logger.flush();
+  const SinkStats streamed = logger.sink_stats();
+  logger.reset_sink(); // EOF; waits for cat to exit
+
+  const std::string text = read_file(out);
+  const bool stream_ok =
+      count_of(text, "==pipe== [INFO] line ") == 5000 &&
+      count_of(text, " line 4999\n") == 1 &&
+      text.find(" line 10\n") < text.find(" line 11\n") &&
+      streamed.bytes_written == text.size() && streamed.dropped_bytes == 0;
+
+  // ── Restart ──────────────────────────
+  // Every child takes one line and exits; later lines reach new children
+  // and nothing raises SIGPIPE in this process.
+  PipeSinkOptions once = opts;
+  once.restart_delay = std::chrono::milliseconds(0);
+  if (!logger.set_pipe_sink("head -n 1 >> '" + restarted.string() + "'",
+                            once))
+    return 1;
+  for (int i = 0; i < 20; ++i) {
+    logger.log(Level::Info, "restart {}\n", i);
+    logger.flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  }
+  logger.reset_sink();
+  const size_t survivors = count_of(read_file(restarted), " restart ");
+  const bool restart_ok = survivors >= 3;
+
+  // ── Overflow ─────────────────────────
+  // A child that never reads: logging keeps its pace and drops.
+  PipeSinkOptions tiny;
+  tiny.buffer_size = 4096;
+  tiny.buffer_count = 2;
+  tiny.drain_timeout = std::chrono::milliseconds(100);
+  if (!logger.set_pipe_sink("sleep 30", tiny))
+    return 1;
+  const Clock::time_point start = Clock::now();
+  for (int i = 0; i < 20000; ++i)
+    logger.log(Level::Info, "filler line {} padding padding padding\n", i);
+  const std::chrono::duration<double> elapsed = Clock::now() - start;
+  const SinkStats full = logger.sink_stats();
+  logger.reset_sink(); // kills the sleeper after drain_timeout
+  const std::chrono::duration<double> closed = Clock::now() - start;
+  const bool overflow_ok = elapsed.count() < 5.0 && closed.count() < 10.0 &&
+                           full.dropped_lines > 0 && full.bytes_written > 0;
+
+  const bool missing_ok = !logger.set_pipe_sink("", opts);
+
+  fs::remove(out);
+  fs::remove(restarted);
+
+  if (!stream_ok || !restart_ok || !overflow_ok || !missing_ok) {
+    std::fprintf(stderr,
+                 "stream=%d (%zu bytes, %llu written) restart=%d (%zu) "
+                 "overflow=%d (%.2fs, %llu dropped) missing=%d\n",
+                 stream_ok, text.size(),
+                 static_cast<unsigned long long>(streamed.bytes_written),
+                 restart_ok, survivors, overflow_ok, elapsed.count(),
+                 static_cast<unsigned long long>(full.dropped_lines),
+                 missing_ok);
+    return 1;
+  }
+  return 0;
+#endif
+}
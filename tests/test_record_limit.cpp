@@ -0,0 +1,131 @@
+#include <coretrace/logger.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> g_calls;
+
+void capture_sink(const char *data, size_t size) {
+  g_calls.emplace_back(data, size);
+}
+
+std::string read_file(const char *path) {
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream all;
+  all << in.rdbuf();
+  return all.str();
+}
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+
+  const char *blob_path = "test_record_limit.blob";
+  std::remove(blob_path);
+
+  set_sink(capture_sink);
+  enable_logging();
+  const std::string head = "|" + std::to_string(pid()) + "| ==ct== [INFO] ";
+  const std::string ellipsis = "\xe2\x80\xa6";
+
+  // ── Limits ───────────────────────────
+  const bool default_ok = max_record_size() == 0;
+  set_max_record_size(10);
+  const bool clamp_ok = max_record_size() == MIN_RECORD_SIZE;
+
+  // Short messages are untouched.
+  set_max_record_size(200);
+  log(Level::Info, "short\n");
+  const bool short_ok = g_calls.size() == 1 && g_calls[0] == head + "short\n";
+
+  // ── Clipping ─────────────────────────
+  // Formatted: the marker counts every dropped byte, newline kept.
+  g_calls.clear();
+  const std::string big(1 << 20, 'x');
+  log(Level::Info, "{}\n", big);
+  const std::string marker = ellipsis + "[+" +
+                             std::to_string(big.size() - 180) + " bytes]";
+  const bool clip_ok =
+      g_calls.size() == 1 &&
+      g_calls[0] == head + std::string(180, 'x') + marker + "\n" &&
+      g_calls[0].size() - head.size() == 200;
+
+  // Unformatted messages are cut the same way.
+  g_calls.clear();
+  log(Level::Info, big);
+  const bool plain_ok = g_calls.size() == 1 &&
+                        g_calls[0].size() - head.size() <= 200 + 1 &&
+                        g_calls[0].find(ellipsis + "[+") != std::string::npos;
+
+  // The cut never splits a UTF-8 sequence.
+  g_calls.clear();
+  std::string wide;
+  while (wide.size() < 1000)
+    wide += "\xc3\xa9"; // é
+  log(Level::Info, "{}", wide);
+  const std::string body = g_calls.empty() ? "" : g_calls[0].substr(
+                                                      head.size());
+  const size_t cut = body.find(ellipsis);
+  const bool utf8_ok = cut != std::string::npos && cut % 2 == 0 &&
+                       body.compare(0, cut, wide, 0, cut) == 0 &&
+                       body.find("[+" + std::to_string(wide.size() - cut) +
+                                 " bytes]") != std::string::npos;
+
+  // ── Batches ──────────────────────────
+  g_calls.clear();
+  {
+    LogBatch batch(Level::Info);
+    batch.add("{}\n", big);
+    batch.add_line("after\n");
+  }
+  const std::string batched = g_calls.empty() ? "" : g_calls[0];
+  const bool batch_ok =
+      g_calls.size() == 1 &&
+      batched == head + std::string(180, 'x') + marker + "\n" + head +
+                     "after\n";
+
+  // ── Blob file ────────────────────────
+  const bool open_ok = set_blob_file(blob_path);
+  g_calls.clear();
+  const std::string payload = std::string(500, 'a') + "tail";
+  log(Level::Info, "{}\n", payload);
+  log(Level::Info, "{}", std::string(300, 'b'));
+  const std::string id1 = std::to_string(pid()) + "-1";
+  const std::string id2 = std::to_string(pid()) + "-2";
+  const bool reference_ok =
+      g_calls.size() == 2 &&
+      g_calls[0].find(", blob " + id1 + "]\n") != std::string::npos &&
+      g_calls[0].size() - head.size() == 200 &&
+      g_calls[1].find(", blob " + id2 + "]") != std::string::npos;
+  const bool close_ok = set_blob_file("");
+  const bool blob_ok =
+      read_file(blob_path) == "#blob " + id1 + " " +
+                                  std::to_string(payload.size() + 1) + "\n" +
+                                  payload + "\n\n" + "#blob " + id2 +
+                                  " 300\n" + std::string(300, 'b') + "\n";
+  const bool missing_ok = !set_blob_file("/nonexistent-dir/x.blob");
+
+  set_max_record_size(0);
+  reset_sink();
+  std::remove(blob_path);
+
+  if (!default_ok || !clamp_ok || !short_ok || !clip_ok || !plain_ok ||
+      !utf8_ok || !batch_ok || !open_ok || !reference_ok || !close_ok ||
+      !blob_ok || !missing_ok) {
+    std::fprintf(stderr,
+                 "default=%d clamp=%d short=%d clip=%d plain=%d utf8=%d "
+                 "batch=%d open=%d reference=%d close=%d blob=%d "
+                 "missing=%d\n",
+                 default_ok, clamp_ok, short_ok, clip_ok, plain_ok, utf8_ok,
+                 batch_ok, open_ok, reference_ok, close_ok, blob_ok,
+                 missing_ok);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,155 @@
+#include <coretrace/logger.hpp>
+
+#include "logger_sanitize.hpp"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> g_calls;
+
+void capture_sink(const char *data, size_t size) {
+  g_calls.emplace_back(data, size);
+}
+
+std::string sanitized(std::string_view value) {
+  std::string out;
+  coretrace::detail::sanitize::append_sanitized(out, value);
+  return out;
+}
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+  namespace sanitize = detail::sanitize;
+
+  // ── Scanner ──────────────────────────
+  // The vectorized scan stops where the scalar one does, at every offset.
+  std::mt19937 rng(3);
+  const char alphabet[] = "ab \t\n~\x7f\x1b\x01\x80\xc3";
+  bool scan_ok = true;
+  for (int trial = 0; trial < 2000 && scan_ok; ++trial) {
+    std::string text(1 + rng() % 100, 'x');
+    const size_t special = rng() % (text.size() + 8);
+    if (special < text.size())
+      text[special] = alphabet[rng() % (sizeof(alphabet) - 1)];
+    for (size_t skew = 0; skew < text.size() && scan_ok; skew += 7)
+      scan_ok = sanitize::ascii_run(text.data() + skew, text.size() - skew) ==
+                sanitize::ascii_run_scalar(text.data() + skew,
+                                           text.size() - skew);
+  }
+
+  // Whole-block UTF-8 validation agrees with the sequence-at-a-time check:
+  // mostly well-formed text with one damaged spot anywhere.
+  const char *const pieces[] = {"a", "~", "\xc3\xa9", "\xe4\xb8\xad",
+                                "\xf0\x9f\x98\x80", "\xc2\xa0",
+                                "\xef\xbf\xbd", "\xf4\x8f\xbf\xbf"};
+  const char *const damage[] = {"\x80", "\xc3", "\xe4\xb8", "\xf0\x9f\x98",
+                                "\xc0\xaf", "\xe0\x9f\xbf", "\xed\xa0\x80",
+                                "\xf4\x90\x80\x80", "\xf8", "\xc2\x85",
+                                "\x1b", "\x7f", "\r"};
+  for (int trial = 0; trial < 20000 && scan_ok; ++trial) {
+    std::string text;
+    const size_t target = rng() % 160;
+    const size_t damage_at = rng() % 200;
+    while (text.size() < target) {
+      if (text.size() >= damage_at && trial % 8 != 0) {
+        text += damage[rng() % (sizeof(damage) / sizeof(damage[0]))];
+        if (trial % 3 == 0)
+          break; // damage at the very end
+        text += pieces[rng() % (sizeof(pieces) / sizeof(pieces[0]))];
+        text += std::string(rng() % 40, 'z');
+        break;
+      }
+      text += pieces[rng() % (sizeof(pieces) / sizeof(pieces[0]))];
+    }
+    scan_ok = sanitize::clean_prefix(text.data(), text.size()) ==
+              sanitize::clean_prefix_scalar(text.data(), text.size());
+  }
+
+  // ── Rewriting ────────────────────────
+  const std::string clean = "plain\ttext é 中 \xf0\x9f\x98\x80 ~\n";
+  const std::string fffd = "\xef\xbf\xbd";
+  const bool clean_ok =
+      sanitize::clean_prefix(clean.data(), clean.size()) == clean.size() &&
+      sanitized(clean) == clean;
+  const bool control_ok =
+      sanitized("\x1b[31mred\r\n\x7f") == "\\x1b[31mred\\x0d\n\\x7f" &&
+      sanitized(std::string_view("a\0b", 3)) == "a\\x00b";
+  const bool c1_ok = sanitized("x\xc2\x9by\xc2\xa0") == "x\\u009by\xc2\xa0";
+  // One U+FFFD per maximal ill-formed subpart.
+  const bool invalid_ok =
+      sanitized("a\xff") == "a" + fffd &&
+      sanitized("\xe0\x80\x80") == fffd + fffd + fffd &&     // overlong
+      sanitized("\xed\xa0\x80") == fffd + fffd + fffd &&     // surrogate
+      sanitized("\xf4\x90\x80\x80") == fffd + fffd + fffd + fffd &&
+      sanitized("\xe4\xb8x") == fffd + "x" &&                // cut short
+      sanitized("\xf0\x9f\x98") == fffd &&                   // at the end
+      sanitized("\xc0\xaf") == fffd + fffd;
+
+  // ── Logger ───────────────────────────
+  set_sink(capture_sink);
+  enable_logging();
+  const std::string head = "|" + std::to_string(pid()) + "| ==ct== [INFO] ";
+  const std::string hostile = "\x1b[2Jroot\xff\n";
+
+  const bool default_ok = !sanitize_enabled();
+  log(Level::Info, "user={}", hostile);
+  const bool off_ok = g_calls.size() == 1 && g_calls[0] == head + "user=" +
+                                                               hostile;
+
+  g_calls.clear();
+  set_sanitize(true);
+  log(Level::Info, "user={}", hostile);
+  log(Level::Info, "{}", clean);
+  log(Level::Info, Module("auth"), hostile, kv("who", "a\x1b"));
+  {
+    LogBatch batch(Level::Info);
+    batch.add("user={}", hostile);
+    batch.add_line(clean);
+  }
+  const std::string rewritten = "\\x1b[2Jroot" + fffd + "\n";
+  const bool on_ok =
+      g_calls.size() == 4 && g_calls[0] == head + "user=" + rewritten &&
+      g_calls[1] == head + clean &&
+      g_calls[2] == head + "(auth) \\x1b[2Jroot" + fffd +
+                        " who=\"a\\x1b\"\n" &&
+      g_calls[3] == head + "user=" + rewritten + head + clean;
+
+  // With a record size cap the message is cut after escaping: it stays
+  // within the cap and the marker counts the escaped bytes dropped.
+  g_calls.clear();
+  set_max_record_size(200);
+  const std::string controls(300, '\x01');
+  log(Level::Info, "{}\n", controls);
+  set_max_record_size(0);
+  const std::string body =
+      g_calls.size() == 1 ? g_calls[0].substr(head.size()) : "";
+  const size_t cut = body.find("\xe2\x80\xa6");
+  const bool limit_ok =
+      body.size() <= 200 && cut != std::string::npos &&
+      body.compare(cut + 3, std::string::npos,
+                   "[+" + std::to_string(controls.size() * 4 - cut) +
+                       " bytes]\n") == 0;
+
+  set_sanitize(false);
+  reset_sink();
+
+  if (!scan_ok || !clean_ok || !control_ok || !c1_ok || !invalid_ok ||
+      !default_ok || !off_ok || !on_ok || !limit_ok) {
+    std::fprintf(stderr,
+                 "scan=%d clean=%d control=%d c1=%d invalid=%d default=%d "
+                 "off=%d on=%d limit=%d (%s)\n",
+                 scan_ok, clean_ok, control_ok, c1_ok, invalid_ok,
+                 default_ok, off_ok, on_ok, limit_ok,
+                 sanitize::ascii_run_engine());
+    for (const std::string &call : g_calls)
+      std::fprintf(stderr, "  %s", call.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,152 @@
+#include <coretrace/logger.hpp>
+
+#include "logger_sink.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+std::string read_file(const fs::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream out;
+  out << in.rdbuf();
+  return out.str();
+}
+
+// Every line of a shard starts with "@<20 digits> <seq> ": sequence
+// numbers count up from 0 and timestamps never go back.
+bool check_shard(const std::string &text, size_t expected_records) {
+  size_t records = 0;
+  unsigned long long last_stamp = 0;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    const size_t nl = text.find('\n', pos);
+    if (nl == std::string::npos)
+      return false;
+    const std::string line = text.substr(pos, nl - pos);
+    pos = nl + 1;
+
+    if (line.size() < 24 || line[0] != '@' || line[21] != ' ')
+      return false;
+    const unsigned long long stamp =
+        std::strtoull(line.substr(1, 20).c_str(), nullptr, 10);
+    char *end = nullptr;
+    const unsigned long long seq =
+        std::strtoull(line.c_str() + 22, &end, 10);
+    if (seq != records || *end != ' ' || stamp < last_stamp)
+      return false;
+    last_stamp = stamp;
+    ++records;
+  }
+  return records == expected_records;
+}
+
+} // namespace
+
+int main() {
+  using namespace coretrace;
+
+  const fs::path dir = fs::temp_directory_path() / "coretrace_test_shards";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  const std::string base = (dir / "app").string();
+
+  Logger logger;
+  logger.enable();
+  logger.set_prefix("==sh==");
+
+  ShardedSinkOptions opts;
+  opts.buffer_size = 4096;
+  opts.flush_interval = std::chrono::milliseconds(0);
+  if (!logger.set_sharded_sink(base, opts))
+    return 1;
+
+  constexpr int THREADS = 4;
+  constexpr int LINES = 2000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; ++t) {
+    threads.emplace_back([&logger, t]() {
+      for (int i = 0; i < LINES; ++i)
+        logger.log(Level::Info, "thread {} line {}\n", t, i);
+    });
+  }
+  for (std::thread &thread : threads)
+    thread.join();
+
+  // A message longer than a line buffer reaches the sink in two writes
+  // but stays one record (one header).
+  const std::string wide(5000, 'w');
+  logger.log(Level::Info, "{}\n", wide);
+
+  const SinkStats stats = logger.sink_stats();
+  logger.reset_sink();
+
+  size_t shards = 0;
+  bool shards_ok = true;
+  bool wide_ok = false;
+  for (const fs::directory_entry &entry : fs::directory_iterator(dir)) {
+    const std::string name = entry.path().filename().string();
+    if (name.rfind("app.", 0) != 0 || entry.path().extension() != ".log")
+      continue;
+    ++shards;
+    const std::string text = read_file(entry.path());
+    if (text.find(wide) != std::string::npos) {
+      wide_ok = check_shard(text, 1);
+      continue;
+    }
+    shards_ok = shards_ok && check_shard(text, LINES);
+  }
+
+  // A missing directory is refused.
+  const bool bad_dir_ok =
+      !logger.set_sharded_sink((dir / "missing" / "app").string());
+
+  // Shards are read back as lines: no CBOR, whichever comes first.
+  logger.set_layout(Layout::Cbor);
+  bool binary_ok = !logger.set_sharded_sink(base, opts);
+  logger.set_layout(Layout::Text);
+  binary_ok = binary_ok && logger.set_sharded_sink(base, opts);
+  logger.set_layout(Layout::Cbor);
+  binary_ok = binary_ok && logger.layout() == Layout::Text;
+  logger.reset_sink();
+
+  // Writes after close are counted as dropped lines, with or without a
+  // shard for the thread.
+  std::unique_ptr<detail::SinkBackend> used =
+      detail::make_sharded_sink(base, opts);
+  std::unique_ptr<detail::SinkBackend> unused =
+      detail::make_sharded_sink(base, opts);
+  used->write("open\n", 5, Level::Info);
+  used->close();
+  unused->close();
+  used->write("a\nb\n", 4, Level::Info);
+  unused->write("c\n", 2, Level::Info);
+  const bool dropped_ok = used->stats().dropped_lines == 2 &&
+                          unused->stats().dropped_lines == 1 &&
+                          used->stats().dropped_bytes == 4;
+
+  fs::remove_all(dir);
+
+  const bool stats_ok = stats.bytes_written > 0 && stats.dropped_bytes == 0;
+  if (shards != THREADS + 1 || !shards_ok || !wide_ok || !stats_ok ||
+      !bad_dir_ok || !binary_ok || !dropped_ok) {
+    std::fprintf(stderr,
+                 "shards=%zu ok=%d wide=%d stats=%d bad_dir=%d binary=%d "
+                 "dropped=%d\n",
+                 shards, shards_ok, wide_ok, stats_ok, bad_dir_ok, binary_ok,
+                 dropped_ok);
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,131 @@
+#include <coretrace/logger.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+int main() {
+#if defined(_WIN32)
+  return 0;
+#else
+  using namespace coretrace;
+  using Clock = std::chrono::steady_clock;
+
+  // stderr becomes a pipe nobody reads yet.
+  int fds[2];
+  if (pipe(fds) != 0)
+    return 1;
+  std::fflush(stderr);
+  const int saved = dup(2);
+  if (saved < 0 || dup2(fds[1], 2) < 0)
+    return 1;
+
+  StderrOptions opts;
+  opts.overflow_bytes = 8192;
+  if (!set_stderr_nonblocking(true, opts)) {
+    dup2(saved, 2);
+    return 0; // not supported here
+  }
+
+  Logger logger;
+  logger.enable();
+  logger.set_prefix("==nb==");
+
+  // About 1 MiB against a 64 KiB pipe: must return, dropping the rest.
+  const Clock::time_point start = Clock::now();
+  for (int i = 0; i < 20000; ++i)
+    logger.log(Level::Info, "filler line {} padding padding padding\n", i);
+  const std::chrono::duration<double> elapsed = Clock::now() - start;
+  const SinkStats full = stderr_stats();
+
+  // Once the reader catches up, the drain thread reports the loss.
+  std::string seen;
+  const Clock::time_point deadline = Clock::now() + std::chrono::seconds(10);
+  while (seen.find("stderr overflow: dropped") == std::string::npos &&
+         Clock::now() < deadline) {
+    pollfd pfd{};
+    pfd.fd = fds[0];
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 50) <= 0)
+      continue;
+    char buf[4096];
+    const ssize_t got = read(fds[0], buf, sizeof(buf));
+    if (got > 0)
+      seen.append(buf, static_cast<size_t>(got));
+  }
+  const bool reported =
+      seen.find("stderr overflow: dropped") != std::string::npos;
+
+  (void)set_stderr_nonblocking(false);
+  close(fds[0]);
+  close(fds[1]);
+
+  // The reader goes away while bytes are parked: writes now fail with
+  // EPIPE. The drain thread drops the parked bytes and waits instead of
+  // retrying under the ring lock, so callers still get through.
+  std::signal(SIGPIPE, SIG_IGN);
+  if (pipe(fds) != 0 || dup2(fds[1], 2) < 0 ||
+      !set_stderr_nonblocking(true, opts))
+    return 1;
+  const SinkStats before = stderr_stats();
+  const std::string line = std::string(100, 'x') + "\n";
+  for (int i = 0; i < 1500; ++i)
+    write_stderr(line.data(), line.size());
+  close(fds[0]);
+
+  std::atomic<bool> answered{false};
+  std::thread probe([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    write_stderr(line.data(), line.size());
+    (void)stderr_stats();
+    answered.store(true, std::memory_order_release);
+  });
+  for (int i = 0; i < 500 && !answered.load(std::memory_order_acquire); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  if (!answered.load(std::memory_order_acquire)) {
+    dup2(saved, 2);
+    std::fprintf(stderr, "stderr_stats() blocked after EPIPE\n");
+    std::_Exit(1);
+  }
+  probe.join();
+
+  // Idle with the reader gone: the drain thread does not spin.
+  const std::clock_t cpu_start = std::clock();
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  const double cpu =
+      static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+  const SinkStats after = stderr_stats();
+  (void)set_stderr_nonblocking(false);
+  dup2(saved, 2);
+  close(saved);
+  close(fds[1]);
+
+  const bool broken_ok =
+      cpu < 0.1 && after.dropped_bytes > before.dropped_bytes;
+
+  const bool ok = elapsed.count() < 5.0 && full.dropped_bytes > 0 &&
+                  full.dropped_lines > 0 && full.bytes_written > 0 &&
+                  seen.find("==nb== [INFO] filler line 0 ") < 64 &&
+                  reported && broken_ok;
+  if (!ok)
+    std::fprintf(stderr,
+                 "elapsed=%.2fs written=%llu dropped=%llu bytes/%llu lines "
+                 "reported=%d broken=%d (cpu=%.2fs)\n",
+                 elapsed.count(),
+                 static_cast<unsigned long long>(full.bytes_written),
+                 static_cast<unsigned long long>(full.dropped_bytes),
+                 static_cast<unsigned long long>(full.dropped_lines),
+                 reported, broken_ok, cpu);
+  return ok ? 0 : 1;
+#endif
+}
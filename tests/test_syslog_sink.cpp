@@ -0,0 +1,278 @@
+#include <coretrace/logger.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#if !defined(_WIN32)
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// Stand-in for /dev/log: collects datagrams, and the contents of memfds
+// passed along with them, until stopped.
+class FakeDaemon {
+public:
+  explicit FakeDaemon(const std::string &path) {
+    fd_ = socket(AF_UNIX, SOCK_DGRAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    ok_ = fd_ >= 0 && bind(fd_, reinterpret_cast<const sockaddr *>(&addr),
+                           sizeof(addr)) == 0;
+    timeval timeout{0, 20000};
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    reader_ = std::thread([this]() { run(); });
+  }
+
+  ~FakeDaemon() {
+    stop_.store(true);
+    reader_.join();
+    close(fd_);
+  }
+
+  [[nodiscard]] bool ok() const { return ok_; }
+
+  // Wait until count records arrived; returns them all.
+  std::vector<std::string> wait_for(size_t count) {
+    for (int i = 0; i < 200; ++i) {
+      {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (records_.size() >= count)
+          return records_;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    return records_;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    records_.clear();
+  }
+
+private:
+  void run() {
+    std::vector<char> buf(1 << 16);
+    while (!stop_.load()) {
+      alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+      iovec iov{buf.data(), buf.size()};
+      msghdr msg{};
+      msg.msg_iov = &iov;
+      msg.msg_iovlen = 1;
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      const ssize_t got = recvmsg(fd_, &msg, 0);
+      if (got < 0)
+        continue;
+
+      std::string record(buf.data(), static_cast<size_t>(got));
+      cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+      if (cmsg && cmsg->cmsg_type == SCM_RIGHTS) {
+        int memfd = -1;
+        std::memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+        record = "memfd:";
+        ssize_t n;
+        off_t offset = 0;
+        while ((n = pread(memfd, buf.data(), buf.size(), offset)) > 0) {
+          record.append(buf.data(), static_cast<size_t>(n));
+          offset += n;
+        }
+        close(memfd);
+      }
+      std::lock_guard<std::mutex> guard(mutex_);
+      records_.push_back(std::move(record));
+    }
+  }
+
+  int fd_ = -1;
+  bool ok_ = false;
+  std::atomic<bool> stop_{false};
+  std::thread reader_;
+  std::mutex mutex_;
+  std::vector<std::string> records_;
+};
+
+bool starts_with(const std::string &text, const char *prefix) {
+  return text.rfind(prefix, 0) == 0;
+}
+
+bool contains(const std::string &text, const std::string &needle) {
+  return text.find(needle) != std::string::npos;
+}
+
+} // namespace
+
+#endif
+
+int main() {
+#if defined(_WIN32)
+  return 0;
+#else
+  using namespace coretrace;
+
+  const fs::path socket_path =
+      fs::temp_directory_path() / "coretrace_test_syslog.sock";
+  fs::remove(socket_path);
+  FakeDaemon daemon(socket_path.string());
+  if (!daemon.ok())
+    return 1;
+
+  Logger logger;
+  logger.enable();
+  logger.set_min_level(Level::Debug);
+
+  // ── RFC 5424 ─────────────────────────
+  SyslogSinkOptions opts;
+  opts.path = socket_path.string();
+  opts.ident = "cttest";
+  if (!logger.set_syslog_sink(opts))
+    return 1;
+
+  logger.log(Level::Debug, "debug {}\n", 1);
+  logger.log(Level::Info, Module("alloc"), "info \"q\"\n");
+  logger.log(Level::Warn, "warn\n");
+  logger.log(Level::Error, "error\n");
+  logger.log(Level::Info, Module("alloc"), "malloc", kv("size", 64),
+             kv("tag", "a]b"));
+  logger.flush();
+
+  std::vector<std::string> got = daemon.wait_for(5);
+  const std::string tail = " cttest " + std::to_string(pid()) + " - ";
+  const bool rfc_ok =
+      got.size() == 5 && starts_with(got[0], "<15>1 ") &&
+      starts_with(got[1], "<14>1 ") && starts_with(got[2], "<12>1 ") &&
+      starts_with(got[3], "<11>1 ") && contains(got[0], tail + "- debug 1") &&
+      contains(got[1], tail + "[coretrace@32473 module=\"alloc\"] info") &&
+      got[3].back() == 'r' &&
+      contains(got[4], "[coretrace@32473 module=\"alloc\" size=\"64\" "
+                       "tag=\"a\\]b\"] malloc");
+
+  // Batching: many records per system call.
+  daemon.clear();
+  for (int i = 0; i < 256; ++i)
+    logger.log(Level::Info, "batched {}\n", i);
+  logger.flush();
+  const SinkStats batched = logger.sink_stats();
+  got = daemon.wait_for(256);
+  bool batch_ok = got.size() == 256 && contains(got[255], "batched 255") &&
+                  batched.dropped_lines == 0;
+#if defined(__linux__)
+  batch_ok = batch_ok && batched.syscalls < 64;
+#endif
+
+  // LogBatch: one datagram per record, with the batch's module.
+  daemon.clear();
+  {
+    LogBatch dump(Level::Warn, Module("alloc"), logger);
+    dump.add("blk {}\n", 1);
+    dump.add_line("blk 2\n");
+  }
+  logger.flush();
+  got = daemon.wait_for(2);
+  const bool log_batch_ok =
+      got.size() == 2 && starts_with(got[0], "<12>1 ") &&
+      contains(got[0], tail + "[coretrace@32473 module=\"alloc\"] blk 1") &&
+      got[0].back() == '1' &&
+      contains(got[1], tail + "[coretrace@32473 module=\"alloc\"] blk 2");
+
+  // ── journald ─────────────────────────
+  daemon.clear();
+  opts.format = SyslogFormat::Journald;
+  opts.max_datagram = 1024;
+  if (!logger.set_syslog_sink(opts))
+    return 1;
+  logger.set_source_location(true);
+  logger.log(Level::Warn, Module("net"), "two\nlines\n");
+  logger.log(Level::Info, "conn", kv("peer-addr", "10.0.0.1"),
+             kv("2x", 1.5));
+  const std::string big(4000, 'z');
+  logger.log(Level::Info, "{}\n", big);
+  logger.reset_sink();
+
+  got = daemon.wait_for(3);
+  const std::string binary_message =
+      std::string("MESSAGE\n") + '\x09' + std::string(7, '\0') +
+      "two\nlines\n";
+  bool journal_ok =
+      got.size() == 3 && starts_with(got[0], "PRIORITY=4\n") &&
+      contains(got[0], "SYSLOG_IDENTIFIER=cttest\n") &&
+      contains(got[0], "CORETRACE_MODULE=net\n") &&
+      contains(got[0], "CODE_FILE=") && contains(got[0], binary_message) &&
+      contains(got[1], "PEER_ADDR=10.0.0.1\nF2X=1.5\n") &&
+      contains(got[1], "MESSAGE=conn\n");
+#if defined(__linux__)
+  // Too large for a datagram: passed as a sealed memfd.
+  journal_ok = journal_ok && starts_with(got[2], "memfd:PRIORITY=6\n") &&
+               contains(got[2], "MESSAGE=" + big + "\n");
+#endif
+
+  // ── Sink switches ────────────────────
+  // Records in flight while the sink changes reach the old sink before
+  // it closes, or the new one; none go into a closed sink.
+  daemon.clear();
+  opts.format = SyslogFormat::Rfc5424;
+  static std::atomic<int> captured{0};
+  captured.store(0);
+  const SinkFn capture = [](const char *data, size_t size) {
+    if (std::string_view(data, size).find("switch ") !=
+        std::string_view::npos)
+      captured.fetch_add(1);
+  };
+  constexpr int SWITCHED = 2000;
+  std::atomic<bool> writing{true};
+  std::thread writer([&]() {
+    for (int i = 0; i < SWITCHED; ++i)
+      logger.log(Level::Info, "switch {}\n", i);
+    writing.store(false);
+  });
+  bool switch_ok = true;
+  while (writing.load()) {
+    switch_ok = logger.set_syslog_sink(opts) && switch_ok;
+    logger.set_sink(capture);
+  }
+  writer.join();
+  logger.reset_sink();
+  got = daemon.wait_for(static_cast<size_t>(SWITCHED - captured.load()));
+  switch_ok = switch_ok &&
+              static_cast<int>(got.size()) + captured.load() == SWITCHED;
+
+  const bool missing_ok = [&]() {
+    SyslogSinkOptions none;
+    none.path = (fs::temp_directory_path() / "coretrace_no_such.sock")
+                    .string();
+    return !logger.set_syslog_sink(none);
+  }();
+
+  fs::remove(socket_path);
+
+  if (!rfc_ok || !batch_ok || !log_batch_ok || !journal_ok || !switch_ok ||
+      !missing_ok) {
+    std::fprintf(stderr, "rfc5424=%d batch=%d (%llu syscalls) log_batch=%d "
+                         "journald=%d switch=%d (%zu + %d) missing=%d\n",
+                 rfc_ok, batch_ok,
+                 static_cast<unsigned long long>(batched.syscalls),
+                 log_batch_ok,
+                 journal_ok, switch_ok, got.size(), captured.load(),
+                 missing_ok);
+    for (const std::string &record : got)
+      std::fprintf(stderr, "  %.120s\n", record.c_str());
+    return 1;
+  }
+  return 0;
+#endif
+}
@@ -0,0 +1,143 @@
+// ct-logcbor: print files written with Layout::Cbor in the text layout.
+//
+//   ct-logcbor [FILE...]        (no FILE, or "-": standard input)
+//
+// Records are decoded in order and their text lines (without colors) go
+// to standard output. Damaged data is reported on standard error and
+// skipped byte by byte until a record decodes again; a record cut short
+// at the end of a file (a crash mid-write) is reported too. Exit status:
+// 0 on success, 1 if data was skipped, 2 if a file cannot be opened.
+
+#include "logger_cbor.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace cbor = coretrace::detail::cbor;
+
+// Largest record accepted; a bad length beyond it is treated as damage
+// instead of a reason to read (and buffer) that much.
+constexpr size_t MAX_RECORD = size_t{1} << 26;
+
+// Sliding read window over a stream.
+class Reader {
+public:
+  explicit Reader(std::FILE *in) : in_(in) {}
+
+  // Make at least n bytes available at data(); false at end of input.
+  bool fill(size_t n) {
+    if (end_ - pos_ >= n)
+      return true;
+    if (pos_ != 0) {
+      std::memmove(buf_.data(), buf_.data() + pos_, end_ - pos_);
+      end_ -= pos_;
+      pos_ = 0;
+    }
+    if (buf_.size() < n)
+      buf_.resize(n < 1 << 16 ? 1 << 16 : n);
+    while (end_ < n) {
+      const size_t got =
+          std::fread(buf_.data() + end_, 1, buf_.size() - end_, in_);
+      if (got == 0)
+        return false;
+      end_ += got;
+    }
+    return true;
+  }
+
+  [[nodiscard]] const char *data() const { return buf_.data() + pos_; }
+  [[nodiscard]] size_t available() const { return end_ - pos_; }
+  [[nodiscard]] unsigned long long offset() const { return consumed_; }
+
+  void skip(size_t n) {
+    pos_ += n;
+    consumed_ += n;
+  }
+
+private:
+  std::FILE *in_;
+  std::vector<char> buf_;
+  size_t pos_ = 0;
+  size_t end_ = 0;
+  unsigned long long consumed_ = 0;
+};
+
+// Returns false if damaged data was skipped.
+bool decode(std::FILE *in, const char *name) {
+  Reader reader(in);
+  cbor::TextDecoder decoder;
+  std::string text;
+  bool clean = true;
+  bool skipping = false; // one report per damaged stretch
+  size_t want = 1;
+
+  while (reader.fill(want)) {
+    size_t consumed = 0;
+    text.clear();
+    const cbor::TextDecoder::Result result =
+        decoder.next(reader.data(), reader.available(), consumed, text);
+
+    if (result == cbor::TextDecoder::Result::Item) {
+      std::fwrite(text.data(), 1, text.size(), stdout);
+      reader.skip(consumed);
+      skipping = false;
+      want = 1;
+      continue;
+    }
+    if (result == cbor::TextDecoder::Result::NeedMore &&
+        reader.available() < MAX_RECORD) {
+      want = reader.available() * 2;
+      continue;
+    }
+
+    if (!skipping)
+      std::fprintf(stderr,
+                   "ct-logcbor: %s: malformed record at offset %llu, "
+                   "skipping\n",
+                   name, reader.offset());
+    clean = false;
+    skipping = true;
+    reader.skip(1);
+    want = 1;
+  }
+
+  if (reader.available() > 0) {
+    std::fprintf(stderr, "ct-logcbor: %s: truncated record at offset %llu\n",
+                 name, reader.offset());
+    clean = false;
+  }
+  return clean;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2)
+    return decode(stdin, "<stdin>") ? 0 : 1;
+
+  int status = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-") == 0) {
+      if (!decode(stdin, "<stdin>") && status == 0)
+        status = 1;
+      continue;
+    }
+
+    std::FILE *in = std::fopen(argv[i], "rb");
+    if (!in) {
+      std::fprintf(stderr, "ct-logcbor: cannot open %s\n", argv[i]);
+      status = 2;
+      continue;
+    }
+    if (!decode(in, argv[i]) && status == 0)
+      status = 1;
+    std::fclose(in);
+  }
+
+  std::fflush(stdout);
+  return status;
+}
@@ -0,0 +1,223 @@
+// ct-logmerge: merge the per-thread shards of set_sharded_sink() into one
+// chronological stream.
+//
+//   ct-logmerge [-k] SHARD...      e.g. ct-logmerge /var/log/app.*.log
+//
+// Every shard record starts with "@<20-digit ns> <seq> "; lines without
+// that header continue the record before them. Shards are mapped and
+// k-way merged on (timestamp, shard, seq); the output drops the headers
+// unless -k is given. Exit status: 0 on success, 2 if a shard cannot be
+// read.
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr size_t STAMP_DIGITS = 20;
+
+// Read-only view of a whole file: mapped where possible.
+class FileView {
+public:
+  FileView() = default;
+  FileView(const FileView &) = delete;
+  FileView &operator=(const FileView &) = delete;
+
+  ~FileView() {
+#if !defined(_WIN32)
+    if (map_)
+      munmap(map_, size_);
+#endif
+  }
+
+  bool open(const char *path) {
+#if defined(_WIN32)
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+      return false;
+    copy_.assign(std::istreambuf_iterator<char>(in),
+                 std::istreambuf_iterator<char>());
+    data_ = copy_.data();
+    size_ = copy_.size();
+    return true;
+#else
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    if (ok && st.st_size > 0) {
+      size_ = static_cast<size_t>(st.st_size);
+      map_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      ok = map_ != MAP_FAILED;
+      if (ok) {
+        data_ = static_cast<const char *>(map_);
+        (void)madvise(map_, size_, MADV_SEQUENTIAL);
+      } else {
+        map_ = nullptr;
+      }
+    }
+    ::close(fd);
+    return ok;
+#endif
+  }
+
+  [[nodiscard]] std::string_view view() const { return {data_, size_}; }
+
+private:
+  const char *data_ = "";
+  size_t size_ = 0;
+#if defined(_WIN32)
+  std::string copy_;
+#else
+  void *map_ = nullptr;
+#endif
+};
+
+struct Header {
+  unsigned long long stamp = 0;
+  unsigned long long seq = 0;
+  size_t size = 0; // header bytes, including the trailing space
+};
+
+// Parse "@<20 digits> <digits> " at the start of line.
+bool parse_header(std::string_view line, Header &out) {
+  if (line.size() < STAMP_DIGITS + 4 || line[0] != '@' ||
+      line[STAMP_DIGITS + 1] != ' ')
+    return false;
+
+  out.stamp = 0;
+  for (size_t i = 1; i <= STAMP_DIGITS; ++i) {
+    if (line[i] < '0' || line[i] > '9')
+      return false;
+    out.stamp = out.stamp * 10 + static_cast<unsigned>(line[i] - '0');
+  }
+
+  size_t pos = STAMP_DIGITS + 2;
+  out.seq = 0;
+  const size_t seq_start = pos;
+  while (pos < line.size() && line[pos] >= '0' && line[pos] <= '9')
+    out.seq = out.seq * 10 + static_cast<unsigned>(line[pos++] - '0');
+  if (pos == seq_start || pos == line.size() || line[pos] != ' ')
+    return false;
+
+  out.size = pos + 1;
+  return true;
+}
+
+// Walks the records of one shard.
+struct Cursor {
+  std::string_view data;
+  size_t pos = 0;
+
+  // Current record: data[start, end) with its parsed header.
+  Header header;
+  size_t start = 0;
+  size_t end = 0;
+
+  [[nodiscard]] size_t line_end(size_t from) const {
+    const size_t nl = data.find('\n', from);
+    return nl == std::string_view::npos ? data.size() : nl + 1;
+  }
+
+  // Load the next record. Returns false at the end of the shard.
+  bool next() {
+    if (pos >= data.size())
+      return false;
+
+    start = pos;
+    if (!parse_header(data.substr(pos), header))
+      header = {}; // text before the first header sorts first
+    end = line_end(pos);
+
+    // Continuation lines belong to this record.
+    Header ignored;
+    while (end < data.size() && !parse_header(data.substr(end), ignored))
+      end = line_end(end);
+
+    pos = end;
+    return true;
+  }
+};
+
+struct Pending {
+  unsigned long long stamp;
+  size_t shard;
+  unsigned long long seq;
+
+  bool operator>(const Pending &other) const {
+    if (stamp != other.stamp)
+      return stamp > other.stamp;
+    if (shard != other.shard)
+      return shard > other.shard;
+    return seq > other.seq;
+  }
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  bool keep_headers = false;
+  std::vector<const char *> paths;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-k") == 0)
+      keep_headers = true;
+    else
+      paths.push_back(argv[i]);
+  }
+
+  if (paths.empty()) {
+    std::fprintf(stderr, "usage: ct-logmerge [-k] SHARD...\n");
+    return 2;
+  }
+
+  std::vector<FileView> files(paths.size());
+  std::vector<Cursor> cursors(paths.size());
+  int status = 0;
+  std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>>
+      queue;
+
+  for (size_t i = 0; i < paths.size(); ++i) {
+    if (!files[i].open(paths[i])) {
+      std::fprintf(stderr, "ct-logmerge: cannot read %s\n", paths[i]);
+      status = 2;
+      continue;
+    }
+    cursors[i].data = files[i].view();
+    if (cursors[i].next())
+      queue.push({cursors[i].header.stamp, i, cursors[i].header.seq});
+  }
+
+  while (!queue.empty()) {
+    const size_t i = queue.top().shard;
+    queue.pop();
+
+    Cursor &cursor = cursors[i];
+    const size_t skip = keep_headers ? 0 : cursor.header.size;
+    const std::string_view record =
+        cursor.data.substr(cursor.start + skip, cursor.end - cursor.start -
+                                                    skip);
+    std::fwrite(record.data(), 1, record.size(), stdout);
+
+    if (cursor.next())
+      queue.push({cursor.header.stamp, i, cursor.header.seq});
+  }
+
+  std::fflush(stdout);
+  return status;
+}
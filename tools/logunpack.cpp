@@ -0,0 +1,159 @@
+// ct-logunpack: decompress files written with FileSinkOptions::compress.
+//
+//   ct-logunpack [FILE...]      (no FILE, or "-": standard input)
+//
+// Frames are decoded in order and the text goes to standard output.
+// Damaged data (bad header, checksum mismatch, a frame cut short by a
+// crash) is reported on standard error and skipped up to the next frame.
+// Exit status: 0 on success, 1 if data was skipped, 2 if a file cannot be
+// opened.
+
+#include "logger_lz.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+namespace lz = coretrace::detail::lz;
+
+// Sliding read window over a stream.
+class Reader {
+public:
+  explicit Reader(std::FILE *in) : in_(in) {}
+
+  // Make at least n bytes available at data(); false at end of input.
+  bool fill(size_t n) {
+    if (end_ - pos_ >= n)
+      return true;
+    if (pos_ != 0) {
+      std::memmove(buf_.data(), buf_.data() + pos_, end_ - pos_);
+      end_ -= pos_;
+      pos_ = 0;
+    }
+    if (buf_.size() < n)
+      buf_.resize(n < 1 << 16 ? 1 << 16 : n);
+    while (end_ < n) {
+      const size_t got =
+          std::fread(buf_.data() + end_, 1, buf_.size() - end_, in_);
+      if (got == 0)
+        return false;
+      end_ += got;
+    }
+    return true;
+  }
+
+  [[nodiscard]] const char *data() const { return buf_.data() + pos_; }
+  [[nodiscard]] size_t available() const { return end_ - pos_; }
+  [[nodiscard]] unsigned long long offset() const { return consumed_; }
+
+  void skip(size_t n) {
+    pos_ += n;
+    consumed_ += n;
+  }
+
+private:
+  std::FILE *in_;
+  std::vector<char> buf_;
+  size_t pos_ = 0;
+  size_t end_ = 0;
+  unsigned long long consumed_ = 0;
+};
+
+// Skip to the next frame magic (or the end of input).
+void resync(Reader &reader) {
+  reader.skip(1);
+  while (reader.fill(sizeof(lz::FRAME_MAGIC))) {
+    const char *p = reader.data();
+    const size_t n = reader.available() - sizeof(lz::FRAME_MAGIC) + 1;
+    for (size_t i = 0; i < n; ++i) {
+      if (std::memcmp(p + i, lz::FRAME_MAGIC, sizeof(lz::FRAME_MAGIC)) == 0) {
+        reader.skip(i);
+        return;
+      }
+    }
+    reader.skip(n);
+  }
+  reader.skip(reader.available());
+}
+
+// Returns false if damaged data was skipped.
+bool unpack(std::FILE *in, const char *name) {
+  Reader reader(in);
+  std::vector<char> raw;
+  bool clean = true;
+
+  while (reader.fill(1)) {
+    const unsigned long long at = reader.offset();
+    const char *problem = nullptr;
+
+    lz::FrameHeader header;
+    if (!reader.fill(lz::FRAME_HEADER_SIZE)) {
+      problem = "truncated frame header";
+    } else if (!lz::read_frame_header(reader.data(), header) ||
+               header.raw_size > lz::MAX_BLOCK_SIZE ||
+               header.payload_size > header.raw_size) {
+      problem = "not a frame";
+    } else if (!reader.fill(lz::FRAME_HEADER_SIZE + header.payload_size)) {
+      problem = "truncated frame";
+    } else {
+      const char *payload = reader.data() + lz::FRAME_HEADER_SIZE;
+      raw.resize(header.raw_size);
+      bool ok;
+      if (header.payload_size == header.raw_size) {
+        std::memcpy(raw.data(), payload, header.raw_size);
+        ok = true;
+      } else {
+        ok = lz::decompress(payload, header.payload_size, raw.data(),
+                            header.raw_size);
+      }
+
+      if (!ok) {
+        problem = "corrupt frame";
+      } else if (lz::checksum(raw.data(), raw.size()) != header.checksum) {
+        problem = "checksum mismatch";
+      } else {
+        std::fwrite(raw.data(), 1, raw.size(), stdout);
+        reader.skip(lz::FRAME_HEADER_SIZE + header.payload_size);
+        continue;
+      }
+    }
+
+    std::fprintf(stderr, "ct-logunpack: %s: %s at offset %llu, skipping\n",
+                 name, problem, at);
+    clean = false;
+    resync(reader);
+  }
+
+  return clean;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2)
+    return unpack(stdin, "<stdin>") ? 0 : 1;
+
+  int status = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-") == 0) {
+      if (!unpack(stdin, "<stdin>") && status == 0)
+        status = 1;
+      continue;
+    }
+
+    std::FILE *in = std::fopen(argv[i], "rb");
+    if (!in) {
+      std::fprintf(stderr, "ct-logunpack: cannot open %s\n", argv[i]);
+      status = 2;
+      continue;
+    }
+    if (!unpack(in, argv[i]) && status == 0)
+      status = 1;
+    std::fclose(in);
+  }
+
+  std::fflush(stdout);
+  return status;
+}